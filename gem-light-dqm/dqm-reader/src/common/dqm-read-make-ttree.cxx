@@ -7,6 +7,7 @@
 #include <sstream>
 #include <vector>
 #include <cstdint>
+#include <cstdlib>
 
 #include <TFile.h>
 #include <TNtuple.h>
@@ -30,6 +31,8 @@
 #include "TMath.h"
 
 #include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMRawFileMap.h"
+#include "gem/readout/GEMRawFileIndex.h"
 
 using namespace std;
 
@@ -54,13 +57,22 @@ TFile* thldread(Int_t get=0)
   TApplication App("App", &argc, argv);
 #endif
  
-  gem::readout::GEBData   geb;
-  gem::readout::VFATData vfat;
+  gem::readout::GEBData   gebPrint;
+  gem::readout::VFATData vfatPrint;
 
+  // optional arguments: file, first event and number of events
   string file="GEMDQMRawData.dat";
+  uint64_t firstEvent = 0;
+  uint64_t nEvents    = 0;
+#ifndef __CINT__
+  if (App.Argc() > 1) file = App.Argv(1);
+  if (App.Argc() > 2) firstEvent = strtoull(App.Argv(2),0,0);
+  if (App.Argc() > 3) nEvents    = strtoull(App.Argv(3),0,0);
+#endif
 
-  ifstream inpf(file.c_str());
-  if(!inpf.is_open()) {
+  // the chambers are read in place from the mapped file, compressed files are decompressed on the fly
+  gem::readout::RawFileMap rawf(file);
+  if(!rawf.isOpen()) {
     cout << "\nThe file: " << file.c_str() << " is missing.\n" << endl;
     return 0;
   };
@@ -85,56 +97,67 @@ TFile* thldread(Int_t get=0)
   bool OKpri = false;
 
 
-  for(int ievent=0; ievent<ieventMax; ievent++){
+  gem::readout::RawFileMap::iterator iGEB = rawf.begin();
+  if (firstEvent) {
+    // jump to the first event through the sidecar index, built on the first use
+    gem::readout::RawFileIndex index;
+    if (!index.open(file)) {
+      cout << "\nThe file: " << file.c_str() << " could not be indexed.\n" << endl;
+      return 0;
+    }
+    iGEB = index.seek(rawf, index.findEvent(firstEvent));
+  }
+
+  for(int ievent=0; ievent<ieventMax && iGEB != rawf.end(); ievent++, ++iGEB){
+    if (nEvents && iGEB->event() >= firstEvent + nEvents) break;
     OKpri = OKprint(ievent,ieventPrint);
-    if(inpf.eof()) break;
-    if(!inpf.good()) break;
 
     if(OKpri) cout << "\nievent " << ievent << endl;
 
-    // read Event Chamber Header 
-    gem::readout::readGEBheader(inpf, geb);
-    if(OKpri) gem::readout::printGEBheader(ievent,geb);
+    // Event Chamber Header 
+    gem::readout::GEBView const& geb = *iGEB;
+    if(OKpri){
+      geb.get(gebPrint);
+      gem::readout::printGEBheader(ievent,gebPrint);
+    }
 
-    uint64_t ZSFlag  = (0xffffff0000000000 & geb.header) >> 40; 
-    uint64_t ChamID  = (0x000000fff0000000 & geb.header) >> 28; 
-    uint64_t sumVFAT = (0x000000000fffffff & geb.header);
+    uint64_t ZSFlag  = gem::readout::GEB::ZSFlag::get(geb.header()); 
+    uint64_t ChamID  = gem::readout::GEB::ChamID::get(geb.header()); 
+    uint64_t sumVFAT = gem::readout::GEB::SumVFAT::get(geb.header());
 
-    for(int ivfat=0; ivfat<sumVFAT; ivfat++){
+    for(gem::readout::GEBView::const_iterator vfat = geb.begin(); vfat != geb.end(); ++vfat){
      /*
       *  GEM Event Reading
       */
-      gem::readout::readVFATdata(inpf, ievent, vfat);
-  
-      uint8_t   b1010  = (0xf000 & vfat.BC) >> 12;
-      uint8_t   b1100  = (0xf000 & vfat.EC) >> 12;
-      uint8_t   Flag   = (0x000f & vfat.EC);
-      uint8_t   b1110  = (0xf000 & vfat.ChipID) >> 12;
-      uint16_t  ChipID = (0x0fff & vfat.ChipID);
-      uint16_t  CRC    = vfat.crc;
-
-      uint16_t  BC     = (0x0fff & vfat.BC);
-      uint8_t   EC     = (0x0fff & vfat.EC) >> 4;
-      uint64_t  lsData = vfat.lsData;
-      uint64_t  msData = vfat.lsData;
-
-      if ( (b1010 == 0xa) && (b1100==0xc) && (b1110==0xe) ){
+      uint8_t   b1010  = gem::readout::VFAT::B1010::get(vfat->BC());
+      uint8_t   b1100  = gem::readout::VFAT::B1100::get(vfat->EC());
+      uint8_t   Flag   = gem::readout::VFAT::Flag::get(vfat->EC());
+      uint8_t   b1110  = gem::readout::VFAT::B1110::get(vfat->ChipID());
+      uint16_t  ChipID = gem::readout::VFAT::ChipID::get(vfat->ChipID());
+      uint16_t  CRC    = vfat->crc();
+
+      uint16_t  BC     = gem::readout::VFAT::BC::get(vfat->BC());
+      uint8_t   EC     = gem::readout::VFAT::EC::get(vfat->EC());
+      uint64_t  lsData = vfat->lsData();
+      uint64_t  msData = vfat->msData();
+
+      if (gem::readout::VFAT::controlBitsOK(vfat->BC(), vfat->EC(), vfat->ChipID())){
         if(OKpri){
-          gem::readout::printVFATdataBits(ievent, vfat);
+          vfat->get(vfatPrint);
+          gem::readout::printVFATdataBits(ievent, vfatPrint);
         }
       }// if 1010,1100,1110, ChipID
 
     }//end ivfat
 
-    // read Event Chamber Header 
-    gem::readout::readGEBtrailer(inpf, geb);
-    if(OKpri) gem::readout::printGEBtrailer(ievent, geb);
+    // Event Chamber Trailer 
+    if(OKpri) gem::readout::printGEBtrailer(ievent, gebPrint);
 
-    uint64_t OHcrc      = (0xffff000000000000 & geb.trailer) >> 48; 
-    uint64_t OHwCount   = (0x0000ffff00000000 & geb.trailer) >> 32; 
-    uint64_t ChamStatus = (0x00000000ffff0000 & geb.trailer) >> 16;
+    uint64_t OHcrc      = gem::readout::GEB::OHcrc::get(geb.trailer()); 
+    uint64_t OHwCount   = gem::readout::GEB::OHwCount::get(geb.trailer()); 
+    uint64_t ChamStatus = gem::readout::GEB::ChamStatus::get(geb.trailer());
 
-    uint16_t GEBres     = (0x000000000000ffff & geb.trailer);
+    uint16_t GEBres     = gem::readout::GEB::GEBres::get(geb.trailer());
 
     if(OKpri){
       cout << "GEM Camber Treiler: OHcrc " << hex << OHcrc << " OHwCount " << OHwCount << " ChamStatus " << ChamStatus << dec 
@@ -147,7 +170,6 @@ TFile* thldread(Int_t get=0)
     }
     if(OKpri) cout<<"ievent "<< ievent <<endl;
   }// end GEB event
-  inpf.close();
 
   // Save all objects in this file
   hfile->Write();
@@ -0,0 +1,110 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <cstdlib>
+#include <cstdint>
+
+#include "gem/readout/GEMRawFileIndex.h"
+
+/**
+* GEM raw file indexer (gemRawIndex): writes the sidecar event index of a raw data file
+*/
+
+/*! \file */
+/*!
+  \mainpage GEM raw file indexer.
+
+  Scans a "Hex" or "Bin" raw data file, compressed or not, once and writes its event index next
+  to it as <file>.idx, see gem/readout/GEMRawFileIndex.h. The DQM tools then start at any event
+  of the file without reading what comes before it.
+
+  ./bin/gemRawIndex GEMDQMRawData.dat [nRanges]
+
+  With nRanges the events are split in that many ranges of about the same size, each range is
+  read back in its own thread to check the index, and the ranges are printed so they can be
+  handed to as many DQM jobs:
+  ./bin/gtc GEMDQMRawData.dat part0.root <firstEvent> <nEvents>
+*/
+
+using namespace std;
+
+struct RangeCheck {
+  uint64_t nChambers;
+  uint64_t nVFATs;
+  uint64_t nBadCRC;
+  bool ok;
+};
+
+//! read the chambers of a range of events, checking they are where the index says
+void checkRange(string const& file, gem::readout::RawFileIndex const& index,
+                gem::readout::RawFileIndex::Range const& range, RangeCheck* check)
+{
+  check->nChambers = check->nVFATs = check->nBadCRC = 0;
+  check->ok = true;
+
+  gem::readout::RawFileMap rawf(file);
+  size_t chamber = index.getEvent(range.first).firstChamber;
+  size_t lastChamber = index.getEvent(range.second-1).firstChamber + index.getEvent(range.second-1).nChambers;
+  gem::readout::RawFileMap::iterator iGEB = index.seek(rawf, range.first);
+  for (; chamber < lastChamber; ++chamber, ++iGEB) {
+    if (iGEB == rawf.end() || rawf.getChamberOffset() != index.getChamber(chamber).offset) {
+      check->ok = false;
+      return;
+    }
+    ++check->nChambers;
+    for (gem::readout::GEBView::const_iterator vfat = iGEB->begin(); vfat != iGEB->end(); ++vfat) {
+      ++check->nVFATs;
+      if (vfat->crc() != gem::readout::vfatCRC(*vfat))
+        ++check->nBadCRC;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    cout << "Usage: <path>/gemRawIndex inputFile.dat [nRanges]" << endl;
+    return 1;
+  }
+  string file = argv[1];
+  unsigned nRanges = (argc > 2) ? strtoul(argv[2], 0, 0) : 0;
+
+  gem::readout::RawFileIndex index;
+  if (!index.build(file)) {
+    cout << "\nThe file: " << file << " is missing.\n" << endl;
+    return 1;
+  }
+  string indexName = gem::readout::RawIndex::sidecarName(file);
+  if (!index.write(indexName)) {
+    cout << "Could not write the index " << indexName << endl;
+    return 1;
+  }
+
+  gem::readout::RawIndex::FileHeader const& header = index.getHeader();
+  cout << file << ": " << (header.format == gem::readout::RawFileMap::FORMAT_BIN ? "Bin" : "Hex")
+       << (header.compressed ? " compressed" : "") << ", " << index.getEvents() << " events, "
+       << index.getChambers() << " chambers, index written to " << indexName << endl;
+  if (!nRanges || !index.getEvents())
+    return 0;
+
+  vector<gem::readout::RawFileIndex::Range> ranges;
+  index.split(0, index.getEvents(), nRanges, ranges);
+  vector<RangeCheck> checks(ranges.size());
+  vector<thread> threads;
+  for (size_t i = 0; i < ranges.size(); ++i)
+    threads.push_back(thread(checkRange, file, std::cref(index), ranges[i], &checks[i]));
+
+  bool ok = true;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    threads[i].join();
+    uint64_t firstEvent = index.getEvent(ranges[i].first).event;
+    uint64_t lastEvent  = index.getEvent(ranges[i].second-1).event;
+    cout << "range " << i << ": firstEvent " << firstEvent << " nEvents " << (lastEvent - firstEvent + 1)
+         << ", " << checks[i].nChambers << " chambers, " << checks[i].nVFATs << " VFAT blocks, "
+         << checks[i].nBadCRC << " bad CRC" << (checks[i].ok ? "" : ", DOES NOT MATCH THE INDEX") << endl;
+    ok = ok && checks[i].ok;
+  }
+  return ok ? 0 : 1;
+}
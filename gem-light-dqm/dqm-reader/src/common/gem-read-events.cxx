@@ -7,6 +7,7 @@
 #include <sstream>
 #include <vector>
 #include <cstdint>
+#include <cstdlib>
 
 #include <TFile.h>
 #include <TNtuple.h>
@@ -25,7 +26,10 @@
 #include <TApplication.h>
 
 #include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMDataCRC.h"
 #include "gem/datachecker/GEMDataChecker.h"
+#include "gem/readout/GEMRawFileMap.h"
+#include "gem/readout/GEMRawFileIndex.h"
 
 /**
 * ... Threshold Scan ROOT based application, could be used for analisys of XDAQ GEM data ...
@@ -66,37 +70,6 @@ using namespace std;
   \author Sergey.Baranov@cern.ch
 */
 
-/*
- *  CRC ******************************************************************
- */
-      uint16_t dataVFAT[11];
-
-      uint16_t crc_calc(uint16_t crc_in, uint16_t dato){
-      uint16_t v = 0x0001;
-      uint16_t mask = 0x0001;    
-      bool d=0;
-      uint16_t crc_temp = crc_in;
-      unsigned char datalen = 16;
-       
-      for (int i=0; i<datalen; i++){
-        if (dato & v) d = 1;
-        else d = 0;
-        if ((crc_temp & mask)^d) crc_temp = crc_temp>>1 ^ 0x8408;
-        else crc_temp = crc_temp>>1;
-        v<<=1;
-      }
-      return(crc_temp);
-    }
-
-    // unsigned short int 
-    uint16_t checkCRC(){
-      uint16_t crc_fin = 0xffff;
-      for (int i = 11; i >= 1; i--){
-        crc_fin = crc_calc(crc_fin, dataVFAT[i]);
-      }
-      return(crc_fin);
-    }
-
     // Ok printing
     bool OKprint(int ievent, int iMaxPrint ){
       if( ievent <= iMaxPrint ){
@@ -129,13 +102,22 @@ TFile* thldread(Int_t get=0)
   TApplication App("App", &argc, argv);
 #endif
  
-  gem::readout::GEBData   geb;
-  gem::readout::VFATData vfat;
+  gem::readout::GEBData   gebPrint;
+  gem::readout::VFATData vfatPrint;
 
+  // optional arguments: file, first event and number of events
   string file="GEMDQMRawData.dat";
+  uint64_t firstEvent = 0;
+  uint64_t nEvents    = 0;
+#ifndef __CINT__
+  if (App.Argc() > 1) file = App.Argv(1);
+  if (App.Argc() > 2) firstEvent = strtoull(App.Argv(2),0,0);
+  if (App.Argc() > 3) nEvents    = strtoull(App.Argv(3),0,0);
+#endif
 
-  ifstream inpf(file.c_str());
-  if(!inpf.is_open()) {
+  // the chambers are read in place from the mapped file, compressed files are decompressed on the fly
+  gem::readout::RawFileMap rawf(file);
+  if(!rawf.isOpen()) {
     cout << "\nThe file: " << file.c_str() << " is missing.\n" << endl;
     return 0;
   };
@@ -252,55 +234,53 @@ TFile* thldread(Int_t get=0)
   const Int_t kUPDATE     = 25;
   bool  OKpri = false;
 
-  for(int ievent=0; ievent<ieventMax; ievent++){
+  gem::readout::RawFileMap::iterator iGEB = rawf.begin();
+  if (firstEvent) {
+    // jump to the first event through the sidecar index, built on the first use
+    gem::readout::RawFileIndex index;
+    if (!index.open(file)) {
+      cout << "\nThe file: " << file.c_str() << " could not be indexed.\n" << endl;
+      return 0;
+    }
+    iGEB = index.seek(rawf, index.findEvent(firstEvent));
+  }
+
+  for(int ievent=0; ievent<ieventMax && iGEB != rawf.end(); ievent++, ++iGEB){
+    if (nEvents && iGEB->event() >= firstEvent + nEvents) break;
     OKpri = OKprint(ievent,ieventPrint);
-    if(inpf.eof()) break;
-    if(!inpf.good()) break;
 
     if(OKpri) cout << "\nievent " << ievent << endl;
 
-    // read Event Chamber Header
-    gem::readout::readGEBheader(inpf, geb);
+    // Event Chamber Header
+    gem::readout::GEBView const& geb = *iGEB;
     //if(OKpri) gem::readout::printGEBheader(ievent,geb);
 
-    uint64_t ZSFlag  = (0xffffff0000000000 & geb.header) >> 40; 
-    uint64_t ChamID  = (0x000000fff0000000 & geb.header) >> 28; 
-    uint64_t sumVFAT = (0x000000000fffffff & geb.header);
+    uint64_t ZSFlag  = gem::readout::GEB::ZSFlag::get(geb.header()); 
+    uint64_t ChamID  = gem::readout::GEB::ChamID::get(geb.header()); 
+    uint64_t sumVFAT = gem::readout::GEB::SumVFAT::get(geb.header());
 
     int iSumVFAT = 0;
     int ifake = 0;
-    for(int ivfat=0; ivfat<sumVFAT; ivfat++){
+    for(gem::readout::GEBView::const_iterator vfat = geb.begin(); vfat != geb.end(); ++vfat){
       iSumVFAT++;
 
      /*
       *  GEM Event Reading
       */
-      gem::readout::readVFATdata(inpf, ievent, vfat);
-  
-      uint8_t   b1010  = (0xf000 & vfat.BC) >> 12;
-      uint8_t   b1100  = (0xf000 & vfat.EC) >> 12;
-      uint8_t   Flag   = (0x000f & vfat.EC);
-      uint8_t   b1110  = (0xf000 & vfat.ChipID) >> 12;
-      uint16_t  ChipID = (0x0fff & vfat.ChipID);
-      uint16_t  CRC    = vfat.crc;
-      uint16_t  BX     = vfat.BXfrOH;  
+      uint8_t   b1010  = gem::readout::VFAT::B1010::get(vfat->BC());
+      uint8_t   b1100  = gem::readout::VFAT::B1100::get(vfat->EC());
+      uint8_t   Flag   = gem::readout::VFAT::Flag::get(vfat->EC());
+      uint8_t   b1110  = gem::readout::VFAT::B1110::get(vfat->ChipID());
+      uint16_t  ChipID = gem::readout::VFAT::ChipID::get(vfat->ChipID());
+      uint16_t  CRC    = vfat->crc();
+      uint16_t  BX     = vfat->BXfrOH();  
+      uint64_t  lsData = vfat->lsData();
+      uint64_t  msData = vfat->msData();
 
       //      if ( (b1010 == 0xa) && (b1100==0xc) && (b1110==0xe) /* && (ChipID==0x68) */ ){
 
         // CRC check
-        dataVFAT[11] = vfat.BC;
-        dataVFAT[10] = vfat.EC;
-        dataVFAT[9]  = vfat.ChipID;
-        dataVFAT[8]  = (0xffff000000000000 & vfat.msData) >> 48;
-        dataVFAT[7]  = (0x0000ffff00000000 & vfat.msData) >> 32;
-        dataVFAT[6]  = (0x00000000ffff0000 & vfat.msData) >> 16;
-        dataVFAT[5]  = (0x000000000000ffff & vfat.msData);
-        dataVFAT[4]  = (0xffff000000000000 & vfat.lsData) >> 48;
-        dataVFAT[3]  = (0x0000ffff00000000 & vfat.lsData) >> 32;
-        dataVFAT[2]  = (0x00000000ffff0000 & vfat.lsData) >> 16;
-        dataVFAT[1]  = (0x000000000000ffff & vfat.lsData);
-
-        uint16_t checkedCRC = checkCRC();
+        uint16_t checkedCRC = gem::readout::vfatCRC(*vfat);
 	/*
         if(OKpri){
            cout << " vfat.crc " << std::setfill('0') << std::setw(4) << hex << CRC 
@@ -325,19 +305,20 @@ TFile* thldread(Int_t get=0)
         uint8_t chan0xf = 0;
         for (int chan = 0; chan < 128; ++chan) {
           if (chan < 64){
-            chan0xf = ((vfat.lsData >> chan) & 0x1);
+            chan0xf = ((lsData >> chan) & 0x1);
             histos[chan]->Fill(chan0xf);
           if(!chan0xf) hiCh128->Fill(chan);
     	  } else {
-            chan0xf = ((vfat.msData >> (chan-64)) & 0x1);
+            chan0xf = ((msData >> (chan-64)) & 0x1);
       	    histos[chan]->Fill(chan0xf);
     	  if(!chan0xf) hiCh128->Fill(chan);
           }
         }
     
         if(OKpri){
-          gem::readout::printVFATdataBits(ievent, vfat);
-          //gem::readout::printVFATdata(ievent, vfat);
+          vfat->get(vfatPrint);
+          gem::readout::printVFATdataBits(ievent, vfatPrint);
+          //gem::readout::printVFATdata(ievent, vfatPrint);
         }
 
      /*
@@ -351,13 +332,15 @@ TFile* thldread(Int_t get=0)
 
     hiFake->Fill(ifake);
 
-    // read Event Chamber Header 
-    gem::readout::readGEBtrailer(inpf, geb);
-    if(OKpri) gem::readout::printGEBtrailer(ievent, geb);
+    // Event Chamber Trailer 
+    if(OKpri){
+      geb.get(gebPrint);
+      gem::readout::printGEBtrailer(ievent, gebPrint);
+    }
 
-    uint64_t OHcrc      = (0xffff000000000000 & geb.trailer) >> 48; 
-    uint64_t OHwCount   = (0x0000ffff00000000 & geb.trailer) >> 32; 
-    uint64_t ChamStatus = (0x00000000ffff0000 & geb.trailer) >> 16;
+    uint64_t OHcrc      = gem::readout::GEB::OHcrc::get(geb.trailer()); 
+    uint64_t OHwCount   = gem::readout::GEB::OHwCount::get(geb.trailer()); 
+    uint64_t ChamStatus = gem::readout::GEB::ChamStatus::get(geb.trailer());
 
     if (ievent%kUPDATE == 0 && ievent != 0) {
       c1->cd(1)->SetLogy(); hiVFAT->Draw();
@@ -382,7 +365,6 @@ TFile* thldread(Int_t get=0)
     hiVFAT->Fill(iSumVFAT);
    
   } // End ievent
-  inpf.close();
 
   // Save all objects in this file
   hfile->Write();
@@ -85,6 +85,8 @@ int main(int argc, char** argv)
     //
     Int_t nVFAT = 0;
     Int_t ifake = 0;
+    // one checker for the whole file
+    dataChecker dc;
     // loop over tree entries
     for (Int_t i = 0; i < nentries; i++)
     {
@@ -118,31 +120,22 @@ int main(int argc, char** argv)
                         hiChip->Fill(v_vfat.at(k).ChipID());
                         // calculate and fill the crc and crc_diff
                         hiCRC->Fill(v_vfat.at(k).crc());
-                        uint16_t dataVFAT[11];
                         // CRC check
-                        uint16_t b1010 = (0x000f & v_vfat.at(k).b1010());
-                        uint16_t b1100 = (0x000f & v_vfat.at(k).b1100());
-                        uint16_t b1110 = (0x000f & v_vfat.at(k).b1110());
-                        uint16_t flag = (0x000f & v_vfat.at(k).Flag());
-                        uint16_t ec = (0x00ff & v_vfat.at(k).EC());
-                        dataVFAT[11] = (0xf000 & (b1010 << 12)) | (0x0fff & v_vfat.at(k).BC());
-                        dataVFAT[10] = ((0xf000 & (b1100 << 12)) | (0x0ff0 & (ec << 4))) | (0x000f & flag);
-                        dataVFAT[9]  = (0xf000 & (b1110 << 12)) | (0x0fff & v_vfat.at(k).ChipID());
-                        dataVFAT[8]  = (0xffff000000000000 & v_vfat.at(k).msData()) >> 48;
-                        dataVFAT[7]  = (0x0000ffff00000000 & v_vfat.at(k).msData()) >> 32;
-                        dataVFAT[6]  = (0x00000000ffff0000 & v_vfat.at(k).msData()) >> 16;
-                        dataVFAT[5]  = (0x000000000000ffff & v_vfat.at(k).msData());
-                        dataVFAT[4]  = (0xffff000000000000 & v_vfat.at(k).lsData()) >> 48;
-                        dataVFAT[3]  = (0x0000ffff00000000 & v_vfat.at(k).lsData()) >> 32;
-                        dataVFAT[2]  = (0x00000000ffff0000 & v_vfat.at(k).lsData()) >> 16;
-                        dataVFAT[1]  = (0x000000000000ffff & v_vfat.at(k).lsData());
-                        dataChecker *dc = new dataChecker();
-                        uint16_t checkedCRC = dc->checkCRC(dataVFAT, 0);
+                        gem::readout::VFATData vfat;
+                        vfat.BC     = gem::readout::VFAT::B1010::pack(v_vfat.at(k).b1010()) |
+                                      gem::readout::VFAT::BC::pack(v_vfat.at(k).BC());
+                        vfat.EC     = gem::readout::VFAT::B1100::pack(v_vfat.at(k).b1100()) |
+                                      gem::readout::VFAT::EC::pack(v_vfat.at(k).EC()) |
+                                      gem::readout::VFAT::Flag::pack(v_vfat.at(k).Flag());
+                        vfat.ChipID = gem::readout::VFAT::B1110::pack(v_vfat.at(k).b1110()) |
+                                      gem::readout::VFAT::ChipID::pack(v_vfat.at(k).ChipID());
+                        vfat.msData = v_vfat.at(k).msData();
+                        vfat.lsData = v_vfat.at(k).lsData();
+                        uint16_t checkedCRC = dc.checkCRC(vfat);
                         std::cout << "read  crc            " << std::hex << v_vfat.at(k).crc() << std::endl;
                         std::cout << "check crc            " << std::hex << checkedCRC << std::endl;
                         hiDiffCRC->Fill(v_vfat.at(k).crc()-checkedCRC);
                         hi2DCRC->Fill(v_vfat.at(k).crc(), checkedCRC);
-                        delete dc;
                         //I think it would be nice to time this...
                         uint16_t chan0xf = 0;
                         for (int chan = 0; chan < 128; ++chan) {
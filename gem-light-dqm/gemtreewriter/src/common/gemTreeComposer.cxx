@@ -6,6 +6,7 @@
 #include <sstream>
 #include <vector>
 #include <cstdint>
+#include <cstdlib>
 
 #include <TFile.h>
 #include <TNtuple.h>
@@ -27,6 +28,9 @@
 #endif
 
 #include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMDataCRC.h"
+#include "gem/readout/GEMRawFileMap.h"
+#include "gem/readout/GEMRawFileIndex.h"
 
 /**
 * GEM Tree Composer (gtc) application provides translation of the GEM output HEX file to ROOT-based TTree with GEM Events
@@ -56,6 +60,10 @@
   Then run the executable providing input and output filenames:
   ./bin/gtc GEMDQMRawData.dat outputROOTtree.root
 
+  To convert only part of the run give the first event and the number of events, the file is
+  then opened at the first event through its index, see dqm-reader bin/gemRawIndex:
+  ./bin/gtc GEMDQMRawData.dat outputROOTtree.root 250000 10000
+
   You can download sample HEX-ASCII data file:
   wget https://baranov.web.cern.ch/baranov/xdaq/DataParker/GEM_DAQ_Tue_Jul_14_10-13-10_2015.dat
 
@@ -72,43 +80,6 @@
 
 using namespace std;
 
- /*
-  *  CRC ******************************************************************
-  */
-      uint16_t dataVFAT[11];
-
-      uint16_t crc_calc(uint16_t crc_in, uint16_t dato){
-      uint16_t v = 0x0001;
-      uint16_t mask = 0x0001;    
-      bool d=0;
-      uint16_t crc_temp = crc_in;
-      unsigned char datalen = 16;
-       
-      for (int i=0; i<datalen; i++){
-        if (dato & v) d = 1;
-        else d = 0;
-        if ((crc_temp & mask)^d) crc_temp = crc_temp>>1 ^ 0x8408;
-        else crc_temp = crc_temp>>1;
-        v<<=1;
-      }
-      return(crc_temp);
-    }
-
-    // unsigned short int 
-    uint16_t checkCRC(bool OKprint){
-      uint16_t crc_fin = 0xffff;
-      for (int i = 11; i >= 1; i--){
-        crc_fin = crc_calc(crc_fin, dataVFAT[i]);
-	/*
-	if(OKprint){
-          cout << " dataVFAT[" << std::setfill('0') << std::setw(2) << i << "] " << hex << std::setfill('0') << std::setw(4) << dataVFAT[i]
-               << " crc_temp " << std::setfill('0') << std::setw(4) << crc_fin << dec << endl;
-        }
-	*/
-      }
-      return(crc_fin);
-    }
-
 //! GEM VFAT2 Data class.
 /*!
   \brief GEMOnline
@@ -143,13 +114,16 @@ int main(int argc, char** argv)
     if (argc<3) 
     {
         cout << "Please provide input and output filenames" << endl;
-        cout << "Usage: <path>/gtc inputFile.dat outputFile.root" << endl;
+        cout << "Usage: <path>/gtc inputFile.dat outputFile.root [firstEvent [nEvents]]" << endl;
         return 0;
     }
     string ifile=argv[1];
     const TString ofile = argv[2];
-    ifstream inpf(ifile.c_str());
-    if(!inpf.is_open()) {
+    uint64_t firstEvent = (argc>3) ? strtoull(argv[3],0,0) : 0;
+    uint64_t nEvents    = (argc>4) ? strtoull(argv[4],0,0) : 0;
+    // the chambers are read in place from the mapped file, compressed files are decompressed on the fly
+    gem::readout::RawFileMap rawf(ifile);
+    if(!rawf.isOpen()) {
       cout << "\nThe file: " << ifile.c_str() << " is missing.\n" << endl;
       return 0;
     };
@@ -159,60 +133,59 @@ int main(int argc, char** argv)
     Event *ev = new Event(); 
     GEMtree.Branch("GEMEvents", &ev);
 
-    gem::readout::GEBData   geb;
-    gem::readout::VFATData vfat;
+    gem::readout::GEBData   gebPrint;
+    gem::readout::VFATData vfatPrint;
 
     const Int_t ieventPrint = 3;
     const Int_t ieventMax   = 9000000;
     const Int_t kUPDATE     = 10;
     bool OKpri = false;
 
-    for(int ievent=0; ievent<ieventMax; ievent++)
+    gem::readout::RawFileMap::iterator iGEB = rawf.begin();
+    if (firstEvent) {
+        // jump to the first event through the sidecar index, built on the first use
+        gem::readout::RawFileIndex index;
+        if (!index.open(ifile)) {
+          cout << "\nThe file: " << ifile.c_str() << " could not be indexed.\n" << endl;
+          return 0;
+        }
+        iGEB = index.seek(rawf, index.findEvent(firstEvent));
+    }
+
+    for(int ievent=0; ievent<ieventMax && iGEB != rawf.end(); ievent++, ++iGEB)
     {
+        if (nEvents && iGEB->event() >= firstEvent + nEvents) break;
         OKpri = OKprint(ievent,ieventPrint);
-        if(inpf.eof()) break;
-        if(!inpf.good()) break;
 
         cout << "Processing event " << ievent << endl;
 
-        // read Event Chamber Header 
-        gem::readout::readGEBheader(inpf, geb);
-        if(OKpri) gem::readout::printGEBheader(ievent,geb);
+        // Event Chamber Header 
+        gem::readout::GEBView const& geb = *iGEB;
+        if(OKpri){
+          geb.get(gebPrint);
+          gem::readout::printGEBheader(ievent,gebPrint);
+        }
 
-        uint32_t ZSFlag  = (0xffffff0000000000 & geb.header) >> 40; 
-        uint16_t ChamID  = (0x000000fff0000000 & geb.header) >> 28; 
-        uint32_t sumVFAT = (0x000000000fffffff & geb.header);
+        uint32_t ZSFlag  = gem::readout::GEB::ZSFlag::get(geb.header()); 
+        uint16_t ChamID  = gem::readout::GEB::ChamID::get(geb.header()); 
+        uint32_t sumVFAT = gem::readout::GEB::SumVFAT::get(geb.header());
 
         GEBdata *GEBdata_ = new GEBdata(ZSFlag, ChamID, sumVFAT);
 
-        for(int ivfat=0; ivfat<sumVFAT; ivfat++){
-            gem::readout::readVFATdata(inpf, ievent, vfat);
-
-            uint8_t   b1010  = (0xf000 & vfat.BC) >> 12;
-            uint16_t  BC     = (0x0fff & vfat.BC);
-            uint8_t   b1100  = (0xf000 & vfat.EC) >> 12;
-            uint8_t   EC     = (0x0ff0 & vfat.EC) >> 4;
-            uint8_t   Flag   = (0x000f & vfat.EC);
-            uint8_t   b1110  = (0xf000 & vfat.ChipID) >> 12;
-            uint16_t  ChipID = (0x0fff & vfat.ChipID);
-            uint16_t  CRC    = vfat.crc;
-            uint64_t lsData = vfat.lsData;
-            uint64_t msData = vfat.msData;
+        for(gem::readout::GEBView::const_iterator vfat = geb.begin(); vfat != geb.end(); ++vfat){
+            uint8_t   b1010  = gem::readout::VFAT::B1010::get(vfat->BC());
+            uint16_t  BC     = gem::readout::VFAT::BC::get(vfat->BC());
+            uint8_t   b1100  = gem::readout::VFAT::B1100::get(vfat->EC());
+            uint8_t   EC     = gem::readout::VFAT::EC::get(vfat->EC());
+            uint8_t   Flag   = gem::readout::VFAT::Flag::get(vfat->EC());
+            uint8_t   b1110  = gem::readout::VFAT::B1110::get(vfat->ChipID());
+            uint16_t  ChipID = gem::readout::VFAT::ChipID::get(vfat->ChipID());
+            uint16_t  CRC    = vfat->crc();
+            uint64_t lsData = vfat->lsData();
+            uint64_t msData = vfat->msData();
 
             // CRC check
-            dataVFAT[11] = vfat.BC;
-            dataVFAT[10] = vfat.EC;
-            dataVFAT[9]  = vfat.ChipID;
-            dataVFAT[8]  = (0xffff000000000000 & vfat.msData) >> 48;
-            dataVFAT[7]  = (0x0000ffff00000000 & vfat.msData) >> 32;
-            dataVFAT[6]  = (0x00000000ffff0000 & vfat.msData) >> 16;
-            dataVFAT[5]  = (0x000000000000ffff & vfat.msData);
-            dataVFAT[4]  = (0xffff000000000000 & vfat.lsData) >> 48;
-            dataVFAT[3]  = (0x0000ffff00000000 & vfat.lsData) >> 32;
-            dataVFAT[2]  = (0x00000000ffff0000 & vfat.lsData) >> 16;
-            dataVFAT[1]  = (0x000000000000ffff & vfat.lsData);
-    
-            uint16_t checkedCRC = checkCRC(OKpri);
+            uint16_t checkedCRC = gem::readout::vfatCRC(*vfat);
             if(OKpri){
                cout << " vfat.crc " << std::setfill('0') << std::setw(4) << hex << CRC 
                     << "     crc " << std::setfill('0') << std::setw(4) << checkedCRC << dec << "\n" << endl;
@@ -223,17 +196,16 @@ int main(int argc, char** argv)
             delete VFATdata_;
 
             if(OKpri){
-              gem::readout::printVFATdataBits(ievent, vfat);
+              vfat->get(vfatPrint);
+              gem::readout::printVFATdataBits(ievent, vfatPrint);
             }
         }
 
-        // read Event Chamber Header 
-        gem::readout::readGEBtrailer(inpf, geb);
-
-        uint16_t OHcrc      = (0xffff000000000000 & geb.trailer) >> 48; 
-        uint16_t OHwCount   = (0x0000ffff00000000 & geb.trailer) >> 32; 
-        uint16_t ChamStatus = (0x00000000ffff0000 & geb.trailer) >> 16;
-        uint16_t GEBres     = (0x000000000000ffff & geb.trailer);
+        // Event Chamber Trailer 
+        uint16_t OHcrc      = gem::readout::GEB::OHcrc::get(geb.trailer()); 
+        uint16_t OHwCount   = gem::readout::GEB::OHwCount::get(geb.trailer()); 
+        uint16_t ChamStatus = gem::readout::GEB::ChamStatus::get(geb.trailer());
+        uint16_t GEBres     = gem::readout::GEB::GEBres::get(geb.trailer());
 
         GEBdata_->setTrailer(OHcrc, OHwCount, ChamStatus, GEBres);
 
@@ -249,7 +221,6 @@ int main(int argc, char** argv)
             << " ievent " << ievent << endl;
         }
     }// End loop on events
-    inpf.close();
     hfile->Write();// Save file with tree
     cout<<"=== hfile->Write()"<<endl;
 	return 0;
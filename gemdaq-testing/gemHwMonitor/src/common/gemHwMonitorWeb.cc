@@ -683,11 +683,11 @@ void gem::hwMonitor::gemHwMonitorWeb::ohPanel(xgi::Input * in, xgi::Output * out
     *out << "<h1><div align=\"center\">Device connection failed!</div></h1>" << std::endl;
   } else {
 		
-    std::vector<gem::hw::GEMHwDevice::linkStatus> activeLinks_;
-    activeLinks_ = ohDevice_->getActiveLinks();
+    // all the registers shown are read in a single transaction
+    gem::hw::optohybrid::HwOptoHybrid::OptoHybridStatus ohStatus = ohDevice_->getStatus();
     *out << "<div class=\"panel panel-primary\">" << std::endl;
     *out << "<div class=\"panel-heading\">" << std::endl;
-    *out << "<h1><div align=\"center\">Chip Id : "<< ohToShow_ << "<br> Firmware version : " << ohDevice_->getFirmwareDate() << "</div></h1>" << std::endl;
+    *out << "<h1><div align=\"center\">Chip Id : "<< ohToShow_ << "<br> Firmware version : 0x" << std::hex << ohStatus.Firmware << std::dec << "</div></h1>" << std::endl;
     *out << "</div>" << std::endl;
     *out << "<div class=\"panel-body\">" << std::endl;
     *out << "<h3><div class=\"alert alert-info\" role=\"alert\" align=\"center\">Device base node : "<< crateToShow_ << "::" << glibToShow_ << "</div></h3>" << std::endl;
@@ -703,7 +703,7 @@ void gem::hwMonitor::gemHwMonitorWeb::ohPanel(xgi::Input * in, xgi::Output * out
       }
     }
 
-    for (auto l = activeLinks_.begin(); l != activeLinks_.end(); l++) {
+    for (auto l = ohStatus.Links.begin(); l != ohStatus.Links.end(); l++) {
       uint8_t i = l->first;
       *out << "<div class=\"panel panel-info\">" << std::endl;
       *out << "<div class=\"panel-heading\">" << std::endl;
@@ -732,7 +732,7 @@ void gem::hwMonitor::gemHwMonitorWeb::ohPanel(xgi::Input * in, xgi::Output * out
       *out << "</td>" << std::endl;
       *out << "</tr>" << std::endl;
 
-      linkStatus_ = ohDevice_->LinkStatus(i);
+      linkStatus_ = l->second;
       *out << "<tr>" << std::endl;
       *out << "<td>" << std::endl;
       *out << (int)i << std::endl;
@@ -772,7 +772,7 @@ void gem::hwMonitor::gemHwMonitorWeb::ohPanel(xgi::Input * in, xgi::Output * out
         if (vfatDevice_->isHwConnected()) {
           // superfluous, as readVFAT2Counters is called in getAllSettings
           //vfatDevice_->readVFAT2Counters();
-          vfatDevice_->getAllSettings(); // takes time. See with Jared how to make it better
+          vfatDevice_->getAllSettings(); // a single transaction per chip
           runmode = gem::hw::vfat::RunModeToString.at(vfatDevice_->getVFAT2Params().runMode);
           for (uint8_t chan = 1; chan < 129; ++chan) {
             if (vfatDevice_->getVFAT2Params().channels[chan-1].mask < 1) n_chan++;
@@ -805,7 +805,7 @@ void gem::hwMonitor::gemHwMonitorWeb::ohPanel(xgi::Input * in, xgi::Output * out
       *out << cgicc::br();
     }
     std::pair<bool,bool> statusVFATClock_;
-    statusVFATClock_ = ohDevice_->StatusVFATClock(/*link*/);
+    statusVFATClock_ = ohStatus.VFATClock;
     *out << cgicc::table().set("class","table");
     *out << "<tr>" << std::endl;
     *out << "<td>" << std::endl;
@@ -826,7 +826,7 @@ void gem::hwMonitor::gemHwMonitorWeb::ohPanel(xgi::Input * in, xgi::Output * out
     //*out << cgicc::table() <<std::endl;
 		
     std::pair<bool,bool> statusCDCEClock_;
-    statusCDCEClock_ = ohDevice_->StatusCDCEClock(/*link*/);
+    statusCDCEClock_ = ohStatus.CDCEClock;
     //*out << cgicc::table().set("class","table");
     *out << "<tr>" << std::endl;
     *out << "<td>" << std::endl;
@@ -852,7 +852,7 @@ void gem::hwMonitor::gemHwMonitorWeb::ohPanel(xgi::Input * in, xgi::Output * out
     *out << "Trigger Source" << std::endl;
     *out << "</td>" << std::endl;
     *out << "<td>" << std::endl;
-    *out << (int)ohDevice_->getTrigSource(/*link*/) << std::endl;
+    *out << (int)ohStatus.TrigSource << std::endl;
     *out << "</td>" << std::endl;
     *out << "</tr>" << std::endl;
     *out << "<tr>" << std::endl;
@@ -860,7 +860,7 @@ void gem::hwMonitor::gemHwMonitorWeb::ohPanel(xgi::Input * in, xgi::Output * out
     *out << "S-bit Source" << std::endl;
     *out << "</td>" << std::endl;
     *out << "<td>" << std::endl;
-    *out << (int)ohDevice_->getSBitSource(/*link*/) << std::endl;
+    *out << (int)ohStatus.SBitSource << std::endl;
     *out << "</td>" << std::endl;
     *out << "</tr>" << std::endl;
     //*out << cgicc::table() <<std::endl;
@@ -873,7 +873,7 @@ void gem::hwMonitor::gemHwMonitorWeb::ohPanel(xgi::Input * in, xgi::Output * out
       *out << l1CountNames[i] << std::endl;
       *out << "</td>" << std::endl;
       *out << "<td>" << std::endl;
-      *out << ohDevice_->GetL1ACount(i/*,link*/) << std::endl;
+      *out << ohStatus.Counters.L1A[i] << std::endl;
       *out << "</td>" << std::endl;
       *out << "</tr>" << std::endl;
     }
@@ -887,7 +887,7 @@ void gem::hwMonitor::gemHwMonitorWeb::ohPanel(xgi::Input * in, xgi::Output * out
       *out << calPulseCountNames[i] << std::endl;
       *out << "</td>" << std::endl;
       *out << "<td>" << std::endl;
-      *out << ohDevice_->GetCalPulseCount(i/*,link*/) << std::endl;
+      *out << ohStatus.Counters.CalPulse[i] << std::endl;
       *out << "</td>" << std::endl;
       *out << "</tr>" << std::endl;
     }
@@ -1,12 +1,28 @@
 #ifndef gem_base_GEMReadoutApplication_h
 #define gem_base_GEMReadoutApplication_h
 
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
 #include "xdaq/WebApplication.h"
 
 #include "xgi/framework/Method.h"
 #include "xgi/framework/UIManager.h"
 
+#include "xdata/String.h"
+#include "xdata/UnsignedInteger32.h"
+
+#include "xoap/MessageReference.h"
+
+#include "toolbox/fsm/FiniteStateMachine.h"
+#include "toolbox/task/WorkLoop.h"
+#include "toolbox/Event.h"
+#include "toolbox/BSem.h"
+
 #include "gem/base/GEMApplication.h"
+#include "gem/utils/SPSCRing.h"
 
 #include "cgicc/HTMLClasses.h"
 
@@ -14,35 +30,173 @@ namespace cgicc {
   BOOLEAN_ELEMENT(section,"section");
 }
 
+namespace toolbox {
+  namespace mem {
+    class Pool;
+    class Reference;
+  }
+}
+
 namespace gem {
   namespace base {
-    
+
+    class GEMReadoutConsumer;
+
+    /** Reads out the hardware into frames of an xdaq memory pool and hands them to its consumers
+     * The readout thread calls readout() to fill frames allocated with getFrame(), the frames are
+     * queued and the processing thread passes each of them to every consumer before releasing it,
+     * so the data is written once, by the hardware read, and shared by reference from there on.
+     * The readout never reads more than can be queued, data the consumers can not take yet is left
+     * in the hardware buffers.
+     * Controlled by the Configure, Start, Stop and Halt SOAP commands, independently of the
+     * supervisor. A derived application implements readout(), adds its consumers on Configure and
+     * calls the transitions of this class from its own.
+     */
     //class GEMReadoutApplication : virtual public gem::base::GEMApplication, public xdaq::WebApplication
     class GEMReadoutApplication : public gem::base::GEMApplication
       {
       public:
         //XDAQ_INSTANTIATOR();
-	
+
+        /** frames queued between the readout and the processing threads */
+        static const size_t MAX_QUEUED_FRAMES = 1024;
+
+        /** time to wait before reading out again when there was no data */
+        static const uint32_t IDLE_SLEEP_US = 1000;
+
         GEMReadoutApplication(xdaq::ApplicationStub *stub)
           throw (xdaq::exception::Exception);
-	
+
+        virtual ~GEMReadoutApplication();
+
+        // SOAP interface
+        xoap::MessageReference onConfigure(xoap::MessageReference message);
+        xoap::MessageReference onStart(    xoap::MessageReference message);
+        xoap::MessageReference onStop(     xoap::MessageReference message);
+        xoap::MessageReference onHalt(     xoap::MessageReference message);
+
+        // work loop call-back functions
+        /**
+         *    Fire the FSM event of a SOAP command, on the command workloop
+         */
+        bool configureAction(toolbox::task::WorkLoop *wl);
+        bool startAction(    toolbox::task::WorkLoop *wl);
+        bool stopAction(     toolbox::task::WorkLoop *wl);
+        bool haltAction(     toolbox::task::WorkLoop *wl);
+        /**
+         *    Readout thread: fill frames with readout() and queue them
+         */
+        bool readoutAction(toolbox::task::WorkLoop *wl);
+        /**
+         *    Processing thread: pass the queued frames to the consumers and release them
+         */
+        bool processAction(toolbox::task::WorkLoop *wl);
+
       protected:
 
         //copy from HCAL readout application
+        /** read out the hardware into pool frames
+         * @param expected maximum number of frames to add to data
+         * @param eventNumbers room for expected entries, filled with the number of the first
+         * event found in each frame
+         * @param data the frames filled, allocated with getFrame(), are appended
+         * @retval returns the number of frames added, 0 if there was no data
+         */
         virtual int readout(unsigned int expected, unsigned int* eventNumbers, std::vector< ::toolbox::mem::Reference* >& data) = 0;
 
         virtual void init();
 
+        // State transitions, a derived application calls these from its own
+        /**
+         *    Create the memory pool, a derived application then adds its consumers
+         */
+        virtual void configureAction(toolbox::Event::Reference e);
+        /**
+         *    Start the readout and processing threads
+         */
+        virtual void startAction(toolbox::Event::Reference e);
+        /**
+         *    Stop reading out, pass what was read out to the consumers and flush them
+         */
+        virtual void stopAction(toolbox::Event::Reference e);
+        /**
+         *    Stop, then drop the consumers
+         */
+        virtual void haltAction(toolbox::Event::Reference e);
+        /**
+         *    Empty action for forbidden state transitions in FSM
+         */
+        void noAction(toolbox::Event::Reference e);
+
+        /** a frame of frameSize bytes from the pool, to be filled by readout()
+         * @retval returns NULL if the pool is exhausted, the consumers still hold all of it
+         */
+        ::toolbox::mem::Reference* getFrame();
+
+        /** consumers see the frames in the order they were added */
+        void addConsumer(std::shared_ptr<GEMReadoutConsumer> const& consumer);
+        void clearConsumers();
+
+        /** stop the readout thread, then let the processing thread finish the queued frames
+         * a derived application calls it from its destructor, before readout() goes away
+         */
+        void stopReadout();
+
         log4cplus::Logger gemReadoutLogger_;
 
+        xdata::UnsignedInteger32 frameSize_; // bytes per frame
+        xdata::UnsignedInteger32 poolSize_;  // MB of memory committed to the pool
+
         virtual void Default(xgi::Input *in, xgi::Output *out)
           throw (xgi::exception::Exception);
-	
+
         virtual void Expert(xgi::Input *in, xgi::Output *out)
           throw (xgi::exception::Exception);
 
         virtual void webRedirect(xgi::Input *in, xgi::Output *out)
           throw (xgi::exception::Exception);
+
+      private:
+        /** hand a frame to every consumer, then release it */
+        void dispatch(::toolbox::mem::Reference* frame);
+
+        void fireEvent(std::string const& name);
+        void stateChanged(toolbox::fsm::FiniteStateMachine &fsm);
+        void transitionFailed(toolbox::Event::Reference event);
+
+        toolbox::fsm::FiniteStateMachine fsm_;
+
+        toolbox::task::WorkLoop *commandWL_;
+        toolbox::task::WorkLoop *readoutWL_;
+        toolbox::task::WorkLoop *processWL_;
+
+        toolbox::task::ActionSignature *configureSig_;
+        toolbox::task::ActionSignature *startSig_;
+        toolbox::task::ActionSignature *stopSig_;
+        toolbox::task::ActionSignature *haltSig_;
+        toolbox::task::ActionSignature *readoutSig_;
+        toolbox::task::ActionSignature *processSig_;
+
+        // held by the readout and processing threads for one iteration, used to stop them
+        toolbox::BSem readoutSemaphore_;
+        toolbox::BSem processSemaphore_;
+        bool isReading_, isProcessing_;
+
+        ::toolbox::mem::Pool* pool_;
+        std::vector<std::shared_ptr<GEMReadoutConsumer> > consumers_;
+
+        // frames read out, waiting for the consumers
+        gem::utils::SPSCRing< ::toolbox::mem::Reference*> queue_;
+        // reused by every readout() call
+        std::vector< ::toolbox::mem::Reference*> frames_;
+        std::vector<unsigned int> eventNumbers_;
+
+        // written by the readout and processing threads, only read elsewhere
+        uint64_t framesRead_;
+        uint64_t bytesRead_;
+        uint64_t framesConsumed_;
+        uint64_t poolExhausted_;
+        unsigned int lastEventNumber_;
       };
   } // namespace gem::base
 } // namespace gem
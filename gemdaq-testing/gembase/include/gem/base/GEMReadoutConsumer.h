@@ -0,0 +1,42 @@
+#ifndef gem_base_GEMReadoutConsumer_h
+#define gem_base_GEMReadoutConsumer_h
+
+namespace toolbox {
+  namespace mem {
+    class Reference;
+  }
+}
+
+namespace gem {
+  namespace base {
+
+    /** Downstream stage of a GEMReadoutApplication, e.g. a file writer, the DQM or an event builder
+     * Every frame read out is passed to each consumer in turn, in readout order, on the processing
+     * thread of the application, which releases it once all consumers have seen it.
+     * A consumer which keeps the data after consume() returns takes its own reference with
+     * duplicate() and releases it when done, the pool memory is reused once the last reference
+     * to it is released. The data itself is never copied.
+     */
+    class GEMReadoutConsumer
+    {
+    public:
+      virtual ~GEMReadoutConsumer() {};
+
+      /** one frame of data, only valid until the call returns unless duplicated
+       * @param frame filled by GEMReadoutApplication::readout
+       */
+      virtual void consume(toolbox::mem::Reference* frame) = 0;
+
+      /** called when no frame is waiting, e.g. to write out the events which timed out
+       */
+      virtual void idle() {};
+
+      /** end of the run, everything consumed so far is to be written out
+       */
+      virtual void flush() {};
+    };
+
+  } // namespace gem::base
+} // namespace gem
+
+#endif
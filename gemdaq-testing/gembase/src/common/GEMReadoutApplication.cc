@@ -0,0 +1,426 @@
+/**
+ * class: GEMReadoutApplication
+ * description: Generic GEM readout application, reads the hardware into memory pool
+ *              frames and passes them by reference to its consumers
+ *              structure borrowed from HCAL readout applications
+ * author:
+ * date:
+ */
+
+#include "gem/base/GEMReadoutApplication.h"
+#include "gem/base/GEMReadoutConsumer.h"
+
+#include "toolbox/mem/MemoryPoolFactory.h"
+#include "toolbox/mem/CommittedHeapAllocator.h"
+#include "toolbox/mem/Reference.h"
+#include "toolbox/mem/exception/Exception.h"
+#include "toolbox/net/URN.h"
+#include "toolbox/task/WorkLoopFactory.h"
+#include "toolbox/fsm/FailedEvent.h"
+#include "toolbox/string.h"
+
+#include "xdaq/NamespaceURI.h"
+#include "xoap/Method.h"
+
+#include "gem/utils/GEMLogging.h"
+
+#include <exception>
+#include <sstream>
+#include <unistd.h>
+
+const size_t   gem::base::GEMReadoutApplication::MAX_QUEUED_FRAMES;
+const uint32_t gem::base::GEMReadoutApplication::IDLE_SLEEP_US;
+
+gem::base::GEMReadoutApplication::GEMReadoutApplication(xdaq::ApplicationStub *stub)
+  throw (xdaq::exception::Exception) :
+  GEMApplication(stub),
+  gemReadoutLogger_(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:base:GEMReadoutApplication"))),
+  readoutSemaphore_(toolbox::BSem::FULL),
+  processSemaphore_(toolbox::BSem::FULL),
+  isReading_(false),
+  isProcessing_(false),
+  pool_(0),
+  queue_(MAX_QUEUED_FRAMES),
+  frames_(),
+  eventNumbers_(MAX_QUEUED_FRAMES, 0),
+  framesRead_(0),
+  bytesRead_(0),
+  framesConsumed_(0),
+  poolExhausted_(0),
+  lastEventNumber_(0)
+{
+  DEBUG("called gem::base::GEMReadoutApplication constructor");
+
+  frameSize_ = 0x10000;
+  poolSize_  = 256;
+  appInfoSpaceP_->fireItemAvailable("frameSize", &frameSize_);
+  appInfoSpaceP_->fireItemAvailable("poolSize",  &poolSize_);
+
+  frames_.reserve(MAX_QUEUED_FRAMES);
+
+  // HyperDAQ bindings, next to the generic pages of GEMApplication
+  xgi::framework::deferredbind(this, this, &GEMReadoutApplication::Default, "readoutView"      );
+  xgi::framework::deferredbind(this, this, &GEMReadoutApplication::Expert,  "readoutExpertView");
+
+  // SOAP bindings
+  xoap::bind(this, &GEMReadoutApplication::onConfigure, "Configure", XDAQ_NS_URI);
+  xoap::bind(this, &GEMReadoutApplication::onStart,     "Start",     XDAQ_NS_URI);
+  xoap::bind(this, &GEMReadoutApplication::onStop,      "Stop",      XDAQ_NS_URI);
+  xoap::bind(this, &GEMReadoutApplication::onHalt,      "Halt",      XDAQ_NS_URI);
+
+  // command workloop, and the readout and processing workloops decoupled by the frame queue
+  std::stringstream loopName;
+  loopName << "urn:toolbox-task-workloop:" << xmlClass_ << ":" << instance_;
+  commandWL_ = toolbox::task::getWorkLoopFactory()->getWorkLoop(loopName.str(),               "waiting");
+  readoutWL_ = toolbox::task::getWorkLoopFactory()->getWorkLoop(loopName.str() + ":readout", "waiting");
+  processWL_ = toolbox::task::getWorkLoopFactory()->getWorkLoop(loopName.str() + ":process", "waiting");
+  commandWL_->activate();
+  readoutWL_->activate();
+  processWL_->activate();
+
+  // Workloop bindings
+  configureSig_ = toolbox::task::bind(this, &GEMReadoutApplication::configureAction, "configureAction");
+  startSig_     = toolbox::task::bind(this, &GEMReadoutApplication::startAction,     "startAction"    );
+  stopSig_      = toolbox::task::bind(this, &GEMReadoutApplication::stopAction,      "stopAction"     );
+  haltSig_      = toolbox::task::bind(this, &GEMReadoutApplication::haltAction,      "haltAction"     );
+  readoutSig_   = toolbox::task::bind(this, &GEMReadoutApplication::readoutAction,   "readoutAction"  );
+  processSig_   = toolbox::task::bind(this, &GEMReadoutApplication::processAction,   "processAction"  );
+
+  // Define FSM states
+  fsm_.addState('H', "Halted",     this, &GEMReadoutApplication::stateChanged);
+  fsm_.addState('C', "Configured", this, &GEMReadoutApplication::stateChanged);
+  fsm_.addState('R', "Running",    this, &GEMReadoutApplication::stateChanged);
+
+  // Define error FSM state
+  fsm_.setStateName('F', "Error");
+  fsm_.setFailedStateTransitionAction( this, &GEMReadoutApplication::transitionFailed);
+  fsm_.setFailedStateTransitionChanged(this, &GEMReadoutApplication::stateChanged);
+
+  // Define allowed FSM state transitions
+  fsm_.addStateTransition('H', 'C', "Configure", this, &GEMReadoutApplication::configureAction);
+  fsm_.addStateTransition('H', 'H', "Halt",      this, &GEMReadoutApplication::haltAction);
+  fsm_.addStateTransition('C', 'C', "Configure", this, &GEMReadoutApplication::configureAction);
+  fsm_.addStateTransition('C', 'R', "Start",     this, &GEMReadoutApplication::startAction);
+  fsm_.addStateTransition('C', 'H', "Halt",      this, &GEMReadoutApplication::haltAction);
+  fsm_.addStateTransition('R', 'C', "Stop",      this, &GEMReadoutApplication::stopAction);
+  fsm_.addStateTransition('R', 'H', "Halt",      this, &GEMReadoutApplication::haltAction);
+
+  // Define forbidden FSM state transitions
+  fsm_.addStateTransition('R', 'R', "Configure", this, &GEMReadoutApplication::noAction);
+  fsm_.addStateTransition('H', 'H', "Start",     this, &GEMReadoutApplication::noAction);
+  fsm_.addStateTransition('R', 'R', "Start",     this, &GEMReadoutApplication::noAction);
+  fsm_.addStateTransition('H', 'H', "Stop",      this, &GEMReadoutApplication::noAction);
+  fsm_.addStateTransition('C', 'C', "Stop",      this, &GEMReadoutApplication::noAction);
+
+  // Set initial FSM state and reset FSM
+  fsm_.setInitialState('H');
+  fsm_.reset();
+
+  DEBUG("gem::base::GEMReadoutApplication constructed");
+}
+
+gem::base::GEMReadoutApplication::~GEMReadoutApplication()
+{
+  stopReadout();
+  // the consumers may still hold frames of the pool
+  clearConsumers();
+}
+
+void gem::base::GEMReadoutApplication::init()
+{
+}
+
+// SOAP interface
+xoap::MessageReference gem::base::GEMReadoutApplication::onConfigure(xoap::MessageReference message)
+{
+  commandWL_->submit(configureSig_);
+  return message;
+}
+
+xoap::MessageReference gem::base::GEMReadoutApplication::onStart(xoap::MessageReference message)
+{
+  commandWL_->submit(startSig_);
+  return message;
+}
+
+xoap::MessageReference gem::base::GEMReadoutApplication::onStop(xoap::MessageReference message)
+{
+  commandWL_->submit(stopSig_);
+  return message;
+}
+
+xoap::MessageReference gem::base::GEMReadoutApplication::onHalt(xoap::MessageReference message)
+{
+  commandWL_->submit(haltSig_);
+  return message;
+}
+
+// work loop call-back functions
+bool gem::base::GEMReadoutApplication::configureAction(toolbox::task::WorkLoop *wl)
+{
+  fireEvent("Configure");
+  return false;
+}
+
+bool gem::base::GEMReadoutApplication::startAction(toolbox::task::WorkLoop *wl)
+{
+  fireEvent("Start");
+  return false;
+}
+
+bool gem::base::GEMReadoutApplication::stopAction(toolbox::task::WorkLoop *wl)
+{
+  fireEvent("Stop");
+  return false;
+}
+
+bool gem::base::GEMReadoutApplication::haltAction(toolbox::task::WorkLoop *wl)
+{
+  fireEvent("Halt");
+  return false;
+}
+
+bool gem::base::GEMReadoutApplication::readoutAction(toolbox::task::WorkLoop *wl)
+{
+  readoutSemaphore_.take();
+  if (!isReading_) {
+    readoutSemaphore_.give();
+    return false;
+  }
+
+  // only the processing thread frees queue entries, so this much room is there for sure
+  size_t room = queue_.capacity() - queue_.occupancy();
+  int nFrames = 0;
+  if (room) {
+    frames_.clear();
+    try {
+      nFrames = readout(room, &eventNumbers_[0], frames_);
+    } catch (std::exception const& e) {
+      ERROR("readoutAction:: readout failed: " << e.what());
+    }
+
+    for (std::vector< ::toolbox::mem::Reference*>::iterator frame = frames_.begin(); frame != frames_.end(); ++frame) {
+      ::toolbox::mem::Reference** entry = queue_.claim();
+      if (!entry) {
+        // readout() returned more than it was asked for
+        ERROR("readoutAction:: frame queue full, dropping a frame");
+        (*frame)->release();
+        continue;
+      }
+      *entry = *frame;
+      queue_.publish();
+      ++framesRead_;
+      bytesRead_ += (*frame)->getDataSize();
+    }
+    if (nFrames)
+      lastEventNumber_ = eventNumbers_[nFrames - 1];
+  }
+  readoutSemaphore_.give();
+
+  // no data (or consumers behind), do not hammer the hardware
+  if (!nFrames)
+    usleep(IDLE_SLEEP_US);
+
+  return true;
+}
+
+bool gem::base::GEMReadoutApplication::processAction(toolbox::task::WorkLoop *wl)
+{
+  processSemaphore_.take();
+  if (!isProcessing_) {
+    processSemaphore_.give();
+    return false;
+  }
+
+  ::toolbox::mem::Reference** entry = queue_.front();
+  if (entry) {
+    dispatch(*entry);
+    queue_.release();
+  } else {
+    for (std::vector<std::shared_ptr<GEMReadoutConsumer> >::iterator consumer = consumers_.begin();
+         consumer != consumers_.end(); ++consumer)
+      (*consumer)->idle();
+  }
+  processSemaphore_.give();
+
+  if (!entry)
+    usleep(IDLE_SLEEP_US);
+
+  return true;
+}
+
+void gem::base::GEMReadoutApplication::dispatch(::toolbox::mem::Reference* frame)
+{
+  for (std::vector<std::shared_ptr<GEMReadoutConsumer> >::iterator consumer = consumers_.begin();
+       consumer != consumers_.end(); ++consumer)
+    (*consumer)->consume(frame);
+  // back to the pool, unless a consumer kept a duplicate
+  frame->release();
+  ++framesConsumed_;
+}
+
+::toolbox::mem::Reference* gem::base::GEMReadoutApplication::getFrame()
+{
+  try {
+    return toolbox::mem::getMemoryPoolFactory()->getFrame(pool_, frameSize_);
+  } catch (toolbox::mem::exception::Exception const& e) {
+    ++poolExhausted_;
+    DEBUG("getFrame:: no frame of " << frameSize_.toString() << " bytes available: " << e.what());
+    return 0;
+  }
+}
+
+void gem::base::GEMReadoutApplication::addConsumer(std::shared_ptr<GEMReadoutConsumer> const& consumer)
+{
+  consumers_.push_back(consumer);
+}
+
+void gem::base::GEMReadoutApplication::clearConsumers()
+{
+  consumers_.clear();
+}
+
+// State transitions
+void gem::base::GEMReadoutApplication::configureAction(toolbox::Event::Reference e)
+{
+  stopReadout();
+  clearConsumers();
+
+  framesRead_     = 0;
+  bytesRead_      = 0;
+  framesConsumed_ = 0;
+  poolExhausted_  = 0;
+
+  // the pool lives as long as the application, the frames are recycled from one run to the next
+  if (!pool_) {
+    std::stringstream poolName;
+    poolName << xmlClass_ << ":" << instance_;
+    toolbox::net::URN urn("toolbox-mem-pool", poolName.str());
+    toolbox::mem::CommittedHeapAllocator* allocator =
+      new toolbox::mem::CommittedHeapAllocator(static_cast<size_t>(poolSize_)*0x100000);
+    pool_ = toolbox::mem::getMemoryPoolFactory()->createPool(urn, allocator);
+    INFO("configureAction:: memory pool " << urn.toString() << " of " << poolSize_.toString() << " MB");
+  }
+}
+
+void gem::base::GEMReadoutApplication::startAction(toolbox::Event::Reference e)
+{
+  readoutSemaphore_.take();
+  processSemaphore_.take();
+  isProcessing_ = true;
+  isReading_    = true;
+  processSemaphore_.give();
+  readoutSemaphore_.give();
+
+  processWL_->submit(processSig_);
+  readoutWL_->submit(readoutSig_);
+  INFO("startAction:: reading out into frames of " << frameSize_.toString() << " bytes, "
+       << consumers_.size() << " consumers");
+}
+
+void gem::base::GEMReadoutApplication::stopAction(toolbox::Event::Reference e)
+{
+  stopReadout();
+  INFO("stopAction:: " << framesRead_ << " frames read out, " << bytesRead_ << " bytes, "
+       << poolExhausted_ << " times the pool was exhausted");
+}
+
+void gem::base::GEMReadoutApplication::haltAction(toolbox::Event::Reference e)
+{
+  stopReadout();
+  clearConsumers();
+}
+
+void gem::base::GEMReadoutApplication::noAction(toolbox::Event::Reference e)
+{
+}
+
+void gem::base::GEMReadoutApplication::stopReadout()
+{
+  readoutSemaphore_.take();
+  bool wasReading = isReading_;
+  isReading_ = false;
+  readoutSemaphore_.give();
+
+  processSemaphore_.take();
+  isProcessing_ = false;
+  for (::toolbox::mem::Reference** entry = queue_.front(); entry; entry = queue_.front()) {
+    dispatch(*entry);
+    queue_.release();
+  }
+  if (wasReading)
+    for (std::vector<std::shared_ptr<GEMReadoutConsumer> >::iterator consumer = consumers_.begin();
+         consumer != consumers_.end(); ++consumer)
+      (*consumer)->flush();
+  processSemaphore_.give();
+}
+
+void gem::base::GEMReadoutApplication::fireEvent(std::string const& name)
+{
+  toolbox::Event::Reference event(new toolbox::Event(name, this));
+  fsm_.fireEvent(event);
+}
+
+void gem::base::GEMReadoutApplication::stateChanged(toolbox::fsm::FiniteStateMachine &fsm)
+{
+  DEBUG("stateChanged:: " << fsm.getStateName(fsm.getCurrentState()));
+}
+
+void gem::base::GEMReadoutApplication::transitionFailed(toolbox::Event::Reference event)
+{
+  toolbox::fsm::FailedEvent &failed = dynamic_cast<toolbox::fsm::FailedEvent&>(*event);
+  ERROR("transitionFailed:: " << failed.getFromState() << " to " << failed.getToState() << ": "
+        << failed.getException().what());
+}
+
+// HyperDAQ interface
+void gem::base::GEMReadoutApplication::Default(xgi::Input *in, xgi::Output *out)
+  throw (xgi::exception::Exception)
+{
+  if (fsm_.getCurrentState() == 'R') {
+    cgicc::HTTPResponseHeader &head = out->getHTTPResponseHeader();
+    head.addHeader("Refresh","5");
+  }
+
+  *out << cgicc::h1("GEM Readout") << std::endl;
+  *out << cgicc::section() << std::endl
+       << cgicc::table().set("class","xdaq-table") << std::endl
+       << cgicc::tbody() << std::endl
+       << cgicc::tr() << cgicc::td("State")           << cgicc::td(fsm_.getStateName(fsm_.getCurrentState())) << cgicc::tr() << std::endl
+       << cgicc::tr() << cgicc::td("Frames read out") << cgicc::td(toolbox::toString("%llu", (unsigned long long)framesRead_))     << cgicc::tr() << std::endl
+       << cgicc::tr() << cgicc::td("Bytes read out")  << cgicc::td(toolbox::toString("%llu", (unsigned long long)bytesRead_))      << cgicc::tr() << std::endl
+       << cgicc::tr() << cgicc::td("Frames consumed") << cgicc::td(toolbox::toString("%llu", (unsigned long long)framesConsumed_)) << cgicc::tr() << std::endl
+       << cgicc::tr() << cgicc::td("Frames queued")   << cgicc::td(toolbox::toString("%lu/%lu", (unsigned long)queue_.occupancy(), (unsigned long)queue_.capacity())) << cgicc::tr() << std::endl
+       << cgicc::tr() << cgicc::td("Last event")      << cgicc::td(toolbox::toString("%u", lastEventNumber_))    << cgicc::tr() << std::endl
+       << cgicc::tbody() << std::endl
+       << cgicc::table() << std::endl
+       << cgicc::section() << std::endl;
+}
+
+void gem::base::GEMReadoutApplication::Expert(xgi::Input *in, xgi::Output *out)
+  throw (xgi::exception::Exception)
+{
+  Default(in, out);
+
+  *out << cgicc::h2("Memory pool") << std::endl;
+  *out << cgicc::section() << std::endl
+       << cgicc::table().set("class","xdaq-table") << std::endl
+       << cgicc::tbody() << std::endl
+       << cgicc::tr() << cgicc::td("Frame size (bytes)")   << cgicc::td(frameSize_.toString()) << cgicc::tr() << std::endl
+       << cgicc::tr() << cgicc::td("Pool size (MB)")       << cgicc::td(poolSize_.toString())  << cgicc::tr() << std::endl
+       << cgicc::tr() << cgicc::td("Pool exhausted")       << cgicc::td(toolbox::toString("%llu", (unsigned long long)poolExhausted_)) << cgicc::tr() << std::endl
+       << cgicc::tr() << cgicc::td("Most frames queued")   << cgicc::td(toolbox::toString("%lu", (unsigned long)queue_.maxOccupancy())) << cgicc::tr() << std::endl
+       << cgicc::tr() << cgicc::td("Consumers")            << cgicc::td(toolbox::toString("%lu", (unsigned long)consumers_.size()))   << cgicc::tr() << std::endl
+       << cgicc::tbody() << std::endl
+       << cgicc::table() << std::endl
+       << cgicc::section() << std::endl;
+}
+
+void gem::base::GEMReadoutApplication::webRedirect(xgi::Input *in, xgi::Output *out)
+  throw (xgi::exception::Exception)
+{
+  std::string url = "/" + getApplicationDescriptor()->getURN() + "/readoutView";
+  *out << "<meta http-equiv=\"refresh\" content=\"0;" << url << "\">" << std::endl;
+
+  this->Default(in, out);
+}
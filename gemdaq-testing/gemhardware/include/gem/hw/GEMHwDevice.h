@@ -9,6 +9,7 @@
 #include <iomanip>
 
 #include "gem/hw/exception/Exception.h"
+#include "gem/hw/Transaction.h"
 
 #include "uhal/uhal.hpp"
 #include "uhal/Utilities.hpp"
@@ -43,7 +44,41 @@ namespace uhal {
 
 namespace gem {
   namespace hw {
-    
+
+    class GEMHwDevice;
+
+    /** A register of a GEMHwDevice, looked up in the address table on its first access only
+     * Obtained from GEMHwDevice::getRegister, the device resolves the name into the uhal node
+     * once and keeps it in the handle, it is resolved again only if the device reconnected.
+     * Meant to be kept by the device for the registers it accesses repeatedly, instead of
+     * building the register name and looking it up on every call.
+     */
+    class RegisterHandle
+    {
+    public:
+      RegisterHandle() :
+        node_(0), device_(0), connection_(0) {};
+
+      /** RegisterHandle(std::string const& name)
+       * @param name full name of the register in the address table
+       */
+      explicit RegisterHandle(std::string const& name) :
+        name_(name), node_(0), device_(0), connection_(0) {};
+
+      std::string const& getName() const { return name_; };
+
+    private:
+      friend class GEMHwDevice;
+
+      std::string        name_;
+      uhal::Node const*  node_;       // resolved by device_, during its connection_th connection
+      GEMHwDevice const* device_;
+      uint32_t           connection_;
+    };
+
+    typedef std::pair<RegisterHandle, uint32_t> register_handle_pair;
+    typedef std::vector<register_handle_pair>   register_handle_list;
+
     class GEMHwDevice
     {
 
@@ -58,6 +93,25 @@ namespace gem {
       OpticalLinkStatus() : Errors(0),I2CReceived(0),I2CSent(0),RegisterReceived(0),RegisterSent(0) {};
         void reset()       {Errors=0; I2CReceived=0; I2CSent=0; RegisterReceived=0; RegisterSent=0;return; };
       } OpticalLinkStatus;
+
+      /** OpticalLinkStatus read by a Transaction
+       */
+      typedef struct OpticalLinkStatusFuture {
+        TransactionFuture<uint32_t> Errors          ;
+        TransactionFuture<uint32_t> I2CReceived     ;
+        TransactionFuture<uint32_t> I2CSent         ;
+        TransactionFuture<uint32_t> RegisterReceived;
+        TransactionFuture<uint32_t> RegisterSent    ;
+
+        OpticalLinkStatus value() const {
+          OpticalLinkStatus status;
+          status.Errors           = Errors.value();
+          status.I2CReceived      = I2CReceived.value();
+          status.I2CSent          = I2CSent.value();
+          status.RegisterReceived = RegisterReceived.value();
+          status.RegisterSent     = RegisterSent.value();
+          return status; };
+      } OpticalLinkStatusFuture;
 	
       typedef struct DeviceErrors {
         int BadHeader    ;
@@ -144,6 +198,37 @@ namespace gem {
        */
       void     readRegs( register_pair_list &regList);
 
+      /** getRegister(std::string const& regName)
+       * @param regName name of the register below the device base node
+       * @retval returns a handle to the register, resolved on its first access
+       */
+      RegisterHandle getRegister(std::string const& regName) const {
+        return RegisterHandle(getDeviceBaseNode()+"."+regName); };
+
+      /** readReg(RegisterHandle& reg)
+       * @param reg register to read, resolved if it was not yet
+       * @retval returns the 32 bit unsigned value in the register
+       */
+      uint32_t readReg( RegisterHandle& reg);
+
+      /** readRegs(register_handle_list::iterator first, register_handle_list::iterator last, bool const& retry)
+       * read a range of registers in a single transaction (one dispatch call), in order
+       * @param first, last range of register handles and uint32_t values to store the result
+       * @param retry dispatch again on a known IPbus error; not for reads with side effects, e.g. a
+       * FIFO, which a partly executed dispatch has already advanced
+       * @retval returns false if the dispatch failed, the values are then left unchanged
+       */
+      bool     readRegs( register_handle_list::iterator first,
+                         register_handle_list::iterator last,
+                         bool const& retry=true);
+
+      /** readRegs(register_handle_list& regList)
+       * read list of registers in a single transaction (one dispatch call)
+       * @param regList list of register handles and uint32_t values to store the result
+       */
+      bool     readRegs( register_handle_list& regList) {
+        return readRegs(regList.begin(), regList.end()); };
+
       /** writeReg(std::string const& regName, uint32_t const val)
        * @param regName name of the register to read 
        * @param val value to write to the register
@@ -167,6 +252,26 @@ namespace gem {
        */
       void     writeRegs(register_pair_list const& regList);
 
+      /** writeReg(RegisterHandle& reg, uint32_t const val)
+       * @param reg register to write, resolved if it was not yet
+       * @param val value to write to the register
+       */
+      void     writeReg( RegisterHandle& reg, uint32_t const val);
+
+      /** writeRegs(register_handle_list& regList)
+       * write list of registers in a single transaction (one dispatch call)
+       * @param regList list of register handles and values to write, the handles are resolved if they were not yet
+       */
+      void     writeRegs(register_handle_list& regList);
+
+      /** dispatch(Transaction& transaction)
+       * execute the operations queued on a transaction of this device in a single dispatch,
+       * the whole transaction is retried on the known IPbus errors
+       * @param transaction operations to execute, its results are filled on success
+       * @retval returns true if the dispatch succeeded
+       */
+      bool     dispatch(Transaction& transaction);
+
       /** writeRegs(register_pair_list const& regList)
        * write single value to a list of registers in a single transaction
        * (one dispatch call) using the supplied vector regList
@@ -297,6 +402,17 @@ namespace gem {
       std::string deviceID_;
 		
       bool knownErrorCode(std::string const& errCode) const;
+
+      /** the uhal node of a register, looked up only if the handle was not resolved by this
+       * device on its current connection, to be called with hwLock_ held
+       */
+      uhal::Node const& resolve(RegisterHandle& reg);
+
+      // counts the connections, the nodes resolved by a previous one are gone
+      uint32_t connection_;
+
+      // values of the handle readRegs, reused by every call
+      std::vector<uhal::ValWord<uint32_t> > readValues_;
 	
       //std::string registerToChar(uint32_t value) const;	
 
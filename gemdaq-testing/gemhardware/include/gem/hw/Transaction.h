@@ -0,0 +1,189 @@
+#ifndef gem_hw_Transaction_h
+#define gem_hw_Transaction_h
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace gem {
+  namespace hw {
+
+    class GEMHwDevice;
+    class RegisterHandle;
+    class Transaction;
+
+    /** values returned by the operations of one Transaction dispatch
+     **/
+    struct TransactionResults {
+      TransactionResults() : dispatched(false) {};
+
+      bool dispatched;
+      std::vector<uint32_t>              words;  // reads and read-modify-writes, in the order queued
+      std::vector<std::vector<uint32_t> > blocks; // block reads, in the order queued
+    };
+
+    /** The value of a read queued on a Transaction, set when the transaction is dispatched
+     * Stays valid after the Transaction is cleared or destroyed.
+     * @param T type the 32 bit register value is converted to, e.g. bool or uint8_t
+     **/
+    template<typename T>
+      class TransactionFuture
+      {
+      public:
+        TransactionFuture() : index_(0) {};
+
+        /** @retval returns true once the transaction was dispatched successfully */
+        bool ready() const { return results_ && results_->dispatched; };
+
+        /** @retval returns the value read, or T() if the transaction was not dispatched successfully */
+        T value() const { return ready() ? static_cast<T>(results_->words[index_]) : T(); };
+
+      private:
+        friend class Transaction;
+
+        TransactionFuture(std::shared_ptr<TransactionResults const> const& results, size_t const index) :
+          results_(results), index_(index) {};
+
+        std::shared_ptr<TransactionResults const> results_;
+        size_t index_;
+      };
+
+    /** The words of a block read queued on a Transaction, set when the transaction is dispatched
+     **/
+    template<>
+      class TransactionFuture<std::vector<uint32_t> >
+      {
+      public:
+        TransactionFuture() : index_(0) {};
+
+        bool ready() const { return results_ && results_->dispatched; };
+
+        /** @retval returns the words read, empty if the transaction was not dispatched successfully */
+        std::vector<uint32_t> const& value() const {
+          static std::vector<uint32_t> const empty;
+          return ready() ? results_->blocks[index_] : empty; };
+
+      private:
+        friend class Transaction;
+
+        TransactionFuture(std::shared_ptr<TransactionResults const> const& results, size_t const index) :
+          results_(results), index_(index) {};
+
+        std::shared_ptr<TransactionResults const> results_;
+        size_t index_;
+      };
+
+    /** Reads and writes queued on a GEMHwDevice, executed in order with a single dispatch
+     * The operations are queued by any number of calls, possibly of different functions, and
+     * return futures that hold the values read once dispatch() is called. The dispatch has the
+     * retry semantics of GEMHwDevice::readRegs: on a known IPbus error the whole transaction is
+     * queued again, writes included, up to MAX_IPBUS_RETRIES times.
+     * Register names are full names in the address table, as for GEMHwDevice::readReg; a
+     * RegisterHandle is kept by reference and must outlive the dispatch. A handle is resolved by
+     * the device of the transaction, under its lock, so only handles of that device may be queued:
+     * the registers of another device reached through the same connection are queued by name.
+     **/
+    class Transaction
+    {
+    public:
+      explicit Transaction(GEMHwDevice& device);
+
+      /** read(std::string const& regName)
+       * @param regName name of the register to read
+       * @retval returns the future value of the register
+       */
+      template<typename T = uint32_t>
+        TransactionFuture<T> read(std::string const& regName) {
+        return TransactionFuture<T>(results_, queue(Operation(Operation::READ, regName)).index); };
+
+      template<typename T = uint32_t>
+        TransactionFuture<T> read(RegisterHandle& reg) {
+        return TransactionFuture<T>(results_, queue(Operation(Operation::READ, reg)).index); };
+
+      /** write(std::string const& regName, uint32_t const val)
+       * @param regName name of the register to write
+       * @param val value to write to the register
+       */
+      void write(std::string const& regName, uint32_t const val);
+      void write(RegisterHandle& reg, uint32_t const val);
+
+      /** readModifyWrite(std::string const& regName, uint32_t const mask, uint32_t const val)
+       * set the bits of mask in the register to those of val with an IPbus RMWbits,
+       * the other bits are unchanged. As for read and write, the bits are those of the node, for a
+       * masked node they are moved to its field and the bits outside it are never modified
+       * @param regName name of the register to modify
+       * @param mask bits of the register to modify
+       * @param val value of the bits, in the position given by mask
+       * @retval returns the future contents of the register before the modification
+       */
+      TransactionFuture<uint32_t> readModifyWrite(std::string const& regName,
+                                                  uint32_t const mask, uint32_t const val);
+      TransactionFuture<uint32_t> readModifyWrite(RegisterHandle& reg,
+                                                  uint32_t const mask, uint32_t const val);
+
+      /** readBlock(std::string const& regName, size_t const nWords)
+       * @param regName memory block or FIFO to read from
+       * @param nWords number of words to read
+       * @retval returns the future words of the block
+       */
+      TransactionFuture<std::vector<uint32_t> > readBlock(std::string const& regName, size_t const nWords);
+
+      /** writeBlock(std::string const& regName, std::vector<uint32_t> const& values)
+       * @param regName memory block to write to
+       * @param values words to write, copied
+       */
+      void writeBlock(std::string const& regName, std::vector<uint32_t> const& values);
+
+      /** dispatch()
+       * execute the queued operations in a single dispatch, then clear the queue
+       * @retval returns true if the dispatch succeeded, the futures are then ready
+       */
+      bool dispatch();
+
+      /** drop the queued operations, the futures of a previous dispatch keep their values */
+      void clear();
+
+      /** @retval returns the number of operations queued */
+      size_t size() const { return operations_.size(); };
+      bool empty() const { return operations_.empty(); };
+
+      /** @retval returns the device the operations are dispatched on */
+      GEMHwDevice const& getDevice() const { return device_; };
+
+    private:
+      friend class GEMHwDevice;
+
+      struct Operation {
+        enum Type { READ, WRITE, RMW, READ_BLOCK, WRITE_BLOCK };
+
+        Operation(Type const t, std::string const& regName) :
+          type(t), name(regName), handle(0), value(0), mask(0), nWords(0), index(0) {};
+        Operation(Type const t, RegisterHandle& reg) :
+          type(t), handle(&reg), value(0), mask(0), nWords(0), index(0) {};
+
+        std::string const& getName() const;
+
+        Type            type;
+        std::string     name;   // used if there is no handle
+        RegisterHandle* handle;
+        uint32_t        value;  // written, or the bits set by a read-modify-write
+        uint32_t        mask;   // bits modified by a read-modify-write
+        size_t          nWords; // of a block read
+        size_t          index;  // in the results of its type, or in writeBlocks_
+      };
+
+      /** append the operation, with its index in the results it will fill */
+      Operation const& queue(Operation op);
+
+      GEMHwDevice& device_;
+
+      std::vector<Operation> operations_;
+      std::vector<std::vector<uint32_t> > writeBlocks_;
+      std::shared_ptr<TransactionResults> results_; // filled by the next dispatch
+    };
+
+  } //end namespace gem::hw
+
+} //end namespace gem
+#endif
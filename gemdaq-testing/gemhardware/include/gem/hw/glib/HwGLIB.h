@@ -1,6 +1,8 @@
 #ifndef gem_hw_glib_HwGLIB_h
 #define gem_hw_glib_HwGLIB_h
 
+#include <atomic>
+
 #include "gem/hw/GEMHwDevice.h"
 
 #include "gem/hw/glib/exception/Exception.h"
@@ -330,6 +332,11 @@ namespace gem {
            * @throws gem::hw::glib::exception::InvalidLink if the link number is outside of 0-2
            **/
           GEMHwDevice::OpticalLinkStatus LinkStatus(uint8_t const& link);
+
+          /** Queue the reads of the link status registers on a transaction of this device
+           * @retval the status, once the transaction is dispatched, all zero for an invalid link
+           **/
+          GEMHwDevice::OpticalLinkStatusFuture LinkStatus(gem::hw::Transaction& transaction, uint8_t const& link);
 	  
           /** Reset the link status registers
            * @param uint8_t link is the number of the link to query
@@ -352,28 +359,32 @@ namespace gem {
               LinkReset(link->first,resets);
           };
 	  
+          /* The trigger and tracking data readout below is virtual so it can be replaced by
+           * a backend without hardware, see gem::readout::GLIBReplay
+           */
+
           /** Read the trigger data
            * @retval uint32_t returns 32 bits 6 bits for s-bits and 26 for bunch countrr
            **/
-          uint32_t readTriggerFIFO(uint8_t const& link);
+          virtual uint32_t readTriggerFIFO(uint8_t const& link);
 
           /** Empty the trigger data FIFO
            * 
            **/
-          void flushTriggerFIFO(uint8_t const& link);
+          virtual void flushTriggerFIFO(uint8_t const& link);
 
           /** Read the tracking data FIFO occupancy
            * @param uint8_t link is the number of the link to query
            * @retval uint32_t returns the number of events in the tracking data FIFO
            **/
-          uint32_t getFIFOOccupancy(uint8_t const& link);
+          virtual uint32_t getFIFOOccupancy(uint8_t const& link);
 
           /** see if there is tracking data available
            * @param uint8_t link is the number of the column of the tracking data to read
            * @retval bool returns true if there is tracking data in the FIFO
            TRK_DATA.COLX.DATA_RDY
           */
-          bool hasTrackingData(uint8_t const& link);
+          virtual bool hasTrackingData(uint8_t const& link);
 
           /** get the tracking data, have to do this intelligently, as each column will be independent (for now)
               and need to pack all events together
@@ -386,11 +397,64 @@ namespace gem {
           */
           std::vector<uint32_t> getTrackingData(uint8_t const& link);
 
+          /** get the 7 tracking data words of a single chip into a caller owned buffer
+           * the buffer keeps its capacity, so a reused buffer is not reallocated
+           * @param uint8_t link is the number of the column of the tracking data to read
+           * @param std::vector<uint32_t> data filled with the 7 data words, zeros for an invalid link
+           TRK_DATA.COLX.DATA.[0-6]
+          */
+          virtual void getTrackingData(uint8_t const& link, std::vector<uint32_t>& data);
+
+          /** number of words per VFAT block returned by drainTrackingFIFO:
+           * the seven tracking data words followed by the trigger data word
+           **/
+          static const uint32_t TRACKING_BLOCK_WORDS = 8;
+
+          /** drain the tracking data FIFO in a single transaction
+           * reads the FIFO occupancy once, then queues the DATA_RDY, DATA.[0-6]
+           * and trigger data reads for up to maxBlocks VFAT blocks and dispatches them together
+           * @param uint8_t link is the number of the column of the tracking data to read
+           * @param uint32_t maxBlocks is the maximum number of VFAT blocks to read
+           * @retval std::vector<uint32_t> contiguous buffer of TRACKING_BLOCK_WORDS words per
+           * VFAT block that was ready, empty if the FIFO was empty
+           TRK_DATA.COLX.DATA_RDY
+           TRK_DATA.COLX.DATA.[0-6]
+           GLIB_LINKS.TRG_DATA.DATA
+          */
+          std::vector<uint32_t> drainTrackingFIFO(uint8_t const& link, uint32_t const& maxBlocks);
+
+          /** drain the tracking data FIFO in a single transaction into a caller owned buffer
+           * the buffer is cleared first and keeps its capacity, so a reused buffer is not reallocated
+           * @param uint8_t link is the number of the column of the tracking data to read
+           * @param uint32_t maxBlocks is the maximum number of VFAT blocks to read
+           * @param std::vector<uint32_t> data filled with TRACKING_BLOCK_WORDS words per VFAT block that was ready
+           * @retval uint32_t returns the number of VFAT blocks stored in data
+          */
+          uint32_t drainTrackingFIFO(uint8_t const& link, uint32_t const& maxBlocks, std::vector<uint32_t>& data);
+
+          /** drain the tracking data FIFO in a single transaction straight into memory owned elsewhere,
+           * e.g. a frame of an xdaq memory pool
+           * @param uint8_t link is the number of the column of the tracking data to read
+           * @param uint32_t maxBlocks is the maximum number of VFAT blocks to read
+           * @param uint32_t* data room for maxBlocks*TRACKING_BLOCK_WORDS words, filled with
+           * TRACKING_BLOCK_WORDS words per VFAT block that was ready
+           * @retval uint32_t returns the number of VFAT blocks stored in data
+           * Reading the FIFO pops it, so a failed drain is not retried: the blocks it may have
+           * popped are lost, none is returned and they are counted by getLostBlocks
+          */
+          virtual uint32_t drainTrackingFIFO(uint8_t const& link, uint32_t const& maxBlocks, uint32_t* data);
+
+          /** @param uint8_t link is the number of the link to query
+           * @retval uint64_t returns the blocks of the failed drains of the link, at most those
+           * the FIFO held when each drain started
+           **/
+          uint64_t getLostBlocks(uint8_t const& link) const { return (link < 3) ? lostBlocks_[link].load() : 0; };
+
           /** Empty the tracking data FIFO
            * @param uint8_t link is the number of the link to query
            * 
            **/
-          void flushFIFO(uint8_t const& link);
+          virtual void flushFIFO(uint8_t const& link);
 
 
         protected:
@@ -404,6 +468,32 @@ namespace gem {
 
 	
           bool links[3];
+
+          /** registers of one tracking data block per link, built on first use
+           * DATA_RDY, DATA.[0-6], TRG_DATA.DATA
+           **/
+          std::vector<gem::hw::RegisterHandle> trackingBlockRegs_[3];
+
+          /** tracking data FIFO depth register per link, built with trackingBlockRegs_
+           **/
+          gem::hw::RegisterHandle trackingFIFODepthReg_[3];
+
+          /** registers of the tracking data readout of a link, built on first use
+           * @retval the entries of trackingBlockRegs_, trackingFIFODepthReg_ is set as well
+           **/
+          std::vector<gem::hw::RegisterHandle>& getTrackingBlockRegs(uint8_t const& link);
+
+          /** register list of the drains per link, only grows, a drain reads the first blocks of it
+           **/
+          gem::hw::register_handle_list trackingBlockData_[3];
+
+          /** register list of getTrackingData per link, DATA.[0-6]
+           **/
+          gem::hw::register_handle_list trackingWordData_[3];
+
+          /** blocks lost by failed drains per link, read by the monitoring while the links are drained
+           **/
+          std::atomic<uint64_t> lostBlocks_[3];
 	    
           std::vector<linkStatus> activeLinks;
 
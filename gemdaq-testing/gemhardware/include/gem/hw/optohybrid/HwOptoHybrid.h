@@ -94,6 +94,11 @@ namespace gem {
            **/
           GEMHwDevice::OpticalLinkStatus LinkStatus(uint8_t const& link) ;
 
+          /** Queue the reads of the link status registers on a transaction of this device
+           * @retval the status, once the transaction is dispatched, all zero for an invalid link
+           **/
+          GEMHwDevice::OpticalLinkStatusFuture LinkStatus(gem::hw::Transaction& transaction, uint8_t const& link);
+
           /** Reset the link status registers
            * @param uint8_t link is the number of the link to query
            * @param uint8_t resets control which bits to reset
@@ -126,22 +131,24 @@ namespace gem {
            * @param bool fallback uses the external clock, false uses the onboard clock
            **/
           void SetVFATClock(bool source, bool fallback, uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            writeReg(getDeviceBaseNode(),regName.str()+".CLOCKING.VFAT.SOURCE"  ,(uint32_t)source  );
-            writeReg(getDeviceBaseNode(),regName.str()+".CLOCKING.VFAT.FALLBACK",(uint32_t)fallback);
+            std::string const regName = getLinkNode()+".CLOCKING.VFAT.";
+            gem::hw::Transaction transaction(*this);
+            transaction.write(regName+"SOURCE"  ,(uint32_t)source  );
+            transaction.write(regName+"FALLBACK",(uint32_t)fallback);
+            transaction.dispatch();
           };
           /** VFAT clock status
            * @param bool source true uses the external clock, false uses the onboard clock
            * @param bool fallback uses the external clock, false uses the onboard clock
            **/
           std::pair<bool,bool> StatusVFATClock(uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            uint32_t src = readReg(getDeviceBaseNode(),regName.str()+".CLOCKING.VFAT.SOURCE");
-            uint32_t flb = readReg(getDeviceBaseNode(),regName.str()+".CLOCKING.VFAT.FALLBACK");
+            std::string const regName = getLinkNode()+".CLOCKING.VFAT.";
+            gem::hw::Transaction transaction(*this);
+            gem::hw::TransactionFuture<bool> src = transaction.read<bool>(regName+"SOURCE");
+            gem::hw::TransactionFuture<bool> flb = transaction.read<bool>(regName+"FALLBACK");
             //maybe do a check to ensure that the value has been read properly?
-            return std::make_pair(src,flb);
+            transaction.dispatch();
+            return std::make_pair(src.value(),flb.value());
           };
 
           /** Setup the CDCE clock 
@@ -149,10 +156,11 @@ namespace gem {
            * @param bool fallback uses the external clock, false uses the onboard clock
            **/
           void SetCDCEClock(bool source, bool fallback, uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            writeReg(getDeviceBaseNode(),regName.str()+".CLOCKING.CDCE.SOURCE"  ,(uint32_t)source  );
-            writeReg(getDeviceBaseNode(),regName.str()+".CLOCKING.CDCE.FALLBACK",(uint32_t)fallback);
+            std::string const regName = getLinkNode()+".CLOCKING.CDCE.";
+            gem::hw::Transaction transaction(*this);
+            transaction.write(regName+"SOURCE"  ,(uint32_t)source  );
+            transaction.write(regName+"FALLBACK",(uint32_t)fallback);
+            transaction.dispatch();
           };
       
           /** CDCE clock status
@@ -160,12 +168,13 @@ namespace gem {
            * @param bool fallback uses the external clock, false uses the onboard clock
            **/
           std::pair<bool,bool> StatusCDCEClock(uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            uint32_t src = readReg(getDeviceBaseNode(),regName.str()+".CLOCKING.CDCE.SOURCE");
-            uint32_t flb = readReg(getDeviceBaseNode(),regName.str()+".CLOCKING.CDCE.FALLBACK");
+            std::string const regName = getLinkNode()+".CLOCKING.CDCE.";
+            gem::hw::Transaction transaction(*this);
+            gem::hw::TransactionFuture<bool> src = transaction.read<bool>(regName+"SOURCE");
+            gem::hw::TransactionFuture<bool> flb = transaction.read<bool>(regName+"FALLBACK");
             //maybe do a check to ensure that the value has been read properly?
-            return std::make_pair(src,flb);
+            transaction.dispatch();
+            return std::make_pair(src.value(),flb.value());
           };
 
           ///** Read the VFAT clock source
@@ -263,20 +272,18 @@ namespace gem {
            * @param uint64_t ntrigs, how many L1As to send
            **/
           void SendL1A(uint64_t ntrigs, uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
+            gem::hw::RegisterHandle& reg = getT1Registers().sendL1A;
             for (uint64_t i = 0; i < ntrigs; ++i) 
-              writeReg(getDeviceBaseNode(),regName.str()+".FAST_COM.Send.L1A",0x1);
+              writeReg(reg,0x1);
           };
 
           /** Send an internal CalPulse
            * @param uint64_t npulse, how many CalPulses to send
            **/
           void SendCalPulse(uint64_t npulse, uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
+            gem::hw::RegisterHandle& reg = getT1Registers().sendCalPulse;
             for (uint64_t i = 0; i < npulse; ++i) 
-              writeReg(getDeviceBaseNode(),regName.str()+".FAST_COM.Send.CalPulse",0x1);
+              writeReg(reg,0x1);
           };
 
           /** Send an internal L1A and CalPulse
@@ -284,28 +291,23 @@ namespace gem {
            * @param uint32_t delay, how long between L1A and CalPulse
            **/
           void SendL1ACal(uint64_t npulse, uint32_t delay, uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
+            gem::hw::RegisterHandle& reg = getT1Registers().sendL1ACalPulse;
             for (uint64_t i = 0; i < npulse; ++i) 
-              writeReg(getDeviceBaseNode(),regName.str()+".FAST_COM.Send.L1ACalPulse",delay);
+              writeReg(reg,delay);
           };
 
           /** Send an internal Resync
            * 
            **/
           void SendResync(uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            writeReg(getDeviceBaseNode(),regName.str()+".FAST_COM.Send.Resync",0x1); };
+            writeReg(getT1Registers().sendResync,0x1); };
 
 
           /** Send an internal BC0
            * 
            **/
           void SendBC0(uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            writeReg(getDeviceBaseNode(),regName.str()+".FAST_COM.Send.BC0",0x1); };
+            writeReg(getT1Registers().sendBC0,0x1); };
 
           ///Counters
           /** Get the recorded number of L1A signals
@@ -316,20 +318,7 @@ namespace gem {
            * 3 total
            **/
           uint32_t GetL1ACount(uint8_t const& mode, uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            switch(mode) {
-            case 0:
-              return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.L1A.External");
-            case 1:
-              return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.L1A.Internal");
-            case 2:
-              return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.L1A.Delayed");
-            case 3:
-              return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.L1A.Total");
-            default:
-              return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.L1A.Total");
-            }
+            return readReg(getT1Registers().l1aCount[mode < 4 ? mode : 3]);
           };
 	  
           /** Get the recorded number of CalPulse signals
@@ -339,40 +328,54 @@ namespace gem {
            * 2 total
            **/
           uint32_t GetCalPulseCount(uint8_t const& mode, uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            switch(mode) {
-            case 0:
-              return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.CalPulse.Internal");
-            case 1:
-              return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.CalPulse.Delayed");
-            case 2:
-              return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.CalPulse.Total");
-            default:
-              return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.CalPulse.Total");
-            }
+            return readReg(getT1Registers().calPulseCount[mode < 3 ? mode : 2]);
           };
 	  
           /** Get the recorded number of Resync signals
            **/
           uint32_t GetResyncCount(uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.Resync"); };
+            return readReg(getT1Registers().resyncCount); };
 
           /** Get the recorded number of BC0 signals
            **/
           uint32_t GetBC0Count(uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.BC0"); };
+            return readReg(getT1Registers().bc0Count); };
 
           /** Get the recorded number of BXCount signals
            **/
           uint32_t GetBXCountCount(uint8_t const& link=0x0) {
-            std::stringstream regName;
-            regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
-            return readReg(getDeviceBaseNode(),regName.str()+".COUNTERS.BXCount"); };
+            return readReg(getT1Registers().bxCount); };
+
+          /** Recorded numbers of each type of T1 signal of the control link
+           **/
+          typedef struct T1Counters {
+            uint32_t L1A[4];      // external, internal, delayed, total
+            uint32_t CalPulse[3]; // internal, delayed, total
+            uint32_t Resync;
+            uint32_t BC0;
+
+            T1Counters() : L1A(), CalPulse(), Resync(0), BC0(0) {};
+          } T1Counters;
+
+          /** Get the recorded numbers of all the T1 signals, read in a single transaction
+           **/
+          T1Counters GetT1Counters();
+
+          /** T1Counters read by a Transaction
+           **/
+          typedef struct T1CountersFuture {
+            gem::hw::TransactionFuture<uint32_t> L1A[4];
+            gem::hw::TransactionFuture<uint32_t> CalPulse[3];
+            gem::hw::TransactionFuture<uint32_t> Resync;
+            gem::hw::TransactionFuture<uint32_t> BC0;
+
+            T1Counters value() const;
+          } T1CountersFuture;
+
+          /** Queue the reads of all the T1 counters on a transaction of this device
+           * @retval the counters, once the transaction is dispatched
+           **/
+          T1CountersFuture GetT1Counters(gem::hw::Transaction& transaction);
 	  
           ///Resets
           /** Reset recorded number of L1A signals
@@ -398,16 +401,12 @@ namespace gem {
             case 3:
               return writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.L1A.Delayed", 0x1);
             case 4:
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.L1A.External", 0x1);
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.L1A.Internal", 0x1);
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.L1A.Delayed",  0x1);
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.L1A.Total",    0x1);
-              return;
             default:
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.L1A.External", 0x1);
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.L1A.Internal", 0x1);
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.L1A.Delayed",  0x1);
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.L1A.Total",    0x1);
+              {
+                gem::hw::Transaction transaction(*this);
+                ResetL1ACounts(transaction);
+                transaction.dispatch();
+              }
               return;
             }
           };
@@ -434,14 +433,12 @@ namespace gem {
               writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.CalPulse.Delayed", 0x1);
               return;
             case 3:
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.CalPulse.Internal", 0x1);
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.CalPulse.Delayed",  0x1);
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.CalPulse.Total",    0x1);
-              return;
             default:
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.CalPulse.Internal", 0x1);
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.CalPulse.Delayed",  0x1);
-              writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.CalPulse.Total",    0x1);
+              {
+                gem::hw::Transaction transaction(*this);
+                ResetCalPulseCounts(transaction);
+                transaction.dispatch();
+              }
               return;
             }
           };
@@ -464,6 +461,10 @@ namespace gem {
             regName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
             return writeReg(getDeviceBaseNode(),regName.str()+".COUNTERS.RESETS.BC0", 0x1); };
 
+          /** Reset all the T1 counters in a single transaction
+           **/
+          void ResetT1Counters();
+
           /** Get the recorded number of BXCount signals
            **/
           void ResetBXCount() {
@@ -479,6 +480,24 @@ namespace gem {
             return getGEMHwInterface(); };
 
           std::vector<linkStatus> getActiveLinks() { return activeLinks; }
+
+          /** Status of the OptoHybrid shown by the monitoring
+           **/
+          typedef struct OptoHybridStatus {
+            uint32_t                Firmware;   // of the control link
+            std::vector<linkStatus> Links;      // status of each active link
+            std::pair<bool,bool>    VFATClock;  // source, fallback
+            std::pair<bool,bool>    CDCEClock;  // source, fallback
+            uint8_t                 TrigSource;
+            uint8_t                 SBitSource;
+            T1Counters              Counters;
+
+            OptoHybridStatus() : Firmware(0), TrigSource(0), SBitSource(0) {};
+          } OptoHybridStatus;
+
+          /** Read the status of the control link and the active links in a single transaction
+           **/
+          OptoHybridStatus getStatus();
           bool isLinkActive(int i) { return links[i]; }
 
         protected:
@@ -496,6 +515,41 @@ namespace gem {
           std::vector<linkStatus> activeLinks;
 
         private:
+          /** the node of the control link, below the device base node
+           **/
+          std::string getLinkNode() const {
+            std::stringstream regName;
+            regName << getDeviceBaseNode() << ".OptoHybrid_LINKS.LINK" << (int)m_controlLink;
+            return regName.str(); };
+
+          /** Queue the resets of all the L1A, resp. CalPulse, counters on a transaction
+           **/
+          void ResetL1ACounts(gem::hw::Transaction& transaction);
+          void ResetCalPulseCounts(gem::hw::Transaction& transaction);
+
+          /** T1 command and counter registers of the control link
+           **/
+          struct T1Registers {
+            gem::hw::RegisterHandle sendL1A;
+            gem::hw::RegisterHandle sendCalPulse;
+            gem::hw::RegisterHandle sendL1ACalPulse;
+            gem::hw::RegisterHandle sendResync;
+            gem::hw::RegisterHandle sendBC0;
+            gem::hw::RegisterHandle l1aCount[4];      // External, Internal, Delayed, Total
+            gem::hw::RegisterHandle calPulseCount[3]; // Internal, Delayed, Total
+            gem::hw::RegisterHandle resyncCount;
+            gem::hw::RegisterHandle bc0Count;
+            gem::hw::RegisterHandle bxCount;
+          };
+
+          /** the T1 registers, built on first use and again when the control link changes
+           **/
+          T1Registers& getT1Registers();
+
+          T1Registers t1Regs_;
+          uint8_t     t1RegsLink_; // control link t1Regs_ were built for
+          bool        t1RegsBuilt_;
+
           uint8_t m_controlLink;
           int m_slot;
 	  
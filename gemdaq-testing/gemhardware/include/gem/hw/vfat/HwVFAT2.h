@@ -58,6 +58,12 @@ namespace gem {
 	  
           //where can we load default parameters?
           void loadDefaults();
+
+          /** getDefaultSettings()
+           * @returns the registers written by loadDefaults with their default values, in the order
+           * they are written; ContReg0 puts the chip in sleep mode, which loadDefaults does not change
+           */
+          vfat_reg_pair_list getDefaultSettings();
           //void connectDevice();
           //void releaseDevice();
           //void initDevice();
@@ -120,6 +126,20 @@ namespace gem {
                                                             //bit 7:0   - register value
                                                             return readReg(getDeviceBaseNode(),regName)&0x000000ff; }*/;
 
+          /** uint8_t  readVFATReg( gem::hw::RegisterHandle& reg, bool debug)
+           * Reads a register on the VFAT2 chip, checking the transaction status
+           * @param reg is the VFAT2 register to read, obtained with getRegister
+           * @returns 8-bit register from the VFAT chip, throws if the transaction failed
+           */
+          uint8_t  readVFATReg( gem::hw::RegisterHandle& reg, bool debug);
+
+          /** uint8_t  readVFATReg( gem::hw::RegisterHandle& reg)
+           * Reads a register on the VFAT2 chip
+           * @param reg is the VFAT2 register to read, obtained with getRegister
+           * @returns 8-bit register from the VFAT chip, 0xff if the transaction failed
+           */
+          uint8_t  readVFATReg( gem::hw::RegisterHandle& reg);
+
           /** readVFATRegs( vfat_reg_pair_list &regList)
            * Reads a list of registers on the VFAT2 chip into the provided key pair
            * @param regList is the list of pairs of register names to read, and values to return
@@ -133,10 +153,27 @@ namespace gem {
 
           /** readVFAT2Counters()
            * Reads the counters on the VFAT2 chip and writes the values into the vfatParams_ object
+           * done with a single dispatch call
            */
           //void     readVFAT2Counters(gem::hw::vfat::VFAT2ControlParams &params);
           void     readVFAT2Counters();
 
+          /** readVFAT2Counters(gem::hw::Transaction& transaction, std::vector<gem::hw::TransactionFuture<uint32_t> >& counters)
+           * Queues the reads of the counters on a transaction, which may be the one of another HwVFAT2
+           * connected to the same hardware, to read several chips in a single dispatch; on the
+           * transaction of another chip the counters are queued by name
+           * @param counters the futures of the counters, to give to storeVFAT2Counters once dispatched
+           */
+          void     readVFAT2Counters(gem::hw::Transaction& transaction,
+                                     std::vector<gem::hw::TransactionFuture<uint32_t> >& counters);
+
+          /** storeVFAT2Counters(std::vector<gem::hw::TransactionFuture<uint32_t> > const& counters)
+           * Writes the counters read into the vfatParams_ object
+           * @param counters the futures of readVFAT2Counters, or the first ones of the settings registers
+           * @returns true if the chip ID was read
+           */
+          bool     storeVFAT2Counters(std::vector<gem::hw::TransactionFuture<uint32_t> > const& counters);
+
           /*
             void     writeReg(std::string const& regName,
             uint32_t const writeVal) {
@@ -157,20 +194,54 @@ namespace gem {
            * @param writeValue is the value to write into the VFAT register
            */
           void     writeVFATReg(std::string const& regName,
-                                uint8_t     const& writeVal) {
-            writeReg(getDeviceBaseNode(), regName, static_cast<uint32_t>(writeVal)); };
+                                uint8_t     const& writeVal);
+
+          /** writeVFATReg( gem::hw::RegisterHandle& reg, uint8_t const& writeVal)
+           * Writes a value to a register on the VFAT2 chip
+           * @param reg is the VFAT2 register to write to, obtained with getRegister
+           * @param writeValue is the value to write into the VFAT register
+           * With the register shadow enabled the register is read back to fill its shadow
+           */
+          void     writeVFATReg(gem::hw::RegisterHandle& reg,
+                                uint8_t     const& writeVal);
+
+          /** writeVFATRegBits( std::string const& regName, uint8_t const& mask, uint8_t const& bits)
+           * Sets some bits of a register on the VFAT2 chip, keeping the others; the register
+           * is read first, unless the register shadow holds its contents
+           * @param regName is the name of the VFAT2 register to modify
+           * @param mask selects the bits to set
+           * @param bits is the value of the bits, in the position given by mask
+           */
+          void     writeVFATRegBits(std::string const& regName,
+                                    uint8_t const& mask, uint8_t const& bits);
 
           /** writeVFATReg( vfat_reg_pair_list const& regList)
            * Writes to a list of VFAT2 registers from a list of pairs of register name and value 
-           * done with a single dispatch call
+           * done with a single dispatch call; with the register shadow enabled the registers are
+           * also read back in it, and checked with checkVFATRegs
            * @param regList is the list of pairs of register names and values to write
            */
-          void     writeVFATRegs(vfat_reg_pair_list const& regList) {
-            register_pair_list fullRegList;
-            for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
-              fullRegList.push_back(std::make_pair(getDeviceBaseNode()+"."+curReg->first,static_cast<uint32_t>(curReg->second)));
-            writeRegs(fullRegList);
-          };
+          void     writeVFATRegs(vfat_reg_pair_list const& regList);
+
+          /** writeVFATRegs( gem::hw::Transaction& transaction, vfat_reg_pair_list const& regList,
+           *                 std::vector<gem::hw::TransactionFuture<uint32_t> >& readBack)
+           * Queues the writes of a list of VFAT2 registers on a transaction, which may be the one of
+           * another HwVFAT2 connected to the same hardware, followed by the reads of the same registers;
+           * on the transaction of another chip the registers are queued by name
+           * @param regList is the list of pairs of register names and values to write
+           * @param readBack the futures of the registers read, to give to checkVFATRegs once dispatched
+           */
+          void     writeVFATRegs(gem::hw::Transaction& transaction, vfat_reg_pair_list const& regList,
+                                 std::vector<gem::hw::TransactionFuture<uint32_t> >& readBack);
+
+          /** checkVFATRegs( vfat_reg_pair_list const& regList,
+           *                 std::vector<gem::hw::TransactionFuture<uint32_t> > const& readBack)
+           * Compares the registers read back after writeVFATRegs with the values written,
+           * the values read are kept in the register shadow
+           * @returns the number of registers that could not be read or differ from the value written
+           */
+          int      checkVFATRegs(vfat_reg_pair_list const& regList,
+                                 std::vector<gem::hw::TransactionFuture<uint32_t> > const& readBack);
 
           /** writeValueToVFATRegs( std::vector<std::string> const& regList, uint8_t const& regValue)
            * Writes a single value to a list of VFAT2 registers, all done with a single dispatch call
@@ -178,10 +249,38 @@ namespace gem {
            * @param regValue is the value to write to each of the registers in the list
            */
           void     writeValueToVFATRegs(std::vector<std::string> const& regList, uint8_t const& regValue) {
-            std::vector<std::string > fullRegList;
+            vfat_reg_pair_list valRegList;
             for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
-              fullRegList.push_back(getDeviceBaseNode()+"."+*curReg);
-            writeValueToRegs(regList,static_cast<uint32_t>(regValue)); };
+              valRegList.push_back(std::make_pair(*curReg,regValue));
+            writeVFATRegs(valRegList); };
+
+          /** setShadowEnabled(bool enable)
+           * The register shadow is a write-through copy of the control, bias and channel registers,
+           * filled by the writes and reads done through this object. With it, the setters of the
+           * fields of a control or channel register only write, instead of reading the register first.
+           * The IPbus write of a VFAT2 register succeeds even if the chip rejects it over I2C, so with
+           * the shadow enabled each register written is read back in the same dispatch, and the shadow
+           * keeps the value read, or nothing if its VFAT2 transaction failed.
+           * Registers changed by other means (writeReg, a reset of the chip) are not seen by the
+           * shadow: call invalidateShadow() or verifyShadow() after such changes.
+           * The shadow is disabled by default, enabling it starts with an empty shadow.
+           * @param enable turns the shadow on or off
+           */
+          void     setShadowEnabled(bool enable);
+          bool     isShadowEnabled() const { return shadowEnabled_; };
+
+          /** invalidateShadow()
+           * Empties the register shadow, each register is read again before its first modification
+           */
+          void     invalidateShadow();
+
+          /** verifyShadow()
+           * Reads all the settings with getAllSettings, compares them to the register shadow and
+           * stores them in the shadow; also done automatically for the registers read when a change
+           * of UpsetReg shows a single event upset
+           * @returns the number of registers that differed from the shadow, -1 if the read failed
+           */
+          int      verifyShadow();
 	  
           //control functions
           //void reset();
@@ -201,10 +300,8 @@ namespace gem {
           /// and do a single IPBus transaction...
 	  
           void setRunMode(VFAT2RunMode mode) {
-            uint8_t settings = readVFATReg("ContReg0");
-            writeVFATReg("ContReg0",
-                         (settings&~VFAT2ContRegBitMasks::RUNMODE)|
-                         (mode<<VFAT2ContRegBitShifts::RUNMODE)); };
+            writeVFATRegBits("ContReg0", VFAT2ContRegBitMasks::RUNMODE,
+                             mode<<VFAT2ContRegBitShifts::RUNMODE); };
 	  
           void setRunMode(VFAT2RunMode mode, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::RUNMODE)|
@@ -216,10 +313,8 @@ namespace gem {
             setRunMode(static_cast<VFAT2RunMode>(mode), settings); };
 
           void setTriggerMode(VFAT2TrigMode mode) {
-            uint8_t settings = readVFATReg("ContReg0");
-            writeVFATReg("ContReg0",
-                         (settings&~VFAT2ContRegBitMasks::TRIGMODE)|
-                         (mode<<VFAT2ContRegBitShifts::TRIGMODE)); };
+            writeVFATRegBits("ContReg0", VFAT2ContRegBitMasks::TRIGMODE,
+                             mode<<VFAT2ContRegBitShifts::TRIGMODE); };
 
           void setTriggerMode(VFAT2TrigMode mode, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::TRIGMODE)|
@@ -231,10 +326,8 @@ namespace gem {
             setTriggerMode(static_cast<VFAT2TrigMode>(mode), settings); };
 
           void setCalibrationMode(VFAT2CalibMode mode) {
-            uint8_t settings = readVFATReg("ContReg0");
-            writeVFATReg("ContReg0",
-                         (settings&~VFAT2ContRegBitMasks::CALMODE)|
-                         (mode<<VFAT2ContRegBitShifts::CALMODE)); };
+            writeVFATRegBits("ContReg0", VFAT2ContRegBitMasks::CALMODE,
+                             mode<<VFAT2ContRegBitShifts::CALMODE); };
 
           void setCalibrationMode(VFAT2CalibMode mode, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::CALMODE)|
@@ -246,10 +339,8 @@ namespace gem {
             setCalibrationMode(static_cast<VFAT2CalibMode>(mode), settings); };
 
           void setMSPolarity(VFAT2MSPol polarity) {
-            uint8_t settings = readVFATReg("ContReg0");
-            writeVFATReg("ContReg0",
-                         (settings&~VFAT2ContRegBitMasks::MSPOL)|
-                         (polarity<<VFAT2ContRegBitShifts::MSPOL)); };
+            writeVFATRegBits("ContReg0", VFAT2ContRegBitMasks::MSPOL,
+                             polarity<<VFAT2ContRegBitShifts::MSPOL); };
 	  
           void setMSPolarity(VFAT2MSPol polarity, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::MSPOL)|
@@ -261,10 +352,8 @@ namespace gem {
             setMSPolarity(static_cast<VFAT2MSPol>(mode), settings); };
 
           void setCalPolarity(VFAT2CalPol polarity) {
-            uint8_t settings = readVFATReg("ContReg0");
-            writeVFATReg("ContReg0",
-                         (settings&~VFAT2ContRegBitMasks::CALPOL)|
-                         (polarity<<VFAT2ContRegBitShifts::CALPOL)); };
+            writeVFATRegBits("ContReg0", VFAT2ContRegBitMasks::CALPOL,
+                             polarity<<VFAT2ContRegBitShifts::CALPOL); };
 	  
           void setCalPolarity(VFAT2CalPol polarity, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::CALPOL)|
@@ -276,10 +365,8 @@ namespace gem {
             setCalPolarity(static_cast<VFAT2CalPol>(mode), settings); };
 
           void setProbeMode(VFAT2ProbeMode mode) {
-            uint8_t settings = readVFATReg("ContReg1");
-            writeVFATReg("ContReg1",
-                         (settings&~VFAT2ContRegBitMasks::PROBEMODE)|
-                         (mode<<VFAT2ContRegBitShifts::PROBEMODE)); };
+            writeVFATRegBits("ContReg1", VFAT2ContRegBitMasks::PROBEMODE,
+                             mode<<VFAT2ContRegBitShifts::PROBEMODE); };
 
           void setProbeMode(VFAT2ProbeMode mode, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::PROBEMODE)|
@@ -291,10 +378,8 @@ namespace gem {
             setProbeMode(static_cast<VFAT2ProbeMode>(mode), settings); };
 
           void setLVDSMode(VFAT2LVDSMode mode) {
-            uint8_t settings = readVFATReg("ContReg1");
-            writeVFATReg("ContReg1",
-                         (settings&~VFAT2ContRegBitMasks::LVDSMODE)|
-                         (mode<<VFAT2ContRegBitShifts::LVDSMODE)); };
+            writeVFATRegBits("ContReg1", VFAT2ContRegBitMasks::LVDSMODE,
+                             mode<<VFAT2ContRegBitShifts::LVDSMODE); };
 
           void setLVDSMode(VFAT2LVDSMode mode, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::LVDSMODE)|
@@ -306,10 +391,8 @@ namespace gem {
             setLVDSMode(static_cast<VFAT2LVDSMode>(mode), settings); };
 
           void setDACMode(VFAT2DACMode mode) {
-            uint8_t settings = readVFATReg("ContReg1");
-            writeVFATReg("ContReg1",
-                         (settings&~VFAT2ContRegBitMasks::DACMODE)|
-                         (mode<<VFAT2ContRegBitShifts::DACMODE)); };
+            writeVFATRegBits("ContReg1", VFAT2ContRegBitMasks::DACMODE,
+                             mode<<VFAT2ContRegBitShifts::DACMODE); };
 
           void setDACMode(VFAT2DACMode mode, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::DACMODE)|
@@ -321,10 +404,8 @@ namespace gem {
             setDACMode(static_cast<VFAT2DACMode>(mode), settings); };
 
           void setHitCountCycleTime(VFAT2ReHitCT cycleTime) {
-            uint8_t settings = readVFATReg("ContReg1");
-            writeVFATReg("ContReg1",
-                         (settings&~VFAT2ContRegBitMasks::REHITCT)|
-                         (cycleTime<<VFAT2ContRegBitShifts::REHITCT)); };
+            writeVFATRegBits("ContReg1", VFAT2ContRegBitMasks::REHITCT,
+                             cycleTime<<VFAT2ContRegBitShifts::REHITCT); };
 
           void setHitCountCycleTime(VFAT2ReHitCT cycleTime, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::REHITCT)|
@@ -336,10 +417,8 @@ namespace gem {
             setHitCountCycleTime(static_cast<VFAT2ReHitCT>(mode), settings); };
 
           void setHitCountMode(VFAT2HitCountMode mode) {
-            uint8_t settings = readVFATReg("ContReg2");
-            writeVFATReg("ContReg2",
-                         (settings&~VFAT2ContRegBitMasks::HITCOUNTMODE)|
-                         (mode<<VFAT2ContRegBitShifts::HITCOUNTMODE)); };
+            writeVFATRegBits("ContReg2", VFAT2ContRegBitMasks::HITCOUNTMODE,
+                             mode<<VFAT2ContRegBitShifts::HITCOUNTMODE); };
 
           void setHitCountMode(VFAT2HitCountMode mode, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::HITCOUNTMODE)|
@@ -351,10 +430,8 @@ namespace gem {
             setHitCountMode(static_cast<VFAT2HitCountMode>(mode), settings); };
 
           void setMSPulseLength(VFAT2MSPulseLength length) {
-            uint8_t settings = readVFATReg("ContReg2");
-            writeVFATReg("ContReg2",
-                         (settings&~VFAT2ContRegBitMasks::MSPULSELENGTH)|
-                         (length<<VFAT2ContRegBitShifts::MSPULSELENGTH)); };
+            writeVFATRegBits("ContReg2", VFAT2ContRegBitMasks::MSPULSELENGTH,
+                             length<<VFAT2ContRegBitShifts::MSPULSELENGTH); };
 
           void setMSPulseLength(VFAT2MSPulseLength length, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::MSPULSELENGTH)|
@@ -366,10 +443,8 @@ namespace gem {
             setMSPulseLength(static_cast<VFAT2MSPulseLength>(mode), settings); };
 
           void setInputPadMode(VFAT2DigInSel mode) {
-            uint8_t settings = readVFATReg("ContReg2");
-            writeVFATReg("ContReg2",
-                         (settings&~VFAT2ContRegBitMasks::DIGINSEL)|
-                         (mode<<VFAT2ContRegBitShifts::DIGINSEL)); };
+            writeVFATRegBits("ContReg2", VFAT2ContRegBitMasks::DIGINSEL,
+                             mode<<VFAT2ContRegBitShifts::DIGINSEL); };
 
           void setInputPadMode(VFAT2DigInSel mode, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::DIGINSEL)|
@@ -381,10 +456,8 @@ namespace gem {
             setInputPadMode(static_cast<VFAT2DigInSel>(mode), settings); };
 
           void setTrimDACRange(VFAT2TrimDACRange range) {
-            uint8_t settings = readVFATReg("ContReg3");
-            writeVFATReg("ContReg3",
-                         (settings&~VFAT2ContRegBitMasks::TRIMDACRANGE)|
-                         (range<<VFAT2ContRegBitShifts::TRIMDACRANGE)); };
+            writeVFATRegBits("ContReg3", VFAT2ContRegBitMasks::TRIMDACRANGE,
+                             range<<VFAT2ContRegBitShifts::TRIMDACRANGE); };
 
           void setTrimDACRange(VFAT2TrimDACRange range, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::TRIMDACRANGE)|
@@ -396,10 +469,8 @@ namespace gem {
             setTrimDACRange(static_cast<VFAT2TrimDACRange>(mode), settings); };
 
           void setBandgapPad(VFAT2PadBandgap mode) {
-            uint8_t settings = readVFATReg("ContReg3");
-            writeVFATReg("ContReg3",
-                         (settings&~VFAT2ContRegBitMasks::PADBANDGAP)|
-                         (mode<<VFAT2ContRegBitShifts::PADBANDGAP)); };
+            writeVFATRegBits("ContReg3", VFAT2ContRegBitMasks::PADBANDGAP,
+                             mode<<VFAT2ContRegBitShifts::PADBANDGAP); };
 
           void setBandgapPad(VFAT2PadBandgap mode, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::PADBANDGAP)|
@@ -411,10 +482,8 @@ namespace gem {
             setBandgapPad(static_cast<VFAT2PadBandgap>(mode), settings); };
 
           void sendTestPattern(VFAT2DFTestPattern send) {
-            uint8_t settings = readVFATReg("ContReg3");
-            writeVFATReg("ContReg3",
-                         (settings&~VFAT2ContRegBitMasks::DFTESTMODE)|
-                         (send<<VFAT2ContRegBitShifts::DFTESTMODE)); };
+            writeVFATRegBits("ContReg3", VFAT2ContRegBitMasks::DFTESTMODE,
+                             send<<VFAT2ContRegBitShifts::DFTESTMODE); };
 
           void sendTestPattern(VFAT2DFTestPattern send, uint8_t& settings) {
             settings = (settings&~VFAT2ContRegBitMasks::DFTESTMODE)|
@@ -459,7 +528,13 @@ namespace gem {
           //void getAllSettings(gem::hw::vfat::VFAT2ControlParams &params);
           //void getAllSettings() {
           //  return getAllSettings(vfatParams_); };
-          void getAllSettings();
+          /** getAllSettings()
+           * Reads the control, bias, counter and channel registers into the vfatParams_ object,
+           * done with a single dispatch call; the transaction status bits are checked for each
+           * register, a register whose VFAT2 transaction failed leaves its settings unchanged;
+           * the values read also fill the register shadow, if enabled
+           */
+          void getAllSettings() { readAllSettings(); };
 	  
           //Get control register settings
           //CR0:<7:0::calMode<7:5>,calPol<4>.msPol<3>,trigMode<2:1>,runMode<0>>
@@ -571,11 +646,15 @@ namespace gem {
           //void    readVFAT2Channel(gem::hw::vfat::VFAT2ControlParams &params, uint8_t channel);
           void    readVFAT2Channel(uint8_t channel);
           //void    readVFAT2Channels(gem::hw::vfat::VFAT2ControlParams &params);
+          /** readVFAT2Channels()
+           * Reads the 128 channel registers into the vfatParams_ object, done with a single dispatch call
+           * a channel whose VFAT2 transaction failed keeps its previous settings
+           */
           void    readVFAT2Channels();
           void    enableCalPulseToChannel(uint8_t channel, bool on=true);
           void    maskChannel(uint8_t channel, bool on=true);
           uint8_t getChannelSettings(uint8_t channel) {
-            return readVFATReg(toolbox::toString("VFATChannels.ChanReg%d",(unsigned)channel));};
+            return readVFATReg(getChannelRegister(channel));};
           uint8_t getChannelTrimDAC(uint8_t channel);
           void    setChannelTrimDAC(uint8_t channel, uint8_t trimDAC);
           //void    setChannelTrimDAC(uint8_t channel, double trimDAC);
@@ -633,6 +712,87 @@ namespace gem {
           */
 	
         private:
+          /** contents of a register in the register shadow */
+          struct ShadowRegister {
+            ShadowRegister() : value(0x0), valid(false) {};
+
+            uint8_t value;
+            bool    valid;
+          };
+
+          /** @returns true if the transaction is dispatched by this chip, which may then queue its
+           * register handles; on the transaction of another chip the registers are queued by name,
+           * the handles are only resolved by their own chip
+           */
+          bool isOwnTransaction(gem::hw::Transaction const& transaction) const {
+            return &transaction.getDevice() == this; };
+
+          /** the shadow of a register obtained from getChannelRegister or getSettingsRegisters,
+           * null for other registers and for the read only counters
+           */
+          ShadowRegister* getShadow(gem::hw::RegisterHandle const& reg);
+
+          /** store a value read from the hardware in the shadow of the register, if enabled
+           * @returns true if the shadow held a different value
+           */
+          bool    refreshShadow(gem::hw::RegisterHandle const& reg, uint8_t const& value);
+
+          /** the handle for a control, bias, counter or channel register name, null for other registers */
+          gem::hw::RegisterHandle* findVFATRegister(std::string const& regName);
+
+          /** set bits of a register from its shadow, or from a read if it has none */
+          void    writeVFATRegBits(gem::hw::RegisterHandle& reg,
+                                   uint8_t const& mask, uint8_t const& bits);
+
+          /** body of getAllSettings and verifyShadow
+           * @returns the number of registers that differed from the shadow, -1 if the read failed
+           */
+          int     readAllSettings();
+
+          /** the channel register VFATChannels.ChanReg<channel>, channel 1 to 128
+           * the handles are built on first use
+           */
+          gem::hw::RegisterHandle& getChannelRegister(uint8_t const& channel);
+
+          /** the counter, control and bias registers read by getAllSettings
+           * the handles are built on first use
+           */
+          std::vector<gem::hw::RegisterHandle>& getSettingsRegisters();
+
+          /** decodeVFATReg(uint32_t const& readVal, std::string const& regName)
+           * @param readVal 32-bit word read from a VFAT2 register
+           * @param regName name of the register, for the error message
+           * @returns 8-bit register from the VFAT chip, throws if the transaction status bits show a failure
+           */
+          uint8_t decodeVFATReg(uint32_t const& readVal, std::string const& regName);
+
+          /** decodeVFATReg(gem::hw::TransactionFuture<uint32_t> const& readVal, gem::hw::RegisterHandle const& reg, uint8_t& value)
+           * @param readVal VFAT2 register word read by a Transaction
+           * @param value set to the 8-bit register, left unchanged if the IPbus or the VFAT2 transaction failed
+           * @returns true if value was set
+           */
+          bool    decodeVFATReg(gem::hw::TransactionFuture<uint32_t> const& readVal,
+                                gem::hw::RegisterHandle const& reg, uint8_t& value);
+
+          /** queue the reads of the channel registers, channel 1 to 128, in order */
+          void    readVFAT2Channels(gem::hw::Transaction& transaction,
+                                    std::vector<gem::hw::TransactionFuture<uint32_t> >& channels);
+
+          /** store the channel registers read into vfatParams_ and the register shadow
+           * @returns the number of channel registers that differed from the shadow
+           */
+          int     storeVFAT2Channels(std::vector<gem::hw::TransactionFuture<uint32_t> > const& channels);
+
+          /** decode a channel register into vfatParams_ */
+          void    storeVFAT2Channel(uint8_t const& channel, uint8_t const& chanSettings);
+
+          gem::hw::RegisterHandle channelRegs_[N_VFAT2_CHANNELS];
+          std::vector<gem::hw::RegisterHandle> settingsRegs_;
+
+          bool shadowEnabled_;
+          ShadowRegister channelShadow_[N_VFAT2_CHANNELS];
+          std::vector<ShadowRegister> settingsShadow_; // indexed as settingsRegs_
+          ShadowRegister upsetCount_; // last UpsetReg read, to detect single event upsets
 
           /*
             uhal::ValWord< uint8_t > r_vfat2_ctrl0        ;
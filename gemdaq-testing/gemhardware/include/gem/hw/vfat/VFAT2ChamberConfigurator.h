@@ -0,0 +1,103 @@
+#ifndef gem_hw_vfat_VFAT2ChamberConfigurator_h
+#define gem_hw_vfat_VFAT2ChamberConfigurator_h
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gem/hw/vfat/HwVFAT2.h"
+
+namespace gem {
+  namespace hw {
+    namespace vfat {
+
+      /** Configures the VFAT2 chips of a chamber with batched transactions
+       * Each chip is written the common register list, with its own overrides, and every register
+       * written is read back to check it. The chips behind the same IP address share their
+       * transactions: the counters of all of them are read in one dispatch, which also checks which
+       * chips respond, then the registers of all the responding chips are written and read back in a
+       * second dispatch, sent by uHAL as a pipeline of IPbus packets.
+       **/
+      class VFAT2ChamberConfigurator
+      {
+      public:
+        typedef std::shared_ptr<HwVFAT2> vfat_shared_ptr;
+
+        /** where the time of a configure() went */
+        struct ConfigureReport {
+          ConfigureReport() { reset(); };
+          void reset() {
+            nChips = 0; nConnected = 0; nConfigured = 0; nRegisters = 0; nBadRegisters = 0; nDispatches = 0;
+            countersMs = 0; writeMs = 0; totalMs = 0; };
+
+          unsigned nChips;        // chips to configure
+          unsigned nConnected;    // chips whose chip ID could be read
+          unsigned nConfigured;   // chips whose registers all read back as written
+          unsigned nRegisters;    // registers written
+          unsigned nBadRegisters; // registers that did not read back as written
+          unsigned nDispatches;
+
+          double countersMs; // reading the counters of all the chips
+          double writeMs;    // writing and reading back the registers of all the chips
+          double totalMs;
+        };
+
+        /** VFAT2ChamberConfigurator(std::vector<vfat_shared_ptr> const& chips)
+         * @param chips connected chips, which must use the same address table
+         */
+        explicit VFAT2ChamberConfigurator(std::vector<vfat_shared_ptr> const& chips);
+
+        /** setCommonSettings(vfat_reg_pair_list const& settings)
+         * @param settings registers written to every chip in this order, e.g. HwVFAT2::getDefaultSettings()
+         */
+        void setCommonSettings(vfat_reg_pair_list const& settings) { common_ = settings; };
+
+        /** setChipSettings(size_t const& chip, vfat_reg_pair_list const& settings)
+         * @param chip index of the chip in the list given to the constructor
+         * @param settings registers whose value for this chip replaces the common one, those that
+         * are not in the common settings are written after them
+         */
+        void setChipSettings(size_t const& chip, vfat_reg_pair_list const& settings);
+
+        /** @returns the registers written to a chip, the common settings with its overrides */
+        vfat_reg_pair_list getChipSettings(size_t const& chip) const;
+
+        /** configure()
+         * Writes the settings of all the chips and reads them back
+         * @returns true if every chip responded and all its registers read back as written
+         */
+        bool configure();
+
+        /** @returns true if the chip returned its chip ID in the last configure(), which is then
+         * in its HwVFAT2::getVFAT2Params()
+         */
+        bool isConnected(size_t const& chip) const {
+          return chip < connected_.size() && connected_[chip]; };
+
+        /** @returns true if the chip responded and read back as written in the last configure() */
+        bool isConfigured(size_t const& chip) const {
+          return chip < configured_.size() && configured_[chip]; };
+
+        ConfigureReport const& getReport() const { return report_; };
+
+        /** @returns a one line summary of the report of the last configure() */
+        std::string printReport() const;
+
+      private:
+        log4cplus::Logger gemLogger_;
+
+        std::vector<vfat_shared_ptr> chips_;
+        vfat_reg_pair_list common_;
+        std::vector<vfat_reg_pair_list> overrides_; // per chip
+        std::vector<bool> connected_;
+        std::vector<bool> configured_;
+
+        ConfigureReport report_;
+      };
+
+    } //end namespace gem::hw::vfat
+
+  } //end namespace gem::hw
+
+} //end namespace gem
+#endif
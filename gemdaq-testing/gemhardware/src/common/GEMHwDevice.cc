@@ -2,6 +2,19 @@
 
 #include "gem/hw/GEMHwDevice.h"
 
+namespace {
+  // position of the lowest bit of the field of a node mask, as uHAL shifts the values of masked nodes
+  uint32_t fieldShift(uint32_t mask)
+  {
+    uint32_t shift = 0;
+    while (mask && !(mask & 0x1)) {
+      mask >>= 1;
+      ++shift;
+    }
+    return shift;
+  }
+}
+
 gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName):
   //gemLogger_(gemLogger),
   //gemLogger_(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT(deviceName))),
@@ -9,7 +22,8 @@ gem::hw::GEMHwDevice::GEMHwDevice(std::string const& deviceName):
   //p_gemHW(0),
   gemLogger_(log4cplus::Logger::getInstance(deviceName)),
   hwLock_(toolbox::BSem::FULL, true),
-  is_connected_(false)
+  is_connected_(false),
+  connection_(0)
   //monGEMHw_(0)
 {
   //need to grab these parameters from the xml file or from some configuration space/file/db
@@ -53,7 +67,8 @@ gem::hw::GEMHwDevice::GEMHwDevice(std::string const& connectionFile,
   //p_gemConnectionManager(0),
   //p_gemHW(0),
   hwLock_(toolbox::BSem::FULL, true),
-  is_connected_(false)
+  is_connected_(false),
+  connection_(0)
   //monGEMHw_(0)
 {
   gemLogger_ = log4cplus::Logger::getInstance(cardName);
@@ -148,6 +163,8 @@ void gem::hw::GEMHwDevice::connectDevice()
   }
   
   p_gemHW.swap(tmpHWP);
+  // the register handles resolved so far refer to the previous connection
+  ++connection_;
   if (isHwConnected())
     INFO("connectDevice::HwDevice pointer active");
   else
@@ -272,136 +289,325 @@ uint32_t gem::hw::GEMHwDevice::readReg(std::string const& name)
 }
 
 void gem::hw::GEMHwDevice::readRegs(register_pair_list &regList)
+{
+  gem::hw::Transaction transaction(*this);
+  std::vector<gem::hw::TransactionFuture<uint32_t> > vals;
+  vals.reserve(regList.size());
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
+    vals.push_back(transaction.read(curReg->first));
+  if (!transaction.dispatch())
+    return;
+
+  auto curVal = vals.begin();
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curVal,++curReg) 
+    curReg->second = curVal->value();
+}
+
+void gem::hw::GEMHwDevice::writeReg(std::string const& name, uint32_t const val)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(hwLock_);
+  uhal::HwInterface& hw = getGEMHwInterface();
+  int retryCount = 0;
+  while (retryCount < MAX_IPBUS_RETRIES) {
+    try {
+      hw.getNode(name).write(val);
+      hw.dispatch();
+      return;
+      //break;
+    } catch (uhal::exception::exception const& err) {
+      std::string msgBase = toolbox::toString("Could not write to register '%s' (uHAL)", name.c_str());
+      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+      std::string errCode = toolbox::toString("%s",err.what());
+      if (knownErrorCode(errCode)) {
+        ++retryCount;
+        if (retryCount > 4)
+          DEBUG("Failed to write value 0x" << std::hex<< val << std::dec << " to register " << name <<
+                ", retrying. retryCount("<<retryCount<<")"
+                << std::endl);
+        updateErrorCounters(errCode);
+        continue;
+      } else {
+        ERROR(msg);
+        //XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+      }
+    } catch (std::exception const& err) {
+      std::string msgBase = toolbox::toString("Could not write to register '%s' (std)", name.c_str());
+      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+      ERROR(msg);
+      //XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+    }
+  }
+}
+
+void gem::hw::GEMHwDevice::writeRegs(register_pair_list const& regList)
+{
+  gem::hw::Transaction transaction(*this);
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
+    transaction.write(curReg->first, curReg->second);
+  transaction.dispatch();
+}
+
+bool gem::hw::GEMHwDevice::dispatch(gem::hw::Transaction& transaction)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(hwLock_);
+  uhal::HwInterface& hw = getGEMHwInterface();
+
+  typedef gem::hw::Transaction::Operation Operation;
+  std::vector<Operation> const& operations = transaction.operations_;
+  gem::hw::TransactionResults& results = *transaction.results_;
+
+  std::vector<uhal::ValWord<uint32_t> >   words;
+  std::vector<uint32_t>                   wordMasks; // field of the register word in each result
+  std::vector<uhal::ValVector<uint32_t> > blocks;
+  words.reserve(results.words.size());
+  wordMasks.reserve(results.words.size());
+  blocks.reserve(results.blocks.size());
+
+  int retryCount = 0;
+  while (retryCount < MAX_IPBUS_RETRIES) {
+    try {
+      words.clear();
+      wordMasks.clear();
+      blocks.clear();
+      for (auto op = operations.begin(); op != operations.end(); ++op) {
+        uhal::Node const& node = op->handle ? resolve(*op->handle) : hw.getNode(op->name);
+        switch (op->type) {
+        case Operation::READ:
+          words.push_back(node.read());
+          wordMasks.push_back(0xffffffff);
+          break;
+        case Operation::WRITE:
+          node.write(op->value);
+          break;
+        case Operation::RMW: {
+          // mask and value are in the bits of the node, as for read and write, RMWbits works on
+          // the whole register word so they are moved to the field the address table gives it
+          uint32_t nodeMask = node.getMask();
+          uint32_t shift    = fieldShift(nodeMask);
+          uint32_t mask     = (op->mask << shift) & nodeMask;
+          words.push_back(hw.getClient().rmw_bits(node.getAddress(), ~mask, (op->value << shift) & mask));
+          wordMasks.push_back(nodeMask);
+          break;
+        }
+        case Operation::READ_BLOCK:
+          blocks.push_back(node.readBlock(op->nWords));
+          break;
+        case Operation::WRITE_BLOCK:
+          node.writeBlock(transaction.writeBlocks_[op->index]);
+          break;
+        }
+      }
+      hw.dispatch();
+
+      auto curWord = results.words.begin();
+      auto curMask = wordMasks.begin();
+      for (auto val = words.begin(); val != words.end(); ++val, ++curWord, ++curMask)
+        *curWord = (val->value() & *curMask) >> fieldShift(*curMask);
+      auto curBlock = results.blocks.begin();
+      for (auto val = blocks.begin(); val != blocks.end(); ++val, ++curBlock)
+        curBlock->assign(val->begin(), val->end());
+      return true;
+    } catch (uhal::exception::exception const& err) {
+      std::string msgBase = "Could not dispatch transaction on registers:";
+      for (auto op = operations.begin(); op != operations.end(); ++op)
+        msgBase += toolbox::toString(" '%s'", op->getName().c_str());
+      std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
+      std::string errCode = toolbox::toString("%s",err.what());
+      if (knownErrorCode(errCode)) {
+        ++retryCount;
+        if (retryCount > 4)
+          DEBUG("Failed to dispatch transaction of " << operations.size() << " operations"
+                << ", retrying. retryCount("<<retryCount<<")" << std::endl);
+        updateErrorCounters(errCode);
+        continue;
+      } else {
+        ERROR(msg);
+        return false;
+      }
+    } catch (std::exception const& err) {
+      std::string msgBase = "Could not dispatch transaction on registers:";
+      for (auto op = operations.begin(); op != operations.end(); ++op)
+        msgBase += toolbox::toString(" '%s'", op->getName().c_str());
+      std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
+      ERROR(msg);
+      return false;
+    }
+  }
+  std::string msg = toolbox::toString("Maximum number of retries reached, unable to dispatch transaction of %d operations",
+                                      (int)operations.size());
+  ERROR(msg);
+  return false;
+}
+
+uhal::Node const& gem::hw::GEMHwDevice::resolve(gem::hw::RegisterHandle& reg)
+{
+  if (!reg.node_ || reg.device_ != this || reg.connection_ != connection_) {
+    reg.node_       = &getGEMHwInterface().getNode(reg.name_);
+    reg.device_     = this;
+    reg.connection_ = connection_;
+  }
+  return *reg.node_;
+}
+
+uint32_t gem::hw::GEMHwDevice::readReg(gem::hw::RegisterHandle& reg)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(hwLock_);
   uhal::HwInterface& hw = getGEMHwInterface();
 
   int retryCount = 0;
+  uint32_t res = 0x0;
   while (retryCount < MAX_IPBUS_RETRIES) {
     try {
-      std::vector<std::pair<std::string,uhal::ValWord<uint32_t> > > vals;
-      //vals.reserve(regList.size());
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
-        vals.push_back(std::make_pair(curReg->first,hw.getNode(curReg->first).read()));
+      uhal::ValWord<uint32_t> val = resolve(reg).read();
+      hw.dispatch();
+      res = val.value();
+      return res;
+    } catch (uhal::exception::exception const& err) {
+      std::string msgBase = toolbox::toString("Could not read register '%s' (uHAL)", reg.name_.c_str());
+      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+      std::string errCode = toolbox::toString("%s",err.what());
+      if (knownErrorCode(errCode)) {
+        ++retryCount;
+        if (retryCount > 4)
+          DEBUG("Failed to read register " << reg.name_ <<
+                ", retrying. retryCount("<<retryCount<<")"
+                << std::endl);
+        updateErrorCounters(errCode);
+        continue;
+      } else {
+        // e.g. a register missing from the address table, retrying will not help
+        ERROR(msg);
+        return res;
+      }
+    } catch (std::exception const& err) {
+      std::string msgBase = toolbox::toString("Could not read register '%s' (std)", reg.name_.c_str());
+      std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
+      ERROR(msg);
+      return res;
+    }
+  }
+  std::string msg = toolbox::toString("Maximum number of retries reached, unable to read register %s",reg.name_.c_str());
+  ERROR(msg);
+  return res;
+}
+
+bool gem::hw::GEMHwDevice::readRegs(gem::hw::register_handle_list::iterator first,
+                                    gem::hw::register_handle_list::iterator last,
+                                    bool const& retry)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(hwLock_);
+  uhal::HwInterface& hw = getGEMHwInterface();
+
+  // the values only, in the order of the list, reused by every call
+  std::vector<uhal::ValWord<uint32_t> >& vals = readValues_;
+  int retryCount = 0;
+  while (retryCount < MAX_IPBUS_RETRIES) {
+    try {
+      vals.clear();
+      for (auto curReg = first; curReg != last; ++curReg)
+        vals.push_back(resolve(curReg->first).read());
       hw.dispatch();
 
-      //would like to have these local to the loop, how to do...?
       auto curVal = vals.begin();
-      auto curReg = regList.begin();
-      for ( ; curReg != regList.end(); ++curVal,++curReg) 
-        curReg->second = (curVal->second).value();
-      return;
-      //break;
+      for (auto curReg = first; curReg != last; ++curVal, ++curReg)
+        curReg->second = curVal->value();
+      return true;
     } catch (uhal::exception::exception const& err) {
       std::string msgBase = "Could not read from register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
-        msgBase += toolbox::toString(" '%s'", curReg->first.c_str());
+      for (auto curReg = first; curReg != last; ++curReg)
+        msgBase += toolbox::toString(" '%s'", curReg->first.name_.c_str());
       std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
       if (knownErrorCode(errCode)) {
         ++retryCount;
-        /* would need to loop the debug message as curReg is out of scope here
-           if (retryCount > 4)
-           for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
-           DEBUG("Failed to read register " << curReg->first <<
-           ", retrying. retryCount("<<retryCount<<")"
-           << std::endl);
-        */
         updateErrorCounters(errCode);
-        continue;
+        if (retry)
+          continue;
+        ERROR(msg);
+        return false;
       } else {
         ERROR(msg);
-        //XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        return false;
       }
     } catch (std::exception const& err) {
       std::string msgBase = "Could not read from register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
-        msgBase += toolbox::toString(" '%s'", curReg->first.c_str());
+      for (auto curReg = first; curReg != last; ++curReg)
+        msgBase += toolbox::toString(" '%s'", curReg->first.name_.c_str());
       std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
       ERROR(msg);
-      //XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      return false;
     }
   }
+  return false;
 }
 
-void gem::hw::GEMHwDevice::writeReg(std::string const& name, uint32_t const val)
+void gem::hw::GEMHwDevice::writeReg(gem::hw::RegisterHandle& reg, uint32_t const val)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(hwLock_);
   uhal::HwInterface& hw = getGEMHwInterface();
   int retryCount = 0;
   while (retryCount < MAX_IPBUS_RETRIES) {
     try {
-      hw.getNode(name).write(val);
+      resolve(reg).write(val);
       hw.dispatch();
       return;
-      //break;
     } catch (uhal::exception::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not write to register '%s' (uHAL)", name.c_str());
+      std::string msgBase = toolbox::toString("Could not write to register '%s' (uHAL)", reg.name_.c_str());
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
       if (knownErrorCode(errCode)) {
         ++retryCount;
         if (retryCount > 4)
-          DEBUG("Failed to write value 0x" << std::hex<< val << std::dec << " to register " << name <<
+          DEBUG("Failed to write value 0x" << std::hex<< val << std::dec << " to register " << reg.name_ <<
                 ", retrying. retryCount("<<retryCount<<")"
                 << std::endl);
         updateErrorCounters(errCode);
         continue;
       } else {
         ERROR(msg);
-        //XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        return;
       }
     } catch (std::exception const& err) {
-      std::string msgBase = toolbox::toString("Could not write to register '%s' (std)", name.c_str());
+      std::string msgBase = toolbox::toString("Could not write to register '%s' (std)", reg.name_.c_str());
       std::string msg     = toolbox::toString("%s: %s.", msgBase.c_str(), err.what());
       ERROR(msg);
-      //XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      return;
     }
   }
 }
 
-void gem::hw::GEMHwDevice::writeRegs(register_pair_list const& regList)
+void gem::hw::GEMHwDevice::writeRegs(gem::hw::register_handle_list& regList)
 {
   gem::utils::LockGuard<gem::utils::Lock> guardedLock(hwLock_);
   uhal::HwInterface& hw = getGEMHwInterface();
   int retryCount = 0;
   while (retryCount < MAX_IPBUS_RETRIES) {
     try {
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
-        hw.getNode(curReg->first).write(curReg->second);
+      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+        resolve(curReg->first).write(curReg->second);
       hw.dispatch();
       return;
-      //break;
     } catch (uhal::exception::exception const& err) {
       std::string msgBase = "Could not write to register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
-        msgBase += toolbox::toString(" '%s'", curReg->first.c_str());
+      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+        msgBase += toolbox::toString(" '%s'", curReg->first.name_.c_str());
       std::string msg     = toolbox::toString("%s (uHAL): %s.", msgBase.c_str(), err.what());
       std::string errCode = toolbox::toString("%s",err.what());
       if (knownErrorCode(errCode)) {
         ++retryCount;
-        /* would need to loop the debug message as curReg is out of scope here
-           if (retryCount > 4)
-           for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
-           DEBUG("Failed to write value 0x" << std::hex <<
-           curReg->second << std::dec <<
-           " to register " << curReg->first <<
-           ", retrying. retryCount("<<retryCount<<")"
-           << std::endl);
-        */
         updateErrorCounters(errCode);
         continue;
       } else {
         ERROR(msg);
-        //XCEPT_RAISE(gem::hw::exception::HardwareProblem, toolbox::toString("%s.", msgBase.c_str()));
+        return;
       }
     } catch (std::exception const& err) {
       std::string msgBase = "Could not write to register in list:";
-      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) 
-        msgBase += toolbox::toString(" '%s'", curReg->first.c_str());
+      for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg)
+        msgBase += toolbox::toString(" '%s'", curReg->first.name_.c_str());
       std::string msg = toolbox::toString("%s (std): %s.", msgBase.c_str(), err.what());
       ERROR(msg);
-      //XCEPT_RAISE(gem::hw::exception::HardwareProblem, msg);
+      return;
     }
   }
 }
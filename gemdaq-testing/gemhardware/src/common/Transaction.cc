@@ -0,0 +1,96 @@
+#include "gem/hw/Transaction.h"
+#include "gem/hw/GEMHwDevice.h"
+
+gem::hw::Transaction::Transaction(gem::hw::GEMHwDevice& device) :
+  device_(device),
+  results_(new gem::hw::TransactionResults())
+{
+}
+
+std::string const& gem::hw::Transaction::Operation::getName() const
+{
+  return handle ? handle->getName() : name;
+}
+
+gem::hw::Transaction::Operation const& gem::hw::Transaction::queue(gem::hw::Transaction::Operation op)
+{
+  switch (op.type) {
+  case Operation::READ:
+  case Operation::RMW:
+    op.index = results_->words.size();
+    results_->words.push_back(0x0);
+    break;
+  case Operation::READ_BLOCK:
+    op.index = results_->blocks.size();
+    results_->blocks.push_back(std::vector<uint32_t>());
+    break;
+  default:
+    break;
+  }
+  operations_.push_back(op);
+  return operations_.back();
+}
+
+void gem::hw::Transaction::write(std::string const& regName, uint32_t const val)
+{
+  Operation op(Operation::WRITE, regName);
+  op.value = val;
+  queue(op);
+}
+
+void gem::hw::Transaction::write(gem::hw::RegisterHandle& reg, uint32_t const val)
+{
+  Operation op(Operation::WRITE, reg);
+  op.value = val;
+  queue(op);
+}
+
+gem::hw::TransactionFuture<uint32_t> gem::hw::Transaction::readModifyWrite(std::string const& regName,
+                                                                           uint32_t const mask, uint32_t const val)
+{
+  Operation op(Operation::RMW, regName);
+  op.mask  = mask;
+  op.value = val & mask;
+  return TransactionFuture<uint32_t>(results_, queue(op).index);
+}
+
+gem::hw::TransactionFuture<uint32_t> gem::hw::Transaction::readModifyWrite(gem::hw::RegisterHandle& reg,
+                                                                           uint32_t const mask, uint32_t const val)
+{
+  Operation op(Operation::RMW, reg);
+  op.mask  = mask;
+  op.value = val & mask;
+  return TransactionFuture<uint32_t>(results_, queue(op).index);
+}
+
+gem::hw::TransactionFuture<std::vector<uint32_t> > gem::hw::Transaction::readBlock(std::string const& regName,
+                                                                                   size_t const nWords)
+{
+  Operation op(Operation::READ_BLOCK, regName);
+  op.nWords = nWords;
+  return TransactionFuture<std::vector<uint32_t> >(results_, queue(op).index);
+}
+
+void gem::hw::Transaction::writeBlock(std::string const& regName, std::vector<uint32_t> const& values)
+{
+  Operation op(Operation::WRITE_BLOCK, regName);
+  op.index = writeBlocks_.size();
+  writeBlocks_.push_back(values);
+  queue(op);
+}
+
+bool gem::hw::Transaction::dispatch()
+{
+  bool success = operations_.empty() || device_.dispatch(*this);
+  results_->dispatched = success;
+  clear();
+  return success;
+}
+
+void gem::hw::Transaction::clear()
+{
+  operations_.clear();
+  writeBlocks_.clear();
+  // the futures handed out so far keep the previous results
+  results_.reset(new gem::hw::TransactionResults());
+}
@@ -12,6 +12,8 @@ gem::hw::glib::HwGLIB::HwGLIB():
   m_crate(-1),
   m_slot(-1)
 {
+  for (int link = 0; link < 3; ++link)
+    lostBlocks_[link] = 0;
   //use a connection file and connection manager?
   setDeviceID("GLIBHw");
   setAddressTableFileName("glib_address_table.xml");
@@ -29,6 +31,8 @@ gem::hw::glib::HwGLIB::HwGLIB(const int& crate, const int& slot):
   m_crate(crate),
   m_slot(slot)
 {
+  for (int link = 0; link < 3; ++link)
+    lostBlocks_[link] = 0;
   //use a connection file and connection manager?
   setDeviceID(toolbox::toString("gem.shelf%02d.glib%02d",crate,slot));
   //uhal::ConnectionManager manager ( "file://${GEM_ADDRESS_TABLE_PATH}/connections_ch.xml" );
@@ -216,9 +220,11 @@ std::string gem::hw::glib::HwGLIB::getMACAddress()
 {
   //gem::utils::LockGuard<gem::utils::Lock> guardedLock(hwLock_);
   std::string res = "N/A";
-  uint32_t val1 = readReg(getDeviceBaseNode(),"SYSTEM.MAC.UPPER");
-  uint32_t val2 = readReg(getDeviceBaseNode(),"SYSTEM.MAC.LOWER");
-  res = uint32ToGroupedHex(val1,val2);
+  gem::hw::Transaction transaction(*this);
+  gem::hw::TransactionFuture<uint32_t> val1 = transaction.read(getDeviceBaseNode()+".SYSTEM.MAC.UPPER");
+  gem::hw::TransactionFuture<uint32_t> val2 = transaction.read(getDeviceBaseNode()+".SYSTEM.MAC.LOWER");
+  if (transaction.dispatch())
+    res = uint32ToGroupedHex(val1.value(),val2.value());
   return res;
 }
 
@@ -302,8 +308,10 @@ void gem::hw::glib::HwGLIB::XPointControl(bool xpoint2, uint8_t const& input, ui
   // input == 3 -> b1b0 == 11
   // but the xpoint switch inverts b0 and b1 when routing outputs
   // thus to select input 3 for output 1, one sets S10=1 and S11=0
-  writeReg(getDeviceBaseNode(),regName.str()+"1",input&0x01);
-  writeReg(getDeviceBaseNode(),regName.str()+"0",(input&0x10)>>1);
+  gem::hw::Transaction transaction(*this);
+  transaction.write(getDeviceBaseNode()+"."+regName.str()+"1",input&0x01);
+  transaction.write(getDeviceBaseNode()+"."+regName.str()+"0",(input&0x10)>>1);
+  transaction.dispatch();
 }
 
 uint8_t gem::hw::glib::HwGLIB::XPointControl(bool xpoint2, uint8_t const& output)
@@ -340,10 +348,14 @@ uint8_t gem::hw::glib::HwGLIB::XPointControl(bool xpoint2, uint8_t const& output
   case (3):
     regName << ".S4";
   }
+  gem::hw::Transaction transaction(*this);
+  gem::hw::TransactionFuture<uint32_t> s0 = transaction.read(getDeviceBaseNode()+"."+regName.str()+"0");
+  gem::hw::TransactionFuture<uint32_t> s1 = transaction.read(getDeviceBaseNode()+"."+regName.str()+"1");
+  transaction.dispatch();
   uint8_t input = 0x0;
-  input |= (readReg(getDeviceBaseNode(),regName.str()+"0")&0x1)<<1;
+  input |= (s0.value()&0x1)<<1;
   //input = input << 1;
-  input |= (readReg(getDeviceBaseNode(),regName.str()+"1")&0x1);
+  input |= (s1.value()&0x1);
   return input;
 }
 
@@ -431,8 +443,16 @@ std::string gem::hw::glib::HwGLIB::getUserFirmwareDate(uint8_t const& link)
 }
 
 gem::hw::GEMHwDevice::OpticalLinkStatus gem::hw::glib::HwGLIB::LinkStatus(uint8_t const& link) {
+  gem::hw::Transaction transaction(*this);
+  gem::hw::GEMHwDevice::OpticalLinkStatusFuture linkStatus = LinkStatus(transaction, link);
+  transaction.dispatch();
+  return linkStatus.value();
+}
+
+gem::hw::GEMHwDevice::OpticalLinkStatusFuture gem::hw::glib::HwGLIB::LinkStatus(gem::hw::Transaction& transaction,
+                                                                                  uint8_t const& link) {
   
-  gem::hw::GEMHwDevice::OpticalLinkStatus linkStatus;
+  gem::hw::GEMHwDevice::OpticalLinkStatusFuture linkStatus;
 
   if (link > 2) {
     std::string msg = toolbox::toString("Link status requested for link (%d): outside expectation (0-2)",link);
@@ -444,12 +464,12 @@ gem::hw::GEMHwDevice::OpticalLinkStatus gem::hw::glib::HwGLIB::LinkStatus(uint8_
     //XCEPT_RAISE(gem::hw::optohybrid::exception::InvalidLink,msg);
   } else {
     std::stringstream regName;
-    regName << "GLIB_LINKS.LINK" << (int)link << ".OPTICAL_LINKS.Counter";
-    linkStatus.Errors           = readReg(getDeviceBaseNode(),regName.str()+".LinkErr"       );
-    linkStatus.I2CReceived      = readReg(getDeviceBaseNode(),regName.str()+".RecI2CRequests");
-    linkStatus.I2CSent          = readReg(getDeviceBaseNode(),regName.str()+".SntI2CRequests");
-    linkStatus.RegisterReceived = readReg(getDeviceBaseNode(),regName.str()+".RecRegRequests");
-    linkStatus.RegisterSent     = readReg(getDeviceBaseNode(),regName.str()+".SntRegRequests");
+    regName << getDeviceBaseNode() << ".GLIB_LINKS.LINK" << (int)link << ".OPTICAL_LINKS.Counter";
+    linkStatus.Errors           = transaction.read(regName.str()+".LinkErr"       );
+    linkStatus.I2CReceived      = transaction.read(regName.str()+".RecI2CRequests");
+    linkStatus.I2CSent          = transaction.read(regName.str()+".SntI2CRequests");
+    linkStatus.RegisterReceived = transaction.read(regName.str()+".RecRegRequests");
+    linkStatus.RegisterSent     = transaction.read(regName.str()+".SntRegRequests");
   }
   return linkStatus;
 }
@@ -468,23 +488,24 @@ void gem::hw::glib::HwGLIB::LinkReset(uint8_t const& link, uint8_t const& resets
   } 
   
   std::stringstream regName;
-  regName << "GLIB_LINKS.LINK" << (int)link << ".OPTICAL_LINKS.Resets";
+  regName << getDeviceBaseNode() << ".GLIB_LINKS.LINK" << (int)link << ".OPTICAL_LINKS.Resets";
+  gem::hw::Transaction transaction(*this);
   if (resets&0x01)
-    writeReg(getDeviceBaseNode(),regName.str()+".LinkErr",0x1);
+    transaction.write(regName.str()+".LinkErr",0x1);
   if (resets&0x02)
-    writeReg(getDeviceBaseNode(),regName.str()+".RecI2CRequests",0x1);
+    transaction.write(regName.str()+".RecI2CRequests",0x1);
   if (resets&0x04)
-    writeReg(getDeviceBaseNode(),regName.str()+".SntI2CRequests",0x1);
+    transaction.write(regName.str()+".SntI2CRequests",0x1);
   if (resets&0x08)
-    writeReg(getDeviceBaseNode(),regName.str()+".RecRegRequests",0x1);
+    transaction.write(regName.str()+".RecRegRequests",0x1);
   if (resets&0x10)
-    writeReg(getDeviceBaseNode(),regName.str()+".SntRegRequests",0x1);
+    transaction.write(regName.str()+".SntRegRequests",0x1);
+  transaction.dispatch();
 }
 
 uint32_t gem::hw::glib::HwGLIB::readTriggerFIFO(uint8_t const& link) {
-  std::stringstream regName;
-  regName << "GLIB_LINKS.TRG_DATA";
-  uint32_t trgword = readReg(getDeviceBaseNode(),regName.str()+".DATA");
+  // the trigger data register is the same for every link, the last one of a tracking block
+  uint32_t trgword = readReg(getTrackingBlockRegs(link < 3 ? link : 0).back());
   return trgword;
 }
 
@@ -508,15 +529,9 @@ uint32_t gem::hw::glib::HwGLIB::getFIFOOccupancy(uint8_t const& link) {
     return fifocc;
   } 
   
-  std::stringstream regName;
-  regName << "GLIB_LINKS.LINK" << (int)link << ".TRK_FIFO";
-  fifocc = readReg(getDeviceBaseNode(),regName.str()+".DEPTH");
-  INFO(toolbox::toString("getFIFOOccupancy(%d) %s.%s%s:: %d",
-                         link,
-                         getDeviceBaseNode().c_str(),
-                         regName.str().c_str(),
-                         ".DEPTH",
-                         fifocc));
+  getTrackingBlockRegs(link);
+  fifocc = readReg(trackingFIFODepthReg_[link]);
+  DEBUG("getFIFOOccupancy(" << (int)link << ") " << trackingFIFODepthReg_[link].getName() << ":: " << fifocc);
   return fifocc;
 }
 
@@ -533,41 +548,116 @@ bool gem::hw::glib::HwGLIB::hasTrackingData(uint8_t const& link) {
     return false;
   }
   
-  std::stringstream regName;
-  regName << "TRK_DATA.COL" << (int)link << ".DATA_RDY";
-  return readReg(getDeviceBaseNode(),regName.str());
+  return readReg(getTrackingBlockRegs(link).front());
 }
 
 std::vector<uint32_t> gem::hw::glib::HwGLIB::getTrackingData(uint8_t const& link) {
+  std::vector<uint32_t> data;
+  getTrackingData(link, data);
+  return data;
+}
+
+void gem::hw::glib::HwGLIB::getTrackingData(uint8_t const& link, std::vector<uint32_t>& data) {
   if (link > 2) {
     std::string msg = toolbox::toString("Tracking data requested for column (%d): outside expectation (0-2)",link);
     ERROR(msg);
     //XCEPT_RAISE(gem::hw::glib::exception::InvalidLink,msg);
-    std::vector<uint32_t> data(7,0x0);
-    return data;
+    data.assign(7,0x0);
+    return;
   } else if (!links[link]) {
     std::string msg = toolbox::toString("Link status requested inactive link (%d)",link);
     ERROR(msg);
     //XCEPT_RAISE(gem::hw::optohybrid::exception::InvalidLink,msg);
-    std::vector<uint32_t> data(7,0x0);
-    return data;
+    data.assign(7,0x0);
+    return;
   } 
   
-  std::stringstream regName;
-  regName << getDeviceBaseNode() << ".TRK_DATA.COL" << (int)link << ".DATA.";
-  register_pair_list trackingData;
-  for (int i = 0; i < 7; ++i) {
-    std::stringstream trkWord;
-    trkWord << regName.str() << i;
-    trackingData.push_back(std::make_pair(trkWord.str(),0x0));
-  }
+  // DATA.[0-6] follow DATA_RDY in the tracking block registers
+  std::vector<gem::hw::RegisterHandle> const& blockRegs = getTrackingBlockRegs(link);
+  gem::hw::register_handle_list& trackingData = trackingWordData_[link];
+  if (trackingData.empty())
+    for (int i = 0; i < 7; ++i)
+      trackingData.push_back(std::make_pair(blockRegs[i+1],0x0));
   readRegs(trackingData);
+  data.resize(7);
+  for (int i = 0; i < 7; ++i)
+    data[i] = trackingData[i].second;
+}
+
+std::vector<uint32_t> gem::hw::glib::HwGLIB::drainTrackingFIFO(uint8_t const& link, uint32_t const& maxBlocks) {
   std::vector<uint32_t> data;
-  for (auto word = trackingData.begin(); word != trackingData.end(); ++word)
-    data.push_back(word->second);
+  drainTrackingFIFO(link, maxBlocks, data);
   return data;
 }
 
+uint32_t gem::hw::glib::HwGLIB::drainTrackingFIFO(uint8_t const& link, uint32_t const& maxBlocks,
+                                                  std::vector<uint32_t>& data) {
+  // within the capacity of a reused buffer after the first drain
+  data.resize(maxBlocks*TRACKING_BLOCK_WORDS);
+  uint32_t nBlocks = maxBlocks ? drainTrackingFIFO(link, maxBlocks, &data[0]) : 0;
+  data.resize(nBlocks*TRACKING_BLOCK_WORDS);
+  return nBlocks;
+}
+
+uint32_t gem::hw::glib::HwGLIB::drainTrackingFIFO(uint8_t const& link, uint32_t const& maxBlocks,
+                                                  uint32_t* data) {
+  // also takes care of the link validity checks
+  uint32_t nBlocks = getFIFOOccupancy(link);
+  if (nBlocks > maxBlocks)
+    nBlocks = maxBlocks;
+  if (!nBlocks)
+    return 0;
+
+  std::vector<gem::hw::RegisterHandle> const& blockRegs = getTrackingBlockRegs(link);
+
+  // the reads are executed in order, so each DATA_RDY is followed by the block it flags
+  // the list is kept per link with its handles resolved, it only grows when more blocks than
+  // ever before are requested, and the drain reads the first nBlocks blocks of it
+  gem::hw::register_handle_list& blockData = trackingBlockData_[link];
+  size_t const nRegs = nBlocks*blockRegs.size();
+  while (blockData.size() < nRegs)
+    for (auto reg = blockRegs.begin(); reg != blockRegs.end(); ++reg)
+      blockData.push_back(std::make_pair(*reg, 0x0));
+  // each read pops the FIFO, so the drain is not retried: a dispatch that failed may have been
+  // partly executed, and a retry would read blocks that are misaligned or already gone
+  if (!readRegs(blockData.begin(), blockData.begin()+nRegs, false)) {
+    lostBlocks_[link] += nBlocks;
+    WARN("drainTrackingFIFO(" << (int)link << ") failed, up to " << nBlocks << " blocks lost, "
+         << lostBlocks_[link] << " lost on this link so far");
+    return 0;
+  }
+
+  uint32_t* out = data;
+  for (auto word = blockData.begin(); word != blockData.begin()+nRegs; word += blockRegs.size()) {
+    if (!word->second)
+      continue;
+    for (auto blockWord = word+1; blockWord != word+blockRegs.size(); ++blockWord)
+      *out++ = blockWord->second;
+  }
+  DEBUG("drainTrackingFIFO(" << (int)link << ") read " << (out - data)/TRACKING_BLOCK_WORDS
+        << " of " << nBlocks << " blocks");
+  return (out - data)/TRACKING_BLOCK_WORDS;
+}
+
+std::vector<gem::hw::RegisterHandle>& gem::hw::glib::HwGLIB::getTrackingBlockRegs(uint8_t const& link) {
+  std::vector<gem::hw::RegisterHandle>& blockRegs = trackingBlockRegs_[link];
+  if (blockRegs.empty()) {
+    std::stringstream regName;
+    regName << "TRK_DATA.COL" << (int)link;
+    blockRegs.push_back(getRegister(regName.str()+".DATA_RDY"));
+    for (int i = 0; i < 7; ++i) {
+      std::stringstream trkWord;
+      trkWord << regName.str() << ".DATA." << i;
+      blockRegs.push_back(getRegister(trkWord.str()));
+    }
+    blockRegs.push_back(getRegister("GLIB_LINKS.TRG_DATA.DATA"));
+
+    std::stringstream depthName;
+    depthName << "GLIB_LINKS.LINK" << (int)link << ".TRK_FIFO.DEPTH";
+    trackingFIFODepthReg_[link] = getRegister(depthName.str());
+  }
+  return blockRegs;
+}
 
 void gem::hw::glib::HwGLIB::flushFIFO(uint8_t const& link) {
   if (link > 2) {
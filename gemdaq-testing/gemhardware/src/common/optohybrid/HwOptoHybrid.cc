@@ -9,6 +9,8 @@ gem::hw::optohybrid::HwOptoHybrid::HwOptoHybrid():
   //monOptoHybrid_(0)
   //is_connected_(false),
   links({false,false,false}),
+  t1RegsLink_(0),
+  t1RegsBuilt_(false),
   m_controlLink(-1)  
 {
   setDeviceID("OptoHybridHw");
@@ -26,6 +28,8 @@ gem::hw::optohybrid::HwOptoHybrid::HwOptoHybrid(gem::hw::glib::HwGLIB const& gli
   //monOptoHybrid_(0),
   //is_connected_(false),
   links({false,false,false}),
+  t1RegsLink_(0),
+  t1RegsBuilt_(false),
   m_controlLink(-1),
   m_slot(slot)
 {
@@ -145,9 +149,45 @@ bool gem::hw::optohybrid::HwOptoHybrid::isHwConnected()
 }
 
 
+gem::hw::optohybrid::HwOptoHybrid::T1Registers& gem::hw::optohybrid::HwOptoHybrid::getT1Registers()
+{
+  if (t1RegsBuilt_ && t1RegsLink_ == m_controlLink)
+    return t1Regs_;
+
+  std::stringstream linkName;
+  linkName << "OptoHybrid_LINKS.LINK" << (int)m_controlLink;
+  std::string const link = linkName.str();
+  t1Regs_.sendL1A          = getRegister(link+".FAST_COM.Send.L1A");
+  t1Regs_.sendCalPulse     = getRegister(link+".FAST_COM.Send.CalPulse");
+  t1Regs_.sendL1ACalPulse  = getRegister(link+".FAST_COM.Send.L1ACalPulse");
+  t1Regs_.sendResync       = getRegister(link+".FAST_COM.Send.Resync");
+  t1Regs_.sendBC0          = getRegister(link+".FAST_COM.Send.BC0");
+  t1Regs_.l1aCount[0]      = getRegister(link+".COUNTERS.L1A.External");
+  t1Regs_.l1aCount[1]      = getRegister(link+".COUNTERS.L1A.Internal");
+  t1Regs_.l1aCount[2]      = getRegister(link+".COUNTERS.L1A.Delayed");
+  t1Regs_.l1aCount[3]      = getRegister(link+".COUNTERS.L1A.Total");
+  t1Regs_.calPulseCount[0] = getRegister(link+".COUNTERS.CalPulse.Internal");
+  t1Regs_.calPulseCount[1] = getRegister(link+".COUNTERS.CalPulse.Delayed");
+  t1Regs_.calPulseCount[2] = getRegister(link+".COUNTERS.CalPulse.Total");
+  t1Regs_.resyncCount      = getRegister(link+".COUNTERS.Resync");
+  t1Regs_.bc0Count         = getRegister(link+".COUNTERS.BC0");
+  t1Regs_.bxCount          = getRegister(link+".COUNTERS.BXCount");
+  t1RegsLink_  = m_controlLink;
+  t1RegsBuilt_ = true;
+  return t1Regs_;
+}
+
 gem::hw::GEMHwDevice::OpticalLinkStatus gem::hw::optohybrid::HwOptoHybrid::LinkStatus(uint8_t const& link) {
+  gem::hw::Transaction transaction(*this);
+  gem::hw::GEMHwDevice::OpticalLinkStatusFuture linkStatus = LinkStatus(transaction, link);
+  transaction.dispatch();
+  return linkStatus.value();
+}
+
+gem::hw::GEMHwDevice::OpticalLinkStatusFuture gem::hw::optohybrid::HwOptoHybrid::LinkStatus(gem::hw::Transaction& transaction,
+                                                                                              uint8_t const& link) {
   
-  gem::hw::GEMHwDevice::OpticalLinkStatus linkStatus;
+  gem::hw::GEMHwDevice::OpticalLinkStatusFuture linkStatus;
 
   //put these into a checkLink(link) function that will return bool, since they're used often
   if (link > 2) {
@@ -160,12 +200,12 @@ gem::hw::GEMHwDevice::OpticalLinkStatus gem::hw::optohybrid::HwOptoHybrid::LinkS
     //XCEPT_RAISE(gem::hw::optohybrid::exception::InvalidLink,msg);
   } else {
     std::stringstream regName;
-    regName << "OptoHybrid_LINKS.LINK" << (int)link << ".OPTICAL_LINKS.Counter.";
-    linkStatus.Errors           = readReg(getDeviceBaseNode(),regName.str()+"LinkErr"       );
-    linkStatus.I2CReceived      = readReg(getDeviceBaseNode(),regName.str()+"RecI2CRequests");
-    linkStatus.I2CSent          = readReg(getDeviceBaseNode(),regName.str()+"SntI2CRequests");
-    linkStatus.RegisterReceived = readReg(getDeviceBaseNode(),regName.str()+"RecRegRequests");
-    linkStatus.RegisterSent     = readReg(getDeviceBaseNode(),regName.str()+"SntRegRequests");
+    regName << getDeviceBaseNode() << ".OptoHybrid_LINKS.LINK" << (int)link << ".OPTICAL_LINKS.Counter.";
+    linkStatus.Errors           = transaction.read(regName.str()+"LinkErr"       );
+    linkStatus.I2CReceived      = transaction.read(regName.str()+"RecI2CRequests");
+    linkStatus.I2CSent          = transaction.read(regName.str()+"SntI2CRequests");
+    linkStatus.RegisterReceived = transaction.read(regName.str()+"RecRegRequests");
+    linkStatus.RegisterSent     = transaction.read(regName.str()+"SntRegRequests");
   }
   return linkStatus;
 }
@@ -184,17 +224,110 @@ void gem::hw::optohybrid::HwOptoHybrid::LinkReset(uint8_t const& link, uint8_t c
   }
   
   std::stringstream regName;
-  regName << "OptoHybrid_LINKS.LINK" << (int)link << ".OPTICAL_LINKS.Resets";
+  regName << getDeviceBaseNode() << ".OptoHybrid_LINKS.LINK" << (int)link << ".OPTICAL_LINKS.Resets";
+  gem::hw::Transaction transaction(*this);
   if (resets&0x01)
-    writeReg(getDeviceBaseNode(),regName.str()+"LinkErr",0x1);
+    transaction.write(regName.str()+"LinkErr",0x1);
   if (resets&0x02)
-    writeReg(getDeviceBaseNode(),regName.str()+"RecI2CRequests",0x1);
+    transaction.write(regName.str()+"RecI2CRequests",0x1);
   if (resets&0x04)
-    writeReg(getDeviceBaseNode(),regName.str()+"SntI2CRequests",0x1);
+    transaction.write(regName.str()+"SntI2CRequests",0x1);
   if (resets&0x08)
-    writeReg(getDeviceBaseNode(),regName.str()+"RecRegRequests",0x1);
+    transaction.write(regName.str()+"RecRegRequests",0x1);
   if (resets&0x10)
-    writeReg(getDeviceBaseNode(),regName.str()+"SntRegRequests",0x1);
+    transaction.write(regName.str()+"SntRegRequests",0x1);
+  transaction.dispatch();
+}
+
+gem::hw::optohybrid::HwOptoHybrid::T1Counters gem::hw::optohybrid::HwOptoHybrid::T1CountersFuture::value() const
+{
+  T1Counters counters;
+  for (int i = 0; i < 4; ++i)
+    counters.L1A[i] = L1A[i].value();
+  for (int i = 0; i < 3; ++i)
+    counters.CalPulse[i] = CalPulse[i].value();
+  counters.Resync = Resync.value();
+  counters.BC0    = BC0.value();
+  return counters;
+}
+
+gem::hw::optohybrid::HwOptoHybrid::T1Counters gem::hw::optohybrid::HwOptoHybrid::GetT1Counters()
+{
+  gem::hw::Transaction transaction(*this);
+  T1CountersFuture counters = GetT1Counters(transaction);
+  transaction.dispatch();
+  return counters.value();
+}
+
+gem::hw::optohybrid::HwOptoHybrid::T1CountersFuture gem::hw::optohybrid::HwOptoHybrid::GetT1Counters(gem::hw::Transaction& transaction)
+{
+  T1Registers& regs = getT1Registers();
+  T1CountersFuture counters;
+  for (int i = 0; i < 4; ++i)
+    counters.L1A[i] = transaction.read(regs.l1aCount[i]);
+  for (int i = 0; i < 3; ++i)
+    counters.CalPulse[i] = transaction.read(regs.calPulseCount[i]);
+  counters.Resync = transaction.read(regs.resyncCount);
+  counters.BC0    = transaction.read(regs.bc0Count);
+  return counters;
+}
+
+void gem::hw::optohybrid::HwOptoHybrid::ResetL1ACounts(gem::hw::Transaction& transaction)
+{
+  std::string const regName = getLinkNode()+".COUNTERS.RESETS.L1A.";
+  transaction.write(regName+"External", 0x1);
+  transaction.write(regName+"Internal", 0x1);
+  transaction.write(regName+"Delayed",  0x1);
+  transaction.write(regName+"Total",    0x1);
+}
+
+void gem::hw::optohybrid::HwOptoHybrid::ResetCalPulseCounts(gem::hw::Transaction& transaction)
+{
+  std::string const regName = getLinkNode()+".COUNTERS.RESETS.CalPulse.";
+  transaction.write(regName+"Internal", 0x1);
+  transaction.write(regName+"Delayed",  0x1);
+  transaction.write(regName+"Total",    0x1);
+}
+
+void gem::hw::optohybrid::HwOptoHybrid::ResetT1Counters()
+{
+  std::string const regName = getLinkNode()+".COUNTERS.RESETS.";
+  gem::hw::Transaction transaction(*this);
+  ResetL1ACounts(transaction);
+  ResetCalPulseCounts(transaction);
+  transaction.write(regName+"Resync", 0x1);
+  transaction.write(regName+"BC0",    0x1);
+  transaction.dispatch();
+}
+
+gem::hw::optohybrid::HwOptoHybrid::OptoHybridStatus gem::hw::optohybrid::HwOptoHybrid::getStatus()
+{
+  std::string const regName = getLinkNode();
+  gem::hw::Transaction transaction(*this);
+
+  gem::hw::TransactionFuture<uint32_t> firmware = transaction.read(regName+".FIRMWARE");
+  std::vector<std::pair<uint8_t, gem::hw::GEMHwDevice::OpticalLinkStatusFuture> > linkStatus;
+  for (auto link = activeLinks.begin(); link != activeLinks.end(); ++link)
+    linkStatus.push_back(std::make_pair(link->first, LinkStatus(transaction, link->first)));
+  gem::hw::TransactionFuture<bool> vfatSource   = transaction.read<bool>(regName+".CLOCKING.VFAT.SOURCE");
+  gem::hw::TransactionFuture<bool> vfatFallback = transaction.read<bool>(regName+".CLOCKING.VFAT.FALLBACK");
+  gem::hw::TransactionFuture<bool> cdceSource   = transaction.read<bool>(regName+".CLOCKING.CDCE.SOURCE");
+  gem::hw::TransactionFuture<bool> cdceFallback = transaction.read<bool>(regName+".CLOCKING.CDCE.FALLBACK");
+  gem::hw::TransactionFuture<uint8_t> trigSource = transaction.read<uint8_t>(regName+".TRIGGER.SOURCE");
+  gem::hw::TransactionFuture<uint8_t> sbitSource = transaction.read<uint8_t>(regName+".TRIGGER.TDC_SBits");
+  T1CountersFuture counters = GetT1Counters(transaction);
+  transaction.dispatch();
+
+  OptoHybridStatus status;
+  status.Firmware = firmware.value();
+  for (auto link = linkStatus.begin(); link != linkStatus.end(); ++link)
+    status.Links.push_back(std::make_pair(link->first, link->second.value()));
+  status.VFATClock  = std::make_pair(vfatSource.value(), vfatFallback.value());
+  status.CDCEClock  = std::make_pair(cdceSource.value(), cdceFallback.value());
+  status.TrigSource = trigSource.value();
+  status.SBitSource = sbitSource.value();
+  status.Counters   = counters.value();
+  return status;
 }
 
 //uint32_t gem::hw::optohybrid::HwOptoHybrid::readTriggerData() {
@@ -2,6 +2,27 @@
 
 #include "gem/hw/vfat/HwVFAT2.h"
 
+#include <cstdlib>
+
+namespace {
+  // registers read by getAllSettings, the counters first as readVFAT2Counters reads only those
+  enum VFAT2SettingsRegister {
+    CHIPID0, CHIPID1, UPSETREG, HITCOUNT0, HITCOUNT1, HITCOUNT2, N_VFAT2_COUNTER_REGS,
+    CONTREG0 = N_VFAT2_COUNTER_REGS, CONTREG1, CONTREG2, CONTREG3,
+    LATENCY, IPREAMPIN, IPREAMPFEED, IPREAMPOUT, ISHAPER, ISHAPERFEED, ICOMP,
+    VCAL, VTHRESHOLD1, VTHRESHOLD2, CALPHASE, N_VFAT2_SETTINGS_REGS
+  };
+
+  char const* const VFAT2_SETTINGS_REGISTERS[N_VFAT2_SETTINGS_REGS] = {
+    "ChipID0", "ChipID1", "UpsetReg", "HitCount0", "HitCount1", "HitCount2",
+    "ContReg0", "ContReg1", "ContReg2", "ContReg3",
+    "Latency", "IPreampIn", "IPreampFeed", "IPreampOut", "IShaper", "IShaperFeed", "IComp",
+    "VCal", "VThreshold1", "VThreshold2", "CalPhase"
+  };
+
+  std::string const VFAT2_CHANNEL_REGISTER = "VFATChannels.ChanReg";
+}
+
 /* removing HW initialization with an application in favour of just a log4cplus::Logger
    gem::hw::vfat::HwVFAT2::HwVFAT2(xdaq::Application* vfatApp,
    std::string const& vfatDevice):
@@ -36,7 +57,8 @@
 */
 
 gem::hw::vfat::HwVFAT2::HwVFAT2(std::string const& vfatDevice):
-  gem::hw::GEMHwDevice::GEMHwDevice(vfatDevice)
+  gem::hw::GEMHwDevice::GEMHwDevice(vfatDevice),
+  shadowEnabled_(false)
   //logVFAT2_(vfatApp->getApplicationLogger()),
   //hwVFAT2_(0)
   //monVFAT2_(0)
@@ -75,36 +97,55 @@ gem::hw::vfat::HwVFAT2::~HwVFAT2()
 
 void gem::hw::vfat::HwVFAT2::loadDefaults()
 {
-  //here load the default settings
-  setTriggerMode(    0x3); //set to S1 to S8
-  setCalibrationMode(0x0); //set to normal
-  setMSPolarity(     0x1); //negative
-  setCalPolarity(    0x1); //negative
-  
-  setProbeMode(        0x0);
-  setLVDSMode(         0x0);
-  setDACMode(          0x0);
-  setHitCountCycleTime(0x0); //maximum number of bits
+  //here load the default settings, keeping the run mode
+  vfat_reg_pair_list defaults = getDefaultSettings();
+  writeVFATRegBits(defaults.front().first,~VFAT2ContRegBitMasks::RUNMODE,defaults.front().second);
+  writeVFATRegs(vfat_reg_pair_list(defaults.begin()+1,defaults.end()));
+}
+
+vfat_reg_pair_list gem::hw::vfat::HwVFAT2::getDefaultSettings()
+{
+  uint8_t cont0 = 0x0;
+  uint8_t cont1 = 0x0;
+  uint8_t cont2 = 0x0;
+  uint8_t cont3 = 0x0;
+
+  setRunMode(        0x0,cont0); //set to sleep
+  setTriggerMode(    0x3,cont0); //set to S1 to S8
+  setCalibrationMode(0x0,cont0); //set to normal
+  setMSPolarity(     0x1,cont0); //negative
+  setCalPolarity(    0x1,cont0); //negative
   
-  setHitCountMode( 0x0);
-  setMSPulseLength(0x3);
-  setInputPadMode( 0x0);
-  setTrimDACRange( 0x0);
-  setBandgapPad(   0x0);
-  sendTestPattern( 0x0);
+  setProbeMode(        0x0,cont1);
+  setLVDSMode(         0x0,cont1);
+  setDACMode(          0x0,cont1);
+  setHitCountCycleTime(0x0,cont1); //maximum number of bits
   
+  setHitCountMode( 0x0,cont2);
+  setMSPulseLength(0x3,cont2);
+  setInputPadMode( 0x0,cont2);
+  setTrimDACRange( 0x0,cont3);
+  setBandgapPad(   0x0,cont3);
+  sendTestPattern( 0x0,cont3);
+
+  vfat_reg_pair_list defaults;
+  defaults.push_back(std::make_pair("ContReg0",cont0));
+  defaults.push_back(std::make_pair("ContReg1",cont1));
+  defaults.push_back(std::make_pair("ContReg2",cont2));
+  defaults.push_back(std::make_pair("ContReg3",cont3));
   
-  setIPreampIn(  168);
-  setIPreampFeed(150);
-  setIPreampOut(  80);
-  setIShaper(    150);
-  setIShaperFeed(100);
-  setIComp(       75);
+  defaults.push_back(std::make_pair("IPreampIn",  168));
+  defaults.push_back(std::make_pair("IPreampFeed",150));
+  defaults.push_back(std::make_pair("IPreampOut",  80));
+  defaults.push_back(std::make_pair("IShaper",    150));
+  defaults.push_back(std::make_pair("IShaperFeed",100));
+  defaults.push_back(std::make_pair("IComp",       75));
   
-  setLatency(15);
+  defaults.push_back(std::make_pair("Latency",15));
   
-  setVThreshold1(25);
-  setVThreshold2(0);
+  defaults.push_back(std::make_pair("VThreshold1",25));
+  defaults.push_back(std::make_pair("VThreshold2", 0));
+  return defaults;
 }
 
 void gem::hw::vfat::HwVFAT2::configureDevice(std::string const& xmlSettings)
@@ -151,7 +192,22 @@ bool gem::hw::vfat::HwVFAT2::isHwConnected()
 
 //
 uint8_t gem::hw::vfat::HwVFAT2::readVFATReg( std::string const& regName, bool debug) {
-  uint32_t readVal = readReg(getDeviceBaseNode(),regName);
+  gem::hw::RegisterHandle* known = findVFATRegister(regName);
+  if (known)
+    return readVFATReg(*known, debug);
+  gem::hw::RegisterHandle reg = getRegister(regName);
+  return readVFATReg(reg, debug);
+}
+
+//
+uint8_t gem::hw::vfat::HwVFAT2::readVFATReg( gem::hw::RegisterHandle& reg, bool debug) {
+  uint8_t value = decodeVFATReg(readReg(reg), reg.getName());
+  refreshShadow(reg, value);
+  return value;
+}
+
+//
+uint8_t gem::hw::vfat::HwVFAT2::decodeVFATReg( uint32_t const& readVal, std::string const& regName) {
   
   /*
   //check the transaction status
@@ -203,6 +259,235 @@ uint8_t gem::hw::vfat::HwVFAT2::readVFATReg( std::string const& regName) {
   }
 }
 
+//
+uint8_t gem::hw::vfat::HwVFAT2::readVFATReg( gem::hw::RegisterHandle& reg) {
+  try {
+    return readVFATReg(reg,false);
+  } catch (gem::hw::vfat::exception::TransactionError const& e) {
+    return 0xff;      
+  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
+    return 0xff;      
+  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
+    return 0xff;      
+  }
+}
+
+//
+bool gem::hw::vfat::HwVFAT2::decodeVFATReg( gem::hw::TransactionFuture<uint32_t> const& readVal,
+                                            gem::hw::RegisterHandle const& reg, uint8_t& value) {
+  if (!readVal.ready())
+    return false;
+  try {
+    value = decodeVFATReg(readVal.value(), reg.getName());
+    return true;
+  } catch (gem::hw::vfat::exception::TransactionError const& e) {
+    return false;
+  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
+    return false;
+  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
+    return false;
+  }
+}
+
+//
+void gem::hw::vfat::HwVFAT2::writeVFATReg( std::string const& regName, uint8_t const& writeVal) {
+  gem::hw::RegisterHandle* known = findVFATRegister(regName);
+  if (known)
+    writeVFATReg(*known, writeVal);
+  else
+    writeReg(getDeviceBaseNode(), regName, static_cast<uint32_t>(writeVal));
+}
+
+//
+void gem::hw::vfat::HwVFAT2::writeVFATReg( gem::hw::RegisterHandle& reg, uint8_t const& writeVal) {
+  ShadowRegister* shadow = shadowEnabled_ ? getShadow(reg) : 0;
+  if (!shadow) {
+    writeReg(reg, static_cast<uint32_t>(writeVal));
+    return;
+  }
+  // the IPbus write succeeds even when the chip rejects it over I2C, so the shadow is only kept
+  // from a read back whose VFAT transaction status is good
+  shadow->valid = false;
+  gem::hw::Transaction transaction(*this);
+  transaction.write(reg, writeVal);
+  gem::hw::TransactionFuture<uint32_t> readBack = transaction.read(reg);
+  transaction.dispatch();
+  uint8_t value = 0x0;
+  if (!decodeVFATReg(readBack, reg, value)) {
+    WARN("writeVFATReg: register " << reg.getName() << " could not be read back, register shadow invalidated");
+    return;
+  }
+  refreshShadow(reg, value);
+  if (value != writeVal)
+    WARN("writeVFATReg: register " << reg.getName() << " wrote 0x" << std::hex << (unsigned)writeVal
+         << ", read back 0x" << (unsigned)value << std::dec);
+}
+
+//
+void gem::hw::vfat::HwVFAT2::writeVFATRegs( vfat_reg_pair_list const& regList) {
+  gem::hw::Transaction transaction(*this);
+  if (shadowEnabled_) {
+    // as in writeVFATReg, the shadow is only kept from the registers read back
+    std::vector<gem::hw::TransactionFuture<uint32_t> > readBack;
+    writeVFATRegs(transaction, regList, readBack);
+    transaction.dispatch();
+    checkVFATRegs(regList, readBack);
+    return;
+  }
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) {
+    gem::hw::RegisterHandle* known = findVFATRegister(curReg->first);
+    if (known)
+      transaction.write(*known, curReg->second);
+    else
+      transaction.write(getDeviceBaseNode()+"."+curReg->first, curReg->second);
+  }
+  transaction.dispatch();
+}
+
+//
+void gem::hw::vfat::HwVFAT2::writeVFATRegs( gem::hw::Transaction& transaction, vfat_reg_pair_list const& regList,
+                                            std::vector<gem::hw::TransactionFuture<uint32_t> >& readBack) {
+  readBack.reserve(readBack.size()+regList.size());
+  bool own = isOwnTransaction(transaction);
+  for (auto curReg = regList.begin(); curReg != regList.end(); ++curReg) {
+    gem::hw::RegisterHandle* known = findVFATRegister(curReg->first);
+    if (known) {
+      // the outcome is known once the registers are read back
+      ShadowRegister* shadow = getShadow(*known);
+      if (shadow)
+        shadow->valid = false;
+    }
+    if (known && own) {
+      transaction.write(*known, curReg->second);
+      readBack.push_back(transaction.read(*known));
+    } else {
+      std::string regName = known ? known->getName() : getDeviceBaseNode()+"."+curReg->first;
+      transaction.write(regName, curReg->second);
+      readBack.push_back(transaction.read(regName));
+    }
+  }
+}
+
+//
+int gem::hw::vfat::HwVFAT2::checkVFATRegs( vfat_reg_pair_list const& regList,
+                                           std::vector<gem::hw::TransactionFuture<uint32_t> > const& readBack) {
+  int nBad = 0;
+  for (size_t reg = 0; reg < regList.size(); ++reg) {
+    gem::hw::RegisterHandle* known = findVFATRegister(regList[reg].first);
+    uint8_t value = 0x0;
+    bool    good  = known ?
+      decodeVFATReg(readBack[reg], *known, value) :
+      decodeVFATReg(readBack[reg], getRegister(regList[reg].first), value);
+    if (good && known)
+      refreshShadow(*known, value);
+    if (!good || value != regList[reg].second) {
+      DEBUG("register " << regList[reg].first << " wrote 0x" << std::hex << (unsigned)regList[reg].second
+            << (good ? ", read 0x" : ", read failed") << (unsigned)value << std::dec);
+      ++nBad;
+    }
+  }
+  if (nBad)
+    WARN(nBad << " of the " << regList.size() << " VFAT registers written did not read back as written");
+  return nBad;
+}
+
+//
+void gem::hw::vfat::HwVFAT2::writeVFATRegBits( std::string const& regName,
+                                               uint8_t const& mask, uint8_t const& bits) {
+  gem::hw::RegisterHandle* known = findVFATRegister(regName);
+  if (known) {
+    writeVFATRegBits(*known, mask, bits);
+  } else {
+    gem::hw::RegisterHandle reg = getRegister(regName);
+    writeVFATRegBits(reg, mask, bits);
+  }
+}
+
+//
+void gem::hw::vfat::HwVFAT2::writeVFATRegBits( gem::hw::RegisterHandle& reg,
+                                               uint8_t const& mask, uint8_t const& bits) {
+  ShadowRegister* shadow = shadowEnabled_ ? getShadow(reg) : 0;
+  try {
+    uint8_t settings = (shadow && shadow->valid) ? shadow->value : readVFATReg(reg, true);
+    writeVFATReg(reg, (settings&~mask)|(bits&mask));
+  } catch (gem::hw::vfat::exception::TransactionError const& e) {
+    WARN("Problem reading register " << reg.getName() << ", transaction error bit set, not modified");
+  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
+    WARN("Problem reading register " << reg.getName() << ", invalid transaction bit set, not modified");
+  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
+    WARN("Problem reading register " << reg.getName() << ", wrong transaction bit set, not modified");
+  }
+}
+
+void gem::hw::vfat::HwVFAT2::setShadowEnabled(bool enable) {
+  if (enable && !shadowEnabled_)
+    invalidateShadow();
+  shadowEnabled_ = enable;
+}
+
+void gem::hw::vfat::HwVFAT2::invalidateShadow() {
+  for (int chan = 0; chan < N_VFAT2_CHANNELS; ++chan)
+    channelShadow_[chan].valid = false;
+  for (auto reg = settingsShadow_.begin(); reg != settingsShadow_.end(); ++reg)
+    reg->valid = false;
+}
+
+int gem::hw::vfat::HwVFAT2::verifyShadow() {
+  int nDiff = readAllSettings();
+  if (nDiff > 0)
+    WARN("verifyShadow: " << nDiff << " VFAT registers differed from the register shadow, shadow updated");
+  return nDiff;
+}
+
+gem::hw::vfat::HwVFAT2::ShadowRegister* gem::hw::vfat::HwVFAT2::getShadow(gem::hw::RegisterHandle const& reg) {
+  if (&reg >= channelRegs_ && &reg < channelRegs_+N_VFAT2_CHANNELS)
+    return &channelShadow_[&reg-channelRegs_];
+  // the counters change on the chip, they have no shadow
+  if (!settingsRegs_.empty() && &reg >= &settingsRegs_[CONTREG0] && &reg < &settingsRegs_[0]+N_VFAT2_SETTINGS_REGS)
+    return &settingsShadow_[&reg-&settingsRegs_[0]];
+  return 0;
+}
+
+bool gem::hw::vfat::HwVFAT2::refreshShadow(gem::hw::RegisterHandle const& reg, uint8_t const& value) {
+  ShadowRegister* shadow = shadowEnabled_ ? getShadow(reg) : 0;
+  if (!shadow)
+    return false;
+  bool differs  = shadow->valid && shadow->value != value;
+  shadow->value = value;
+  shadow->valid = true;
+  return differs;
+}
+
+gem::hw::RegisterHandle* gem::hw::vfat::HwVFAT2::findVFATRegister(std::string const& regName) {
+  if (regName.compare(0, VFAT2_CHANNEL_REGISTER.size(), VFAT2_CHANNEL_REGISTER) == 0) {
+    char* end = 0;
+    unsigned long channel = strtoul(regName.c_str()+VFAT2_CHANNEL_REGISTER.size(), &end, 10);
+    if (*end || channel < 1 || channel > N_VFAT2_CHANNELS)
+      return 0;
+    return &getChannelRegister(channel);
+  }
+  for (int reg = 0; reg < N_VFAT2_SETTINGS_REGS; ++reg)
+    if (regName == VFAT2_SETTINGS_REGISTERS[reg])
+      return &getSettingsRegisters()[reg];
+  return 0;
+}
+
+gem::hw::RegisterHandle& gem::hw::vfat::HwVFAT2::getChannelRegister(uint8_t const& channel) {
+  gem::hw::RegisterHandle& reg = channelRegs_[channel-1];
+  if (reg.getName().empty())
+    reg = getRegister(toolbox::toString("%s%d",VFAT2_CHANNEL_REGISTER.c_str(),(unsigned)channel));
+  return reg;
+}
+
+std::vector<gem::hw::RegisterHandle>& gem::hw::vfat::HwVFAT2::getSettingsRegisters() {
+  if (settingsRegs_.empty()) {
+    for (int reg = 0; reg < N_VFAT2_SETTINGS_REGS; ++reg)
+      settingsRegs_.push_back(getRegister(VFAT2_SETTINGS_REGISTERS[reg]));
+    settingsShadow_.resize(N_VFAT2_SETTINGS_REGS);
+  }
+  return settingsRegs_;
+}
+
 //
 void gem::hw::vfat::HwVFAT2::readVFATRegs( vfat_reg_pair_list &regList) {
   register_pair_list fullRegList;
@@ -215,23 +500,57 @@ void gem::hw::vfat::HwVFAT2::readVFATRegs( vfat_reg_pair_list &regList) {
 //void gem::hw::vfat::HwVFAT2::readVFAT2Counters(gem::hw::vfat::VFAT2ControlParams &params)
 void gem::hw::vfat::HwVFAT2::readVFAT2Counters()
 {
-  try {
-    vfatParams_.chipID       = getChipID();
-    vfatParams_.upsetCounter = getUpsetCount();
-    vfatParams_.hitCounter   = getHitCount();
-  } catch (gem::hw::vfat::exception::TransactionError& e) {
-    DEBUG(e.what());
-  } catch (gem::hw::vfat::exception::InvalidTransaction& e) {
-    DEBUG(e.what());
-  } catch (gem::hw::vfat::exception::WrongTransaction& e) {
-    DEBUG(e.what());
+  gem::hw::Transaction transaction(*this);
+  std::vector<gem::hw::TransactionFuture<uint32_t> > counters;
+  readVFAT2Counters(transaction, counters);
+  if (!transaction.dispatch())
+    DEBUG("Problem reading the VFAT counter registers, dispatch failed");
+  storeVFAT2Counters(counters);
+}
+
+void gem::hw::vfat::HwVFAT2::readVFAT2Counters(gem::hw::Transaction& transaction,
+                                               std::vector<gem::hw::TransactionFuture<uint32_t> >& counters)
+{
+  std::vector<gem::hw::RegisterHandle>& regs = getSettingsRegisters();
+  bool own = isOwnTransaction(transaction);
+  for (int reg = 0; reg < N_VFAT2_COUNTER_REGS; ++reg)
+    counters.push_back(own ? transaction.read(regs[reg]) : transaction.read(regs[reg].getName()));
+}
+
+bool gem::hw::vfat::HwVFAT2::storeVFAT2Counters(std::vector<gem::hw::TransactionFuture<uint32_t> > const& settings)
+{
+  std::vector<gem::hw::RegisterHandle>& regs = getSettingsRegisters();
+  uint8_t vals[N_VFAT2_COUNTER_REGS];
+  bool    good[N_VFAT2_COUNTER_REGS];
+  for (int reg = 0; reg < N_VFAT2_COUNTER_REGS; ++reg)
+    good[reg] = decodeVFATReg(settings[reg], regs[reg], vals[reg]);
+
+  if (good[CHIPID0] && good[CHIPID1])
+    vfatParams_.chipID = (vals[CHIPID1]<<8)|vals[CHIPID0];
+  if (good[UPSETREG]) {
+    vfatParams_.upsetCounter = vals[UPSETREG];
+    // a single event upset may have flipped bits of the other registers
+    if (shadowEnabled_ && upsetCount_.valid && upsetCount_.value != vals[UPSETREG]) {
+      WARN("UpsetReg changed from " << (unsigned)upsetCount_.value << " to " << (unsigned)vals[UPSETREG]
+           << ", invalidating the register shadow");
+      invalidateShadow();
+    }
+    upsetCount_.value = vals[UPSETREG];
+    upsetCount_.valid = true;
   }
+  if (good[HITCOUNT0] && good[HITCOUNT1] && good[HITCOUNT2])
+    vfatParams_.hitCounter = (vals[HITCOUNT2]<<16)|(vals[HITCOUNT1]<<8)|vals[HITCOUNT0];
+  return good[CHIPID0] && good[CHIPID1];
 }
 
 //void gem::hw::vfat::HwVFAT2::readVFAT2Channel(gem::hw::vfat::VFAT2ControlParams &params, uint8_t channel)
 void gem::hw::vfat::HwVFAT2::readVFAT2Channel(uint8_t channel)
 {
-  uint8_t chanSettings = getChannelSettings(channel);
+  storeVFAT2Channel(channel, getChannelSettings(channel));
+}
+
+void gem::hw::vfat::HwVFAT2::storeVFAT2Channel(uint8_t const& channel, uint8_t const& chanSettings)
+{
   if (channel>1)
     vfatParams_.activeChannel = (unsigned)channel;
   vfatParams_.channels[channel-1].fullChannelReg = chanSettings;
@@ -253,11 +572,40 @@ void gem::hw::vfat::HwVFAT2::readVFAT2Channel(uint8_t channel)
 //void gem::hw::vfat::HwVFAT2::readVFAT2Channels(gem::hw::vfat::VFAT2ControlParams &params)
 void gem::hw::vfat::HwVFAT2::readVFAT2Channels()
 {
-  for (uint8_t chan = 1; chan < 129; ++chan) {
-    //readVFAT2Channel(vfatParams_,chan);
-    readVFAT2Channel(chan);
+  gem::hw::Transaction transaction(*this);
+  std::vector<gem::hw::TransactionFuture<uint32_t> > channels;
+  readVFAT2Channels(transaction, channels);
+  if (!transaction.dispatch())
+    WARN("Problem reading the VFAT channel registers, dispatch failed");
+  storeVFAT2Channels(channels);
+}
+
+void gem::hw::vfat::HwVFAT2::readVFAT2Channels(gem::hw::Transaction& transaction,
+                                               std::vector<gem::hw::TransactionFuture<uint32_t> >& channels)
+{
+  channels.reserve(channels.size()+N_VFAT2_CHANNELS);
+  for (uint8_t chan = 1; chan < N_VFAT2_CHANNELS+1; ++chan)
+    channels.push_back(transaction.read(getChannelRegister(chan)));
+}
+
+int gem::hw::vfat::HwVFAT2::storeVFAT2Channels(std::vector<gem::hw::TransactionFuture<uint32_t> > const& channels)
+{
+  int nBad  = 0;
+  int nDiff = 0;
+  for (uint8_t chan = 1; chan < N_VFAT2_CHANNELS+1; ++chan) {
+    uint8_t chanSettings = 0x0;
+    if (decodeVFATReg(channels[chan-1], getChannelRegister(chan), chanSettings)) {
+      storeVFAT2Channel(chan, chanSettings);
+      if (refreshShadow(getChannelRegister(chan), chanSettings))
+        ++nDiff;
+    } else {
+      ++nBad;
+    }
     DEBUG("chan = "<< (unsigned)chan << "; activeChannel = " <<(unsigned)vfatParams_.activeChannel << std::endl);
   }
+  if (nBad)
+    WARN("Problem reading " << nBad << " of the VFAT channel registers, their settings were not updated");
+  return nDiff;
 }
 
 /////////************************///////////////
@@ -314,130 +662,106 @@ void gem::hw::vfat::HwVFAT2::setAllSettings(const gem::hw::vfat::VFAT2ControlPar
   chanReg|=(params.channels[0].mask     <<VFAT2ChannelBitShifts::ISMASKED);
   chanReg|=(params.channels[0].calPulse <<VFAT2ChannelBitShifts::CHANCAL );
   chanReg|=(params.channels[0].calPulse0<<VFAT2ChannelBitShifts::CHANCAL0);
-  writeVFATReg("VFATChannels.ChanReg1",chanReg);
+  writeVFATReg(getChannelRegister(1),chanReg);
 
   for (uint8_t chan = 2; chan < N_VFAT2_CHANNELS+1; ++chan) {
     chanReg = 0x0;
     chanReg|=(params.channels[chan-1].trimDAC <<VFAT2ChannelBitShifts::TRIMDAC );
     chanReg|=(params.channels[chan-1].mask    <<VFAT2ChannelBitShifts::ISMASKED);
     chanReg|=(params.channels[chan-1].calPulse<<VFAT2ChannelBitShifts::CHANCAL );
-    writeVFATReg(toolbox::toString("VFATChannels.ChanReg%d",(unsigned)chan),(unsigned)chanReg);
+    writeVFATReg(getChannelRegister(chan),chanReg);
   }
 }
 
 //void gem::hw::vfat::HwVFAT2::getAllSettings(gem::hw::vfat::VFAT2ControlParams &params) {
-void gem::hw::vfat::HwVFAT2::getAllSettings() {
+int gem::hw::vfat::HwVFAT2::readAllSettings() {
   //want to lock the hardware (and the params variable) while performing this operation
-  //when sending all these requests, might it be better to do a single transaction?
-  //check that the hardware is alive
-  //maybe find a way to do a single transaction, using the vector read/write?
-  //what is the performance cost/benefit
+  //all the registers are read in a single transaction, the VFAT2 transaction
+  //status of each one is checked separately
 
   DEBUG("getting all settings in HwVFAT2.cc");
-  try {
-    uint8_t cont0 = readVFATReg("ContReg0");
-    uint8_t cont1 = readVFATReg("ContReg1");
-    uint8_t cont2 = readVFATReg("ContReg2");
-    uint8_t cont3 = readVFATReg("ContReg3");
-  
-    DEBUG("getting all settings in HwVFAT2.cc");
-    vfatParams_.control0 = static_cast<unsigned>(cont0);
-    DEBUG("getting all settings in HwVFAT2.cc");
-    vfatParams_.control1 = static_cast<unsigned>(cont1);
-    DEBUG("getting all settings in HwVFAT2.cc");
-    vfatParams_.control2 = static_cast<unsigned>(cont2);
-    DEBUG("getting all settings in HwVFAT2.cc");
-    vfatParams_.control3 = static_cast<unsigned>(cont3);
-    
-    DEBUG("storing RunMode in HwVFAT2.cc");
+  std::vector<gem::hw::RegisterHandle>& regs = getSettingsRegisters();
+  gem::hw::Transaction transaction(*this);
+  std::vector<gem::hw::TransactionFuture<uint32_t> > settings;
+  std::vector<gem::hw::TransactionFuture<uint32_t> > channels;
+  for (auto reg = regs.begin(); reg != regs.end(); ++reg)
+    settings.push_back(transaction.read(*reg));
+  readVFAT2Channels(transaction, channels);
+  if (!transaction.dispatch()) {
+    WARN("Problem reading the VFAT settings, dispatch failed");
+    return -1;
+  }
+
+  //counters, first as an upset invalidates the register shadow the settings refresh
+  DEBUG("getting all counters in HwVFAT2.cc");
+  storeVFAT2Counters(settings);
+
+  uint8_t vals[N_VFAT2_SETTINGS_REGS];
+  bool    good[N_VFAT2_SETTINGS_REGS];
+  int     nBad  = 0;
+  int     nDiff = 0;
+  for (int reg = N_VFAT2_COUNTER_REGS; reg < N_VFAT2_SETTINGS_REGS; ++reg)
+    if (!(good[reg] = decodeVFATReg(settings[reg], regs[reg], vals[reg])))
+      ++nBad;
+    else if (refreshShadow(regs[reg], vals[reg]))
+      ++nDiff;
+  if (nBad)
+    WARN("Problem reading " << nBad << " of the control and analog settings registers, their settings were not updated");
+
+  if (good[CONTREG0]) {
+    uint8_t cont0 = vals[CONTREG0];
+    vfatParams_.control0  = static_cast<unsigned>(cont0);
     vfatParams_.runMode   = static_cast<VFAT2RunMode  >(getRunMode(        cont0));
-    DEBUG("storing TriggerMode in HwVFAT2.cc");
     vfatParams_.trigMode  = static_cast<VFAT2TrigMode >(getTriggerMode(    cont0));
-    DEBUG("storing MSPolarity in HwVFAT2.cc");
     vfatParams_.msPol     = static_cast<VFAT2MSPol    >(getMSPolarity(     cont0));
-    DEBUG("storing CalPolarity in HwVFAT2.cc");
     vfatParams_.calPol    = static_cast<VFAT2CalPol   >(getCalPolarity(    cont0));
-    DEBUG("storing CalibrationMode in HwVFAT2.cc");
     vfatParams_.calibMode = static_cast<VFAT2CalibMode>(getCalibrationMode(cont0));
-    
-    DEBUG("storing DACMode in HwVFAT2.cc");
+  }
+
+  if (good[CONTREG1]) {
+    uint8_t cont1 = vals[CONTREG1];
+    vfatParams_.control1  = static_cast<unsigned>(cont1);
     vfatParams_.dacMode   = static_cast<VFAT2DACMode  >(getDACMode(          cont1));
-    DEBUG("storing ProbeMode in HwVFAT2.cc");
     vfatParams_.probeMode = static_cast<VFAT2ProbeMode>(getProbeMode(        cont1));
-    DEBUG("storing LVDSMode in HwVFAT2.cc");
     vfatParams_.lvdsMode  = static_cast<VFAT2LVDSMode >(getLVDSMode(         cont1));
-    DEBUG("storing HitCycleTime in HwVFAT2.cc");
     vfatParams_.reHitCT   = static_cast<VFAT2ReHitCT  >(getHitCountCycleTime(cont1));
-    
-    DEBUG("storing HitCountMode in HwVFAT2.cc");
+  }
+
+  if (good[CONTREG2]) {
+    uint8_t cont2 = vals[CONTREG2];
+    vfatParams_.control2     = static_cast<unsigned>(cont2);
     vfatParams_.hitCountMode = static_cast<VFAT2HitCountMode >(getHitCountMode( cont2));
-    DEBUG("storing MSPulseLength in HwVFAT2.cc");
     vfatParams_.msPulseLen   = static_cast<VFAT2MSPulseLength>(getMSPulseLength(cont2));
-    DEBUG("storing DigInSel in HwVFAT2.cc");
     vfatParams_.digInSel     = static_cast<VFAT2DigInSel     >(getInputPadMode( cont2));
-    
-    DEBUG("storing TrimDACRange in HwVFAT2.cc");
+  }
+
+  if (good[CONTREG3]) {
+    uint8_t cont3 = vals[CONTREG3];
+    vfatParams_.control3        = static_cast<unsigned>(cont3);
     vfatParams_.trimDACRange    = static_cast<VFAT2TrimDACRange >(getTrimDACRange(   cont3));
-    DEBUG("storing PadBandgap in HwVFAT2.cc");
     vfatParams_.padBandGap      = static_cast<VFAT2PadBandgap   >(getBandgapPad(     cont3));
-    DEBUG("storing DFTestPattern HwVFAT2.cc");
     vfatParams_.sendTestPattern = static_cast<VFAT2DFTestPattern>(getTestPatternMode(cont3));
-  } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    WARN("Problem reading the control registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    WARN("Problem reading the control registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    WARN("Problem reading the control registers, wrong transaction bit set");
   }
 
-  try {
-    vfatParams_.latency = getLatency();
-    
-    vfatParams_.iPreampIn   = getIPreampIn()  ;
-    vfatParams_.iPreampFeed = getIPreampFeed();
-    vfatParams_.iPreampOut  = getIPreampOut() ;
-    vfatParams_.iShaper     = getIShaper()    ;
-    vfatParams_.iShaperFeed = getIShaperFeed();
-    vfatParams_.iComp       = getIComp()      ;
-    
-    vfatParams_.vCal     = getVCal()       ;
-    vfatParams_.vThresh1 = getVThreshold1();
-    vfatParams_.vThresh2 = getVThreshold2();
-    vfatParams_.calPhase = getCalPhase()   ;
-  } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    WARN("Problem reading the analog settings registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    WARN("Problem reading the analog settings registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    WARN("Problem reading the analog settings registers, wrong transaction bit set");
-  }
+  if (good[LATENCY])     vfatParams_.latency     = vals[LATENCY];
 
-  //counters
-  DEBUG("getting all counters in HwVFAT2.cc");
-  //readVFAT2Counters(params);
-  try {
-    readVFAT2Counters();
-  } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    WARN("Problem reading the VFAT counter registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    WARN("Problem reading the VFAT counter registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    WARN("Problem reading the VFAT counter registers, wrong transaction bit set");
-  }
+  if (good[IPREAMPIN])   vfatParams_.iPreampIn   = vals[IPREAMPIN];
+  if (good[IPREAMPFEED]) vfatParams_.iPreampFeed = vals[IPREAMPFEED];
+  if (good[IPREAMPOUT])  vfatParams_.iPreampOut  = vals[IPREAMPOUT];
+  if (good[ISHAPER])     vfatParams_.iShaper     = vals[ISHAPER];
+  if (good[ISHAPERFEED]) vfatParams_.iShaperFeed = vals[ISHAPERFEED];
+  if (good[ICOMP])       vfatParams_.iComp       = vals[ICOMP];
+
+  if (good[VCAL])        vfatParams_.vCal        = vals[VCAL];
+  if (good[VTHRESHOLD1]) vfatParams_.vThresh1    = vals[VTHRESHOLD1];
+  if (good[VTHRESHOLD2]) vfatParams_.vThresh2    = vals[VTHRESHOLD2];
+  if (good[CALPHASE])    vfatParams_.calPhase    = vals[CALPHASE];
 
   //set the channel settings here
   DEBUG("getting all channel settings in HwVFAT2.cc");
-  //readVFAT2Channels(params);
-  try {
-    readVFAT2Channels();
-  } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    WARN("Problem reading the VFAT channel registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    WARN("Problem reading the VFAT channel registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    WARN("Problem reading the VFAT channel registers, wrong transaction bit set");
-  }
+  nDiff += storeVFAT2Channels(channels);
   DEBUG("done getting all settings in HwVFAT2.cc");
+  return nDiff;
 }
 
 //channel specific settings
@@ -452,25 +776,13 @@ void gem::hw::vfat::HwVFAT2::enableCalPulseToChannel(uint8_t channel, bool on) {
     return;
   }
   
-  std::string registerName = "VFATChannels.ChanReg1";
-  if (channel > 1)
-    registerName = toolbox::toString("VFATChannels.ChanReg%d",(unsigned)channel);
+  // channel 0 is the cal pulse bit of the register of channel 1
+  gem::hw::RegisterHandle& reg = getChannelRegister(channel > 1 ? channel : 1);
   
-  try {
-    uint8_t channelSettings = readVFATReg(registerName);
-    
-    if (channel == 0) 
-      writeVFATReg(registerName,(channelSettings&~VFAT2ChannelBitMasks::CHANCAL0)|(on ? 0x80 : 0x0));
-    else
-      writeVFATReg(registerName,(channelSettings&~VFAT2ChannelBitMasks::CHANCAL)|(on ? 0x40 : 0x0));
-  } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    WARN("Problem reading the control registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    WARN("Problem reading the control registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    WARN("Problem reading the control registers, wrong transaction bit set");
-  }
-
+  if (channel == 0) 
+    writeVFATRegBits(reg,VFAT2ChannelBitMasks::CHANCAL0,(on ? 0x80 : 0x0));
+  else
+    writeVFATRegBits(reg,VFAT2ChannelBitMasks::CHANCAL,(on ? 0x40 : 0x0));
 }
 
 void gem::hw::vfat::HwVFAT2::maskChannel(uint8_t channel, bool on) {
@@ -483,17 +795,7 @@ void gem::hw::vfat::HwVFAT2::maskChannel(uint8_t channel, bool on) {
     ERROR(msg);
     return;
   }
-  try {
-    std::string registerName = toolbox::toString("VFATChannels.ChanReg%d",(unsigned)channel);
-    uint8_t channelSettings = (readVFATReg(registerName)&~VFAT2ChannelBitMasks::ISMASKED);
-    writeVFATReg(registerName,channelSettings|(on ? 0x20 : 0x0));
-  } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    WARN("Problem reading the control registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    WARN("Problem reading the control registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    WARN("Problem reading the control registers, wrong transaction bit set");
-  }
+  writeVFATRegBits(getChannelRegister(channel),VFAT2ChannelBitMasks::ISMASKED,(on ? 0x20 : 0x0));
 }
 
 uint8_t gem::hw::vfat::HwVFAT2::getChannelTrimDAC(uint8_t channel) {
@@ -505,8 +807,7 @@ uint8_t gem::hw::vfat::HwVFAT2::getChannelTrimDAC(uint8_t channel) {
     //XCEPT_RAISE(gem::hw::vfat::exception::NonexistentChannel,msg);
     return 0xff;
   }
-  std::string registerName = toolbox::toString("VFATChannels.ChanReg%d",(unsigned)channel);
-  return (readVFATReg(registerName)&VFAT2ChannelBitMasks::TRIMDAC);
+  return (readVFATReg(getChannelRegister(channel))&VFAT2ChannelBitMasks::TRIMDAC);
 }
 
 void gem::hw::vfat::HwVFAT2::setChannelTrimDAC(uint8_t channel, uint8_t trimDAC) {
@@ -518,17 +819,7 @@ void gem::hw::vfat::HwVFAT2::setChannelTrimDAC(uint8_t channel, uint8_t trimDAC)
     //XCEPT_RAISE(gem::hw::vfat::exception::NonexistentChannel,msg);
     return;
   }
-  std::string registerName = toolbox::toString("VFATChannels.ChanReg%d",channel);
-  try {
-    uint8_t channelSettings = (readVFATReg(registerName)&~VFAT2ChannelBitMasks::TRIMDAC)|trimDAC;
-    writeVFATReg(registerName,channelSettings|trimDAC);
-  } catch (gem::hw::vfat::exception::TransactionError const& e) {
-    WARN("Problem reading the control registers, transaction error bit set");
-  } catch (gem::hw::vfat::exception::InvalidTransaction const& e) {
-    WARN("Problem reading the control registers, invalid transaction bit set");
-  } catch (gem::hw::vfat::exception::WrongTransaction const& e) {
-    WARN("Problem reading the control registers, wrong transaction bit set");
-  }
+  writeVFATRegBits(getChannelRegister(channel),VFAT2ChannelBitMasks::TRIMDAC,trimDAC);
 }
 
 /***
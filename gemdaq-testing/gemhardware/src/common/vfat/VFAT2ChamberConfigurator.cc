@@ -0,0 +1,147 @@
+#include "gem/hw/vfat/VFAT2ChamberConfigurator.h"
+
+#include <map>
+#include <time.h>
+
+namespace {
+  double nowMs()
+  {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec*1e3 + now.tv_nsec/1e6;
+  }
+}
+
+gem::hw::vfat::VFAT2ChamberConfigurator::VFAT2ChamberConfigurator(std::vector<vfat_shared_ptr> const& chips) :
+  gemLogger_(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:hw:vfat:VFAT2ChamberConfigurator"))),
+  chips_(chips),
+  overrides_(chips.size()),
+  connected_(chips.size(), false),
+  configured_(chips.size(), false)
+{
+}
+
+void gem::hw::vfat::VFAT2ChamberConfigurator::setChipSettings(size_t const& chip, vfat_reg_pair_list const& settings)
+{
+  if (chip >= chips_.size()) {
+    ERROR("setChipSettings: chip " << chip << " outside the " << chips_.size() << " chips configured");
+    return;
+  }
+  overrides_[chip] = settings;
+}
+
+vfat_reg_pair_list gem::hw::vfat::VFAT2ChamberConfigurator::getChipSettings(size_t const& chip) const
+{
+  vfat_reg_pair_list settings = common_;
+  vfat_reg_pair_list const& overrides = overrides_.at(chip);
+  for (auto curReg = overrides.begin(); curReg != overrides.end(); ++curReg) {
+    auto common = settings.begin();
+    while (common != settings.end() && common->first != curReg->first)
+      ++common;
+    if (common != settings.end())
+      common->second = curReg->second;
+    else
+      settings.push_back(*curReg);
+  }
+  return settings;
+}
+
+bool gem::hw::vfat::VFAT2ChamberConfigurator::configure()
+{
+  double start = nowMs();
+  report_.reset();
+  report_.nChips = chips_.size();
+  connected_.assign(chips_.size(), false);
+  configured_.assign(chips_.size(), false);
+
+  // the chips behind one IP address are reached through the connection of any of them, the others
+  // queue their registers by name on its transactions so their handles are left to them
+  std::map<std::string, std::vector<size_t> > groups;
+  for (size_t chip = 0; chip < chips_.size(); ++chip)
+    groups[chips_[chip]->getDeviceIPAddress()].push_back(chip);
+
+  std::map<std::string, vfat_shared_ptr> links;
+  for (auto group = groups.begin(); group != groups.end(); ++group)
+    for (auto chip = group->second.begin(); chip != group->second.end(); ++chip)
+      if (chips_[*chip]->gem::hw::GEMHwDevice::isHwConnected()) {
+        links[group->first] = chips_[*chip];
+        break;
+      }
+
+  // read the counters, a chip that does not return its chip ID is not configured
+  double phase = nowMs();
+  for (auto group = groups.begin(); group != groups.end(); ++group) {
+    if (!links.count(group->first)) {
+      WARN("configure: no connection to the VFATs at " << group->first);
+      continue;
+    }
+    gem::hw::Transaction transaction(*links[group->first]);
+    std::vector<std::vector<gem::hw::TransactionFuture<uint32_t> > > counters(group->second.size());
+    for (size_t chip = 0; chip < group->second.size(); ++chip)
+      chips_[group->second[chip]]->readVFAT2Counters(transaction, counters[chip]);
+    if (!transaction.dispatch())
+      WARN("configure: problem reading the VFAT counters at " << group->first << ", dispatch failed");
+    ++report_.nDispatches;
+
+    for (size_t chip = 0; chip < group->second.size(); ++chip) {
+      size_t index = group->second[chip];
+      connected_[index] = chips_[index]->storeVFAT2Counters(counters[chip]);
+      if (connected_[index])
+        ++report_.nConnected;
+      else
+        WARN("configure: " << chips_[index]->getDeviceBaseNode() << " did not respond, not configured");
+    }
+  }
+  report_.countersMs = nowMs()-phase;
+
+  // write the settings of all the chips, then read them all back
+  phase = nowMs();
+  for (auto group = groups.begin(); group != groups.end(); ++group) {
+    if (!links.count(group->first))
+      continue;
+    gem::hw::Transaction transaction(*links[group->first]);
+    std::vector<vfat_reg_pair_list> settings(group->second.size());
+    std::vector<std::vector<gem::hw::TransactionFuture<uint32_t> > > readBack(group->second.size());
+    for (size_t chip = 0; chip < group->second.size(); ++chip) {
+      size_t index = group->second[chip];
+      if (!connected_[index])
+        continue;
+      settings[chip] = getChipSettings(index);
+      chips_[index]->writeVFATRegs(transaction, settings[chip], readBack[chip]);
+      report_.nRegisters += settings[chip].size();
+    }
+    if (transaction.empty())
+      continue;
+    if (!transaction.dispatch())
+      WARN("configure: problem writing the VFAT settings at " << group->first << ", dispatch failed");
+    ++report_.nDispatches;
+
+    for (size_t chip = 0; chip < group->second.size(); ++chip) {
+      size_t index = group->second[chip];
+      if (!connected_[index])
+        continue;
+      int nBad = chips_[index]->checkVFATRegs(settings[chip], readBack[chip]);
+      report_.nBadRegisters += nBad;
+      configured_[index] = (nBad == 0);
+      if (configured_[index])
+        ++report_.nConfigured;
+      else
+        WARN("configure: " << chips_[index]->getDeviceBaseNode() << " has " << nBad
+             << " registers that did not read back as written");
+    }
+  }
+  report_.writeMs = nowMs()-phase;
+  report_.totalMs = nowMs()-start;
+
+  INFO("configure: " << printReport());
+  return report_.nConfigured == report_.nChips;
+}
+
+std::string gem::hw::vfat::VFAT2ChamberConfigurator::printReport() const
+{
+  return toolbox::toString("%d/%d VFATs configured (%d responding), %d registers written (%d bad), "
+                           "%d dispatches in %.1f ms: counters %.1f ms, write and read back %.1f ms",
+                           report_.nConfigured, report_.nChips, report_.nConnected,
+                           report_.nRegisters, report_.nBadRegisters, report_.nDispatches,
+                           report_.totalMs, report_.countersMs, report_.writeMs);
+}
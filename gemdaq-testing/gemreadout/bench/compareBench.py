@@ -0,0 +1,60 @@
+#!/usr/bin/env python
+"""
+Compares two readoutBench results stage by stage
+
+  ./bench/compareBench.py reference.json results.json [threshold]
+
+Prints the events/s, MB/s and endToEnd latency percentiles of both runs with the relative
+change, and flags the changes worse than threshold percent (default 5). The exit status is 1
+if any stage regressed, so it can be used to check a commit against a reference run.
+"""
+
+import json, sys
+
+RATES     = ['events_per_s', 'MB_per_s']
+LATENCIES = ['p50', 'p90', 'p99', 'p999', 'max']
+
+def change(ref, new):
+	if ref == 0:
+		return 0.
+	return 100.*(new - ref)/ref
+
+def main():
+	if len(sys.argv) < 3:
+		print(__doc__)
+		return 2
+	ref = json.load(open(sys.argv[1]))
+	new = json.load(open(sys.argv[2]))
+	threshold = float(sys.argv[3]) if len(sys.argv) > 3 else 5.
+
+	print("reference %s (%s), results %s (%s)" % (sys.argv[1], ref.get('label', ''),
+	                                             sys.argv[2], new.get('label', '')))
+	for key in ['input', 'events', 'link_mask', 'occupancy', 'compression', 'rate']:
+		if ref.get(key) != new.get(key):
+			print("warning: %s differs, %s and %s" % (key, ref.get(key), new.get(key)))
+
+	regressed = 0
+	print("%-10s %-14s %14s %14s %9s" % ('stage', 'quantity', 'reference', 'results', 'change'))
+	for name in ref['stages']:
+		if name not in new['stages']:
+			print("%-10s missing from the results" % name)
+			continue
+		refStage = ref['stages'][name]
+		newStage = new['stages'][name]
+		rows = [(quantity, refStage[quantity], newStage[quantity], False) for quantity in RATES]
+		if 'latency_us' in refStage and 'latency_us' in newStage:
+			rows += [('latency_' + quantity, refStage['latency_us'][quantity],
+			          newStage['latency_us'][quantity], True) for quantity in LATENCIES]
+		for quantity, refValue, newValue, lowerIsBetter in rows:
+			delta = change(refValue, newValue)
+			worse = (delta > threshold) if lowerIsBetter else (delta < -threshold)
+			if worse:
+				regressed += 1
+			print("%-10s %-14s %14.3f %14.3f %+8.1f%%%s" % (name, quantity, refValue, newValue,
+			                                              delta, '  REGRESSION' if worse else ''))
+
+	print("%d regressions over %.1f%%" % (regressed, threshold))
+	return 1 if regressed else 0
+
+if __name__ == '__main__':
+	sys.exit(main())
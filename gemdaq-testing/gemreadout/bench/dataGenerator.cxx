@@ -0,0 +1,111 @@
+/**
+ * Synthetic raw data files
+ *
+ * Makes events with the GEMDataGenerator and writes them through GLIBReplay and the
+ * GEMDataParker, so the file is what the readout would have written for that data, for load
+ * tests of the writers and the DQM at occupancies the recorded runs do not reach.
+ *
+ *   make bench
+ *   ./bench/dataGenerator GEM_DAQ_synthetic.dat nEvents [outputType] [occupancy] [linkMask] [errorRate] [seed] [compression]
+ *
+ * outputType is Hex or Bin. occupancy is the probability of each channel to fire in an event,
+ * or a file with one probability per line for channels 0 to 127. errorRate is the fraction of
+ * VFAT blocks corrupted, each with one of the errors of GEMDataGenerator::Error. compression
+ * is the zlib level, 0 for none.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "gem/readout/GEMDataGenerator.h"
+#include "gem/readout/GLIBReplay.h"
+#include "gem/readout/GEMDataParker.h"
+
+static const uint32_t EVENT_TIMEOUT_MS = 100;
+
+static char const* errorNames[gem::readout::GEMDataGenerator::N_ERRORS] = {
+  "CRC", "control bits", "BC mismatch", "unknown chip"
+};
+
+/** one probability per channel, one per line */
+static bool readOccupancy(std::string const& fileName, gem::readout::GEMDataGenerator& generator)
+{
+  std::ifstream profile(fileName.c_str());
+  if (!profile.is_open())
+    return false;
+  double occupancy;
+  unsigned channel = 0;
+  for (; channel < gem::readout::GEMDataGenerator::N_CHANNELS && profile >> occupancy; ++channel)
+    generator.setOccupancy(channel, occupancy);
+  return channel == gem::readout::GEMDataGenerator::N_CHANNELS;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3) {
+    std::cout << "Usage: dataGenerator file.dat nEvents [Hex|Bin] [occupancy|profile.txt] [linkMask] [errorRate]"
+              << " [seed] [compression]" << std::endl;
+    return 1;
+  }
+  std::string outFile    = argv[1];
+  uint64_t    nEvents    = std::strtoull(argv[2], 0, 0);
+  std::string outputType = (argc > 3) ? argv[3] : "Bin";
+  std::string occupancy  = (argc > 4) ? argv[4] : "0.01";
+  uint8_t     linkMask   = (argc > 5) ? std::strtoul(argv[5], 0, 0) : 0x1;
+  double      errorRate  = (argc > 6) ? std::strtod(argv[6], 0) : 0;
+  uint64_t    seed       = (argc > 7) ? std::strtoull(argv[7], 0, 0) : 1;
+  int         level      = (argc > 8) ? std::strtol(argv[8], 0, 0) : 0;
+
+  gem::readout::GEMDataGenerator generator(seed);
+  generator.setLinkMask(linkMask);
+  generator.setErrorRate(errorRate);
+  char* end;
+  double probability = std::strtod(occupancy.c_str(), &end);
+  if (*end == '\0') {
+    generator.setOccupancy(probability);
+  } else if (!readOccupancy(occupancy, generator)) {
+    std::cout << "Unable to read " << gem::readout::GEMDataGenerator::N_CHANNELS << " occupancies from "
+              << occupancy << std::endl;
+    return 1;
+  }
+
+  gem::readout::GLIBReplay glib(generator, nEvents);
+  if (!glib.isHwConnected()) {
+    std::cout << "No events to write" << std::endl;
+    return 1;
+  }
+
+  std::remove(outFile.c_str());
+  uint64_t crcErrors = 0;
+  {
+    gem::readout::GEMDataParker parker(glib, outFile, outputType, glib.getLinkMask(), EVENT_TIMEOUT_MS);
+    // the chips of the generator are in the first slots of each GEB
+    for (uint8_t link = 0; link < gem::readout::GEMDataGenerator::MAX_LINKS; ++link)
+      for (size_t chip = 0; chip < generator.getChipIDs(link).size(); ++chip)
+        parker.setChipSlot(link, chip, generator.getChipIDs(link)[chip]);
+    if (level)
+      parker.setCompression(level, 1);
+    while (!glib.isDone())
+      parker.dumpDataToDisk();
+    parker.flush();
+    crcErrors = parker.getCRCErrors();
+  }
+
+  uint64_t nChannels = generator.getBlocks()*gem::readout::GEMDataGenerator::N_CHANNELS;
+  std::cout << std::fixed << std::setprecision(4)
+            << "file " << outFile << ", output " << outputType << ", compression " << level << "\n"
+            << generator.getEvents() << " events, " << generator.getBlocks() << " VFAT blocks, "
+            << generator.getHits() << " hits, mean occupancy "
+            << (nChannels ? generator.getHits()/static_cast<double>(nChannels) : 0.) << "\n"
+            << generator.getErrors() << " blocks corrupted:";
+  for (unsigned error = 0; error < gem::readout::GEMDataGenerator::N_ERRORS; ++error)
+    std::cout << " " << errorNames[error] << " "
+              << generator.getErrors(static_cast<gem::readout::GEMDataGenerator::Error>(error));
+  std::cout << "\n" << crcErrors << " CRC errors seen by the readout" << std::endl;
+  return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * Tracking data decode microbenchmark
+ *
+ * Compares the hand written mask/shift decode the parker used to do with the
+ * GEMDataCodec field descriptors, on the same random tracking data blocks.
+ * Both decoders must give the same VFATData, the program fails if they do not.
+ *
+ *   make bench
+ *   ./bench/decodeBench [nBlocks] [nPasses]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <stdint.h>
+#include <time.h>
+
+#include "gem/readout/GEMDataAMCformat.h"
+
+static const unsigned BLOCK_WORDS = 8; // seven tracking data words and the trigger data word
+
+static double nowNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec*1e9 + now.tv_nsec;
+}
+
+// the decode the parker did before the field descriptors
+static void legacyDecode(uint32_t const* data, gem::readout::VFATData& vfat)
+{
+  uint16_t b1010 = ((data[5] & 0xF0000000)>>28);
+  uint16_t b1100 = ((data[5] & 0x0000F000)>>12);
+  uint16_t b1110 = ((data[4] & 0xF0000000)>>28);
+
+  uint16_t bcn    = (0x0fff0000 & data[5]) >> 16;
+  uint16_t evn    = (0x00000ff0 & data[5]) >> 4;
+  uint16_t chipid = (0x0fff0000 & data[4]) >> 16;
+  uint8_t  flags  = (0x0000000f & data[5]);
+  uint16_t crc    = (0x0000ffff & data[0]);
+
+  uint64_t data1  = ((0x0000ffff & data[4]) << 16) | ((0xffff0000 & data[3]) >> 16);
+  uint64_t data2  = ((0x0000ffff & data[3]) << 16) | ((0xffff0000 & data[2]) >> 16);
+  uint64_t data3  = ((0x0000ffff & data[2]) << 16) | ((0xffff0000 & data[1]) >> 16);
+  uint64_t data4  = ((0x0000ffff & data[1]) << 16) | ((0xffff0000 & data[0]) >> 16);
+
+  vfat.BC     = ( b1010 << 12 ) | (bcn);
+  vfat.EC     = ( b1100 << 12 ) | (evn << 4) | (flags);
+  vfat.ChipID = ( b1110 << 12 ) | (chipid);
+  vfat.lsData = (data3 << 32) | (data4);
+  vfat.msData = (data1 << 32) | (data2);
+  vfat.BXfrOH = data[6];
+  vfat.crc    = crc;
+}
+
+static bool sameBlock(gem::readout::VFATData const& a, gem::readout::VFATData const& b)
+{
+  return a.BC == b.BC && a.EC == b.EC && a.ChipID == b.ChipID &&
+    a.lsData == b.lsData && a.msData == b.msData && a.BXfrOH == b.BXfrOH && a.crc == b.crc;
+}
+
+template <typename DECODE>
+static double run(DECODE decode, std::vector<uint32_t> const& blocks, uint32_t nBlocks, unsigned nPasses,
+                  uint64_t& checksum)
+{
+  gem::readout::VFATData vfat;
+  double start = nowNs();
+  for (unsigned pass = 0; pass < nPasses; ++pass)
+    for (uint32_t iBlock = 0; iBlock < nBlocks; ++iBlock) {
+      decode(&blocks[iBlock*BLOCK_WORDS], vfat);
+      // keep the compiler from dropping the decode
+      checksum += vfat.BC ^ vfat.EC ^ vfat.ChipID ^ vfat.lsData ^ vfat.msData ^ vfat.BXfrOH ^ vfat.crc;
+    }
+  return (nowNs() - start)/(static_cast<double>(nBlocks)*nPasses);
+}
+
+int main(int argc, char** argv)
+{
+  uint32_t nBlocks = (argc > 1) ? std::strtoul(argv[1], 0, 0) : 100000;
+  unsigned nPasses = (argc > 2) ? std::strtoul(argv[2], 0, 0) : 50;
+  if (!nBlocks || !nPasses) {
+    std::cout << "Usage: decodeBench [nBlocks] [nPasses]" << std::endl;
+    return 1;
+  }
+
+  std::vector<uint32_t> blocks(nBlocks*BLOCK_WORDS);
+  srand(12345);
+  for (size_t i = 0; i < blocks.size(); ++i)
+    blocks[i] = (static_cast<uint32_t>(rand()) << 16) ^ static_cast<uint32_t>(rand());
+
+  for (uint32_t iBlock = 0; iBlock < nBlocks; ++iBlock) {
+    gem::readout::VFATData legacy, codec;
+    legacyDecode(&blocks[iBlock*BLOCK_WORDS], legacy);
+    gem::readout::decodeTrackingBlock(&blocks[iBlock*BLOCK_WORDS], codec);
+    if (!sameBlock(legacy, codec)) {
+      std::cout << "decoders disagree on block " << iBlock << std::endl;
+      return 1;
+    }
+  }
+
+  uint64_t checksum = 0;
+  double legacyNs = run(legacyDecode, blocks, nBlocks, nPasses, checksum);
+  double codecNs  = run(gem::readout::decodeTrackingBlock, blocks, nBlocks, nPasses, checksum);
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "blocks " << nBlocks << " passes " << nPasses << "\n"
+            << "hand written decode " << legacyNs << " ns/block\n"
+            << "GEMDataCodec decode " << codecNs  << " ns/block\n"
+            << "(checksum " << std::hex << checksum << std::dec << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,394 @@
+/**
+ * Readout stage benchmark
+ *
+ * Times each stage of the readout on the same events, one after the other, and the whole chain
+ * at once, and writes the results as JSON so runs on different commits can be compared:
+ *
+ *   drain      tracking data FIFOs of GLIBReplay read out MAX_BLOCKS_PER_DRAIN blocks at a time
+ *   decode     decodeTrackingBlock on every block drained
+ *   crc        checkVFATCRCs on every block decoded
+ *   build      GEMEventBuilder, the links interleaved one drain at a time as the parker does
+ *   writeHex, writeBin, writeBinZ
+ *              GEMDataParker fillGEMevent and writeGEMevent of the built events, to a closed file
+ *   endToEnd   drain, decode, check, build and write to a Bin file in one loop, with the latency
+ *              of each event from the drain that read its first block until it is written
+ *
+ *   make bench
+ *   ./bench/readoutBench [nEvents|file.dat] [occupancy] [linkMask] [compression] [rate] [results.json] [label]
+ *
+ * The events are made by the GEMDataGenerator, or replayed from a raw data file. compression is
+ * the zlib level of writeBinZ, rate the events per second GLIBReplay emits in the endToEnd stage,
+ * 0 to have all of them ready from the start. The label, e.g. the commit, is copied to the
+ * results, which go to standard output without a file name.
+ * Rates are per second of the stage, MB/s count the tracking data words for the readout stages
+ * and the bytes of the file for the write stages.
+ * bench/compareBench.py reference.json results.json compares two runs stage by stage.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "gem/readout/GEMDataCRC.h"
+#include "gem/readout/GEMDataGenerator.h"
+#include "gem/readout/GEMDataParker.h"
+#include "gem/readout/GEMEventBuilder.h"
+#include "gem/readout/GLIBReplay.h"
+#include "gem/datachecker/GEMDataChecker.h"
+
+static double nowNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec*1e9 + now.tv_nsec;
+}
+
+static const uint32_t EVENT_TIMEOUT_MS = 100;
+static const uint8_t  MAX_LINKS        = gem::readout::GLIBReplay::MAX_LINKS;
+static const unsigned BLOCK_WORDS      = gem::hw::glib::HwGLIB::TRACKING_BLOCK_WORDS;
+static const unsigned BLOCK_BYTES      = BLOCK_WORDS*sizeof(uint32_t);
+
+// ChipIDs of the generated events per link, the chip in slot n is the nth, empty for a replayed file
+static std::vector<uint16_t> chipMap[MAX_LINKS];
+
+static void setChipMap(gem::readout::GEMDataParker& parker)
+{
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    for (size_t chip = 0; chip < chipMap[link].size(); ++chip)
+      parker.setChipSlot(link, chip, chipMap[link][chip]);
+}
+
+struct Stage {
+  std::string name;
+  double   seconds;
+  uint64_t events;
+  uint64_t blocks;
+  uint64_t bytes;
+  std::vector<double> latencyNs; // per event, endToEnd only
+};
+
+static uint64_t fileSize(std::string const& fileName)
+{
+  struct stat st;
+  return (stat(fileName.c_str(), &st) == 0) ? st.st_size : 0;
+}
+
+// an event is known by the OptoHybrid BX and the EC of its blocks, as in the event builder
+static uint32_t eventKey(gem::readout::VFATData const& vfat)
+{
+  return (static_cast<uint32_t>(vfat.BXfrOH) << 8) | gem::readout::VFAT::EC::get(vfat.EC);
+}
+
+static bool eventKey(gem::readout::GEMData const& gem, uint32_t& key)
+{
+  for (std::vector<gem::readout::GEBData>::const_iterator geb = gem.gebs.begin(); geb != gem.gebs.end(); ++geb)
+    if (!geb->vfats.empty()) {
+      key = eventKey(geb->vfats.front());
+      return true;
+    }
+  return false;
+}
+
+static Stage drainStage(gem::readout::GLIBReplay& glib, std::vector<uint32_t> (&words)[MAX_LINKS])
+{
+  Stage stage = {"drain", 0, glib.getFileEvents(), 0, 0};
+  uint8_t mask = glib.getLinkMask();
+  std::vector<uint32_t> data;
+  glib.start();
+  double start = nowNs();
+  while (!glib.isDone())
+    for (uint8_t link = 0; link < MAX_LINKS; ++link) {
+      if (!((mask >> link) & 0x1))
+        continue;
+      uint32_t nBlocks = glib.drainTrackingFIFO(link, gem::readout::GEMDataParker::MAX_BLOCKS_PER_DRAIN, data);
+      words[link].insert(words[link].end(), data.begin(), data.begin() + nBlocks*BLOCK_WORDS);
+      stage.blocks += nBlocks;
+    }
+  stage.seconds = (nowNs() - start)*1e-9;
+  stage.bytes   = stage.blocks*BLOCK_BYTES;
+  return stage;
+}
+
+static Stage decodeStage(std::vector<uint32_t> const (&words)[MAX_LINKS], uint64_t const& nEvents,
+                         std::vector<gem::readout::VFATData> (&vfats)[MAX_LINKS])
+{
+  Stage stage = {"decode", 0, nEvents, 0, 0};
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    vfats[link].resize(words[link].size()/BLOCK_WORDS);
+  double start = nowNs();
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    for (size_t block = 0; block < vfats[link].size(); ++block)
+      gem::readout::decodeTrackingBlock(&words[link][block*BLOCK_WORDS], vfats[link][block]);
+  stage.seconds = (nowNs() - start)*1e-9;
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    stage.blocks += vfats[link].size();
+  stage.bytes = stage.blocks*BLOCK_BYTES;
+  return stage;
+}
+
+static Stage crcStage(std::vector<gem::readout::VFATData> const (&vfats)[MAX_LINKS], uint64_t const& nEvents,
+                      uint64_t& nBad)
+{
+  Stage stage = {"crc", 0, nEvents, 0, 0};
+  nBad = 0;
+  double start = nowNs();
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    if (!vfats[link].empty())
+      nBad += gem::readout::checkVFATCRCs(&vfats[link][0], vfats[link].size());
+  stage.seconds = (nowNs() - start)*1e-9;
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    stage.blocks += vfats[link].size();
+  stage.bytes = stage.blocks*BLOCK_BYTES;
+  return stage;
+}
+
+static Stage buildStage(std::vector<gem::readout::VFATData> const (&vfats)[MAX_LINKS], uint8_t const& mask,
+                        std::vector<gem::readout::GEMData>& events)
+{
+  Stage stage = {"build", 0, 0, 0, 0};
+  gem::readout::GEMEventBuilder builder(mask, EVENT_TIMEOUT_MS);
+  size_t next[MAX_LINKS] = {0, 0, 0};
+  gem::readout::GEMData gem;
+  double start = nowNs();
+  for (bool more = true; more; ) {
+    more = false;
+    for (uint8_t link = 0; link < MAX_LINKS; ++link) {
+      size_t end = std::min(next[link] + gem::readout::GEMDataParker::MAX_BLOCKS_PER_DRAIN, vfats[link].size());
+      for (; next[link] < end; ++next[link])
+        builder.addBlock(link, vfats[link][next[link]]);
+      more |= (end < vfats[link].size());
+    }
+    while (builder.popEvent(gem))
+      events.push_back(gem);
+  }
+  builder.flush();
+  while (builder.popEvent(gem))
+    events.push_back(gem);
+  stage.seconds = (nowNs() - start)*1e-9;
+  stage.events  = events.size();
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    stage.blocks += vfats[link].size();
+  stage.bytes = stage.blocks*BLOCK_BYTES;
+  return stage;
+}
+
+static Stage writeStage(std::string const& name, gem::readout::GLIBReplay& glib, std::string const& outputType,
+                        int const& compression, std::vector<gem::readout::GEMData>& events)
+{
+  Stage stage = {name, 0, events.size(), 0, 0};
+  std::string outFile = "readoutBench_" + name + ".dat";
+  std::remove(outFile.c_str());
+  double start = nowNs();
+  {
+    gem::readout::GEMDataParker parker(glib, outFile, outputType, glib.getLinkMask(), EVENT_TIMEOUT_MS);
+    setChipMap(parker);
+    if (compression)
+      parker.setCompression(compression, 1);
+    for (std::vector<gem::readout::GEMData>::iterator gem = events.begin(); gem != events.end(); ++gem) {
+      parker.fillGEMevent(*gem);
+      parker.writeGEMevent(*gem);
+      for (std::vector<gem::readout::GEBData>::const_iterator geb = gem->gebs.begin(); geb != gem->gebs.end(); ++geb)
+        stage.blocks += geb->vfats.size();
+    }
+    parker.flush();
+  }
+  stage.seconds = (nowNs() - start)*1e-9;
+  stage.bytes   = fileSize(outFile);
+  return stage;
+}
+
+static Stage endToEndStage(gem::readout::GLIBReplay& glib, double const& rate)
+{
+  Stage stage = {"endToEnd", 0, 0, 0, 0};
+  std::string outFile = "readoutBench_endToEnd.dat";
+  std::remove(outFile.c_str());
+  uint8_t mask = glib.getLinkMask();
+  gem::datachecker::GEMDataChecker checker;
+  gem::readout::GEMEventBuilder builder(mask, EVENT_TIMEOUT_MS);
+  std::map<uint32_t, double> firstSeen;
+  uint32_t lastKey[MAX_LINKS] = {0, 0, 0};
+  bool     linkSeen[MAX_LINKS] = {false, false, false};
+  std::vector<uint32_t> data;
+  gem::readout::VFATData vfat;
+  gem::readout::GEMData gem;
+  uint32_t key;
+
+  glib.setRate(rate);
+  glib.start();
+  double start = nowNs();
+  {
+    gem::readout::GEMDataParker parker(glib, outFile, "Bin", mask, EVENT_TIMEOUT_MS);
+    setChipMap(parker);
+    for (bool done = false; !done; ) {
+      done = glib.isDone();
+      for (uint8_t link = 0; link < MAX_LINKS; ++link) {
+        if (!((mask >> link) & 0x1))
+          continue;
+        uint32_t nBlocks = glib.drainTrackingFIFO(link, gem::readout::GEMDataParker::MAX_BLOCKS_PER_DRAIN, data);
+        double drained = nowNs();
+        for (uint32_t block = 0; block < nBlocks; ++block) {
+          gem::readout::decodeTrackingBlock(&data[block*BLOCK_WORDS], vfat);
+          checker.checkBlock(link, vfat);
+          // only the first block of an event on each link can be the first one seen
+          key = eventKey(vfat);
+          if (!linkSeen[link] || key != lastKey[link])
+            firstSeen.insert(std::make_pair(key, drained));
+          lastKey[link]  = key;
+          linkSeen[link] = true;
+          builder.addBlock(link, vfat);
+        }
+        stage.blocks += nBlocks;
+      }
+      if (done)
+        builder.flush();
+      while (builder.popEvent(gem)) {
+        parker.fillGEMevent(gem);
+        parker.writeGEMevent(gem);
+        if (eventKey(gem, key)) {
+          std::map<uint32_t, double>::iterator seen = firstSeen.find(key);
+          if (seen != firstSeen.end()) {
+            stage.latencyNs.push_back(nowNs() - seen->second);
+            firstSeen.erase(seen);
+          }
+        }
+        ++stage.events;
+      }
+    }
+    parker.flush();
+  }
+  stage.seconds = (nowNs() - start)*1e-9;
+  stage.bytes   = stage.blocks*BLOCK_BYTES;
+  return stage;
+}
+
+static double percentile(std::vector<double> const& sorted, double const& fraction)
+{
+  if (sorted.empty())
+    return 0;
+  size_t at = static_cast<size_t>(fraction*(sorted.size() - 1) + 0.5);
+  return sorted[at];
+}
+
+// a string as a JSON string literal, the label and the input are given on the command line
+static std::string jsonString(std::string const& str)
+{
+  std::string quoted = "\"";
+  for (std::string::const_iterator c = str.begin(); c != str.end(); ++c) {
+    if (*c == '"' || *c == '\\') {
+      quoted += '\\';
+      quoted += *c;
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(*c));
+      quoted += escaped;
+    } else {
+      quoted += *c;
+    }
+  }
+  return quoted + "\"";
+}
+
+static void printStage(std::ostream& out, Stage& stage, bool const& last)
+{
+  double seconds = (stage.seconds > 0) ? stage.seconds : 1e-9;
+  out << "    \"" << stage.name << "\": {"
+      << "\"seconds\": " << stage.seconds
+      << ", \"events\": " << stage.events
+      << ", \"blocks\": " << stage.blocks
+      << ", \"bytes\": " << stage.bytes
+      << ", \"events_per_s\": " << stage.events/seconds
+      << ", \"blocks_per_s\": " << stage.blocks/seconds
+      << ", \"MB_per_s\": " << stage.bytes/seconds/1e6;
+  if (!stage.latencyNs.empty()) {
+    std::sort(stage.latencyNs.begin(), stage.latencyNs.end());
+    out << ", \"latency_us\": {"
+        << "\"p50\": "    << percentile(stage.latencyNs, 0.5)*1e-3
+        << ", \"p90\": "  << percentile(stage.latencyNs, 0.9)*1e-3
+        << ", \"p99\": "  << percentile(stage.latencyNs, 0.99)*1e-3
+        << ", \"p999\": " << percentile(stage.latencyNs, 0.999)*1e-3
+        << ", \"max\": "  << stage.latencyNs.back()*1e-3 << "}";
+  }
+  out << "}" << (last ? "" : ",") << "\n";
+}
+
+int main(int argc, char** argv)
+{
+  std::string input       = (argc > 1) ? argv[1] : "50000";
+  double      occupancy   = (argc > 2) ? std::strtod(argv[2], 0) : 0.01;
+  uint8_t     linkMask    = (argc > 3) ? std::strtoul(argv[3], 0, 0) : 0x7;
+  int         compression = (argc > 4) ? std::strtol(argv[4], 0, 0) : 1;
+  double      rate        = (argc > 5) ? std::strtod(argv[5], 0) : 0;
+  std::string jsonFile    = (argc > 6) ? argv[6] : "";
+  std::string label       = (argc > 7) ? argv[7] : "";
+
+  // a number of events to generate, or a file to replay
+  char* end;
+  uint64_t nEvents = std::strtoull(input.c_str(), &end, 0);
+  std::shared_ptr<gem::readout::GLIBReplay> glib;
+  if (*end == '\0') {
+    gem::readout::GEMDataGenerator generator(1);
+    generator.setLinkMask(linkMask);
+    generator.setOccupancy(occupancy);
+    for (uint8_t link = 0; link < MAX_LINKS; ++link)
+      chipMap[link] = generator.getChipIDs(link);
+    glib.reset(new gem::readout::GLIBReplay(generator, nEvents));
+  } else {
+    glib.reset(new gem::readout::GLIBReplay(input));
+  }
+  if (!glib->isHwConnected()) {
+    std::cout << "No events in " << input << std::endl;
+    return 1;
+  }
+  nEvents = glib->getFileEvents();
+
+  std::vector<uint32_t> words[MAX_LINKS];
+  std::vector<gem::readout::VFATData> vfats[MAX_LINKS];
+  std::vector<gem::readout::GEMData> events;
+  uint64_t nBadCRC = 0;
+  std::vector<Stage> stages;
+  stages.push_back(drainStage(*glib, words));
+  stages.push_back(decodeStage(words, nEvents, vfats));
+  stages.push_back(crcStage(vfats, nEvents, nBadCRC));
+  stages.push_back(buildStage(vfats, glib->getLinkMask(), events));
+  stages.push_back(writeStage("writeHex", *glib, "Hex", 0, events));
+  stages.push_back(writeStage("writeBin", *glib, "Bin", 0, events));
+  stages.push_back(writeStage("writeBinZ", *glib, "Bin", compression, events));
+  stages.push_back(endToEndStage(*glib, rate));
+
+  std::ofstream file;
+  if (!jsonFile.empty()) {
+    file.open(jsonFile.c_str());
+    if (!file.is_open()) {
+      std::cout << "Unable to open " << jsonFile << std::endl;
+      return 1;
+    }
+  }
+  std::ostream& out = jsonFile.empty() ? std::cout : file;
+  out << std::fixed << std::setprecision(6)
+      << "{\n"
+      << "  \"bench\": \"readoutBench\",\n"
+      << "  \"label\": " << jsonString(label) << ",\n"
+      << "  \"input\": " << jsonString((*end == '\0') ? "generator" : input) << ",\n"
+      << "  \"events\": " << nEvents << ",\n"
+      << "  \"link_mask\": " << (int)glib->getLinkMask() << ",\n"
+      << "  \"occupancy\": " << occupancy << ",\n"
+      << "  \"compression\": " << compression << ",\n"
+      << "  \"rate\": " << rate << ",\n"
+      << "  \"bad_crc\": " << nBadCRC << ",\n"
+      << "  \"stages\": {\n";
+  for (size_t stage = 0; stage < stages.size(); ++stage)
+    printStage(out, stages[stage], stage + 1 == stages.size());
+  out << "  }\n"
+      << "}" << std::endl;
+  return 0;
+}
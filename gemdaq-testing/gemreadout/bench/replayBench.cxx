@@ -0,0 +1,231 @@
+/**
+ * Readout chain benchmark without hardware
+ *
+ * Replays a recorded raw data file through GLIBReplay into the GEMDataParker, the way the
+ * supervisor reads out a GLIB, and reports the events and megabytes per second it sustained.
+ *
+ *   parker    one thread reading out the links and writing the events, GEMDataParker::dumpDataToDisk
+ *   pipeline  one thread draining the FIFOs, another one decoding and writing, as readAction and
+ *             processAction of the supervisor
+ *   links     one parker and output file per link, each on its own thread, as GEMLinkReadout
+ *
+ *   make bench
+ *   ./bench/replayBench GEM_DAQ_run.dat [mode] [rate] [burst] [fifoDepth] [loops] [outputType]
+ *
+ * rate is in events per second, 0 to have all the events ready from the start; with a FIFO
+ * depth the blocks the readout could not keep up with are lost and reported.
+ * The parker drains a FIFO until it is empty before it builds events, so in the parker and
+ * links modes a replay of several loops needs a rate or a FIFO depth, or the passes over the
+ * file are merged into the same events.
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gem/readout/GLIBReplay.h"
+#include "gem/readout/GEMDataParker.h"
+#include "gem/readout/GEMEventBuilder.h"
+
+static double nowNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec*1e9 + now.tv_nsec;
+}
+
+static const uint32_t EVENT_TIMEOUT_MS = 100;
+static const unsigned IDLE_SLEEP_US    = 100;
+
+// one drain of the tracking data FIFO of a link
+struct Drain {
+  uint8_t link;
+  uint32_t nBlocks;
+  std::vector<uint32_t> words;
+};
+
+static uint64_t runParker(gem::readout::GLIBReplay& glib, std::string const& outFile, std::string const& outputType)
+{
+  gem::readout::GEMDataParker parker(glib, outFile, outputType, glib.getLinkMask(), EVENT_TIMEOUT_MS);
+  while (!glib.isDone()) {
+    uint64_t before = glib.getBlocksRead();
+    parker.dumpDataToDisk();
+    if (glib.getBlocksRead() == before)
+      usleep(IDLE_SLEEP_US);
+  }
+  parker.flush();
+  return parker.processBlocks(0, 0, 0)[1];
+}
+
+// drains handed from the reading to the processing thread
+struct DrainQueue {
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<std::shared_ptr<Drain> > drains;
+  bool reading;
+};
+
+// readAction of the supervisor: only drain the FIFOs
+static void readLinks(gem::readout::GLIBReplay* glib, DrainQueue* queue)
+{
+  uint8_t mask = glib->getLinkMask();
+  while (!glib->isDone()) {
+    bool idle = true;
+    for (uint8_t link = 0; link < gem::readout::GLIBReplay::MAX_LINKS; ++link) {
+      if (!((mask >> link) & 0x1))
+        continue;
+      std::shared_ptr<Drain> drain(new Drain());
+      drain->link    = link;
+      drain->nBlocks = glib->drainTrackingFIFO(link, gem::readout::GEMDataParker::MAX_BLOCKS_PER_DRAIN, drain->words);
+      if (!drain->nBlocks)
+        continue;
+      idle = false;
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->drains.push_back(drain);
+      queue->ready.notify_one();
+    }
+    if (idle)
+      usleep(IDLE_SLEEP_US);
+  }
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  queue->reading = false;
+  queue->ready.notify_one();
+}
+
+static uint64_t runPipeline(gem::readout::GLIBReplay& glib, std::string const& outFile, std::string const& outputType)
+{
+  gem::readout::GEMDataParker parker(glib, outFile, outputType, glib.getLinkMask(), EVENT_TIMEOUT_MS);
+  DrainQueue queue;
+  queue.reading = true;
+  std::thread reader(readLinks, &glib, &queue);
+
+  // processAction of the supervisor: decode and write what was drained
+  std::unique_lock<std::mutex> lock(queue.mutex);
+  for (;;) {
+    while (queue.drains.empty() && queue.reading)
+      queue.ready.wait(lock);
+    if (queue.drains.empty())
+      break;
+    std::shared_ptr<Drain> drain = queue.drains.front();
+    queue.drains.pop_front();
+    lock.unlock();
+    parker.processBlocks(drain->link, &drain->words[0], drain->nBlocks);
+    lock.lock();
+  }
+  lock.unlock();
+  reader.join();
+
+  parker.flush();
+  return parker.processBlocks(0, 0, 0)[1];
+}
+
+// GEMLinkReadout: a parker of its own for one link
+static void readLink(gem::readout::GLIBReplay* glib, uint8_t link, std::string outFile, std::string outputType,
+                     uint64_t* nEvents)
+{
+  gem::readout::GEMDataParker parker(*glib, outFile, outputType, (1 << link), EVENT_TIMEOUT_MS);
+  uint64_t linkBlocks = 0;
+  while (!glib->isDone()) {
+    parker.dumpDataToDisk();
+    if (glib->getBlocksRead(link) == linkBlocks)
+      usleep(IDLE_SLEEP_US);
+    linkBlocks = glib->getBlocksRead(link);
+  }
+  parker.flush();
+  *nEvents = parker.processBlocks(link, 0, 0)[1];
+}
+
+static uint64_t runLinks(gem::readout::GLIBReplay& glib, std::string const& outFile, std::string const& outputType)
+{
+  std::vector<std::thread> threads;
+  std::vector<uint64_t> events(gem::readout::GLIBReplay::MAX_LINKS, 0);
+  uint8_t mask = glib.getLinkMask();
+  for (uint8_t link = 0; link < gem::readout::GLIBReplay::MAX_LINKS; ++link) {
+    if (!((mask >> link) & 0x1))
+      continue;
+    std::stringstream linkFile;
+    linkFile << outFile.substr(0, outFile.rfind(".dat")) << "_link" << (int)link << ".dat";
+    std::remove(linkFile.str().c_str());
+    threads.push_back(std::thread(readLink, &glib, link, linkFile.str(), outputType, &events[link]));
+  }
+  for (std::vector<std::thread>::iterator thread = threads.begin(); thread != threads.end(); ++thread)
+    thread->join();
+
+  // every link sees every event
+  uint64_t nEvents = 0;
+  for (size_t link = 0; link < events.size(); ++link)
+    nEvents = (events[link] > nEvents) ? events[link] : nEvents;
+  return nEvents;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    std::cout << "Usage: replayBench file.dat [parker|pipeline|links] [rate] [burst] [fifoDepth] [loops] [Hex|Bin]"
+              << std::endl;
+    return 1;
+  }
+  std::string fileName   = argv[1];
+  std::string mode       = (argc > 2) ? argv[2] : "parker";
+  double      rate       = (argc > 3) ? std::strtod(argv[3], 0) : 0;
+  uint32_t    burst      = (argc > 4) ? std::strtoul(argv[4], 0, 0) : 1;
+  uint32_t    fifoDepth  = (argc > 5) ? std::strtoul(argv[5], 0, 0) : 0;
+  uint32_t    loops      = (argc > 6) ? std::strtoul(argv[6], 0, 0) : 1;
+  std::string outputType = (argc > 7) ? argv[7] : "Bin";
+  // the parker drains a FIFO until it is empty, an endless replay must be paced
+  if (!loops) {
+    std::cout << "loops must be at least 1" << std::endl;
+    return 1;
+  }
+
+  gem::readout::GLIBReplay glib(fileName);
+  if (!glib.isHwConnected()) {
+    std::cout << "No events to replay in " << fileName << std::endl;
+    return 1;
+  }
+  glib.setRate(rate);
+  glib.setBurst(burst);
+  glib.setFIFODepth(fifoDepth);
+  glib.setLoops(loops);
+
+  std::string outFile = "replayBench_" + mode + ".dat";
+  std::remove(outFile.c_str());
+
+  glib.start();
+  double start = nowNs();
+  uint64_t nEvents = 0;
+  if (mode == "parker")
+    nEvents = runParker(glib, outFile, outputType);
+  else if (mode == "pipeline")
+    nEvents = runPipeline(glib, outFile, outputType);
+  else if (mode == "links")
+    nEvents = runLinks(glib, outFile, outputType);
+  else {
+    std::cout << "Unknown mode " << mode << std::endl;
+    return 1;
+  }
+  double seconds = (nowNs() - start)*1e-9;
+
+  // tracking data words as read from the GLIB, the trigger data word included
+  double mb = glib.getBlocksRead()*gem::hw::glib::HwGLIB::TRACKING_BLOCK_WORDS*sizeof(uint32_t)/1e6;
+  std::cout << std::fixed << std::setprecision(2)
+            << "file " << fileName << ", " << glib.getFileEvents() << " events x " << loops << " loops\n"
+            << "mode " << mode << ", output " << outputType << ", rate " << rate << " events/s, burst " << burst
+            << ", FIFO depth " << fifoDepth << "\n"
+            << "events written " << nEvents << ", VFAT blocks read " << glib.getBlocksRead()
+            << ", lost " << glib.getBlocksLost() << "\n"
+            << seconds << " s, " << nEvents/seconds << " events/s, " << mb/seconds << " MB/s read out" << std::endl;
+  return 0;
+}
@@ -1,31 +1,158 @@
 #ifndef gem_datachecker_GEMDataChecker_h
 #define gem_datachecker_GEMDataChecker_h
 
-//#include "gem/utils/GEMLogging.h"
+#include <ostream>
+#include <stdint.h>
+
+#include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMDataCRC.h"
 
 namespace gem {
-  namespace readout {
-    struct VFATData;
-    struct GEBData;
-    struct GEMData;
-  }
   namespace datachecker {
-    class GEMDataChecker {
+
+    /** Streaming validation of the VFAT blocks, called on every block right after decoding
+     * Checks the 1010/1100/1110 control nibbles, the CRC, the EC continuity of each chip,
+     * that all the chips of a link agree on the BC of an event, and that the ChipID is one
+     * of the chips configured on the GEB. The EC of chips not in the map is not followed.
+     * The errors are counted per link, per VFAT slot and per check in fixed size arrays,
+     * nothing is allocated or logged while checking.
+     */
+    class GEMDataChecker
+    {
     public:
+      static const unsigned MAX_LINKS = 3;
+      /** VFAT slots on a GEB, the counters of slot MAX_CHIPS collect the chips not in the map */
+      static const unsigned MAX_CHIPS = 24;
+      static const uint8_t  NO_SLOT   = 0xff;
+
+      /** checks, checkBlock() returns a bit (1 << check) for each one that failed
+       */
+      enum Check {
+        CONTROL_1010 = 0,
+        CONTROL_1100,
+        CONTROL_1110,
+        CRC,
+        EC_JUMP,
+        BC_MISMATCH,
+        UNKNOWN_CHIP,
+        N_CHECKS
+      };
 
-      GEMDataChecker(gem::readout::GEMData& gem, gem::readout::GEBData& geb, 
-                     gem::readout::VFATData& vfat);
+      static const uint32_t CONTROL_BITS_ERRORS = (1 << CONTROL_1010) | (1 << CONTROL_1100) | (1 << CONTROL_1110);
+
+      GEMDataChecker();
       ~GEMDataChecker() {};
 
-      int  counterGEMdata  (gem::readout::GEMData& gem, gem::readout::GEBData& geb, 
-                            gem::readout::VFATData& vfat);
+      /** place a chip on the GEB of a link
+       * @param link GLIB link of the GEB
+       * @param slot VFAT position on the GEB, 0 to MAX_CHIPS-1
+       * @param chipID 12 bit ChipID of the VFAT in this position
+       */
+      void setChipSlot(uint8_t const& link, uint8_t const& slot, uint16_t const& chipID);
+
+      /** position of a chip on the GEB of a link
+       * @retval returns NO_SLOT if the chip is not in the map
+       */
+      uint8_t getChipSlot(uint8_t const& link, uint16_t const& chipID) const {
+        return slot_[link][gem::readout::VFAT::ChipID::get(chipID)];
+      };
+
+      /** check one decoded block
+       * @param link GLIB link the block was read from, blocks of any other link are not checked
+       * @param vfat decoded block
+       * @retval returns 0 if the block passed every check, otherwise a bit per failed Check
+       */
+      uint32_t checkBlock(uint8_t const& link, gem::readout::VFATData const& vfat);
+
+      /** do not compute the CRC of the blocks, e.g. if it is checked elsewhere */
+      void setCheckCRC(bool const& checkCRC) { checkCRC_ = checkCRC; };
+
+      /** reset the counters and forget the last EC/BC of every chip, the chip map is kept */
+      void reset();
+
+      uint64_t getBlocks()    const { return nBlocks_;    };
+      uint64_t getBadBlocks() const { return nBadBlocks_; };
+      uint64_t getBlocks(uint8_t const& link, uint8_t const& slot) const { return blocks_[link][slot]; };
+      uint64_t getErrors(uint8_t const& link, uint8_t const& slot, Check const& check) const {
+        return errors_[link][slot][check];
+      };
+      /** errors of one check summed over all the links and chips */
+      uint64_t getErrors(Check const& check) const;
+
+      /** write the counters of every chip with errors */
+      void report(std::ostream& out) const;
+
+      static char const* checkName(Check const& check);
 
     private:
+      bool checkCRC_;
+
+      // ChipID -> slot, one table per link
+      uint8_t slot_[MAX_LINKS][4096];
+      bool    hasMap_[MAX_LINKS];
 
-      // log4cplus::Logger gemLogger_;
-      int event_counter_;
+      // per chip state, slot MAX_CHIPS is used for the unknown chips
+      uint8_t  lastEC_[MAX_LINKS][MAX_CHIPS+1];
+      bool     seen_  [MAX_LINKS][MAX_CHIPS+1];
 
+      // BC of the EC being read out on each link
+      uint8_t  eventEC_[MAX_LINKS];
+      uint16_t eventBC_[MAX_LINKS];
+      bool     eventSeen_[MAX_LINKS];
+
+      uint64_t blocks_[MAX_LINKS][MAX_CHIPS+1];
+      uint64_t errors_[MAX_LINKS][MAX_CHIPS+1][N_CHECKS];
+      uint64_t nBlocks_;
+      uint64_t nBadBlocks_;
     };
   }
 }
+
+inline uint32_t gem::datachecker::GEMDataChecker::checkBlock(uint8_t const& link, gem::readout::VFATData const& vfat)
+{
+  // the event builder drops the blocks of an invalid link
+  if (link >= MAX_LINKS)
+    return 0;
+
+  uint32_t errors = 0;
+  errors |= (gem::readout::VFAT::B1010::get(vfat.BC)     != gem::readout::VFAT::CONTROL_1010) << CONTROL_1010;
+  errors |= (gem::readout::VFAT::B1100::get(vfat.EC)     != gem::readout::VFAT::CONTROL_1100) << CONTROL_1100;
+  errors |= (gem::readout::VFAT::B1110::get(vfat.ChipID) != gem::readout::VFAT::CONTROL_1110) << CONTROL_1110;
+  if (checkCRC_)
+    errors |= (!gem::readout::checkVFATCRC(vfat)) << CRC;
+
+  uint8_t  ec = gem::readout::VFAT::EC::get(vfat.EC);
+  uint16_t bc = gem::readout::VFAT::BC::get(vfat.BC);
+
+  uint8_t slot = slot_[link][gem::readout::VFAT::ChipID::get(vfat.ChipID)];
+  if (slot == NO_SLOT) {
+    // without a map for the link there is nothing to compare the ChipID to
+    errors |= hasMap_[link] << UNKNOWN_CHIP;
+    slot = MAX_CHIPS;
+  } else {
+    // every trigger increments the EC of each chip by one
+    errors |= (seen_[link][slot] && ec != static_cast<uint8_t>(lastEC_[link][slot] + 1)) << EC_JUMP;
+    lastEC_[link][slot] = ec;
+    seen_[link][slot]   = true;
+  }
+
+  // the BC of consecutive triggers is arbitrary, but the chips of one event must agree on it
+  if (eventSeen_[link] && ec == eventEC_[link]) {
+    errors |= (bc != eventBC_[link]) << BC_MISMATCH;
+  } else {
+    eventEC_[link]   = ec;
+    eventBC_[link]   = bc;
+    eventSeen_[link] = true;
+  }
+
+  ++nBlocks_;
+  ++blocks_[link][slot];
+  if (errors) {
+    ++nBadBlocks_;
+    for (unsigned check = 0; check < N_CHECKS; ++check)
+      errors_[link][slot][check] += (errors >> check) & 0x1;
+  }
+  return errors;
+}
+
 #endif
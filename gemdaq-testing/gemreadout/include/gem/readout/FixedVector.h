@@ -0,0 +1,73 @@
+#ifndef gem_readout_FixedVector_h
+#define gem_readout_FixedVector_h
+
+#include <stddef.h>
+
+namespace gem {
+  namespace readout {
+
+    /** Vector of at most N elements stored inline, it never allocates
+     * The part of the std::vector interface the readout uses. The capacity is fixed: resize()
+     * stops at N and push_back() drops an element that does not fit and returns false, callers
+     * which can receive more than N elements check full() first.
+     * Only the elements in use are copied.
+     */
+    template <typename T, size_t N>
+      class FixedVector
+      {
+      public:
+        typedef T        value_type;
+        typedef size_t   size_type;
+        typedef T*       iterator;
+        typedef T const* const_iterator;
+
+        FixedVector() : size_(0) {};
+
+        FixedVector(FixedVector const& other) : size_(other.size_) {
+          for (size_t i = 0; i < size_; ++i)
+            data_[i] = other.data_[i];
+        };
+
+        FixedVector& operator=(FixedVector const& other) {
+          size_ = other.size_;
+          for (size_t i = 0; i < size_; ++i)
+            data_[i] = other.data_[i];
+          return *this;
+        };
+
+        static size_t capacity() { return N; };
+        size_t size()  const { return size_; };
+        bool   empty() const { return size_ == 0; };
+        bool   full()  const { return size_ == N; };
+
+        void clear() { size_ = 0; };
+
+        /** elements added are left as they were, at most N */
+        void resize(size_t const n) { size_ = (n < N) ? n : N; };
+
+        bool push_back(T const& value) {
+          if (size_ == N)
+            return false;
+          data_[size_++] = value;
+          return true;
+        };
+
+        iterator       begin()       { return data_; };
+        iterator       end()         { return data_ + size_; };
+        const_iterator begin() const { return data_; };
+        const_iterator end()   const { return data_ + size_; };
+
+        T&       operator[](size_t const i)       { return data_[i]; };
+        T const& operator[](size_t const i) const { return data_[i]; };
+        T&       front()       { return data_[0]; };
+        T const& front() const { return data_[0]; };
+        T&       back()        { return data_[size_ - 1]; };
+        T const& back()  const { return data_[size_ - 1]; };
+
+      private:
+        T      data_[N];
+        size_t size_;
+      };
+  }
+}
+#endif
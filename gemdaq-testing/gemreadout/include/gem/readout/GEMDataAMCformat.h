@@ -7,6 +7,10 @@
 #include <string>
 #include <vector>
 
+#include "gem/readout/GEMDataCodec.h"
+#include "gem/readout/GEMDataHexCodec.h"
+#include "gem/readout/FixedVector.h"
+
 namespace gem {
   namespace readout {
 
@@ -20,9 +24,14 @@ namespace gem {
       uint16_t crc;         // :16       CRC
     };    
     
+    /** VFAT blocks a chamber can hold, one per bit of GEB::ZSFlag */
+    static const size_t GEB_MAX_VFATS = 24;
+
     struct GEBData {
-      uint64_t header;      // ZSFlag:24 ChamID:12 
-      std::vector<VFATData> vfats;
+      typedef FixedVector<VFATData, GEB_MAX_VFATS> VFATs;
+
+      uint64_t header;      // ZSFlag:24 ChamID:12 ZSMode:1 sumVFAT:27
+      VFATs    vfats;       // inline, copying or reusing a GEBData never allocates
       uint64_t trailer;     // OHcrc: 16 OHwCount:16  ChamStatus:16
     };
 
@@ -35,6 +44,76 @@ namespace gem {
       uint64_t trailer1;     // crc:32       LV1IDT:8   0000:4     DataLgth:20 
     };
 
+    /*
+     *  VFAT block from/to the GLIB tracking data words, field layout in GEMDataCodec.h
+     */
+    inline void decodeTrackingBlock(uint32_t const* data, VFATData& vfat) {
+      vfat.BC     = TRK::BCword::get(data[5]);     // 1010:4 | BC:12
+      vfat.EC     = TRK::ECword::get(data[5]);     // 1100:4 | EC:8 | Flag:4
+      vfat.ChipID = TRK::ChipIDword::get(data[4]); // 1110:4 | ChipID:12
+      vfat.msData = TRK::msData(data);             // msData:64
+      vfat.lsData = TRK::lsData(data);             // lsData:64
+      vfat.BXfrOH = TRK::BXfrOH::get(data[6]);     // BXfrOH:16
+      vfat.crc    = TRK::CRC::get(data[0]);        // crc:16
+    };
+
+    inline void encodeTrackingBlock(VFATData const& vfat, uint32_t* data) {
+      data[6] = TRK::BXfrOH::pack(vfat.BXfrOH);
+      data[5] = TRK::BCword::pack(vfat.BC) | TRK::ECword::pack(vfat.EC);
+      data[4] = TRK::ChipIDword::pack(vfat.ChipID);
+      data[3] = 0;
+      data[2] = 0;
+      data[1] = 0;
+      data[0] = TRK::CRC::pack(vfat.crc);
+      TRK::packMSData(vfat.msData, data);
+      TRK::packLSData(vfat.lsData, data);
+    };
+
+    /*
+     *  Zero suppressed VFAT payload
+     *
+     *  In a chamber with GEB::ZSMode set every VFAT block carries, after ChipID, the number of
+     *  channels that fired followed by their indices (0-63 in lsData, 64-127 in msData), or
+     *  ZS_FULL_PAYLOAD followed by lsData and msData when that is shorter.
+     *  Bit 23-slot of GEB::ZSFlag is set if the payload of the chip in that slot of the GEB was
+     *  suppressed; without GEB::ZSMode the bits mark the slots whose chip sent a block. Chips
+     *  without a known slot have no bit.
+     */
+    static const uint8_t  ZS_FULL_PAYLOAD     = 0xff;
+    static const unsigned ZS_MAX_SPARSE_HITS  = 10;
+
+    /** number of channels that fired, or ZS_FULL_PAYLOAD if the block is better written in full */
+    inline uint8_t zsChannelCount(VFATData const& vfat) {
+      unsigned nHits = __builtin_popcountll(vfat.lsData) + __builtin_popcountll(vfat.msData);
+      return (nHits > ZS_MAX_SPARSE_HITS) ? ZS_FULL_PAYLOAD : nHits;
+    };
+
+    /** list the channels that fired, lowest first
+     * @param channels at least ZS_MAX_SPARSE_HITS entries
+     * @retval returns the number of channels
+     */
+    inline uint8_t zsEncodeChannels(VFATData const& vfat, uint8_t* channels) {
+      uint8_t nHits = 0;
+      for (uint64_t bits = vfat.lsData; bits && nHits < ZS_MAX_SPARSE_HITS; bits &= bits - 1)
+        channels[nHits++] = __builtin_ctzll(bits);
+      for (uint64_t bits = vfat.msData; bits && nHits < ZS_MAX_SPARSE_HITS; bits &= bits - 1)
+        channels[nHits++] = 64 + __builtin_ctzll(bits);
+      return nHits;
+    };
+
+    /** rebuild lsData and msData from a list of channels */
+    inline void zsDecodeChannels(uint8_t const* channels, uint8_t const nHits, VFATData& vfat) {
+      vfat.lsData = 0;
+      vfat.msData = 0;
+      for (uint8_t i = 0; i < nHits; ++i) {
+        uint8_t channel = channels[i] & 0x7f;
+        if (channel < 64)
+          vfat.lsData |= (static_cast<uint64_t>(1) << channel);
+        else
+          vfat.msData |= (static_cast<uint64_t>(1) << (channel - 64));
+      }
+    };
+
     /*
      *  GEB Data Format
      *    geb.header
@@ -43,29 +122,30 @@ namespace gem {
      *
      */
 
-    bool writeGEBheader(std::string file, int event, const GEBData& geb) {
+    inline bool writeGEBheader(std::string file, int event, const GEBData& geb) {
       std::ofstream outf(file.c_str(), std::ios_base::app );
       if ( event<0) return(false);
       if (!outf.is_open()) return(false);
-      outf << std::hex << geb.header << std::dec << std::endl;
+      char line[HEX::MAX_LINE];
+      outf.write(line, HEX::putLine(line, geb.header) - line);
       outf.close();
       return(true);
     };	  
 
-    bool readGEBheader(std::ifstream& inpf, GEBData& geb) {
-      inpf >> std::hex >> geb.header;
+    inline bool readGEBheader(std::istream& inpf, GEBData& geb) {
+      HEX::read(inpf, geb.header);
       return(true);
     };	  
 
-    bool printGEBheader(int event, const GEBData& geb) {
+    inline bool printGEBheader(int event, const GEBData& geb) {
       if ( event<0) return(false);
       std::cout << "Received tracking data word: event " << event << std::endl;
-      std::cout << " 0x" << std::setw(8) << std::hex << geb.header << " ChamID " << ((0x000000fff0000000 & geb.header) >> 28) 
-                << std::dec << " sumVFAT " << (0x000000000fffffff & geb.header) << std::endl;
+      std::cout << " 0x" << std::setw(8) << std::hex << geb.header << " ChamID " << GEB::ChamID::get(geb.header)
+                << std::dec << " sumVFAT " << GEB::SumVFAT::get(geb.header) << std::endl;
       return(true);
     };	  
 
-    bool writeZEROline(std::string file) {
+    inline bool writeZEROline(std::string file) {
       std::ofstream outf(file.c_str(), std::ios_base::app );
       if (!outf.is_open()) return(false);
       outf << "\n" << std::endl;
@@ -73,47 +153,51 @@ namespace gem {
       return(true);
     };	  
 
-    bool writeGEBtrailer(std::string file, int event, const GEBData& geb) {
+    inline bool writeGEBtrailer(std::string file, int event, const GEBData& geb) {
       std::ofstream outf(file.c_str(), std::ios_base::app );
       if ( event<0) return(false);
       if (!outf.is_open()) return(false);
-      outf << std::hex << geb.trailer << std::dec << std::endl;
+      char line[HEX::MAX_LINE];
+      outf.write(line, HEX::putLine(line, geb.trailer) - line);
       outf.close();
       return(true);
     };	  
 
-    bool readGEBtrailer(std::ifstream& inpf, GEBData& geb) {
-      inpf >> std::hex >> geb.trailer;
+    inline bool readGEBtrailer(std::istream& inpf, GEBData& geb) {
+      HEX::read(inpf, geb.trailer);
       return(true);
     };	  
 
-    bool printGEBtrailer(int event, const GEBData& geb) {
+    inline bool printGEBtrailer(int event, const GEBData& geb) {
       if ( event<0) return(false);
-      uint64_t OHcrc      = (0xffff000000000000 & geb.trailer) >> 48; 
-      uint64_t OHwCount   = (0x0000ffff00000000 & geb.trailer) >> 32; 
-      uint64_t ChamStatus = (0x00000000ffff0000 & geb.trailer) >> 16;
+      uint64_t OHcrc      = GEB::OHcrc::get(geb.trailer);
+      uint64_t OHwCount   = GEB::OHwCount::get(geb.trailer);
+      uint64_t ChamStatus = GEB::ChamStatus::get(geb.trailer);
       std::cout << "GEM Camber Treiler: OHcrc " << std::hex << OHcrc << " OHwCount " << OHwCount << " ChamStatus " << ChamStatus << std::dec 
                 << std::endl;
       return(true);
     };	  
 
-    bool writeVFATdata(std::string file, int event, const VFATData& vfat) {
+    inline bool writeVFATdata(std::string file, int event, const VFATData& vfat) {
       std::ofstream outf(file.c_str(), std::ios_base::app );
       if ( event<0) return(false);
       if (!outf.is_open()) return(false);
-      outf << std::hex << vfat.BC << std::dec << std::endl;
-      outf << std::hex << vfat.EC << std::dec << std::endl;
-      outf << std::hex << vfat.ChipID << std::dec << std::endl;
-      outf << std::hex << vfat.lsData << std::dec << std::endl;
-      outf << std::hex << vfat.msData << std::dec << std::endl;
-      outf << std::hex << vfat.BXfrOH << std::dec << std::endl;
-      outf << std::hex << vfat.crc << std::dec << std::endl;
+      char lines[7*HEX::MAX_LINE];
+      char* end = lines;
+      end = HEX::putLine(end, vfat.BC);
+      end = HEX::putLine(end, vfat.EC);
+      end = HEX::putLine(end, vfat.ChipID);
+      end = HEX::putLine(end, vfat.lsData);
+      end = HEX::putLine(end, vfat.msData);
+      end = HEX::putLine(end, vfat.BXfrOH);
+      end = HEX::putLine(end, vfat.crc);
+      outf.write(lines, end - lines);
       //writeZEROline(file);
       outf.close();
       return(true);
     };	  
 
-    bool printVFATdata(int event, const VFATData& vfat) {
+    inline bool printVFATdata(int event, const VFATData& vfat) {
       if ( event<0) return(false);
       std::cout << "Received tracking data word:" << std::endl;
       std::cout << "BC      :: 0x" << std::setfill('0') << std::setw(4) << std::hex << vfat.BC     << std::dec << std::endl;
@@ -126,19 +210,48 @@ namespace gem {
       return(true);
     };
 
-    bool readVFATdata(std::ifstream& inpf, int event, VFATData& vfat) {
+    inline bool readVFATdata(std::istream& inpf, int event, VFATData& vfat) {
       if (event<0) return(false);
-      inpf >> std::hex >> vfat.BC;
-      inpf >> std::hex >> vfat.EC;
-      inpf >> std::hex >> vfat.ChipID;
-      inpf >> std::hex >> vfat.lsData;
-      inpf >> std::hex >> vfat.msData;
-      inpf >> std::hex >> vfat.BXfrOH;
-      inpf >> std::hex >> vfat.crc;
+      HEX::read(inpf, vfat.BC);
+      HEX::read(inpf, vfat.EC);
+      HEX::read(inpf, vfat.ChipID);
+      HEX::read(inpf, vfat.lsData);
+      HEX::read(inpf, vfat.msData);
+      HEX::read(inpf, vfat.BXfrOH);
+      HEX::read(inpf, vfat.crc);
       return(true);
     };	  
 
-    bool writeGEBheaderBinary(std::string file, int event, const GEBData& geb) {
+    /** read a VFAT block of the chamber whose header is in geb, zero suppressed or not
+     */
+    inline bool readVFATdata(std::istream& inpf, GEBData const& geb, int event, VFATData& vfat) {
+      if (!GEB::ZSMode::get(geb.header))
+        return readVFATdata(inpf, event, vfat);
+      if (event<0) return(false);
+      uint16_t nHits;
+      HEX::read(inpf, vfat.BC);
+      HEX::read(inpf, vfat.EC);
+      HEX::read(inpf, vfat.ChipID);
+      HEX::read(inpf, nHits);
+      if (nHits == ZS_FULL_PAYLOAD) {
+        HEX::read(inpf, vfat.lsData);
+        HEX::read(inpf, vfat.msData);
+      } else {
+        uint8_t channels[ZS_MAX_SPARSE_HITS];
+        if (nHits > ZS_MAX_SPARSE_HITS) return(false);
+        for (uint16_t i = 0; i < nHits; ++i) {
+          uint16_t channel;
+          HEX::read(inpf, channel);
+          channels[i] = channel;
+        }
+        zsDecodeChannels(channels, nHits, vfat);
+      }
+      HEX::read(inpf, vfat.BXfrOH);
+      HEX::read(inpf, vfat.crc);
+      return(true);
+    };
+
+    inline bool writeGEBheaderBinary(std::string file, int event, const GEBData& geb) {
       std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
       if ( event<0) return(false);
       if (!outf.is_open()) return(false);
@@ -147,7 +260,7 @@ namespace gem {
       return(true);
     };
 	  
-    bool writeGEBtrailerBinary(std::string file, int event, const GEBData& geb) {
+    inline bool writeGEBtrailerBinary(std::string file, int event, const GEBData& geb) {
       std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
       if ( event<0) return(false);
       if (!outf.is_open()) return(false);
@@ -156,7 +269,7 @@ namespace gem {
       return(true);
     };
 
-    bool writeVFATdataBinary(std::string file, int event, const VFATData& vfat) {
+    inline bool writeVFATdataBinary(std::string file, int event, const VFATData& vfat) {
       std::ofstream outf(file.c_str(), std::ios_base::app | std::ios::binary );
       if ( event<0) return(false);
       if (!outf.is_open()) return(false);
@@ -165,31 +278,29 @@ namespace gem {
       outf.write( (char*)&vfat.ChipID, sizeof(vfat.ChipID));
       outf.write( (char*)&vfat.lsData, sizeof(vfat.lsData));  
       outf.write( (char*)&vfat.msData, sizeof(vfat.msData));
-      outf.write( (char*)&vfat.BXfrOH, sizeof(vfat.msData));
+      outf.write( (char*)&vfat.BXfrOH, sizeof(vfat.BXfrOH));
       outf.write( (char*)&vfat.crc, sizeof(vfat.crc));
       outf.close();
       return(true);
     };	  
 
-    bool readVFATDataBinary(std::string file, int event, const VFATData& vfat) {
-      std::ifstream inpf(file.c_str(), std::ios_base::app | std::ios::binary );
+    /** read back a block written by writeVFATdataBinary, for run files see GEMRunFile.h */
+    inline bool readVFATDataBinary(std::istream& inpf, int event, VFATData& vfat) {
       if ( event<0) return(false);
-      if (!inpf.is_open()) return(false);
       inpf.read( (char*)&vfat.BC, sizeof(vfat.BC));
       inpf.read( (char*)&vfat.EC, sizeof(vfat.EC));
       inpf.read( (char*)&vfat.ChipID, sizeof(vfat.ChipID));
       inpf.read( (char*)&vfat.lsData, sizeof(vfat.lsData));
       inpf.read( (char*)&vfat.msData, sizeof(vfat.msData));
-      inpf.read( (char*)&vfat.BXfrOH, sizeof(vfat.msData));
+      inpf.read( (char*)&vfat.BXfrOH, sizeof(vfat.BXfrOH));
       inpf.read( (char*)&vfat.crc, sizeof(vfat.crc));
-      inpf.seekg (0, inpf.cur);
-      return(true);
+      return(inpf.good());
     };	  
 
     //
     // Useful printouts 
     //
-    void show4bits(uint8_t x) {
+    inline void show4bits(uint8_t x) {
       int i;
       const unsigned long unit = 1;
       for(i=(sizeof(uint8_t)*4)-1; i>=0; i--)
@@ -197,7 +308,7 @@ namespace gem {
       //printf("\n");
     }
 
-    void show16bits(uint16_t x) {
+    inline void show16bits(uint16_t x) {
       int i;
       const unsigned long unit = 1;
       for(i=(sizeof(uint16_t)*8)-1; i>=0; i--)
@@ -205,7 +316,7 @@ namespace gem {
       printf("\n");
     }
 
-    void show24bits(uint32_t x) {
+    inline void show24bits(uint32_t x) {
       int i;
       const unsigned long unit = 1;
       for(i=(sizeof(uint32_t)*8)-8-1; i>=0; i--)
@@ -213,7 +324,7 @@ namespace gem {
       printf("\n");
     }
 
-    void show32bits(uint32_t x) {
+    inline void show32bits(uint32_t x) {
       int i;
       const unsigned long unit = 1;
       for(i=(sizeof(uint32_t)*8)-1; i>=0; i--)
@@ -221,7 +332,7 @@ namespace gem {
       printf("\n");
     }
 
-    void show64bits(uint64_t x) {
+    inline void show64bits(uint64_t x) {
       int i;
       const unsigned long unit = 1;
       for(i=(sizeof(uint64_t)*8)-1; i>=0; i--)
@@ -229,22 +340,22 @@ namespace gem {
       printf("\n");
     }
 
-    bool printVFATdataBits(int event, const VFATData& vfat) {
+    inline bool printVFATdataBits(int event, const VFATData& vfat) {
       if ( event<0) return(false);
       std::cout << "\nReceived VFAT data word: ichip " << event << std::endl;
 
-      uint8_t   b1010 = (0xf000 & vfat.BC) >> 12;
-      show4bits(b1010); std::cout << " BC     0x" << std::hex << (0x0fff & vfat.BC) 
+      uint8_t   b1010 = VFAT::B1010::get(vfat.BC);
+      show4bits(b1010); std::cout << " BC     0x" << std::hex << VFAT::BC::get(vfat.BC)
                                   << std::setfill('0') << std::setw(4) << "      BX 0x" << vfat.BXfrOH << std::dec << std::endl;
 
-      uint8_t   b1100 = (0xf000 & vfat.EC) >> 12;
-      uint16_t   EC   = (0x0ff0 & vfat.EC) >> 4;
-      uint8_t   Flag  = (0x000f & vfat.EC);
+      uint8_t   b1100 = VFAT::B1100::get(vfat.EC);
+      uint16_t   EC   = VFAT::EC::get(vfat.EC);
+      uint8_t   Flag  = VFAT::Flag::get(vfat.EC);
       show4bits(b1100); std::cout << " EC     0x" << std::hex << EC << std::dec << std::endl; 
       show4bits(Flag);  std::cout << " Flags " << std::endl;
 
-      uint8_t   b1110 = (0xf000 & vfat.ChipID) >> 12;
-      uint16_t ChipID = (0x0fff & vfat.ChipID);
+      uint8_t   b1110 = VFAT::B1110::get(vfat.ChipID);
+      uint16_t ChipID = VFAT::ChipID::get(vfat.ChipID);
       show4bits(b1110); std::cout << " ChipID 0x" << std::hex << ChipID << std::dec << " " << std::endl;
 
       /* std::cout << "     bxExp  0x" << std::hex << vfat.bxExp << std::dec << " " << std::endl;
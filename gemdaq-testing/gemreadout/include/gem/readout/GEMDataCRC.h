@@ -0,0 +1,183 @@
+#ifndef gem_readout_GEMDataCRC_h
+#define gem_readout_GEMDataCRC_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gem/readout/GEMDataAMCformat.h"
+
+namespace gem {
+  namespace readout {
+
+    /*
+     *  VFAT2 block CRC
+     *
+     *  CRC-16 with the reflected CCITT polynomial 0x8408, initial value 0xffff and no final xor,
+     *  over the eleven 16 bit words BC, EC, ChipID, msData<63:0>, lsData<63:0> of the block
+     *  (most significant word of msData/lsData first), each word fed least significant bit first.
+     *  Feeding a word LSB first is the same as feeding its low byte then its high byte to a
+     *  reflected byte-wise CRC, which is what the table driven versions do.
+     */
+    namespace CRC16 {
+      static const uint16_t POLY       = 0x8408;
+      static const uint16_t INIT       = 0xffff;
+      static const unsigned VFAT_WORDS = 11;
+      static const unsigned SLICES     = 8;
+
+      /** reference implementation, one bit at a time as the VFAT2 does it
+       * @param crc CRC of the words before
+       * @param word next 16 bit word
+       */
+      inline uint16_t updateBitwise(uint16_t crc, uint16_t const word) {
+        for (unsigned bit = 0; bit < 16; ++bit) {
+          bool d = (word >> bit) & 0x1;
+          crc = ((crc & 0x1) ^ d) ? ((crc >> 1) ^ POLY) : (crc >> 1);
+        }
+        return crc;
+      };
+
+      /** lookup tables, table[0] is the plain byte table and table[k] advances a byte by k more bytes
+       */
+      struct Tables
+      {
+        uint16_t table[SLICES][256];
+
+        Tables() {
+          for (unsigned byte = 0; byte < 256; ++byte) {
+            uint16_t crc = byte;
+            for (unsigned bit = 0; bit < 8; ++bit)
+              crc = (crc & 0x1) ? ((crc >> 1) ^ POLY) : (crc >> 1);
+            table[0][byte] = crc;
+          }
+          for (unsigned slice = 1; slice < SLICES; ++slice)
+            for (unsigned byte = 0; byte < 256; ++byte)
+              table[slice][byte] = (table[slice-1][byte] >> 8) ^ table[0][table[slice-1][byte] & 0xff];
+        };
+      };
+
+      /** the tables are built once, on first use */
+      inline Tables const& tables() {
+        static const Tables crcTables;
+        return crcTables;
+      };
+
+      /** byte table implementation, two lookups per word */
+      inline uint16_t updateTable(uint16_t crc, uint16_t const word, Tables const& t = tables()) {
+        crc = (crc >> 8) ^ t.table[0][(crc ^ word) & 0xff];
+        crc = (crc >> 8) ^ t.table[0][(crc ^ (word >> 8)) & 0xff];
+        return crc;
+      };
+
+      /** slicing-by-8 implementation, four words with eight independent lookups
+       * @param words four consecutive words, the first one in the least significant bits
+       */
+      inline uint16_t updateSlice(uint16_t const crc, uint64_t words, Tables const& t = tables()) {
+        words ^= crc;
+        return
+          t.table[7][ words        & 0xff] ^ t.table[6][(words >>  8) & 0xff] ^
+          t.table[5][(words >> 16) & 0xff] ^ t.table[4][(words >> 24) & 0xff] ^
+          t.table[3][(words >> 32) & 0xff] ^ t.table[2][(words >> 40) & 0xff] ^
+          t.table[1][(words >> 48) & 0xff] ^ t.table[0][ words >> 56        ];
+      };
+
+      inline uint16_t computeBitwise(uint16_t const* words, size_t const nWords, uint16_t crc = INIT) {
+        for (size_t i = 0; i < nWords; ++i)
+          crc = updateBitwise(crc, words[i]);
+        return crc;
+      };
+
+      inline uint16_t computeTable(uint16_t const* words, size_t const nWords, uint16_t crc = INIT) {
+        Tables const& t = tables();
+        for (size_t i = 0; i < nWords; ++i)
+          crc = updateTable(crc, words[i], t);
+        return crc;
+      };
+
+      /** CRC of a sequence of 16 bit words, slicing-by-8 with a byte table tail
+       * @param words the words in the order they are fed to the CRC
+       * @param nWords number of words
+       * @param crc CRC of the words before, INIT to start a new CRC
+       */
+      inline uint16_t compute(uint16_t const* words, size_t const nWords, uint16_t crc = INIT) {
+        Tables const& t = tables();
+        size_t i = 0;
+        for (; i + 4 <= nWords; i += 4)
+          crc = updateSlice(crc,
+                            static_cast<uint64_t>(words[i])          |
+                            (static_cast<uint64_t>(words[i+1]) << 16) |
+                            (static_cast<uint64_t>(words[i+2]) << 32) |
+                            (static_cast<uint64_t>(words[i+3]) << 48), t);
+        for (; i < nWords; ++i)
+          crc = updateTable(crc, words[i], t);
+        return crc;
+      };
+    }
+
+    /** the eleven words of a VFAT block in the order they enter the CRC
+     * @param words array of CRC16::VFAT_WORDS words, filled
+     */
+    inline void vfatCRCWords(VFATData const& vfat, uint16_t* words) {
+      words[0]  = vfat.BC;
+      words[1]  = vfat.EC;
+      words[2]  = vfat.ChipID;
+      words[3]  = static_cast<uint16_t>(vfat.msData >> 48);
+      words[4]  = static_cast<uint16_t>(vfat.msData >> 32);
+      words[5]  = static_cast<uint16_t>(vfat.msData >> 16);
+      words[6]  = static_cast<uint16_t>(vfat.msData);
+      words[7]  = static_cast<uint16_t>(vfat.lsData >> 48);
+      words[8]  = static_cast<uint16_t>(vfat.lsData >> 32);
+      words[9]  = static_cast<uint16_t>(vfat.lsData >> 16);
+      words[10] = static_cast<uint16_t>(vfat.lsData);
+    };
+
+    /** CRC the VFAT should have sent with the block
+     */
+    inline uint16_t vfatCRC(VFATData const& vfat) {
+      uint16_t words[CRC16::VFAT_WORDS];
+      vfatCRCWords(vfat, words);
+      return CRC16::compute(words, CRC16::VFAT_WORDS);
+    };
+
+    /** true if the CRC sent by the VFAT matches its data
+     */
+    inline bool checkVFATCRC(VFATData const& vfat) {
+      return vfatCRC(vfat) == vfat.crc;
+    };
+
+    /** check the CRC of many blocks at once
+     * @param vfats blocks to check
+     * @param nVFATs number of blocks
+     * @param ok if not NULL, filled with the result for each block
+     * @retval returns the number of blocks with a bad CRC
+     */
+    inline size_t checkVFATCRCs(VFATData const* vfats, size_t const nVFATs, bool* ok = NULL) {
+      CRC16::Tables const& t = CRC16::tables();
+      size_t nBad = 0;
+      for (size_t i = 0; i < nVFATs; ++i) {
+        VFATData const& vfat = vfats[i];
+        // BC, EC, ChipID, msData<63:48> | msData<47:0>, lsData<63:48> | lsData<47:0>
+        uint16_t crc = CRC16::updateSlice(CRC16::INIT,
+                                          static_cast<uint64_t>(vfat.BC)                |
+                                          (static_cast<uint64_t>(vfat.EC)        << 16) |
+                                          (static_cast<uint64_t>(vfat.ChipID)    << 32) |
+                                          ((vfat.msData >> 48)                   << 48), t);
+        crc = CRC16::updateSlice(crc,
+                                 ((vfat.msData >> 32) & 0xffff)         |
+                                 (((vfat.msData >> 16) & 0xffff) << 16) |
+                                 ((vfat.msData & 0xffff)         << 32) |
+                                 ((vfat.lsData >> 48)            << 48), t);
+        crc = CRC16::updateTable(crc, static_cast<uint16_t>(vfat.lsData >> 32), t);
+        crc = CRC16::updateTable(crc, static_cast<uint16_t>(vfat.lsData >> 16), t);
+        crc = CRC16::updateTable(crc, static_cast<uint16_t>(vfat.lsData),       t);
+
+        bool good = (crc == vfat.crc);
+        if (ok)
+          ok[i] = good;
+        nBad += !good;
+      }
+      return nBad;
+    };
+
+  } //end namespace gem::readout
+} //end namespace gem
+#endif
@@ -0,0 +1,171 @@
+#ifndef gem_readout_GEMDataCodec_h
+#define gem_readout_GEMDataCodec_h
+
+#include <stdint.h>
+
+namespace gem {
+  namespace readout {
+
+    /** Description of a field of SIZE bits starting at bit OFFSET of a word of type W
+     * All functions are constexpr and branch free, get()/pack() compile down to a shift and a mask.
+     * The field descriptors of the AMC/GEB/VFAT words below are the only place the data format
+     * is spelled out, the readout and all the readers decode through them.
+     */
+    template <typename W, unsigned OFFSET, unsigned SIZE>
+      struct BitField
+      {
+        static_assert(SIZE > 0 && OFFSET + SIZE <= 8*sizeof(W), "field does not fit in the word");
+
+        typedef W word_type;
+
+        static constexpr unsigned offset() { return OFFSET; };
+        static constexpr unsigned size()   { return SIZE;   };
+
+        /** mask of the field, right aligned */
+        static constexpr W max()  { return static_cast<W>(~static_cast<W>(0)) >> (8*sizeof(W) - SIZE); };
+        /** mask of the field, in place */
+        static constexpr W mask() { return static_cast<W>(max() << OFFSET); };
+
+        /** extract the field from a word */
+        static constexpr W get(W const word) { return (word >> OFFSET) & max(); };
+        /** place a value in the field, bits outside the field are dropped */
+        static constexpr W pack(W const value) { return static_cast<W>((value & max()) << OFFSET); };
+        /** replace the field in a word */
+        static constexpr W set(W const word, W const value) { return static_cast<W>((word & ~mask()) | pack(value)); };
+      };
+
+    /*
+     *  AMC (GEM board) header and trailer words
+     */
+    namespace AMC {
+      // header1: AmcNo:4      0000:4     LV1ID:24   BXID:12     DataLgth:20
+      typedef BitField<uint64_t, 60,  4> AmcNo;
+      typedef BitField<uint64_t, 56,  4> ZeroFlag;
+      typedef BitField<uint64_t, 32, 24> LV1ID;
+      typedef BitField<uint64_t, 20, 12> BXID;
+      typedef BitField<uint64_t,  0, 20> DataLgth;
+
+      // header2: User:32      OrN:16     BoardID:16
+      typedef BitField<uint64_t, 32, 32> User;
+      typedef BitField<uint64_t, 16, 16> OrN;
+      typedef BitField<uint64_t,  0, 16> BoardID;
+
+      // header3: DAVList:24   BufStat:24 DAVCount:5 FormatVer:3 MP7BordStat:8
+      typedef BitField<uint64_t, 40, 24> DAVList;
+      typedef BitField<uint64_t, 16, 24> BufStat;
+      typedef BitField<uint64_t, 11,  5> DAVCount;
+      typedef BitField<uint64_t,  8,  3> FormatVer;
+      typedef BitField<uint64_t,  0,  8> MP7BordStat;
+
+      // trailer2: EventStat:32 GEBerrFlag:24
+      typedef BitField<uint64_t, 24, 32> EventStat;
+      typedef BitField<uint64_t,  0, 24> GEBerrFlag;
+
+      // trailer1: crc:32       LV1IDT:8   0000:4     DataLgth:20
+      typedef BitField<uint64_t, 32, 32> CRC;
+      typedef BitField<uint64_t, 24,  8> LV1IDT;
+      typedef BitField<uint64_t, 20,  4> TrailerZeroFlag;
+      typedef BitField<uint64_t,  0, 20> TrailerDataLgth;
+    }
+
+    /*
+     *  GEB (chamber) header and trailer words
+     */
+    namespace GEB {
+      // header: ZSFlag:24 ChamID:12 ZSMode:1 sumVFAT:27
+      // ZSMode marks a zero suppressed chamber, bit 23-slot of ZSFlag stands for the chip in
+      // that slot of the GEB, see GEMDataAMCformat.h
+      typedef BitField<uint64_t, 40, 24> ZSFlag;
+      typedef BitField<uint64_t, 28, 12> ChamID;
+      typedef BitField<uint64_t, 27,  1> ZSMode;
+      typedef BitField<uint64_t,  0, 27> SumVFAT;
+
+      // trailer: OHcrc:16 OHwCount:16 ChamStatus:16 res:16
+      typedef BitField<uint64_t, 48, 16> OHcrc;
+      typedef BitField<uint64_t, 32, 16> OHwCount;
+      typedef BitField<uint64_t, 16, 16> ChamStatus;
+      typedef BitField<uint64_t,  0, 16> GEBres;
+    }
+
+    /*
+     *  VFAT block
+     */
+    namespace VFAT {
+      // VFATData::BC     1010:4 BC:12
+      typedef BitField<uint16_t, 12,  4> B1010;
+      typedef BitField<uint16_t,  0, 12> BC;
+      // VFATData::EC     1100:4 EC:8 Flags:4
+      typedef BitField<uint16_t, 12,  4> B1100;
+      typedef BitField<uint16_t,  4,  8> EC;
+      typedef BitField<uint16_t,  0,  4> Flag;
+      // VFATData::ChipID 1110:4 ChipID:12
+      typedef BitField<uint16_t, 12,  4> B1110;
+      typedef BitField<uint16_t,  0, 12> ChipID;
+
+      static const uint16_t CONTROL_1010 = 0xa;
+      static const uint16_t CONTROL_1100 = 0xc;
+      static const uint16_t CONTROL_1110 = 0xe;
+
+      /** true if the three control nibbles of a block have their fixed values
+       * @param BCword, ECword, ChipIDword the first three 16 bit words of the block
+       */
+      inline bool controlBitsOK(uint16_t const BCword, uint16_t const ECword, uint16_t const ChipIDword) {
+        return ((B1010::get(BCword) == CONTROL_1010) &
+                (B1100::get(ECword) == CONTROL_1100) &
+                (B1110::get(ChipIDword) == CONTROL_1110));
+      };
+    }
+
+    /*
+     *  GLIB tracking data FIFO, seven 32 bit words per VFAT block plus the trigger data word
+     *    word 6: BX from OH
+     *    word 5: BC word:16 | EC word:16
+     *    word 4: ChipID word:16 | channels <127:112>
+     *    word 3: channels <111:80>
+     *    word 2: channels <79:48>
+     *    word 1: channels <47:16>
+     *    word 0: channels <15:0> | crc:16
+     */
+    namespace TRK {
+      typedef BitField<uint32_t,  0, 16> BXfrOH;    // word 6
+      typedef BitField<uint32_t, 16, 16> BCword;    // word 5
+      typedef BitField<uint32_t,  0, 16> ECword;    // word 5
+      typedef BitField<uint32_t, 16, 16> ChipIDword;// word 4
+      typedef BitField<uint32_t,  0, 16> DataHigh;  // word 4, 2: the upper 16 bits of msData/lsData
+      typedef BitField<uint32_t, 16, 16> DataLow;   // word 2, 0: the lower 16 bits of msData/lsData
+      typedef BitField<uint32_t,  0, 16> CRC;       // word 0
+
+      // trigger data word: BX:26 SBit:6
+      typedef BitField<uint32_t,  6, 26> TrigBX;
+      typedef BitField<uint32_t,  0,  6> SBit;
+
+      /** channels <127:64> of a tracking data block */
+      inline uint64_t msData(uint32_t const* data) {
+        return (static_cast<uint64_t>(DataHigh::get(data[4])) << 48) |
+          (static_cast<uint64_t>(data[3]) << 16) | DataLow::get(data[2]);
+      };
+
+      /** channels <63:0> of a tracking data block */
+      inline uint64_t lsData(uint32_t const* data) {
+        return (static_cast<uint64_t>(DataHigh::get(data[2])) << 48) |
+          (static_cast<uint64_t>(data[1]) << 16) | DataLow::get(data[0]);
+      };
+
+      /** split channels <127:64> into tracking data words 4 (low half), 3 and 2 (high half) */
+      inline void packMSData(uint64_t const msData, uint32_t* data) {
+        data[4] = static_cast<uint32_t>(DataHigh::set(data[4], static_cast<uint32_t>(msData >> 48)));
+        data[3] = static_cast<uint32_t>(msData >> 16);
+        data[2] = static_cast<uint32_t>(DataLow::set(data[2], static_cast<uint32_t>(msData & 0xffff)));
+      };
+
+      /** split channels <63:0> into tracking data words 2 (low half), 1 and 0 (high half) */
+      inline void packLSData(uint64_t const lsData, uint32_t* data) {
+        data[2] = static_cast<uint32_t>(DataHigh::set(data[2], static_cast<uint32_t>(lsData >> 48)));
+        data[1] = static_cast<uint32_t>(lsData >> 16);
+        data[0] = static_cast<uint32_t>(DataLow::set(data[0], static_cast<uint32_t>(lsData & 0xffff)));
+      };
+    }
+
+  } //end namespace gem::readout
+} //end namespace gem
+#endif
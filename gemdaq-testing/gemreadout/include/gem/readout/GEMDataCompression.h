@@ -0,0 +1,324 @@
+#ifndef gem_readout_GEMDataCompression_h
+#define gem_readout_GEMDataCompression_h
+
+#include <algorithm>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <thread>
+#include <stdint.h>
+
+#include <zlib.h>
+
+namespace gem {
+  namespace readout {
+
+    /*
+     *  Compressed raw data file
+     *
+     *  A sequence of independent frames, each holding a chunk of whole events of the plain (hex
+     *  or binary) output compressed with zlib. Every frame starts with a ZFrame::Header giving
+     *  the compressed and uncompressed sizes and the number of the first event in the frame, so
+     *  a file can be scanned frame by frame without decompressing anything and any frame can be
+     *  decompressed on its own, in any order.
+     */
+    namespace ZFrame {
+      static const uint32_t MAGIC      = 0x5a4d4547; // "GEMZ" in the file
+      static const uint16_t VERSION    = 1;
+      static const uint16_t FLAG_STORED = 0x1;        // payload is not compressed
+      static const uint32_t MAX_FRAME_SIZE = 64*1024*1024; // uncompressed bytes, a larger size is damage
+
+      struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t flags;
+        uint32_t compressedSize;   // bytes of payload after the header
+        uint32_t uncompressedSize;
+        uint64_t firstEvent;       // events written to the file before the first one of the frame
+        uint32_t nEvents;
+        uint32_t reserved;
+      };
+      static_assert(sizeof(Header) == 32, "frame header must not be padded");
+
+      /** compress a chunk of events into a frame
+       * if zlib fails the chunk is stored as it is, a frame is always produced
+       * @param data first byte of the chunk
+       * @param nBytes size of the chunk
+       * @param firstEvent number of the first event of the chunk
+       * @param nEvents number of events in the chunk
+       * @param level zlib compression level, 1 (fastest) to 9
+       * @param frame filled with the header and the payload
+       * @retval returns false if the chunk had to be stored uncompressed
+       */
+      inline bool compress(char const* data, size_t const nBytes, uint64_t const firstEvent, uint32_t const nEvents,
+                           int const level, std::vector<char>& frame) {
+        uLongf compressedSize = compressBound(nBytes);
+        frame.resize(sizeof(Header) + compressedSize);
+
+        Header header;
+        header.magic            = MAGIC;
+        header.version          = VERSION;
+        header.flags            = 0;
+        header.uncompressedSize = nBytes;
+        header.firstEvent       = firstEvent;
+        header.nEvents          = nEvents;
+        header.reserved         = 0;
+
+        bool ok = (compress2(reinterpret_cast<Bytef*>(&frame[sizeof(Header)]), &compressedSize,
+                             reinterpret_cast<Bytef const*>(data), nBytes, level) == Z_OK);
+        if (!ok || compressedSize >= nBytes) {
+          // incompressible data is not worth the decompression time
+          header.flags |= FLAG_STORED;
+          compressedSize = nBytes;
+          frame.resize(sizeof(Header) + nBytes);
+          std::copy(data, data + nBytes, &frame[sizeof(Header)]);
+        }
+        header.compressedSize = compressedSize;
+        frame.resize(sizeof(Header) + compressedSize);
+        std::copy(reinterpret_cast<char const*>(&header), reinterpret_cast<char const*>(&header) + sizeof(Header),
+                  &frame[0]);
+        return ok;
+      };
+
+      /** decompress the payload of a frame
+       * @param header header of the frame
+       * @param payload header.compressedSize bytes following the header
+       * @param data filled with the header.uncompressedSize bytes of the chunk
+       * @retval returns false if the payload is corrupted
+       */
+      inline bool decompress(Header const& header, char const* payload, std::vector<char>& data) {
+        data.resize(header.uncompressedSize);
+        if (header.flags & FLAG_STORED) {
+          if (header.compressedSize != header.uncompressedSize)
+            return false;
+          std::copy(payload, payload + header.compressedSize, data.begin());
+          return true;
+        }
+        uLongf size = header.uncompressedSize;
+        return (uncompress(reinterpret_cast<Bytef*>(&data[0]), &size,
+                           reinterpret_cast<Bytef const*>(payload), header.compressedSize) == Z_OK &&
+                size == header.uncompressedSize);
+      };
+
+      /** read the header of the next frame
+       * @retval returns false at the end of the file or if the next bytes are not a frame header
+       */
+      inline bool readHeader(std::istream& in, Header& header) {
+        in.read(reinterpret_cast<char*>(&header), sizeof(Header));
+        return (in.gcount() == sizeof(Header) && header.magic == MAGIC && header.version <= VERSION);
+      };
+    }
+
+    /** Input stream buffer over a raw data file, compressed or not
+     * A compressed file is read a batch of frames at a time. The frames of a batch are
+     * decompressed in parallel, one thread per frame, while the events of the previous batch
+     * are being read. A plain file is passed through, so the readers can use the same
+     * std::istream for both:
+     *
+     *   std::ifstream file(name.c_str(), std::ios::binary);
+     *   gem::readout::RawFileBuf buf(file);
+     *   std::istream inpf(&buf);
+     */
+    class RawFileBuf : public std::streambuf
+    {
+    public:
+      static const size_t PLAIN_BLOCK_SIZE = 1024*1024;
+
+      /** RawFileBuf constructor
+       * @param in the file, opened in binary mode
+       * @param nThreads frames decompressed in parallel, 0 to use one per core
+       */
+      RawFileBuf(std::istream& in, unsigned const nThreads=0) :
+        in_(in),
+        nThreads_(nThreads ? nThreads : std::thread::hardware_concurrency()),
+        compressed_(false),
+        current_(0),
+        badFrames_(0)
+      {
+        if (!nThreads_)
+          nThreads_ = 1;
+
+        // a compressed file starts with a frame header, anything else is read as it is
+        std::streampos start = in_.tellg();
+        ready_.resize(1);
+        ready_[0].data.resize(sizeof(uint32_t));
+        in_.read(&ready_[0].data[0], sizeof(uint32_t));
+        ready_[0].data.resize(in_.gcount());
+        uint32_t magic = 0;
+        if (ready_[0].data.size() == sizeof(uint32_t))
+          std::copy(ready_[0].data.begin(), ready_[0].data.end(), reinterpret_cast<char*>(&magic));
+        compressed_ = (magic == ZFrame::MAGIC);
+        if (compressed_) {
+          // rewind to the start of the first header
+          in_.clear();
+          in_.seekg(start);
+          ready_.clear();
+          readBatch();
+        } else if (!ready_[0].data.empty()) {
+          setg(&ready_[0].data[0], &ready_[0].data[0], &ready_[0].data[0] + ready_[0].data.size());
+        }
+      };
+
+      ~RawFileBuf() {
+        join();
+      };
+
+      bool isCompressed() const { return compressed_; };
+
+      /** frames that could not be decompressed, damaged frame headers and a truncated last frame,
+       * all skipped; after a damaged header the reading goes on at the next frame header found
+       */
+      uint64_t getBadFrames() const { return badFrames_; };
+
+    protected:
+      int_type underflow() {
+        if (gptr() < egptr())
+          return traits_type::to_int_type(*gptr());
+        if (!(compressed_ ? nextFrame() : readPlain()))
+          return traits_type::eof();
+        return traits_type::to_int_type(*gptr());
+      };
+
+    private:
+      struct Frame {
+        ZFrame::Header header;
+        std::vector<char> payload;
+        std::vector<char> data;
+        bool ok;
+      };
+
+      bool readPlain() {
+        ready_[0].data.resize(PLAIN_BLOCK_SIZE);
+        in_.read(&ready_[0].data[0], PLAIN_BLOCK_SIZE);
+        size_t nBytes = in_.gcount();
+        if (!nBytes)
+          return false;
+        setg(&ready_[0].data[0], &ready_[0].data[0], &ready_[0].data[0] + nBytes);
+        return true;
+      };
+
+      /** read the compressed payload of the next batch and start decompressing it */
+      void readBatch() {
+        pending_.resize(nThreads_);
+        size_t nFrames = 0;
+        while (nFrames < nThreads_) {
+          Frame& frame = pending_[nFrames];
+          std::streampos start = in_.tellg();
+          if (!ZFrame::readHeader(in_, frame.header)) {
+            if (!in_.gcount())
+              break;
+            // a damaged header, go on from the next frame
+            ++badFrames_;
+            in_.clear();
+            in_.seekg(start + std::streamoff(1));
+            if (!findFrame())
+              break;
+            continue;
+          }
+          // a damaged size is caught before its payload is allocated, a frame is never larger
+          // than its chunk and the file ends after its last frame
+          if (frame.header.uncompressedSize > ZFrame::MAX_FRAME_SIZE ||
+              frame.header.compressedSize > frame.header.uncompressedSize ||
+              frame.header.compressedSize > bytesLeft()) {
+            ++badFrames_;
+            in_.seekg(start + std::streamoff(1));
+            if (!findFrame())
+              break;
+            continue;
+          }
+          frame.payload.resize(frame.header.compressedSize);
+          in_.read(frame.payload.data(), frame.header.compressedSize);
+          if (static_cast<uint32_t>(in_.gcount()) != frame.header.compressedSize) {
+            // the file ends in the middle of the frame
+            ++badFrames_;
+            break;
+          }
+          ++nFrames;
+        }
+        pending_.resize(nFrames);
+        for (size_t i = 0; i < nFrames; ++i)
+          threads_.push_back(std::thread(&RawFileBuf::decompress, &pending_[i]));
+      };
+
+      /** @retval returns the bytes of the file after the current position */
+      uint64_t bytesLeft() {
+        std::streampos current = in_.tellg();
+        in_.seekg(0, std::ios::end);
+        std::streampos end = in_.tellg();
+        in_.seekg(current);
+        return (end > current) ? static_cast<uint64_t>(end - current) : 0;
+      };
+
+      /** move the stream to the next ZFrame::MAGIC
+       * @retval returns false if there is none before the end of the file
+       */
+      bool findFrame() {
+        char magic[sizeof(uint32_t)];
+        std::copy(reinterpret_cast<char const*>(&ZFrame::MAGIC),
+                  reinterpret_cast<char const*>(&ZFrame::MAGIC) + sizeof(uint32_t), magic);
+        char window[sizeof(uint32_t)] = { 0, 0, 0, 0 };
+        size_t nRead = 0;
+        int c;
+        while ((c = in_.get()) != std::char_traits<char>::eof()) {
+          std::copy(window + 1, window + sizeof(uint32_t), window);
+          window[sizeof(uint32_t) - 1] = static_cast<char>(c);
+          if (++nRead >= sizeof(uint32_t) && std::equal(window, window + sizeof(uint32_t), magic)) {
+            in_.seekg(-static_cast<std::streamoff>(sizeof(uint32_t)), std::ios::cur);
+            return true;
+          }
+        }
+        return false;
+      };
+
+      static void decompress(Frame* frame) {
+        frame->ok = ZFrame::decompress(frame->header, frame->payload.data(), frame->data);
+      };
+
+      void join() {
+        for (size_t i = 0; i < threads_.size(); ++i)
+          threads_[i].join();
+        threads_.clear();
+      };
+
+      /** point the get area to the next frame, swapping in the pending batch when needed */
+      bool nextFrame() {
+        for (;;) {
+          if (current_ < ready_.size()) {
+            Frame& frame = ready_[current_++];
+            if (!frame.ok) {
+              ++badFrames_;
+              continue;
+            }
+            if (frame.data.empty())
+              continue;
+            setg(&frame.data[0], &frame.data[0], &frame.data[0] + frame.data.size());
+            return true;
+          }
+          join();
+          if (pending_.empty())
+            return false;
+          ready_.swap(pending_);
+          current_ = 0;
+          readBatch();
+        }
+      };
+
+      std::istream& in_;
+      unsigned nThreads_;
+      bool compressed_;
+
+      std::vector<Frame> ready_;    // frames being read, data holds the plain blocks for a plain file
+      std::vector<Frame> pending_;  // frames being decompressed
+      std::vector<std::thread> threads_;
+      size_t current_;
+      uint64_t badFrames_;
+
+      // Prevent copying.
+      RawFileBuf(RawFileBuf const&);
+      RawFileBuf& operator=(RawFileBuf const&);
+    };
+
+  } //end namespace gem::readout
+} //end namespace gem
+#endif
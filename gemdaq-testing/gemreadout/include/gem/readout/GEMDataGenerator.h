@@ -0,0 +1,301 @@
+#ifndef gem_readout_GEMDataGenerator_h
+#define gem_readout_GEMDataGenerator_h
+
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+
+#include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMDataCRC.h"
+
+namespace gem {
+  namespace readout {
+
+    /** Synthetic GEM events, for load tests of the readout, the writers and the DQM
+     * Each call to next() makes one AMC event with a chamber per link in the link mask and a
+     * VFAT block per chip of the link, in the order of its chip list. The blocks have the fixed
+     * control nibbles, the EC of the event and the BC of its bunch crossing, and a valid CRC.
+     * Every channel fires with its own probability, the same for all the chips.
+     * The bunch crossing advances by a random number of BX between the minimum and maximum
+     * step from one event to the next, the EC by one, as the VFATs count the triggers.
+     * With an error rate set, that fraction of the blocks is corrupted with one of the errors
+     * enabled, each of them caught by one of the GEMDataChecker checks. The CRC of a corrupted
+     * block is recomputed, except for ERROR_CRC, so each block has only the error injected.
+     * The sequence only depends on the seed and the settings, runs can be reproduced.
+     *
+     *   gem::readout::GEMDataGenerator generator(1);
+     *   generator.setLinkMask(0x3);
+     *   generator.setOccupancy(0.01);
+     *   gem::readout::GEMData gem;
+     *   generator.next(gem);
+     *
+     * To go through the readout, see the GLIBReplay constructor taking a generator.
+     */
+    class GEMDataGenerator
+    {
+    public:
+      static const uint8_t  MAX_LINKS      = 3;
+      static const unsigned N_CHANNELS     = 128;
+      static const uint32_t BX_PER_ORBIT   = 3564;
+      /** 64 bit words of a VFAT block in the AMC event: BC, EC, ChipID, the 128 channels and crc */
+      static const unsigned VFAT_AMC_WORDS = 3;
+
+      /** errors injected, each one a bit of the mask given to setErrorRate()
+       */
+      enum Error {
+        ERROR_CRC = 0,      // a bit of the crc flipped
+        ERROR_CONTROL_BITS, // one of the control nibbles changed
+        ERROR_BC_MISMATCH,  // a BC different from the one of the event
+        ERROR_UNKNOWN_CHIP, // a ChipID not in the chip list of the link
+        N_ERRORS
+      };
+
+      static const uint32_t ALL_ERRORS = (1 << N_ERRORS) - 1;
+
+      /** GEMDataGenerator constructor
+       * one chamber on link 0 with the chips the GEMDataParker knows, no hits and no errors
+       * @param seed seed of the random numbers
+       */
+      GEMDataGenerator(uint64_t const& seed=1) :
+        linkMask_(0x1),
+        minBXStep_(1),
+        maxBXStep_(1),
+        bx_(0),
+        event_(0),
+        amcNo_(1),
+        boardID_(1),
+        errorThreshold_(0),
+        errorMask_(ALL_ERRORS),
+        anyHits_(false),
+        nEvents_(0),
+        nBlocks_(0),
+        nHits_(0)
+      {
+        setSeed(seed);
+        uint16_t const chipIDs[] = {0x838, 0xe7b, 0xe21, 0xe74, 0x840, 0xa64};
+        for (uint8_t link = 0; link < MAX_LINKS; ++link)
+          chipIDs_[link].assign(chipIDs, chipIDs + sizeof(chipIDs)/sizeof(chipIDs[0]));
+        std::fill(threshold_, threshold_ + N_CHANNELS, 0);
+        std::fill(nErrors_, nErrors_ + N_ERRORS, 0);
+      };
+
+      /** restart the random numbers, a seed of 0 is replaced by 1 */
+      void setSeed(uint64_t const& seed) { state_ = seed ? seed : 1; };
+
+      /** links with a chamber in every event */
+      void    setLinkMask(uint8_t const& linkMask) { linkMask_ = linkMask & ((1 << MAX_LINKS) - 1); };
+      uint8_t getLinkMask() const { return linkMask_; };
+
+      /** chips of the chamber on a link, in the order their blocks are sent, GEB_MAX_VFATS at most
+       * @param chipIDs 12 bit ChipIDs
+       */
+      void setChipIDs(uint8_t const& link, std::vector<uint16_t> const& chipIDs) {
+        if (link < MAX_LINKS)
+          chipIDs_[link].assign(chipIDs.begin(),
+                                chipIDs.begin() + std::min(chipIDs.size(), GEBData::VFATs::capacity()));
+      };
+      std::vector<uint16_t> const& getChipIDs(uint8_t const& link) const { return chipIDs_[link % MAX_LINKS]; };
+
+      /** probability of every channel to fire in an event */
+      void setOccupancy(double const& occupancy) {
+        for (unsigned channel = 0; channel < N_CHANNELS; ++channel)
+          setOccupancy(channel, occupancy);
+      };
+
+      /** probability of one channel to fire in an event, channels 0-63 are in lsData */
+      void setOccupancy(unsigned const& channel, double const& occupancy) {
+        if (channel >= N_CHANNELS)
+          return;
+        threshold_[channel] = probabilityThreshold(occupancy);
+        anyHits_ = false;
+        for (unsigned ch = 0; ch < N_CHANNELS; ++ch)
+          anyHits_ |= (threshold_[ch] != 0);
+      };
+
+      /** bunch crossings from one event to the next, drawn uniformly in [minStep, maxStep] */
+      void setBXStep(uint32_t const& minStep, uint32_t const& maxStep) {
+        minBXStep_ = minStep;
+        maxBXStep_ = (maxStep < minStep) ? minStep : maxStep;
+      };
+
+      /** event number (LV1ID, and EC modulo 256) and bunch crossing of the next event
+       * @param bx bunch crossings since the first orbit, BXID and OrN are derived from it
+       */
+      void setNextEvent(uint32_t const& event, uint64_t const& bx) {
+        event_ = event;
+        bx_    = bx;
+      };
+
+      void setAmcNo(uint8_t const& amcNo)      { amcNo_   = amcNo;   };
+      void setBoardID(uint16_t const& boardID) { boardID_ = boardID; };
+
+      /** corrupt a fraction of the blocks
+       * @param rate probability of a block to be corrupted
+       * @param errors mask of the errors to choose from, (1 << Error) each, one per corrupted block
+       */
+      void setErrorRate(double const& rate, uint32_t const& errors=ALL_ERRORS) {
+        errorThreshold_ = probabilityThreshold(rate);
+        errorMask_      = errors & ALL_ERRORS;
+      };
+
+      /** make the next event
+       * @param gem filled with the event, the vectors are reused
+       */
+      void next(GEMData& gem) {
+        uint16_t bxid  = static_cast<uint16_t>(bx_ % BX_PER_ORBIT);
+        uint64_t orbit = bx_ / BX_PER_ORBIT;
+
+        uint64_t nChambers = 0;
+        uint64_t DAVList   = 0;
+        uint64_t nWords    = 5; // AMC headers and trailers
+        gem.gebs.resize(__builtin_popcount(linkMask_));
+        for (uint8_t link = 0; link < MAX_LINKS; ++link) {
+          if (!((linkMask_ >> link) & 0x1))
+            continue;
+          GEBData& geb = gem.gebs[nChambers++];
+          std::vector<uint16_t> const& chipIDs = chipIDs_[link];
+          geb.vfats.resize(chipIDs.size());
+          for (size_t chip = 0; chip < chipIDs.size(); ++chip)
+            makeBlock(link, chipIDs[chip], bxid, geb.vfats[chip]);
+          geb.header  = GEB::ChamID::pack(link) | GEB::SumVFAT::pack(chipIDs.size());
+          geb.trailer = GEB::OHwCount::pack(chipIDs.size());
+          DAVList |= (static_cast<uint64_t>(1) << link);
+          nWords  += 2 + VFAT_AMC_WORDS*chipIDs.size();
+        }
+
+        gem.header1  = AMC::AmcNo::pack(amcNo_) | AMC::LV1ID::pack(event_) | AMC::BXID::pack(bxid) |
+          AMC::DataLgth::pack(nWords);
+        gem.header2  = AMC::OrN::pack(orbit) | AMC::BoardID::pack(boardID_);
+        gem.header3  = AMC::DAVList::pack(DAVList) | AMC::DAVCount::pack(nChambers) | AMC::FormatVer::pack(1);
+        gem.trailer2 = 0;
+        gem.trailer1 = AMC::LV1IDT::pack(event_) | AMC::TrailerDataLgth::pack(nWords);
+
+        ++nEvents_;
+        ++event_;
+        bx_ += minBXStep_;
+        if (maxBXStep_ > minBXStep_)
+          bx_ += random() % (maxBXStep_ - minBXStep_ + 1);
+      };
+
+      uint64_t getEvents() const { return nEvents_; };
+      uint64_t getBlocks() const { return nBlocks_; };
+      uint64_t getHits()   const { return nHits_;   };
+      uint64_t getErrors(Error const& error) const { return nErrors_[error]; };
+      /** blocks corrupted, of any kind */
+      uint64_t getErrors() const {
+        uint64_t nErrors = 0;
+        for (unsigned error = 0; error < N_ERRORS; ++error)
+          nErrors += nErrors_[error];
+        return nErrors;
+      };
+
+    private:
+      /** xorshift64*, fast enough to draw every channel of every block */
+      uint64_t random() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_*0x2545f4914f6cdd1dULL;
+      };
+
+      /** a 32 bit random number below the threshold has the probability */
+      static uint32_t probabilityThreshold(double const& probability) {
+        if (probability <= 0)
+          return 0;
+        if (probability >= 1)
+          return 0xffffffff;
+        return static_cast<uint32_t>(probability*4294967296.);
+      };
+
+      void makeBlock(uint8_t const& link, uint16_t const& chipID, uint16_t const& bxid, VFATData& vfat) {
+        vfat.BC     = VFAT::B1010::pack(VFAT::CONTROL_1010) | VFAT::BC::pack(bxid);
+        vfat.EC     = VFAT::B1100::pack(VFAT::CONTROL_1100) | VFAT::EC::pack(event_);
+        vfat.ChipID = VFAT::B1110::pack(VFAT::CONTROL_1110) | VFAT::ChipID::pack(chipID);
+        vfat.BXfrOH = bxid;
+        vfat.lsData = 0;
+        vfat.msData = 0;
+        if (anyHits_) {
+          // two channels per random number
+          for (unsigned channel = 0; channel < N_CHANNELS; channel += 2) {
+            uint64_t r = random();
+            uint64_t& data = (channel < 64) ? vfat.lsData : vfat.msData;
+            data |= static_cast<uint64_t>(static_cast<uint32_t>(r)       < threshold_[channel])     << (channel % 64);
+            data |= static_cast<uint64_t>(static_cast<uint32_t>(r >> 32) < threshold_[channel + 1]) << (channel % 64 + 1);
+          }
+          nHits_ += __builtin_popcountll(vfat.lsData) + __builtin_popcountll(vfat.msData);
+        }
+        vfat.crc = vfatCRC(vfat);
+        ++nBlocks_;
+
+        if (errorThreshold_ && errorMask_ && static_cast<uint32_t>(random()) < errorThreshold_)
+          corrupt(link, vfat);
+      };
+
+      void corrupt(uint8_t const& link, VFATData& vfat) {
+        // one of the errors enabled, at random
+        unsigned nEnabled = __builtin_popcount(errorMask_);
+        unsigned pick     = random() % nEnabled;
+        unsigned error    = 0;
+        for (; error < N_ERRORS; ++error)
+          if (((errorMask_ >> error) & 0x1) && !pick--)
+            break;
+
+        uint64_t r = random();
+        switch (error) {
+        case ERROR_CRC:
+          vfat.crc ^= (1 << (r % 16));
+          ++nErrors_[error];
+          return;
+        case ERROR_CONTROL_BITS: {
+          uint16_t nibble = 0x1 + (r >> 8) % 0xf;
+          if (r % 3 == 0)
+            vfat.BC     ^= VFAT::B1010::pack(nibble);
+          else if (r % 3 == 1)
+            vfat.EC     ^= VFAT::B1100::pack(nibble);
+          else
+            vfat.ChipID ^= VFAT::B1110::pack(nibble);
+          break;
+        }
+        case ERROR_BC_MISMATCH:
+          vfat.BC = VFAT::BC::set(vfat.BC, VFAT::BC::get(vfat.BC) + 1 + r % (VFAT::BC::max() - 1));
+          break;
+        case ERROR_UNKNOWN_CHIP: {
+          std::vector<uint16_t> const& chipIDs = chipIDs_[link];
+          uint16_t chipID = r & VFAT::ChipID::max();
+          while (std::find(chipIDs.begin(), chipIDs.end(), chipID) != chipIDs.end())
+            chipID = (chipID + 1) & VFAT::ChipID::max();
+          vfat.ChipID = VFAT::ChipID::set(vfat.ChipID, chipID);
+          break;
+        }
+        default:
+          return;
+        }
+        vfat.crc = vfatCRC(vfat);
+        ++nErrors_[error];
+      };
+
+      uint64_t state_;
+
+      uint8_t  linkMask_;
+      std::vector<uint16_t> chipIDs_[MAX_LINKS];
+      uint32_t threshold_[N_CHANNELS];
+
+      uint32_t minBXStep_;
+      uint32_t maxBXStep_;
+      uint64_t bx_;
+      uint32_t event_;
+      uint8_t  amcNo_;
+      uint16_t boardID_;
+
+      uint32_t errorThreshold_;
+      uint32_t errorMask_;
+      bool     anyHits_;
+
+      uint64_t nEvents_;
+      uint64_t nBlocks_;
+      uint64_t nHits_;
+      uint64_t nErrors_[N_ERRORS];
+    };
+  }
+}
+#endif
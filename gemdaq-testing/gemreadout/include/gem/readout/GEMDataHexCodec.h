@@ -0,0 +1,151 @@
+#ifndef gem_readout_GEMDataHexCodec_h
+#define gem_readout_GEMDataHexCodec_h
+
+#include <istream>
+#include <streambuf>
+#include <cstring>
+#include <stdint.h>
+
+namespace gem {
+  namespace readout {
+
+    /*
+     *  "Hex" output type
+     *
+     *  One value per line, lower case hex digits without prefix or leading zeros, each line ended
+     *  by a single '\n': byte for byte what "outf << std::hex << value << std::endl" writes, so the
+     *  files are the same as the ones written before, only without a stream flush per line.
+     *  The encoder works on a caller's buffer, the decoder reads the digits straight from the
+     *  stream buffer, neither goes through the locale.
+     */
+    namespace HEX {
+      /** longest line, 16 digits and the newline */
+      static const unsigned MAX_LINE = 17;
+
+      // character classes of the decode table
+      static const uint8_t SPACE = 0x10;
+      static const uint8_t OTHER = 0xff;
+
+      struct Tables
+      {
+        char    pairs[256][2]; // two digits of a byte, most significant first
+        uint8_t digit[256];    // value of a hex digit, SPACE or OTHER
+
+        Tables() {
+          static char const digits[] = "0123456789abcdef";
+          for (unsigned byte = 0; byte < 256; ++byte) {
+            pairs[byte][0] = digits[byte >> 4];
+            pairs[byte][1] = digits[byte & 0xf];
+            digit[byte] = OTHER;
+          }
+          for (unsigned d = 0; d < 16; ++d) {
+            digit[static_cast<uint8_t>(digits[d])] = d;
+            digit[static_cast<uint8_t>("0123456789ABCDEF"[d])] = d;
+          }
+          digit[static_cast<uint8_t>(' ')]  = SPACE;
+          digit[static_cast<uint8_t>('\t')] = SPACE;
+          digit[static_cast<uint8_t>('\n')] = SPACE;
+          digit[static_cast<uint8_t>('\v')] = SPACE;
+          digit[static_cast<uint8_t>('\f')] = SPACE;
+          digit[static_cast<uint8_t>('\r')] = SPACE;
+        };
+      };
+
+      /** the tables are built once, on first use */
+      inline Tables const& tables() {
+        static const Tables hexTables;
+        return hexTables;
+      };
+
+      /** number of digits of a value, 1 for 0 */
+      inline unsigned nDigits(uint64_t const value) {
+        return value ? (67 - __builtin_clzll(value)) >> 2 : 1;
+      };
+
+      /** write a value as one line
+       * @param out room for at least MAX_LINE characters
+       * @param value value to write
+       * @retval returns the position after the newline
+       */
+      inline char* putLine(char* out, uint64_t value, Tables const& t = tables()) {
+        char* end = out + nDigits(value);
+        char* p   = end;
+        // a byte, two digits, per lookup from the least significant end
+        while (p - out >= 2) {
+          p -= 2;
+          std::memcpy(p, t.pairs[value & 0xff], 2);
+          value >>= 8;
+        }
+        if (p != out)
+          *out = t.pairs[value & 0xff][1];
+        *end = '\n';
+        return end + 1;
+      };
+
+      /** parse the next value of a buffer, skipping the white space before it
+       * @param p position to start from, moved to the first character after the digits
+       * @param end end of the buffer
+       * @param value parsed value, digits beyond the 16th shift the first ones out
+       * @retval returns false if there is no hex digit before the next other character or the end
+       */
+      inline bool parse(char const*& p, char const* end, uint64_t& value, Tables const& t = tables()) {
+        uint8_t d = OTHER;
+        while (p != end && (d = t.digit[static_cast<uint8_t>(*p)]) == SPACE)
+          ++p;
+        if (p == end || d > 0xf)
+          return false;
+        value = 0;
+        do {
+          value = (value << 4) | d;
+        } while (++p != end && (d = t.digit[static_cast<uint8_t>(*p)]) <= 0xf);
+        return true;
+      };
+
+      /** read the next value of a stream, the replacement of "inpf >> std::hex >> value"
+       * Sets failbit if no value could be read and eofbit when the end of the stream is reached,
+       * like the extraction operator does.
+       * @retval returns false if no value could be read
+       */
+      inline bool read(std::istream& in, uint64_t& value, Tables const& t = tables()) {
+        typedef std::char_traits<char> traits;
+        if (!in.good()) {
+          in.setstate(std::ios::failbit);
+          return false;
+        }
+        std::streambuf* buf = in.rdbuf();
+        traits::int_type c = buf->sgetc();
+        uint8_t d = OTHER;
+        while (!traits::eq_int_type(c, traits::eof()) && (d = t.digit[static_cast<uint8_t>(c)]) == SPACE)
+          c = buf->snextc();
+        if (traits::eq_int_type(c, traits::eof())) {
+          in.setstate(std::ios::eofbit | std::ios::failbit);
+          return false;
+        }
+        if (d > 0xf) {
+          in.setstate(std::ios::failbit);
+          return false;
+        }
+        value = 0;
+        do {
+          value = (value << 4) | d;
+          c = buf->snextc();
+        } while (!traits::eq_int_type(c, traits::eof()) && (d = t.digit[static_cast<uint8_t>(c)]) <= 0xf);
+        if (traits::eq_int_type(c, traits::eof()))
+          in.setstate(std::ios::eofbit);
+        return true;
+      };
+
+      /** read the next value into a narrower field, the upper bits are dropped */
+      template <typename T>
+        inline bool read(std::istream& in, T& field, Tables const& t = tables()) {
+        uint64_t value;
+        if (!read(in, value, t))
+          return false;
+        field = static_cast<T>(value);
+        return true;
+      };
+    }
+
+  } //end namespace gem::readout
+} //end namespace gem
+#endif
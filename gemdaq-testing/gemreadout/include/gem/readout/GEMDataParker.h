@@ -3,6 +3,10 @@
 
 #include "xdata/String.h"
 #include <string>
+#include <memory>
+#include <ctime>
+#include <vector>
+#include <stdint.h>
 
 #include "gem/utils/GEMLogging.h"
 
@@ -16,33 +20,185 @@ namespace gem {
     struct VFATData;
     struct GEBData;
     struct GEMData;
+    class RawEventWriter;
+    class RunFileWriter;
+    class SegmentCloser;
+    class GEMEventBuilder;
+  }
+  namespace datachecker {
+    class GEMDataChecker;
   }
   namespace readout {
     class GEMDataParker
     {
     public:
-      GEMDataParker(gem::hw::glib::HwGLIB& glibDevice, std::string const& outFileName, std::string const& outputType);
-      ~GEMDataParker() {};
+      /** maximum number of VFAT blocks read from the tracking data FIFO in one IPbus dispatch
+       */
+      static const uint32_t MAX_BLOCKS_PER_DRAIN = 64;
+
+      /** GEMDataParker constructor
+       * @param glibDevice GLIB to read the tracking data from
+       * @param outFileName file the events are written to
+       * @param outputType "Hex" or "Bin"
+       * @param readoutMask bit mask of the GLIB links to read out
+       * @param eventTimeout time in ms after which an incomplete event is written anyway
+       */
+      GEMDataParker(gem::hw::glib::HwGLIB& glibDevice, std::string const& outFileName, std::string const& outputType,
+                    uint8_t const& readoutMask, uint32_t const& eventTimeout);
+      ~GEMDataParker();
 
-      int *dumpDataToDisk(uint8_t const& link);
+      /** read out all the links in the readout mask and write the complete events to disk
+       * @retval returns the VFAT blocks counter, the events counter and the number of VFATs in the last event
+       */
+      int *dumpDataToDisk();
 
+      /** drain the tracking data FIFO of one link into the event builder
+       * @param link GLIB link to read out
+       * @param vfat filled with each decoded VFAT block
+       * @retval returns the VFAT blocks counter
+       */
       int  getGLIBData  (uint8_t const& link,
-                         gem::readout::GEMData& gem,
-                         gem::readout::GEBData& geb, 
                          gem::readout::VFATData& vfat);
-      void fillGEMevent (gem::readout::GEMData& gem,
-                         gem::readout::GEBData& geb, 
-                         gem::readout::VFATData& vfat);
-      void writeGEMevent(gem::readout::GEMData& gem,
-                         gem::readout::GEBData& geb,
+
+      /** decode VFAT blocks read from the tracking data FIFO and pass them to the event builder
+       * @param link GLIB link the blocks were read from
+       * @param blocks HwGLIB::TRACKING_BLOCK_WORDS words per block, as returned by HwGLIB::drainTrackingFIFO
+       * @param nBlocks number of blocks
+       * @param vfat filled with each decoded VFAT block
+       */
+      void decodeBlocks (uint8_t const& link, uint32_t const* blocks, uint32_t const& nBlocks,
                          gem::readout::VFATData& vfat);
 
+      /** decode blocks read out elsewhere, e.g. by a separate readout thread, and write the complete events
+       * may be called with no blocks to only release the events which timed out
+       * @retval returns the VFAT blocks counter, the events counter and the number of VFATs in the last event
+       */
+      int *processBlocks(uint8_t const& link, uint32_t const* blocks, uint32_t const& nBlocks);
+
+      void fillGEMevent (gem::readout::GEMData& gem);
+      void writeGEMevent(gem::readout::GEMData& gem);
+
+      /** write all buffered events to disk, to be called when the run stops
+       * incomplete events still held by the event builder are written as well,
+       * a run written in segments closes its current segment
+       */
+      void flush();
+
+      /** write the VFAT payloads zero suppressed, empty payloads are dropped and low occupancy
+       * ones written as a list of channels, see GEMDataAMCformat.h
+       */
+      void setZeroSuppression(bool const& zeroSuppression) { zeroSuppression_ = zeroSuppression; };
+      bool getZeroSuppression() const { return zeroSuppression_; };
+
+      /** place a configured chip on the GEB of a link, see GEMDataChecker::setChipSlot
+       * The slot of each block gives its GEB ZSFlag bit, and a link with chips placed flags the
+       * blocks of any other chip as unknown. To be set before the first event.
+       * @param link GLIB link of the GEB
+       * @param slot VFAT position on the GEB
+       * @param chipID ChipID of the VFAT in this position, as read from the chip
+       */
+      void setChipSlot(uint8_t const& link, uint8_t const& slot, uint16_t const& chipID);
+
+      /** compress the output file in frames of whole events, see RawEventWriter::setCompression
+       * @param level zlib compression level, 0 to write the file uncompressed
+       * @param nThreads number of compression threads
+       */
+      void setCompression(int const& level, unsigned const& nThreads);
+
+      /** run number written in the header of a "Bin" run file, to be set before the first event
+       */
+      void setRunNumber(uint32_t const& runNumber);
+
+      /** write the run in numbered segments, <outFileName>_NNNN.dat, instead of a single file
+       * A segment is complete when it reaches any of the limits, checked after each event, the
+       * next event then goes to the next segment. Each segment is preallocated with maxBytes,
+       * complete segments are closed in the background and moved to closedDir.
+       * To be set before the first event, all limits 0 to write a single file.
+       * @param maxBytes event bytes per segment, before compression
+       * @param maxEvents events per segment
+       * @param maxSeconds seconds since the first event of the segment
+       * @param closedDir directory the complete segments are moved to
+       */
+      void setSegmentation(uint64_t const& maxBytes, uint64_t const& maxEvents, uint32_t const& maxSeconds,
+                           std::string const& closedDir);
+
+      /** number of the segment being written, or to be written with the next event */
+      uint32_t getSegment() const { return segment_; };
+
+      /** number of events waiting for data from one of the links
+       */
+      size_t getPendingEvents() const;
+
+      /** number of VFAT blocks read out with a CRC not matching their data
+       */
+      uint64_t getCRCErrors() const;
+
     private:
+      /** write every event the event builder has completed
+       * @retval returns the number of events written
+       */
+      int writeBuiltEvents();
+
+      /** open the output file, or the next segment, with the current settings */
+      void openOutput();
+
+      /** close the output file, a segment is handed to the closer */
+      void closeOutput();
+
+      /** true once the current segment reached one of its limits */
+      bool segmentComplete() const;
+
+      /** the bit of GEB::ZSFlag of a block, 1 << (23-slot) with the slot of its chip on the GEB
+       * @retval returns 0 if the chip has no slot in the data checker
+       */
+      uint64_t slotFlag(uint64_t const& gebHeader, gem::readout::VFATData const& vfat) const;
 
       log4cplus::Logger gemLogger_;
       gem::hw::glib::HwGLIB* glibDevice_;
       std::string outFileName_;
       std::string outputType_;
+      uint8_t     readoutMask_;
+
+      // merges the blocks of all links into events
+      std::shared_ptr<gem::readout::GEMEventBuilder> builder_;
+
+      // validates every block as it is decoded
+      std::shared_ptr<gem::datachecker::GEMDataChecker> checker_;
+
+      // persistent output file, opened with the first event and kept for the run, or its current segment
+      std::shared_ptr<gem::readout::RawEventWriter> writer_;
+      // run file framing of the "Bin" output type
+      std::shared_ptr<gem::readout::RunFileWriter> runFile_;
+
+      // applied to every file opened
+      int      compressionLevel_;
+      unsigned compressionThreads_;
+      uint32_t runNumber_;
+
+      // segmentation, see setSegmentation
+      uint64_t segmentMaxBytes_;
+      uint64_t segmentMaxEvents_;
+      uint32_t segmentMaxSeconds_;
+      std::shared_ptr<gem::readout::SegmentCloser> closer_;
+      uint32_t segment_;
+      uint64_t segmentBytes_;
+      uint64_t segmentEvents_;
+      time_t   segmentStart_;
+      // events written in the segments before the current one
+      uint64_t runEvents_;
+
+      // reused drain buffer of getGLIBData
+      std::vector<uint32_t> blocks_;
+
+      // reused for every event popped from the event builder
+      std::shared_ptr<gem::readout::GEMData> builtEvent_;
+
+      // reused to format one event, as hex text or as a run file payload
+      std::vector<char> eventBuffer_;
+
+      bool zeroSuppression_;
+      // channel count of each block of the chamber being written
+      std::vector<uint8_t> zsHits_;
 
       // Counter
       int counter_[3];
@@ -53,7 +209,7 @@ namespace gem {
       // Events Counter     
       int event_;
          
-      // VFATs counter per event
+      // VFATs counter, last event
       int sumVFAT_;
 
     };
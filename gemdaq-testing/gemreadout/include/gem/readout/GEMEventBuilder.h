@@ -0,0 +1,121 @@
+#ifndef gem_readout_GEMEventBuilder_h
+#define gem_readout_GEMEventBuilder_h
+
+#include <vector>
+#include <stdint.h>
+
+#include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/ObjectPool.h"
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace readout {
+
+    /** Merges the VFAT block streams of the GLIB links into complete GEM events
+     * Blocks are aligned on the OptoHybrid BX and the VFAT EC. A link has finished
+     * its part of an event when it sends a block with a different BX/EC, the event is
+     * complete once every link in the readout mask has finished it, or once it has been
+     * pending for longer than the completion timeout.
+     * Each GEMData produced has one GEBData per chamber (link), with the link number
+     * in the ChamID field of the GEB header. Events are released in the order they were first seen.
+     * The pending events come from a pool and the chambers hold their blocks inline, so once the
+     * builder has seen as many pending events as the readout ever keeps it no longer allocates.
+     * A chamber holds at most GEB_MAX_VFATS blocks, the blocks beyond are dropped and counted.
+     */
+    class GEMEventBuilder
+    {
+    public:
+      static const uint8_t  MAX_LINKS = 3;
+      static const uint32_t DEFAULT_TIMEOUT_MS = 100;
+
+      /** GEMEventBuilder constructor
+       * @param readoutMask bit mask of the links expected to contribute to every event
+       * @param timeoutMs time in ms after which an incomplete event is released
+       */
+      GEMEventBuilder(uint8_t const& readoutMask, uint32_t const& timeoutMs=DEFAULT_TIMEOUT_MS);
+      ~GEMEventBuilder() {};
+
+      /** add one decoded VFAT block from a link
+       * @param link number of the link the block was read from
+       * @param vfat the decoded block
+       */
+      void addBlock(uint8_t const& link, gem::readout::VFATData const& vfat);
+
+      /** get the next complete event
+       * @param gem filled with the chamber data of the event, reuse it to avoid allocating
+       * @retval returns false if no event is ready
+       */
+      bool popEvent(gem::readout::GEMData& gem);
+
+      /** close every pending event, to be called at the end of the run
+       * the events are then released by popEvent regardless of completeness
+       */
+      void flush();
+
+      void     setTimeout(uint32_t const& timeoutMs) { timeoutMs_ = timeoutMs; };
+      uint32_t getTimeout()                    const { return timeoutMs_;     };
+
+      size_t   getPendingEvents()              const { return nPending_;      };
+      uint64_t getBuiltEvents()                const { return builtEvents_;   };
+      uint64_t getIncompleteEvents()           const { return incompleteEvents_; };
+      uint64_t getDroppedBlocks()              const { return droppedBlocks_; };
+
+    private:
+      struct PendingEvent {
+        uint16_t bx;
+        uint8_t  ec;
+        uint8_t  seenMask;  // links which sent at least one block
+        uint8_t  doneMask;  // links which moved on to a later event
+        bool     closed;    // released by flush()
+        uint64_t firstSeen; // ms
+        gem::readout::GEBData chambers[MAX_LINKS];
+      };
+
+      /** find the pending event for a BX/EC, creating it if necessary
+       * @param link the link the block comes from, its previous event is looked at first
+       */
+      PendingEvent& findEvent(uint8_t const& link, uint16_t const& bx, uint8_t const& ec);
+
+      /** i-th pending event, the oldest first */
+      PendingEvent*& pending(size_t const& i) { return pending_[(firstPending_ + i) % pending_.size()]; };
+
+      /** pending event with the given sequence number, 0 if it was released or not yet seen */
+      PendingEvent* pendingSeq(uint64_t const& seq) {
+        return (seq >= builtEvents_ && seq - builtEvents_ < nPending_) ? pending(seq - builtEvents_) : 0;
+      };
+
+      /** mark that a link has finished its part of the event with the given BX/EC
+       */
+      void closeLink(uint8_t const& link, uint16_t const& bx, uint8_t const& ec);
+
+      static uint64_t nowMs();
+
+      log4cplus::Logger gemLogger_;
+
+      uint8_t  readoutMask_;
+      uint32_t timeoutMs_;
+
+      // BX/EC of the event currently open on each link
+      bool     linkOpen_[MAX_LINKS];
+      uint16_t linkBX_[MAX_LINKS];
+      uint8_t  linkEC_[MAX_LINKS];
+      // sequence number of the event a link last added to, the event popped next is builtEvents_
+      uint64_t linkSeq_[MAX_LINKS];
+
+      // pending events in a ring, grown when full
+      gem::readout::ObjectPool<PendingEvent> pool_;
+      std::vector<PendingEvent*> pending_;
+      size_t firstPending_;
+      size_t nPending_;
+
+      uint64_t builtEvents_;
+      uint64_t incompleteEvents_;
+      uint64_t droppedBlocks_;
+
+      // Prevent copying.
+      GEMEventBuilder(GEMEventBuilder const&);
+      GEMEventBuilder& operator=(GEMEventBuilder const&);
+    };
+  }
+}
+#endif
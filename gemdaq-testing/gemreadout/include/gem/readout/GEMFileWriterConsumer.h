@@ -0,0 +1,44 @@
+#ifndef gem_readout_GEMFileWriterConsumer_h
+#define gem_readout_GEMFileWriterConsumer_h
+
+#include <memory>
+
+#include "gem/base/GEMReadoutConsumer.h"
+
+namespace gem {
+  namespace readout {
+    class GEMDataParker;
+
+    /** Builds the events of the frames of a GEMGLIBReadoutApplication and writes them to disk
+     * The blocks are decoded by the GEMDataParker straight from the pool frame, see
+     * GEMDataParker::processBlocks, the frame is not kept.
+     */
+    class GEMFileWriterConsumer : public gem::base::GEMReadoutConsumer
+    {
+    public:
+      /** GEMFileWriterConsumer constructor
+       * @param parker set up with the output file and its options
+       */
+      GEMFileWriterConsumer(std::shared_ptr<gem::readout::GEMDataParker> const& parker);
+      virtual ~GEMFileWriterConsumer() {};
+
+      virtual void consume(toolbox::mem::Reference* frame);
+
+      /** writes the events which timed out */
+      virtual void idle();
+
+      /** writes the events still pending, see GEMDataParker::flush */
+      virtual void flush();
+
+      std::shared_ptr<gem::readout::GEMDataParker> const& getParker() const { return parker_; };
+
+    private:
+      std::shared_ptr<gem::readout::GEMDataParker> parker_;
+
+      // Prevent copying.
+      GEMFileWriterConsumer(GEMFileWriterConsumer const&);
+      GEMFileWriterConsumer& operator=(GEMFileWriterConsumer const&);
+    };
+  }
+}
+#endif
@@ -0,0 +1,102 @@
+#ifndef gem_readout_GEMGLIBReadoutApplication_h
+#define gem_readout_GEMGLIBReadoutApplication_h
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "xdaq/Application.h"
+
+#include "xdata/Bag.h"
+#include "xdata/Boolean.h"
+#include "xdata/String.h"
+#include "xdata/UnsignedInteger32.h"
+#include "xdata/Vector.h"
+
+#include "gem/base/GEMReadoutApplication.h"
+
+namespace gem {
+  namespace hw {
+    namespace glib {
+      class HwGLIB;
+    }
+  }
+  namespace readout {
+    class GEMDataParker;
+    class GEMSamplingConsumer;
+
+    /** Reads the tracking data FIFOs of a GLIB into memory pool frames, see GEMReadoutFrame
+     * The IPbus reads write the VFAT blocks straight into the frames, which are then passed by
+     * reference to a GEMFileWriterConsumer building and writing the events, and to a
+     * GEMSamplingConsumer keeping a sample of them for monitoring.
+     * Takes no part in the configuration of the front-end, that is left to the supervisor.
+     */
+    class GEMGLIBReadoutApplication : public gem::base::GEMReadoutApplication
+      {
+      public:
+        XDAQ_INSTANTIATOR();
+
+        GEMGLIBReadoutApplication(xdaq::ApplicationStub *stub)
+          throw (xdaq::exception::Exception);
+
+        virtual ~GEMGLIBReadoutApplication();
+
+        class ConfigParams
+        {
+        public:
+          void registerFields(xdata::Bag<ConfigParams> *bag);
+
+          xdata::String deviceIP;
+          xdata::UnsignedInteger32 readoutMask;  // bit mask of the GLIB links to read out
+          xdata::Vector<xdata::UnsignedInteger32> chipIDs; // ChipID of VFATn, slot n of link n/8, 0 for none
+          xdata::String outFileName;             // written to GEM_DAQ_<UTC time>.dat if empty
+          xdata::String outputType;
+
+          xdata::UnsignedInteger32 eventTimeout; // ms before an incomplete event is written
+          xdata::Boolean zeroSuppression;        // write the VFAT payloads zero suppressed
+          xdata::UnsignedInteger32 compressionLevel;   // zlib level of the output file, 0 for none
+          xdata::UnsignedInteger32 compressionThreads; // compression threads per output file
+          xdata::UnsignedInteger32 runNumber;          // written in the header of "Bin" run files
+          xdata::UnsignedInteger32 segmentSize;        // MB of events per output file segment, 0 for no limit
+          xdata::UnsignedInteger32 segmentEvents;      // events per segment, 0 for no limit
+          xdata::UnsignedInteger32 segmentSeconds;     // seconds per segment, 0 for no limit
+          xdata::String            closedDir;          // directory the complete segments are moved to
+
+          xdata::UnsignedInteger32 sampleFrames;       // frames kept for monitoring, 0 for none
+          xdata::UnsignedInteger32 samplePrescale;     // one frame out of samplePrescale is kept
+        };
+
+        /** the sample of the frames read out, for a monitoring client
+         * @retval returns NULL if the application is not configured or keeps no sample
+         */
+        std::shared_ptr<gem::readout::GEMSamplingConsumer> getSampler() const { return sampler_; };
+
+      protected:
+        /** drain the tracking data FIFO of every link in the readout mask into pool frames
+         * a link is drained again as long as its frames come back full
+         */
+        virtual int readout(unsigned int expected, unsigned int* eventNumbers, std::vector< ::toolbox::mem::Reference* >& data);
+
+        /**
+         *    Connect to the GLIB, open the output file and add the consumers
+         */
+        virtual void configureAction(toolbox::Event::Reference e);
+        /**
+         *    Stop, then disconnect from the GLIB
+         */
+        virtual void haltAction(toolbox::Event::Reference e);
+
+      private:
+        xdata::Bag<ConfigParams> confParams_;
+
+        std::shared_ptr<gem::hw::glib::HwGLIB> glibDevice_;
+        std::shared_ptr<gem::readout::GEMSamplingConsumer> sampler_;
+
+        uint32_t readoutMask_;
+        uint32_t maxBlocks_; // VFAT blocks a frame holds
+      };
+  } // namespace gem::readout
+} // namespace gem
+
+#endif
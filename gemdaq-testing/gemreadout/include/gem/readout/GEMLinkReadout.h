@@ -0,0 +1,105 @@
+#ifndef gem_readout_GEMLinkReadout_h
+#define gem_readout_GEMLinkReadout_h
+
+#include <string>
+#include <memory>
+#include <stdint.h>
+
+#include "toolbox/task/WorkLoop.h"
+#include "toolbox/task/Action.h"
+
+#include "gem/utils/Lock.h"
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace hw {
+    namespace glib {
+      class HwGLIB;
+    }
+  }
+  namespace readout {
+    class GEMDataParker;
+
+    /** Reads out one GLIB link with its own GEMDataParker, on its own workloop thread
+     * Each link has its own event builder and output file, so several links (or GLIBs)
+     * are parsed and written in parallel. The only shared resource is the IPbus
+     * connection of the GLIB, which is serialised by the hardware device lock.
+     */
+    class GEMLinkReadout
+    {
+    public:
+      /** time to wait before polling the FIFO again when it was found empty
+       */
+      static const uint32_t IDLE_SLEEP_US = 1000;
+
+      /** GEMLinkReadout constructor
+       * @param glibDevice GLIB to read the tracking data from
+       * @param link GLIB link to read out
+       * @param loopName name of the workloop, must be unique in the executive
+       * @param outFileName file the events of this link are written to
+       * @param outputType "Hex" or "Bin"
+       * @param eventTimeout time in ms after which an incomplete event is written anyway
+       */
+      GEMLinkReadout(gem::hw::glib::HwGLIB& glibDevice, uint8_t const& link, std::string const& loopName,
+                     std::string const& outFileName, std::string const& outputType, uint32_t const& eventTimeout);
+      ~GEMLinkReadout();
+
+      /** start reading out the link on the workloop
+       */
+      void start();
+
+      /** stop the workloop and write everything read out so far to disk
+       */
+      void stop();
+
+      /** workloop action, reads out the link once and resubmits itself while running
+       */
+      bool readAction(toolbox::task::WorkLoop* wl);
+
+      /** copy the VFAT blocks counter, the events counter and the number of VFATs in the last event
+       */
+      void getCounters(int* counters);
+
+      /** see GEMDataParker::setZeroSuppression */
+      void setZeroSuppression(bool const& zeroSuppression);
+
+      /** see GEMDataParker::setChipSlot, for the link read out */
+      void setChipSlot(uint8_t const& slot, uint16_t const& chipID);
+
+      /** see GEMDataParker::setCompression */
+      void setCompression(int const& level, unsigned const& nThreads);
+
+      /** see GEMDataParker::setRunNumber */
+      void setRunNumber(uint32_t const& runNumber);
+
+      /** see GEMDataParker::setSegmentation */
+      void setSegmentation(uint64_t const& maxBytes, uint64_t const& maxEvents, uint32_t const& maxSeconds,
+                           std::string const& closedDir);
+
+      uint8_t getLink() const { return link_; };
+      std::string const& getOutFileName() const { return outFileName_; };
+
+    private:
+      log4cplus::Logger gemLogger_;
+
+      uint8_t     link_;
+      std::string loopName_;
+      std::string outFileName_;
+
+      std::shared_ptr<gem::readout::GEMDataParker> parker_;
+
+      toolbox::task::WorkLoop*        wl_;
+      toolbox::task::ActionSignature* readSig_;
+
+      // protects running_ and counters_, held for the whole of one read out
+      gem::utils::Lock lock_;
+      bool running_;
+      int  counters_[3];
+
+      // Prevent copying.
+      GEMLinkReadout(GEMLinkReadout const&);
+      GEMLinkReadout& operator=(GEMLinkReadout const&);
+    };
+  }
+}
+#endif
@@ -0,0 +1,269 @@
+#ifndef gem_readout_GEMRawFileIndex_h
+#define gem_readout_GEMRawFileIndex_h
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+
+#include <sys/stat.h>
+
+#include "gem/readout/GEMRawFileMap.h"
+
+namespace gem {
+  namespace readout {
+
+    /*
+     *  Sidecar index of a raw data file, written next to it as <file>.idx
+     *
+     *    FileHeader                 48 bytes: size and modification time of the indexed file
+     *    Event   events[nEvents]    24 bytes each, in file order
+     *    Chamber chambers[nChambers] 16 bytes each, the chambers of the events one after the other
+     *
+     *  Offsets are positions in the plain file, see RawFileMap. The index is rebuilt when the
+     *  size or the modification time of the file no longer match.
+     */
+    namespace RawIndex {
+      static const uint64_t MAGIC   = 0x31305844494d4547ULL; // "GEMIDX01"
+      static const uint16_t VERSION = 1;
+      /** Event::bx of an event without VFAT blocks */
+      static const uint16_t NO_BX   = 0xffff;
+
+      struct FileHeader {
+        uint64_t magic;
+        uint16_t version;
+        uint8_t  format;        // RawFileMap::Format
+        uint8_t  compressed;
+        uint32_t reserved;
+        uint64_t fileSize;
+        uint64_t fileTime;      // modification time, seconds since the epoch
+        uint64_t nEvents;
+        uint64_t nChambers;
+      };
+      static_assert(sizeof(FileHeader) == 48, "index header must not be padded");
+
+      struct Event {
+        uint64_t offset;        // RawFileMap::getEventOffset
+        uint64_t event;
+        uint32_t firstChamber;  // into the chambers
+        uint16_t nChambers;
+        uint16_t bx;            // VFAT::BC of the first block
+      };
+      static_assert(sizeof(Event) == 24, "index event must not be padded");
+
+      struct Chamber {
+        uint64_t offset;        // RawFileMap::getChamberOffset
+        uint32_t nVFATs;
+        uint16_t chamID;
+        uint16_t reserved;
+      };
+      static_assert(sizeof(Chamber) == 16, "index chamber must not be padded");
+
+      /** name of the index of a file */
+      inline std::string sidecarName(std::string const& fileName) {
+        return fileName + ".idx";
+      };
+    }
+
+    /** Event index of a raw data file
+     * Built with one pass of a RawFileMap over the file and kept next to it, so a reader can
+     * start at any event, or at the events of a BX, and the events can be split in ranges for
+     * several readers:
+     *
+     *   gem::readout::RawFileIndex index;
+     *   gem::readout::RawFileMap file(name);
+     *   if (index.open(name))
+     *     for (gem::readout::RawFileMap::iterator geb = index.seek(file, index.findEvent(first));
+     *          geb != file.end(); ++geb)
+     *       ...
+     */
+    class RawFileIndex
+    {
+    public:
+      typedef std::pair<size_t, size_t> Range;
+
+      RawFileIndex() {
+        std::memset(&header_, 0, sizeof(header_));
+      };
+
+      /** index a file, reading all of it
+       * @retval returns false if the file cannot be read
+       */
+      bool build(std::string const& fileName) {
+        events_.clear();
+        chambers_.clear();
+        RawFileMap file(fileName);
+        if (!file.isOpen() || !stamp(fileName, header_))
+          return false;
+        header_.format     = file.getFormat();
+        header_.compressed = file.isCompressed();
+
+        for (RawFileMap::iterator geb = file.begin(); geb != file.end(); ++geb) {
+          if (events_.empty() || events_.back().event != geb->event() || events_.back().nChambers == 0xffff) {
+            RawIndex::Event event = {file.getEventOffset(), geb->event(),
+                                     static_cast<uint32_t>(chambers_.size()), 0, RawIndex::NO_BX};
+            events_.push_back(event);
+          }
+          RawIndex::Event& event = events_.back();
+          if (event.bx == RawIndex::NO_BX && geb->nVFATs())
+            event.bx = VFAT::BC::get(geb->begin()->BC());
+          ++event.nChambers;
+
+          RawIndex::Chamber chamber = {file.getChamberOffset(), static_cast<uint32_t>(geb->nVFATs()),
+                                       static_cast<uint16_t>(GEB::ChamID::get(geb->header())), 0};
+          chambers_.push_back(chamber);
+        }
+        header_.nEvents   = events_.size();
+        header_.nChambers = chambers_.size();
+        return true;
+      };
+
+      /** write the index
+       * @retval returns false if it could not be written
+       */
+      bool write(std::string const& indexName) const {
+        std::ofstream out(indexName.c_str(), std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<char const*>(&header_), sizeof(header_));
+        if (!events_.empty())
+          out.write(reinterpret_cast<char const*>(events_.data()), events_.size()*sizeof(RawIndex::Event));
+        if (!chambers_.empty())
+          out.write(reinterpret_cast<char const*>(chambers_.data()), chambers_.size()*sizeof(RawIndex::Chamber));
+        out.close();
+        return static_cast<bool>(out);
+      };
+
+      /** read the index of a file
+       * @retval returns false if there is no index or it does not match the file any more
+       */
+      bool read(std::string const& indexName, std::string const& fileName) {
+        events_.clear();
+        chambers_.clear();
+        RawIndex::FileHeader current;
+        std::ifstream in(indexName.c_str(), std::ios::binary);
+        if (!in.read(reinterpret_cast<char*>(&header_), sizeof(header_)) ||
+            header_.magic != RawIndex::MAGIC || header_.version > RawIndex::VERSION ||
+            !stamp(fileName, current) ||
+            header_.fileSize != current.fileSize || header_.fileTime != current.fileTime)
+          return false;
+        // a truncated index is rebuilt
+        in.seekg(0, std::ios::end);
+        uint64_t indexSize = static_cast<uint64_t>(in.tellg()) - sizeof(header_);
+        in.seekg(sizeof(header_));
+        if (header_.nEvents > indexSize/sizeof(RawIndex::Event) || header_.nChambers > indexSize/sizeof(RawIndex::Chamber) ||
+            indexSize != header_.nEvents*sizeof(RawIndex::Event) + header_.nChambers*sizeof(RawIndex::Chamber))
+          return false;
+        events_.resize(header_.nEvents);
+        chambers_.resize(header_.nChambers);
+        if ((!events_.empty() &&
+             !in.read(reinterpret_cast<char*>(events_.data()), events_.size()*sizeof(RawIndex::Event))) ||
+            (!chambers_.empty() &&
+             !in.read(reinterpret_cast<char*>(chambers_.data()), chambers_.size()*sizeof(RawIndex::Chamber)))) {
+          events_.clear();
+          chambers_.clear();
+          return false;
+        }
+        return true;
+      };
+
+      /** read the sidecar index of a file, or build it and write it if it is missing or out of date
+       * @retval returns false if the file cannot be read, not writing the index is not an error
+       */
+      bool open(std::string const& fileName) {
+        std::string indexName = RawIndex::sidecarName(fileName);
+        if (read(indexName, fileName))
+          return true;
+        if (!build(fileName))
+          return false;
+        write(indexName);
+        return true;
+      };
+
+      RawIndex::FileHeader const& getHeader() const { return header_; };
+
+      size_t getEvents()   const { return events_.size(); };
+      size_t getChambers() const { return chambers_.size(); };
+
+      RawIndex::Event   const& getEvent(size_t const& i)   const { return events_[i]; };
+      RawIndex::Chamber const& getChamber(size_t const& i) const { return chambers_[i]; };
+
+      /** index of the first event numbered event or later
+       * @retval returns getEvents() if there is none
+       */
+      size_t findEvent(uint64_t const& event) const {
+        return std::lower_bound(events_.begin(), events_.end(), event, lessEvent) - events_.begin();
+      };
+
+      /** indices of the events of a BX */
+      void findBX(uint16_t const& bx, std::vector<size_t>& events) const {
+        events.clear();
+        for (size_t i = 0; i < events_.size(); ++i)
+          if (events_[i].bx == bx)
+            events.push_back(i);
+      };
+
+      /** split the events [first, last) in up to nRanges ranges of about the same number of chambers
+       * @param ranges filled with [first, last) index pairs, in order
+       */
+      void split(size_t const& first, size_t const& last, unsigned const& nRanges, std::vector<Range>& ranges) const {
+        ranges.clear();
+        if (first >= last || !nRanges)
+          return;
+        uint64_t firstChamber = events_[first].firstChamber;
+        uint64_t nChambers = events_[last-1].firstChamber + events_[last-1].nChambers - firstChamber;
+        size_t start = first;
+        for (unsigned range = 1; range <= nRanges && start < last; ++range) {
+          size_t end = last;
+          if (range < nRanges) {
+            RawIndex::Event target = {0, 0, static_cast<uint32_t>(firstChamber + nChambers*range/nRanges), 0, 0};
+            end = std::lower_bound(events_.begin() + start, events_.begin() + last, target, lessChamber) - events_.begin();
+          }
+          if (end > start) {
+            ranges.push_back(Range(start, end));
+            start = end;
+          }
+        }
+      };
+
+      /** move a reader of the indexed file to an event
+       * @param i index of the event
+       * @retval returns file.end() if there is no such event
+       */
+      RawFileMap::iterator seek(RawFileMap& file, size_t const& i) const {
+        if (i >= events_.size())
+          return file.end();
+        return file.seek(events_[i].offset, events_[i].event);
+      };
+
+    private:
+      static bool lessEvent(RawIndex::Event const& event, uint64_t const& number) {
+        return event.event < number;
+      };
+
+      static bool lessChamber(RawIndex::Event const& event, RawIndex::Event const& target) {
+        return event.firstChamber < target.firstChamber;
+      };
+
+      /** size and modification time of the indexed file */
+      static bool stamp(std::string const& fileName, RawIndex::FileHeader& header) {
+        struct stat st;
+        if (::stat(fileName.c_str(), &st) != 0)
+          return false;
+        header.magic    = RawIndex::MAGIC;
+        header.version  = RawIndex::VERSION;
+        header.reserved = 0;
+        header.fileSize = st.st_size;
+        header.fileTime = st.st_mtime;
+        return true;
+      };
+
+      RawIndex::FileHeader header_;
+      std::vector<RawIndex::Event> events_;
+      std::vector<RawIndex::Chamber> chambers_;
+    };
+
+  } //end namespace gem::readout
+} //end namespace gem
+#endif
@@ -0,0 +1,739 @@
+#ifndef gem_readout_GEMRawFileMap_h
+#define gem_readout_GEMRawFileMap_h
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMDataCRC.h"
+#include "gem/readout/GEMDataCompression.h"
+#include "gem/readout/GEMRunFile.h"
+
+namespace gem {
+  namespace readout {
+
+    /** View of a VFAT record in the run file layout, see GEMRunFile.h
+     * Holds a pointer to the record, the fields are decoded when asked for.
+     */
+    class VFATView
+    {
+    public:
+      VFATView() : p_(0), zsMode_(false) {};
+      VFATView(char const* p, bool const zsMode) : p_(p), zsMode_(zsMode) {};
+
+      uint16_t BC()     const { return load<uint16_t>(0); };
+      uint16_t EC()     const { return load<uint16_t>(2); };
+      uint16_t ChipID() const { return load<uint16_t>(4); };
+
+      /** number of channels of a zero suppressed record, ZS_FULL_PAYLOAD if it holds the full payload */
+      uint8_t nHits() const { return zsMode_ ? static_cast<uint8_t>(p_[6]) : ZS_FULL_PAYLOAD; };
+
+      /** channels of a zero suppressed record, nHits() of them */
+      uint8_t const* channels() const { return reinterpret_cast<uint8_t const*>(p_ + 7); };
+
+      uint64_t lsData() const {
+        uint8_t n = nHits();
+        return (n == ZS_FULL_PAYLOAD) ? load<uint64_t>(dataOffset()) : sparseData(n, 0);
+      };
+
+      uint64_t msData() const {
+        uint8_t n = nHits();
+        return (n == ZS_FULL_PAYLOAD) ? load<uint64_t>(dataOffset() + sizeof(uint64_t)) : sparseData(n, 64);
+      };
+
+      uint16_t BXfrOH() const { return load<uint16_t>(dataOffset() + payloadSize()); };
+      uint16_t crc()    const { return load<uint16_t>(dataOffset() + payloadSize() + sizeof(uint16_t)); };
+
+      /** size of the record in bytes */
+      size_t size() const { return dataOffset() + payloadSize() + 2*sizeof(uint16_t); };
+
+      /** copy the block into the structure the rest of the code uses */
+      void get(VFATData& vfat) const {
+        vfat.BC     = BC();
+        vfat.EC     = EC();
+        vfat.ChipID = ChipID();
+        vfat.lsData = lsData();
+        vfat.msData = msData();
+        vfat.BXfrOH = BXfrOH();
+        vfat.crc    = crc();
+      };
+
+      /** size of the record starting at p
+       * @retval returns 0 if it does not fit before end or has more than ZS_MAX_SPARSE_HITS channels
+       */
+      static size_t recordSize(char const* p, char const* end, bool const zsMode) {
+        if (end - p < static_cast<ptrdiff_t>(RunFile::MIN_VFAT_RECORD))
+          return 0;
+        VFATView vfat(p, zsMode);
+        uint8_t n = vfat.nHits();
+        if (n != ZS_FULL_PAYLOAD && n > ZS_MAX_SPARSE_HITS)
+          return 0;
+        size_t size = vfat.size();
+        return (static_cast<size_t>(end - p) < size) ? 0 : size;
+      };
+
+    private:
+      template <typename T>
+        T load(size_t const offset) const {
+        T value;
+        std::memcpy(&value, p_ + offset, sizeof(T));
+        return value;
+      };
+
+      size_t dataOffset() const { return zsMode_ ? 7 : 6; };
+
+      size_t payloadSize() const {
+        uint8_t n = nHits();
+        return (n == ZS_FULL_PAYLOAD) ? 2*sizeof(uint64_t) : n;
+      };
+
+      /** the 64 channels from first of a zero suppressed record */
+      uint64_t sparseData(uint8_t const n, uint8_t const first) const {
+        uint64_t data = 0;
+        uint8_t const* channel = channels();
+        for (uint8_t i = 0; i < n; ++i) {
+          uint8_t c = channel[i] & 0x7f;
+          if (c >= first && c < first + 64)
+            data |= (static_cast<uint64_t>(1) << (c - first));
+        }
+        return data;
+      };
+
+      char const* p_;
+      bool zsMode_;
+    };
+
+    /** CRC the VFAT should have sent with the block, for a block viewed in place
+     */
+    inline uint16_t vfatCRC(VFATView const& vfat) {
+      VFATData block;
+      block.BC     = vfat.BC();
+      block.EC     = vfat.EC();
+      block.ChipID = vfat.ChipID();
+      block.lsData = vfat.lsData();
+      block.msData = vfat.msData();
+      uint16_t words[CRC16::VFAT_WORDS];
+      vfatCRCWords(block, words);
+      return CRC16::compute(words, CRC16::VFAT_WORDS);
+    };
+
+    /** View of a chamber in the run file layout, see GEMRunFile.h
+     */
+    class GEBView
+    {
+    public:
+      /** iterator over the VFAT records of the chamber */
+      class const_iterator : public std::iterator<std::forward_iterator_tag, VFATView const>
+      {
+      public:
+        const_iterator() : index_(0) {};
+
+        VFATView const& operator*()  const { return vfat_; };
+        VFATView const* operator->() const { return &vfat_; };
+
+        const_iterator& operator++() {
+          vfat_ = VFATView(p_ += vfat_.size(), zsMode_);
+          ++index_;
+          return *this;
+        };
+
+        bool operator==(const_iterator const& other) const { return index_ == other.index_; };
+        bool operator!=(const_iterator const& other) const { return index_ != other.index_; };
+
+      private:
+        friend class GEBView;
+        const_iterator(char const* p, bool const zsMode, uint64_t const index) :
+          p_(p), zsMode_(zsMode), index_(index), vfat_(p, zsMode) {};
+
+        char const* p_;
+        bool zsMode_;
+        uint64_t index_;
+        VFATView vfat_;
+      };
+
+      GEBView() : p_(0), trailer_(0), event_(0) {};
+      GEBView(char const* p, char const* trailer, uint64_t const event) : p_(p), trailer_(trailer), event_(event) {};
+
+      uint64_t header()  const { return load(p_); };
+      uint64_t trailer() const { return load(trailer_); };
+
+      uint64_t nVFATs() const { return GEB::SumVFAT::get(header()); };
+      bool     zsMode() const { return GEB::ZSMode::get(header()); };
+
+      /** event the chamber belongs to, see RawFileMap */
+      uint64_t event() const { return event_; };
+
+      const_iterator begin() const { return const_iterator(p_ + sizeof(uint64_t), zsMode(), 0); };
+      const_iterator end()   const { return const_iterator(trailer_, zsMode(), nVFATs()); };
+
+      /** copy the chamber into the structure the rest of the code uses
+       * blocks beyond what a GEB can hold are left out
+       */
+      void get(GEBData& geb) const {
+        geb.header  = header();
+        geb.trailer = trailer();
+        geb.vfats.resize(nVFATs());
+        GEBData::VFATs::iterator out = geb.vfats.begin();
+        for (const_iterator vfat = begin(); vfat != end() && out != geb.vfats.end(); ++vfat, ++out)
+          vfat->get(*out);
+      };
+
+      /** end of the VFAT records of the chamber starting at p, where its trailer is
+       * @retval returns 0 if the chamber does not fit before end
+       */
+      static char const* trailerOf(char const* p, char const* end) {
+        if (end - p < static_cast<ptrdiff_t>(2*sizeof(uint64_t)))
+          return 0;
+        uint64_t header = load(p);
+        bool zsMode = GEB::ZSMode::get(header);
+        uint64_t nVFATs = GEB::SumVFAT::get(header);
+        p += sizeof(uint64_t);
+        if (nVFATs*RunFile::MIN_VFAT_RECORD > static_cast<uint64_t>(end - p))
+          return 0;
+        for (uint64_t i = 0; i < nVFATs; ++i) {
+          size_t size = VFATView::recordSize(p, end, zsMode);
+          if (!size)
+            return 0;
+          p += size;
+        }
+        return (end - p < static_cast<ptrdiff_t>(sizeof(uint64_t))) ? 0 : p;
+      };
+
+    private:
+      static uint64_t load(char const* p) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+      };
+
+      char const* p_;
+      char const* trailer_;
+      uint64_t event_;
+    };
+
+    /** Reader of raw data files through a memory mapping
+     * Reads "Bin" run files (GEMRunFile.h) and "Hex" files, compressed or not, chamber by chamber.
+     * The chambers of a plain run file are viewed where they are in the mapping, nothing is
+     * copied; a "Hex" chamber is parsed straight from the mapped text into a small buffer in the
+     * run file layout, so both look the same. A compressed file is decompressed by a RawFileBuf,
+     * in parallel, into a window the same views work on.
+     *
+     * The mapping asks the kernel to read READ_AHEAD bytes ahead of the reader and to drop the
+     * pages it is done with, so files larger than the memory are read at disk speed without
+     * pushing everything else out of the page cache.
+     *
+     *   gem::readout::RawFileMap file(name);
+     *   for (gem::readout::RawFileMap::iterator geb = file.begin(); geb != file.end(); ++geb)
+     *     for (gem::readout::GEBView::const_iterator vfat = geb->begin(); vfat != geb->end(); ++vfat)
+     *       ... vfat->ChipID(), vfat->lsData() ...
+     *
+     * A view is valid until the iterator is moved on. For "Hex" files, which do not mark the
+     * events, GEBView::event() counts the chambers.
+     *
+     * Positions count the bytes of the plain file, before compression. seek() goes back to a
+     * position taken from getEventOffset(), see RawFileIndex for finding them without a scan.
+     */
+    class RawFileMap
+    {
+    public:
+      enum Format { FORMAT_HEX, FORMAT_BIN };
+
+      static const size_t READ_AHEAD = 16*1024*1024;
+      /** bytes decompressed at a time from a compressed file */
+      static const size_t WINDOW_BLOCK = 1024*1024;
+
+      /** single pass iterator over the chambers of the file */
+      class iterator : public std::iterator<std::input_iterator_tag, GEBView const>
+      {
+      public:
+        iterator() : map_(0) {};
+
+        GEBView const& operator*()  const { return map_->view_; };
+        GEBView const* operator->() const { return &map_->view_; };
+
+        iterator& operator++() {
+          if (!map_->next())
+            map_ = 0;
+          return *this;
+        };
+
+        bool operator==(iterator const& other) const { return map_ == other.map_; };
+        bool operator!=(iterator const& other) const { return map_ != other.map_; };
+
+      private:
+        friend class RawFileMap;
+        explicit iterator(RawFileMap* map) : map_(map) {};
+
+        RawFileMap* map_;
+      };
+
+      /** RawFileMap constructor, maps the file
+       * @param fileName raw data file
+       * @param nThreads frames of a compressed file decompressed in parallel, 0 to use one per core
+       */
+      RawFileMap(std::string const& fileName, unsigned const nThreads=0) :
+        fileName_(fileName),
+        nThreads_(nThreads),
+        fd_(-1),
+        data_(0),
+        size_(0),
+        open_(false),
+        compressed_(false),
+        format_(FORMAT_HEX),
+        cur_(0),
+        end_(0),
+        exhausted_(true),
+        windowPos_(0),
+        framesLoaded_(false),
+        advised_(0),
+        released_(0),
+        event_(0),
+        eventEnd_(0),
+        chamber_(0),
+        eventOffset_(0),
+        chamberOffset_(0),
+        resyncs_(0),
+        badChambers_(0)
+      {
+        std::memset(&header_, 0, sizeof(header_));
+
+        fd_ = ::open(fileName_.c_str(), O_RDONLY);
+        if (fd_ < 0)
+          return;
+        struct stat st;
+        if (::fstat(fd_, &st) != 0)
+          return;
+        size_ = st.st_size;
+        if (size_) {
+          void* map = ::mmap(0, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+          if (map == MAP_FAILED)
+            return;
+          data_ = static_cast<char const*>(map);
+          ::madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+        }
+
+        uint32_t magic = 0;
+        if (size_ >= sizeof(magic))
+          std::memcpy(&magic, data_, sizeof(magic));
+        compressed_ = (magic == ZFrame::MAGIC);
+        open_ = true;
+        rewind();
+      };
+
+      ~RawFileMap() {
+        rawbuf_.reset();
+        if (data_)
+          ::munmap(const_cast<char*>(data_), size_);
+        if (fd_ >= 0)
+          ::close(fd_);
+      };
+
+      bool isOpen()       const { return open_; };
+      bool isCompressed() const { return compressed_; };
+      Format getFormat()  const { return format_; };
+      uint64_t getSize()  const { return size_; };
+
+      /** header of a run file, 0 for a "Hex" file */
+      RunFile::FileHeader const* getRunHeader() const { return (format_ == FORMAT_BIN) ? &header_ : 0; };
+
+      /** times the reader had to skip to the next sync record of a run file */
+      uint64_t getResyncs() const { return resyncs_; };
+
+      /** chambers that did not fit in their event and were skipped */
+      uint64_t getBadChambers() const { return badChambers_; };
+
+      /** frames of a compressed file that were damaged and skipped, since the last rewind or seek */
+      uint64_t getBadFrames() const { return rawbuf_ ? rawbuf_->getBadFrames() : 0; };
+
+      /** position of the record of the event of the current chamber, its chamber for a "Hex" file */
+      uint64_t getEventOffset() const { return eventOffset_; };
+
+      /** position of the current chamber */
+      uint64_t getChamberOffset() const { return chamberOffset_; };
+
+      /** start over from the first chamber of the file */
+      iterator begin() {
+        rewind();
+        return iterator(next() ? this : 0);
+      };
+
+      /** continue from an event
+       * @param offset position of the event, from getEventOffset()
+       * @param event number of the event, only used by "Hex" files where chambers are counted
+       * @retval returns end() if the position is past the end of the file
+       */
+      iterator seek(uint64_t const& offset, uint64_t const& event) {
+        rewind();
+        if (!open_)
+          return end();
+        if (compressed_) {
+          // start decompressing at the frame holding the position
+          loadFrames();
+          std::vector<std::pair<uint64_t, uint64_t> >::const_iterator frame =
+            std::upper_bound(frames_.begin(), frames_.end(), std::make_pair(offset, ~static_cast<uint64_t>(0)));
+          if (frame == frames_.begin())
+            return end();
+          --frame;
+          rawbuf_.reset();
+          rawfile_.reset(new std::ifstream(fileName_.c_str(), std::ios::binary));
+          rawfile_->seekg(frame->second);
+          rawbuf_.reset(new RawFileBuf(*rawfile_, nThreads_));
+          window_.clear();
+          windowPos_ = frame->first;
+          cur_ = end_ = window_.data();
+          exhausted_ = false;
+          if (!ensure(offset - frame->first))
+            return end();
+          cur_ += offset - frame->first;
+        } else {
+          if (offset > size_)
+            return end();
+          cur_ = data_ + offset;
+          advised_ = released_ = offset - offset%READ_AHEAD;
+        }
+        event_ = event;
+        return iterator(next() ? this : 0);
+      };
+
+      iterator end() { return iterator(); };
+
+    private:
+      enum { CHAMBER, MORE, STOP };
+
+      /** go back to the start of the file and find out its format */
+      void rewind() {
+        if (!open_)
+          return;
+        advised_ = released_ = 0;
+        event_ = 0;
+        eventEnd_ = chamber_ = 0;
+        if (compressed_) {
+          rawbuf_.reset();
+          rawfile_.reset(new std::ifstream(fileName_.c_str(), std::ios::binary));
+          rawbuf_.reset(new RawFileBuf(*rawfile_, nThreads_));
+          window_.clear();
+          windowPos_ = 0;
+          cur_ = end_ = window_.data();
+          exhausted_ = false;
+        } else {
+          cur_ = data_;
+          end_ = data_ + size_;
+          exhausted_ = true;
+        }
+
+        format_ = FORMAT_HEX;
+        uint64_t magic;
+        if (ensure(sizeof(RunFile::FileHeader)) && (std::memcpy(&magic, cur_, sizeof(magic)), magic == RunFile::MAGIC)) {
+          std::memcpy(&header_, cur_, sizeof(header_));
+          if (header_.version <= RunFile::VERSION && header_.headerSize >= sizeof(header_) &&
+              ensure(header_.headerSize)) {
+            format_ = FORMAT_BIN;
+            cur_ += header_.headerSize;
+          }
+        }
+      };
+
+      /** make at least nBytes available from cur_, decompressing more of a compressed file
+       * @retval returns false if the file has fewer bytes left
+       */
+      bool ensure(size_t const nBytes) {
+        while (static_cast<size_t>(end_ - cur_) < nBytes)
+          if (!refill(nBytes))
+            return false;
+        return true;
+      };
+
+      /** append the next block of a compressed file to what is left of the window */
+      bool refill(size_t const nBytes) {
+        if (exhausted_)
+          return false;
+        size_t left = end_ - cur_;
+        windowPos_ += cur_ - window_.data();
+        if (left && cur_ != window_.data())
+          std::memmove(window_.data(), cur_, left);
+        size_t block = (nBytes > WINDOW_BLOCK) ? nBytes : WINDOW_BLOCK;
+        window_.resize(left + block);
+        size_t nRead = rawbuf_->sgetn(&window_[left], block);
+        window_.resize(left + nRead);
+        if (nRead < block)
+          exhausted_ = true;
+        cur_ = window_.data();
+        end_ = cur_ + window_.size();
+        chamber_ = eventEnd_ = 0;
+        return nRead != 0;
+      };
+
+      /** position of a byte of the mapping or of the window */
+      uint64_t position(char const* p) const {
+        return compressed_ ? windowPos_ + (p - window_.data()) : p - data_;
+      };
+
+      /** positions in the plain file where the frames of a compressed file start, and their offsets */
+      void loadFrames() {
+        if (framesLoaded_)
+          return;
+        framesLoaded_ = true;
+        uint64_t position = 0;
+        size_t offset = 0;
+        ZFrame::Header header;
+        while (size_ - offset >= sizeof(header)) {
+          std::memcpy(&header, data_ + offset, sizeof(header));
+          if (header.magic != ZFrame::MAGIC || header.uncompressedSize > ZFrame::MAX_FRAME_SIZE ||
+              header.compressedSize > header.uncompressedSize ||
+              header.compressedSize > size_ - offset - sizeof(header))
+            break;
+          frames_.push_back(std::make_pair(position, static_cast<uint64_t>(offset)));
+          position += header.uncompressedSize;
+          offset += sizeof(header) + header.compressedSize;
+        }
+      };
+
+      /** keep the kernel reading ahead of a mapped file and drop the pages already read
+       * @param p start of the data still in use
+       */
+      void advise(char const* p) {
+        if (compressed_ || !data_)
+          return;
+        size_t pos = p - data_;
+        while (advised_ < size_ && advised_ < pos + READ_AHEAD) {
+          size_t length = size_ - advised_;
+          if (length > READ_AHEAD)
+            length = READ_AHEAD;
+          ::madvise(const_cast<char*>(data_) + advised_, length, MADV_WILLNEED);
+          advised_ += READ_AHEAD;
+        }
+        while (released_ + READ_AHEAD <= pos) {
+          ::madvise(const_cast<char*>(data_) + released_, READ_AHEAD, MADV_DONTNEED);
+          released_ += READ_AHEAD;
+        }
+      };
+
+      /** move the view to the next chamber */
+      bool next() {
+        if (!open_)
+          return false;
+        if (format_ == FORMAT_HEX)
+          return nextHex();
+
+        for (;;) {
+          if (!chamber_ || chamber_ == eventEnd_) {
+            if (!nextEvent())
+              return false;
+            continue;
+          }
+          char const* trailer = GEBView::trailerOf(chamber_, eventEnd_);
+          if (!trailer) {
+            ++badChambers_;
+            chamber_ = eventEnd_;
+            continue;
+          }
+          view_ = GEBView(chamber_, trailer, event_);
+          chamberOffset_ = position(chamber_);
+          chamber_ = trailer + sizeof(uint64_t);
+          return true;
+        }
+      };
+
+      /** find the next event record of a run file, see RunFileReader::next */
+      bool nextEvent() {
+        for (;;) {
+          advise(cur_);
+          if (!ensure(sizeof(RunFile::EventHeader)))
+            return false;
+          uint64_t magic;
+          std::memcpy(&magic, cur_, sizeof(magic));
+          if (magic == RunFile::INDEX_MAGIC)
+            return false;
+          if (magic == RunFile::SYNC_MAGIC) {
+            cur_ += sizeof(RunFile::SyncRecord);
+            continue;
+          }
+
+          RunFile::EventHeader header;
+          std::memcpy(&header, cur_, sizeof(header));
+          if (header.marker != RunFile::EVENT_MARKER || header.size > RunFile::MAX_EVENT_SIZE) {
+            ++resyncs_;
+            if (!resync())
+              return false;
+            continue;
+          }
+          if (!ensure(sizeof(header) + header.size))
+            return false;
+          eventOffset_ = position(cur_);
+          cur_ += sizeof(header);
+          chamber_ = cur_;
+          eventEnd_ = cur_ + header.size;
+          event_ = header.event;
+          cur_ = eventEnd_;
+          if (chamber_ != eventEnd_)
+            return true;
+        }
+      };
+
+      /** skip to the record after the next sync record */
+      bool resync() {
+        for (++cur_; ensure(sizeof(uint64_t)); ++cur_) {
+          uint64_t magic;
+          std::memcpy(&magic, cur_, sizeof(magic));
+          if (magic == RunFile::INDEX_MAGIC)
+            return false;
+          if (magic == RunFile::SYNC_MAGIC) {
+            if (!ensure(sizeof(RunFile::SyncRecord)))
+              return false;
+            cur_ += sizeof(RunFile::SyncRecord);
+            return true;
+          }
+        }
+        return false;
+      };
+
+      /** parse the next "Hex" chamber, taking more of a compressed file when it is cut */
+      bool nextHex() {
+        for (;;) {
+          advise(cur_);
+          char const* p = cur_;
+          int result = parseHex(p);
+          if (result == CHAMBER) {
+            eventOffset_ = chamberOffset_ = position(cur_);
+            cur_ = p;
+            view_ = GEBView(&scratch_[0], &scratch_[trailer_], event_++);
+            return true;
+          }
+          if (result == STOP || !refill(end_ - cur_ + 1))
+            return false;
+        }
+      };
+
+      /** parse a value, one at the end of the window may go on in the next block */
+      int hexValue(char const*& p, uint64_t& value) const {
+        if (!HEX::parse(p, end_, value))
+          return (p == end_ && !exhausted_) ? MORE : STOP;
+        return (p == end_ && !exhausted_) ? MORE : CHAMBER;
+      };
+
+      template <typename T>
+        int hexPut(char const*& p, size_t& out) {
+        uint64_t value;
+        int result = hexValue(p, value);
+        if (result == CHAMBER)
+          out = putScratch(out, static_cast<T>(value));
+        return result;
+      };
+
+      template <typename T>
+        size_t putScratch(size_t const out, T const value) {
+        std::memcpy(&scratch_[out], &value, sizeof(T));
+        return out + sizeof(T);
+      };
+
+      /** parse a "Hex" chamber into scratch_ in the run file layout */
+      int parseHex(char const*& p) {
+        int result;
+        size_t out = 0;
+        if (scratch_.size() < sizeof(uint64_t) + RunFile::MAX_VFAT_RECORD)
+          scratch_.resize(sizeof(uint64_t) + RunFile::MAX_VFAT_RECORD);
+        if ((result = hexPut<uint64_t>(p, out)) != CHAMBER)
+          return result;
+
+        uint64_t header;
+        std::memcpy(&header, &scratch_[0], sizeof(header));
+        bool zsMode = GEB::ZSMode::get(header);
+        uint64_t nVFATs = GEB::SumVFAT::get(header);
+        for (uint64_t i = 0; i < nVFATs; ++i) {
+          if (scratch_.size() < out + RunFile::MAX_VFAT_RECORD + sizeof(uint64_t))
+            scratch_.resize(2*(out + RunFile::MAX_VFAT_RECORD + sizeof(uint64_t)));
+          if ((result = hexPut<uint16_t>(p, out)) != CHAMBER ||
+              (result = hexPut<uint16_t>(p, out)) != CHAMBER ||
+              (result = hexPut<uint16_t>(p, out)) != CHAMBER)
+            return result;
+          uint8_t nHits = ZS_FULL_PAYLOAD;
+          if (zsMode) {
+            if ((result = hexPut<uint8_t>(p, out)) != CHAMBER)
+              return result;
+            nHits = static_cast<uint8_t>(scratch_[out - 1]);
+            if (nHits != ZS_FULL_PAYLOAD && nHits > ZS_MAX_SPARSE_HITS)
+              return STOP;
+          }
+          if (nHits == ZS_FULL_PAYLOAD) {
+            if ((result = hexPut<uint64_t>(p, out)) != CHAMBER ||
+                (result = hexPut<uint64_t>(p, out)) != CHAMBER)
+              return result;
+          } else {
+            for (uint8_t hit = 0; hit < nHits; ++hit)
+              if ((result = hexPut<uint8_t>(p, out)) != CHAMBER)
+                return result;
+          }
+          if ((result = hexPut<uint16_t>(p, out)) != CHAMBER ||
+              (result = hexPut<uint16_t>(p, out)) != CHAMBER)
+            return result;
+        }
+        trailer_ = out;
+        return hexPut<uint64_t>(p, out);
+      };
+
+      std::string fileName_;
+      unsigned nThreads_;
+
+      int fd_;
+      char const* data_;
+      size_t size_;
+      bool open_;
+      bool compressed_;
+      Format format_;
+      RunFile::FileHeader header_;
+
+      // compressed files are read through a RawFileBuf into the window
+      std::shared_ptr<std::ifstream> rawfile_;
+      std::shared_ptr<RawFileBuf> rawbuf_;
+      std::vector<char> window_;
+
+      // bytes still to be read, in the mapping or in the window
+      char const* cur_;
+      char const* end_;
+      bool exhausted_;
+      uint64_t windowPos_;
+
+      // plain file position and file offset of each frame of a compressed file
+      std::vector<std::pair<uint64_t, uint64_t> > frames_;
+      bool framesLoaded_;
+
+      size_t advised_;
+      size_t released_;
+
+      // current event of a run file and its next chamber
+      uint64_t event_;
+      char const* eventEnd_;
+      char const* chamber_;
+      uint64_t eventOffset_;
+      uint64_t chamberOffset_;
+
+      // a "Hex" chamber in the run file layout
+      std::vector<char> scratch_;
+      size_t trailer_;
+
+      GEBView view_;
+
+      uint64_t resyncs_;
+      uint64_t badChambers_;
+
+      // Prevent copying.
+      RawFileMap(RawFileMap const&);
+      RawFileMap& operator=(RawFileMap const&);
+    };
+
+  } //end namespace gem::readout
+} //end namespace gem
+#endif
@@ -0,0 +1,42 @@
+#ifndef gem_readout_GEMReadoutFrame_h
+#define gem_readout_GEMReadoutFrame_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "toolbox/mem/Reference.h"
+
+namespace gem {
+  namespace readout {
+
+    /** Memory pool frame filled by GEMGLIBReadoutApplication: one drain of the tracking data FIFO of a link
+     * This header is followed by nBlocks VFAT blocks of HwGLIB::TRACKING_BLOCK_WORDS words, as
+     * returned by HwGLIB::drainTrackingFIFO, and written there directly by the IPbus read.
+     */
+    struct GEMReadoutFrame
+    {
+      uint32_t link;
+      uint32_t nBlocks;
+
+      uint32_t*       blocks()       { return reinterpret_cast<uint32_t*>(this + 1);       };
+      uint32_t const* blocks() const { return reinterpret_cast<uint32_t const*>(this + 1); };
+
+      /** the frame header at the start of the data of a pool reference */
+      static GEMReadoutFrame* get(toolbox::mem::Reference* ref) {
+        return static_cast<GEMReadoutFrame*>(ref->getDataLocation());
+      };
+
+      /** number of blocks a frame of frameSize bytes can hold */
+      static uint32_t maxBlocks(size_t const& frameSize, uint32_t const& blockWords) {
+        return (frameSize < sizeof(GEMReadoutFrame)) ? 0 :
+          (frameSize - sizeof(GEMReadoutFrame))/(blockWords*sizeof(uint32_t));
+      };
+
+      /** bytes of a frame holding nBlocks blocks */
+      static size_t size(uint32_t const& nBlocks, uint32_t const& blockWords) {
+        return sizeof(GEMReadoutFrame) + nBlocks*blockWords*sizeof(uint32_t);
+      };
+    };
+  }
+}
+#endif
@@ -0,0 +1,398 @@
+#ifndef gem_readout_GEMRunFile_h
+#define gem_readout_GEMRunFile_h
+
+#include <algorithm>
+#include <istream>
+#include <vector>
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gem/readout/GEMDataAMCformat.h"
+
+namespace gem {
+  namespace readout {
+
+    /*
+     *  "Bin" run file, format version 1
+     *
+     *  Integers are stored little endian, as the readout PC writes them.
+     *
+     *    FileHeader                 64 bytes at offset 0: version, run number, boards, start time
+     *    SyncRecord                 16 bytes, before event 0 and then every SYNC_INTERVAL events
+     *    EventHeader                16 bytes: EVENT_MARKER, payload size, event number
+     *    payload                    the chambers of the event, see below
+     *    ...
+     *    IndexHeader                24 bytes, written when the file is closed
+     *    uint64_t offsets[nEvents]  offset of the EventHeader of each event
+     *    FileTrailer                24 bytes, the last ones of the file
+     *
+     *  Event payload, for each chamber:
+     *    uint64_t GEB header
+     *    SumVFAT VFAT records:
+     *      uint16_t BC, EC, ChipID
+     *      uint8_t  nHits                     only if GEB::ZSMode is set
+     *      uint8_t  channels[nHits]           only if GEB::ZSMode is set and nHits != ZS_FULL_PAYLOAD
+     *      uint64_t lsData, msData            otherwise
+     *      uint16_t BXfrOH, crc
+     *    uint64_t GEB trailer
+     *
+     *  A file that was not closed by its writer has no index, the reader then finds the events by
+     *  following the records. After a corrupted record it skips ahead to the next SyncRecord.
+     *  Event numbers count the events of the file from 0, a run written in segments numbers them
+     *  in the run as FileHeader::firstEvent plus the event number.
+     */
+    namespace RunFile {
+      static const uint64_t MAGIC         = 0x31304e55524d4547ULL; // "GEMRUN01"
+      static const uint16_t VERSION       = 1;
+      static const uint32_t EVENT_MARKER  = 0x54564547;            // "GEVT"
+      static const uint64_t SYNC_MAGIC    = 0x434e5953524d4547ULL; // "GEMRSYNC"
+      static const uint64_t INDEX_MAGIC   = 0x58444e49524d4547ULL; // "GEMRINDX"
+      static const uint64_t TRAILER_MAGIC = 0x524c5254524d4547ULL; // "GEMRTRLR"
+
+      static const uint32_t SYNC_INTERVAL  = 1024;
+      static const uint32_t MAX_EVENT_SIZE = 16*1024*1024;
+      static const unsigned MAX_BOARDS     = 12;
+
+      struct FileHeader {
+        uint64_t magic;
+        uint16_t version;
+        uint16_t headerSize;           // sizeof(FileHeader), a later version may append fields
+        uint32_t runNumber;
+        uint64_t startTime;            // seconds since the epoch when the first event was written
+        uint16_t nBoards;
+        uint16_t boardIDs[MAX_BOARDS]; // AMC BoardID of the boards in the events
+        uint16_t segment;              // number of the file in a run written in segments, from 0
+        uint32_t reserved;
+        uint64_t firstEvent;           // events of the run written in the segments before this one
+      };
+      static_assert(sizeof(FileHeader) == 64, "file header must not be padded");
+
+      struct EventHeader {
+        uint32_t marker;
+        uint32_t size;                 // bytes of payload after the header
+        uint64_t event;
+      };
+      static_assert(sizeof(EventHeader) == 16, "event header must not be padded");
+
+      struct SyncRecord {
+        uint64_t magic;
+        uint64_t nextEvent;
+      };
+
+      struct IndexHeader {
+        uint64_t magic;
+        uint64_t firstEvent;
+        uint64_t nEvents;
+      };
+
+      struct FileTrailer {
+        uint64_t indexOffset;
+        uint64_t nEvents;
+        uint64_t magic;
+      };
+
+      /** longest VFAT record, zero suppressed with the full payload */
+      static const size_t MAX_VFAT_RECORD = 3*sizeof(uint16_t) + sizeof(uint8_t) + 2*sizeof(uint64_t) + 2*sizeof(uint16_t);
+      /** shortest VFAT record, zero suppressed without hits */
+      static const size_t MIN_VFAT_RECORD = 3*sizeof(uint16_t) + sizeof(uint8_t) + 2*sizeof(uint16_t);
+
+      template <typename T>
+        inline char* put(char* out, T const value) {
+        std::memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+      };
+
+      template <typename T>
+        inline bool get(char const*& p, char const* end, T& value) {
+        if (end - p < static_cast<ptrdiff_t>(sizeof(T)))
+          return false;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+      };
+
+      /** write a VFAT record
+       * @param out room for at least MAX_VFAT_RECORD bytes
+       * @param zsMode GEB::ZSMode of the chamber
+       * @param nHits number of channels, ZS_FULL_PAYLOAD to write lsData and msData
+       * @param channels the nHits channels from zsEncodeChannels
+       * @retval returns the end of the record
+       */
+      inline char* putVFAT(char* out, VFATData const& vfat, bool const zsMode, uint8_t const nHits,
+                           uint8_t const* channels) {
+        out = put(out, vfat.BC);
+        out = put(out, vfat.EC);
+        out = put(out, vfat.ChipID);
+        if (zsMode)
+          out = put(out, nHits);
+        if (!zsMode || nHits == ZS_FULL_PAYLOAD) {
+          out = put(out, vfat.lsData);
+          out = put(out, vfat.msData);
+        } else {
+          std::memcpy(out, channels, nHits);
+          out += nHits;
+        }
+        out = put(out, vfat.BXfrOH);
+        return put(out, vfat.crc);
+      };
+
+      /** decode a VFAT record
+       * @retval returns false if the record is truncated or has more than ZS_MAX_SPARSE_HITS channels
+       */
+      inline bool getVFAT(char const*& p, char const* end, bool const zsMode, VFATData& vfat) {
+        uint8_t nHits = ZS_FULL_PAYLOAD;
+        if (!get(p, end, vfat.BC) || !get(p, end, vfat.EC) || !get(p, end, vfat.ChipID))
+          return false;
+        if (zsMode && !get(p, end, nHits))
+          return false;
+        if (nHits == ZS_FULL_PAYLOAD) {
+          if (!get(p, end, vfat.lsData) || !get(p, end, vfat.msData))
+            return false;
+        } else {
+          if (nHits > ZS_MAX_SPARSE_HITS || end - p < nHits)
+            return false;
+          zsDecodeChannels(reinterpret_cast<uint8_t const*>(p), nHits, vfat);
+          p += nHits;
+        }
+        return get(p, end, vfat.BXfrOH) && get(p, end, vfat.crc);
+      };
+
+      /** decode the next chamber of an event payload
+       * @retval returns false if the chamber is truncated, or has more blocks than a GEB can hold
+       */
+      inline bool getGEB(char const*& p, char const* end, GEBData& geb) {
+        if (!get(p, end, geb.header))
+          return false;
+        bool zsMode = GEB::ZSMode::get(geb.header);
+        uint64_t nVFATs = GEB::SumVFAT::get(geb.header);
+        if (nVFATs > GEBData::VFATs::capacity() || nVFATs*MIN_VFAT_RECORD > static_cast<uint64_t>(end - p))
+          return false;
+        geb.vfats.resize(nVFATs);
+        for (uint64_t i = 0; i < nVFATs; ++i)
+          if (!getVFAT(p, end, zsMode, geb.vfats[i]))
+            return false;
+        return get(p, end, geb.trailer);
+      };
+    }
+
+    /** Reader of "Bin" run files
+     * Reads the events in order, skipping corrupted records, and jumps to any event of a file
+     * opened in a seekable stream, through the index if the file has one.
+     *
+     *   std::ifstream file(name.c_str(), std::ios::binary);
+     *   gem::readout::RunFileReader reader(file);
+     *   std::vector<char> payload;
+     *   uint64_t event;
+     *   while (reader.next(payload, event)) {
+     *     char const* p = payload.data();
+     *     gem::readout::GEBData geb;
+     *     while (gem::readout::RunFile::getGEB(p, payload.data() + payload.size(), geb))
+     *       ...
+     *   }
+     */
+    class RunFileReader
+    {
+    public:
+      /** RunFileReader constructor, reads the file header
+       * @param in the file, opened in binary mode
+       */
+      RunFileReader(std::istream& in) :
+        in_(in),
+        valid_(false),
+        indexLoaded_(false),
+        hasIndex_(false),
+        resyncs_(0)
+      {
+        in_.read(reinterpret_cast<char*>(&header_), sizeof(header_));
+        valid_ = (in_.gcount() == sizeof(header_) && header_.magic == RunFile::MAGIC &&
+                  header_.version <= RunFile::VERSION && header_.headerSize >= sizeof(header_));
+        // skip the fields of a later version
+        if (valid_ && header_.headerSize > sizeof(header_))
+          in_.ignore(header_.headerSize - sizeof(header_));
+      };
+
+      /** false if the stream does not start with a run file header */
+      bool isValid() const { return valid_; };
+
+      RunFile::FileHeader const& getHeader() const { return header_; };
+
+      /** number of times the reader had to skip to the next sync record */
+      uint64_t getResyncs() const { return resyncs_; };
+
+      /** read the next event
+       * @param payload filled with the chambers of the event
+       * @param event number of the event
+       * @retval returns false at the end of the events
+       */
+      bool next(std::vector<char>& payload, uint64_t& event) {
+        if (!valid_)
+          return false;
+        for (;;) {
+          char record[sizeof(RunFile::EventHeader)];
+          in_.read(record, sizeof(record));
+          if (in_.gcount() != sizeof(record))
+            return false;
+
+          uint64_t magic;
+          std::memcpy(&magic, record, sizeof(magic));
+          if (magic == RunFile::INDEX_MAGIC)
+            return false;
+          if (magic == RunFile::SYNC_MAGIC)
+            continue;
+
+          RunFile::EventHeader header;
+          std::memcpy(&header, record, sizeof(header));
+          if (header.marker != RunFile::EVENT_MARKER || header.size > RunFile::MAX_EVENT_SIZE) {
+            ++resyncs_;
+            if (!resync(record + 1, sizeof(record) - 1))
+              return false;
+            continue;
+          }
+
+          payload.resize(header.size);
+          in_.read(payload.data(), header.size);
+          if (static_cast<uint32_t>(in_.gcount()) != header.size)
+            return false;
+          event = header.event;
+          return true;
+        }
+      };
+
+      /** true if the file was closed by its writer and has an index, needs a seekable stream */
+      bool hasIndex() {
+        if (!indexLoaded_)
+          loadIndex();
+        return hasIndex_;
+      };
+
+      /** offset of an event in the file, from the index
+       * @retval returns 0 if the file has no index or not that many events
+       */
+      uint64_t getOffset(uint64_t const& event) {
+        if (!hasIndex() || event >= offsets_.size())
+          return 0;
+        return offsets_[event];
+      };
+
+      /** position the reader so that next() returns the given event, needs a seekable stream
+       * @retval returns false if the file has no such event
+       */
+      bool seek(uint64_t const& event) {
+        if (!valid_)
+          return false;
+        if (hasIndex()) {
+          if (event >= offsets_.size())
+            return false;
+          in_.clear();
+          in_.seekg(offsets_[event]);
+          return in_.good();
+        }
+
+        // without an index, hop from record to record from the start
+        in_.clear();
+        in_.seekg(header_.headerSize);
+        for (;;) {
+          std::streampos start = in_.tellg();
+          char record[sizeof(RunFile::EventHeader)];
+          in_.read(record, sizeof(record));
+          if (in_.gcount() != sizeof(record))
+            return false;
+          uint64_t magic;
+          std::memcpy(&magic, record, sizeof(magic));
+          if (magic == RunFile::INDEX_MAGIC)
+            return false;
+          if (magic == RunFile::SYNC_MAGIC)
+            continue;
+          RunFile::EventHeader header;
+          std::memcpy(&header, record, sizeof(header));
+          if (header.marker != RunFile::EVENT_MARKER || header.size > RunFile::MAX_EVENT_SIZE) {
+            ++resyncs_;
+            if (!resync(record + 1, sizeof(record) - 1))
+              return false;
+            continue;
+          }
+          if (header.event == event) {
+            in_.seekg(start);
+            return in_.good();
+          }
+          in_.seekg(header.size, std::ios::cur);
+        }
+      };
+
+    private:
+      /** scan for the next sync record and leave the stream after it
+       * @param seen bytes already read after the start of the corrupted record
+       * @retval returns false if the end of the events was reached first
+       */
+      bool resync(char const* seen, size_t const nSeen) {
+        uint64_t window = 0;
+        size_t nBytes = 0;
+        for (size_t i = 0; ; ++i) {
+          int byte;
+          if (i < nSeen) {
+            byte = static_cast<uint8_t>(seen[i]);
+          } else {
+            byte = in_.get();
+            if (byte == std::istream::traits_type::eof())
+              return false;
+          }
+          window = (window >> 8) | (static_cast<uint64_t>(byte) << 56);
+          if (++nBytes < sizeof(window))
+            continue;
+          if (window == RunFile::INDEX_MAGIC)
+            return false;
+          if (window == RunFile::SYNC_MAGIC) {
+            // skip the event number of the sync record, part of it may be among the bytes already read
+            size_t fromSeen = (i + 1 < nSeen) ? std::min(nSeen - i - 1, sizeof(uint64_t)) : 0;
+            in_.ignore(sizeof(uint64_t) - fromSeen);
+            return true;
+          }
+        }
+      };
+
+      void loadIndex() {
+        indexLoaded_ = true;
+        hasIndex_ = false;
+        if (!valid_)
+          return;
+
+        std::streampos pos = in_.tellg();
+        in_.clear();
+        RunFile::FileTrailer trailer;
+        RunFile::IndexHeader index;
+        if (in_.seekg(-static_cast<std::streamoff>(sizeof(trailer)), std::ios::end) &&
+            in_.read(reinterpret_cast<char*>(&trailer), sizeof(trailer)) &&
+            trailer.magic == RunFile::TRAILER_MAGIC &&
+            in_.seekg(trailer.indexOffset) &&
+            in_.read(reinterpret_cast<char*>(&index), sizeof(index)) &&
+            index.magic == RunFile::INDEX_MAGIC && index.firstEvent == 0 && index.nEvents == trailer.nEvents) {
+          offsets_.resize(index.nEvents);
+          if (!offsets_.empty())
+            in_.read(reinterpret_cast<char*>(offsets_.data()), offsets_.size()*sizeof(uint64_t));
+          hasIndex_ = static_cast<bool>(in_);
+        }
+        if (!hasIndex_)
+          offsets_.clear();
+        in_.clear();
+        in_.seekg(pos);
+      };
+
+      std::istream& in_;
+      RunFile::FileHeader header_;
+      bool valid_;
+
+      bool indexLoaded_;
+      bool hasIndex_;
+      std::vector<uint64_t> offsets_;
+
+      uint64_t resyncs_;
+
+      // Prevent copying.
+      RunFileReader(RunFileReader const&);
+      RunFileReader& operator=(RunFileReader const&);
+    };
+
+  } //end namespace gem::readout
+} //end namespace gem
+#endif
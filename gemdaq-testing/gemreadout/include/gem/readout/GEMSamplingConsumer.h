@@ -0,0 +1,57 @@
+#ifndef gem_readout_GEMSamplingConsumer_h
+#define gem_readout_GEMSamplingConsumer_h
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gem/base/GEMReadoutConsumer.h"
+#include "gem/utils/Lock.h"
+
+namespace gem {
+  namespace readout {
+
+    /** Keeps a sample of the frames read out for monitoring, e.g. by the DQM
+     * Every prescale-th frame is kept by taking a duplicate reference to it, nothing is copied.
+     * At most maxSamples are kept, the oldest one is released to make room for a new one, so a
+     * monitoring client which is not keeping up only holds back a bounded part of the pool.
+     * takeSample() may be called from any thread.
+     */
+    class GEMSamplingConsumer : public gem::base::GEMReadoutConsumer
+    {
+    public:
+      /** GEMSamplingConsumer constructor
+       * @param maxSamples number of frames kept at most
+       * @param prescale one frame out of prescale is kept
+       */
+      GEMSamplingConsumer(size_t const& maxSamples, uint32_t const& prescale);
+      virtual ~GEMSamplingConsumer();
+
+      virtual void consume(toolbox::mem::Reference* frame);
+
+      /** the oldest sample, see GEMReadoutFrame for its layout
+       * @retval returns NULL if there is none, otherwise the caller owns the reference and releases it
+       */
+      toolbox::mem::Reference* takeSample();
+
+      size_t   getSamples();
+      uint64_t getSampled() const { return sampled_; };
+
+    private:
+      uint32_t prescale_;
+      uint64_t seen_;
+      uint64_t sampled_;
+
+      // protects the samples ring
+      gem::utils::Lock lock_;
+      std::vector<toolbox::mem::Reference*> samples_;
+      size_t firstSample_;
+      size_t nSamples_;
+
+      // Prevent copying.
+      GEMSamplingConsumer(GEMSamplingConsumer const&);
+      GEMSamplingConsumer& operator=(GEMSamplingConsumer const&);
+    };
+  }
+}
+#endif
@@ -0,0 +1,160 @@
+#ifndef gem_readout_GLIBReplay_h
+#define gem_readout_GLIBReplay_h
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "gem/hw/glib/HwGLIB.h"
+
+namespace gem {
+  namespace readout {
+
+    struct VFATData;
+    class GEMDataGenerator;
+
+    /** GLIB without hardware, replaying a recorded raw data file or synthetic events
+     * The chambers of a "Hex" or "Bin" file, compressed or not, or of the events made by a
+     * GEMDataGenerator, are turned into tracking data blocks on the link given by their ChamID,
+     * with the OptoHybrid BX in the trigger data word, and the trigger and tracking data readout
+     * of HwGLIB serves them as if they were coming out of the tracking data FIFOs. Everything
+     * built on HwGLIB, the GEMDataParker and the readout loops of the supervisor, then runs
+     * unchanged and as fast as it can:
+     *
+     *   gem::readout::GLIBReplay glib("GEM_DAQ_run.dat");
+     *   glib.setRate(100000);   // events per second, 0 for as fast as they are read
+     *   glib.start();
+     *   gem::readout::GEMDataParker parker(glib, "replayed.dat", "Bin", glib.getLinkMask(), 100);
+     *   while (!glib.isDone())
+     *     parker.dumpDataToDisk();
+     *
+     * Events are emitted at the configured rate, in bursts of a configurable number of events.
+     * With a FIFO depth set, the blocks of a link that do not fit in its FIFO when they are
+     * emitted are lost, as on the GLIB, and counted. Emission is evaluated each time a FIFO is
+     * looked at, so a loss is seen at the resolution of the readout calls.
+     * The links may be read out from different threads, each link from only one at a time.
+     * Blocks thrown away by flushFIFO are counted with the lost ones.
+     */
+    class GLIBReplay : public gem::hw::glib::HwGLIB
+    {
+    public:
+      static const uint8_t MAX_LINKS = 3;
+
+      /** GLIBReplay constructor, reads the whole file into memory
+       * @param fileName raw data file to replay
+       */
+      GLIBReplay(std::string const& fileName);
+
+      /** GLIBReplay constructor, makes the events to replay with a generator
+       * @param generator settings of the events, it is left after the last one
+       * @param nEvents number of events, replayed in each pass
+       */
+      GLIBReplay(gem::readout::GEMDataGenerator& generator, uint64_t const& nEvents);
+      ~GLIBReplay();
+
+      /** the file was read and has events */
+      virtual bool isHwConnected() { return nEvents_ != 0; };
+
+      /** average emission rate, to be set before start()
+       * @param eventsPerSecond events per second, 0 to have every event ready from the start
+       */
+      void setRate(double const& eventsPerSecond) { rate_ = eventsPerSecond; };
+
+      /** number of events emitted together, the bursts are spaced to keep the average rate */
+      void setBurst(uint32_t const& eventsPerBurst) { burst_ = eventsPerBurst ? eventsPerBurst : 1; };
+
+      /** tracking data FIFO depth of each link in VFAT blocks, 0 for no limit */
+      void setFIFODepth(uint32_t const& blocks) { fifoDepth_ = blocks; };
+
+      /** number of passes over the file, 0 to replay it until the readout stops */
+      void setLoops(uint32_t const& loops) { loops_ = loops; };
+
+      /** empty the FIFOs and start emitting the events of the file from the first one
+       */
+      void start();
+
+      /** every event of every pass was emitted and read out, lost or flushed
+       * may be called from any thread
+       */
+      bool isDone();
+
+      /** readout mask with the links found in the file */
+      uint8_t getLinkMask() const;
+
+      uint64_t getFileEvents() const { return nEvents_; };
+      /** events emitted since start() */
+      uint64_t getEventsEmitted();
+      uint64_t getBlocksRead(uint8_t const& link) const;
+      uint64_t getBlocksLost(uint8_t const& link) const;
+      uint64_t getBlocksRead() const;
+      uint64_t getBlocksLost() const;
+
+      // HwGLIB readout
+      virtual uint32_t readTriggerFIFO(uint8_t const& link);
+      virtual void flushTriggerFIFO(uint8_t const& link);
+      virtual uint32_t getFIFOOccupancy(uint8_t const& link);
+      virtual bool hasTrackingData(uint8_t const& link);
+      using gem::hw::glib::HwGLIB::getTrackingData;
+      virtual void getTrackingData(uint8_t const& link, std::vector<uint32_t>& data);
+      using gem::hw::glib::HwGLIB::drainTrackingFIFO;
+      virtual uint32_t drainTrackingFIFO(uint8_t const& link, uint32_t const& maxBlocks, uint32_t* data);
+      virtual void flushFIFO(uint8_t const& link);
+
+    private:
+      /** blocks of the stream of one link, positions count over all the passes */
+      typedef std::pair<uint64_t, uint64_t> BlockRange;
+
+      struct Link {
+        std::vector<uint32_t> words;      // TRACKING_BLOCK_WORDS per block, one pass over the file
+        std::vector<uint64_t> eventEnd;   // blocks of the link in events [0, i], per event of the file
+        std::deque<BlockRange> fifo;      // blocks in the FIFO, in order, [first, last)
+        uint64_t emitted;                 // blocks handed to the FIFO or lost
+        std::atomic<uint64_t> read;
+        std::atomic<uint64_t> lost;       // did not fit in the FIFO, or flushed
+        uint32_t triggerWord;             // trigger data word of the last block read
+      };
+
+      /** decode the file into the blocks of the links */
+      void load(std::string const& fileName);
+
+      /** make the blocks of the links with a generator */
+      void load(gem::readout::GEMDataGenerator& generator, uint64_t const& nEvents);
+
+      /** append a block to the stream of a link, and close the event on every link */
+      void addBlock(uint8_t const& link, gem::readout::VFATData const& vfat);
+      void endEvent();
+
+      /** report what was loaded */
+      void loaded(std::string const& source);
+
+      /** events emitted by now */
+      uint64_t eventsDue();
+
+      /** move the blocks emitted by now into the FIFO of a link
+       * @retval returns the FIFO occupancy
+       */
+      uint64_t update(uint8_t const& link);
+
+      /** blocks of a link in the first nEvents events of the stream */
+      uint64_t linkBlocks(Link const& link, uint64_t const& nEvents) const;
+
+      std::string fileName_;
+      uint64_t nEvents_;
+      Link links_[MAX_LINKS];
+
+      double   rate_;
+      uint32_t burst_;
+      uint32_t fifoDepth_;
+      uint32_t loops_;
+      double   startNs_;
+
+      // Prevent copying.
+      GLIBReplay(GLIBReplay const&);
+      GLIBReplay& operator=(GLIBReplay const&);
+    };
+  }
+}
+#endif
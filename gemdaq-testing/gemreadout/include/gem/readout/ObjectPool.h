@@ -0,0 +1,52 @@
+#ifndef gem_readout_ObjectPool_h
+#define gem_readout_ObjectPool_h
+
+#include <memory>
+#include <vector>
+#include <stddef.h>
+
+namespace gem {
+  namespace readout {
+
+    /** Objects handed out and taken back for reuse, so a steady readout loop does not allocate
+     * New objects are only made while more are in use than ever before. An object comes back
+     * as it was released, the caller resets what it needs. Not thread safe: one pool per
+     * readout thread, e.g. owned by the GEMEventBuilder of a parker.
+     */
+    template <typename T>
+      class ObjectPool
+      {
+      public:
+        ObjectPool() {};
+
+        /** an object to use until it is released */
+        T* acquire() {
+          if (free_.empty()) {
+            objects_.push_back(std::shared_ptr<T>(new T()));
+            free_.reserve(objects_.size());
+            return objects_.back().get();
+          }
+          T* object = free_.back();
+          free_.pop_back();
+          return object;
+        };
+
+        /** give back an object acquired from this pool */
+        void release(T* object) { free_.push_back(object); };
+
+        /** objects made so far */
+        size_t size()      const { return objects_.size(); };
+        /** objects ready to be acquired without allocating */
+        size_t available() const { return free_.size(); };
+
+      private:
+        std::vector<std::shared_ptr<T> > objects_;
+        std::vector<T*> free_;
+
+        // Prevent copying.
+        ObjectPool(ObjectPool const&);
+        ObjectPool& operator=(ObjectPool const&);
+      };
+  }
+}
+#endif
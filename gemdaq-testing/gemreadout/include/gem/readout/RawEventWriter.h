@@ -0,0 +1,175 @@
+#ifndef gem_readout_RawEventWriter_h
+#define gem_readout_RawEventWriter_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace readout {
+
+    /** Long lived writer for the raw data file
+     * keeps a single file descriptor open for the whole run and collects
+     * complete events in a user space buffer, which is written out in large
+     * blocks aligned to WRITE_ALIGNMENT bytes.
+     * Nothing reaches the disk in the middle of an event, the remaining
+     * (unaligned) tail is only written by flush() or close()
+     *
+     * With compression enabled, the buffer is instead cut into chunks of whole events which
+     * are handed to a pool of worker threads, compressed into the frames described in
+     * GEMDataCompression.h and written out in the order they were cut. The thread calling
+     * commitEvent() only ever copies bytes, unless the workers fall so far behind that
+     * MAX_CHUNKS_PER_THREAD chunks per worker are waiting.
+     */
+    class RawEventWriter
+    {
+    public:
+      static const size_t WRITE_ALIGNMENT     = 4096;
+      static const size_t DEFAULT_BUFFER_SIZE = 4*1024*1024;
+      static const size_t DEFAULT_CHUNK_SIZE  = 1024*1024;
+      static const size_t MAX_CHUNKS_PER_THREAD = 2;
+
+      /** RawEventWriter constructor
+       * @param fileName file to write the data to, an existing file of this name is truncated
+       * @param bufferSize number of bytes to accumulate before writing to disk
+       */
+      RawEventWriter(std::string const& fileName, size_t const& bufferSize=DEFAULT_BUFFER_SIZE);
+      ~RawEventWriter();
+
+      /** open the output file, called by the constructor
+       * the first open truncates the file, later ones (after close()) append to it
+       * @retval returns true if the file descriptor is valid
+       */
+      bool open();
+
+      /** add bytes to the event currently being built
+       * @param data pointer to the bytes to store
+       * @param nBytes number of bytes to store
+       */
+      void append(void const* data, size_t const& nBytes);
+      void append(std::string const& data) { append(data.data(), data.size()); };
+
+      /** mark the end of the current event
+       * once the buffer reaches its nominal size, the aligned part of it is written to disk
+       */
+      void commitEvent();
+
+      /** write everything in the buffer to disk, including a partially built event
+       * to be called when the run is stopped
+       */
+      void flush();
+
+      /** flush the buffer and close the file descriptor
+       * the part of a preallocation that was not filled is given back first
+       */
+      void close();
+
+      /** reserve disk space for the file, so it is laid out in one piece however slowly it fills
+       * the file size is not changed, the data is still appended at its end
+       * @param nBytes number of bytes the file is expected to reach
+       * @retval returns false if the file system cannot preallocate, the file is then written as before
+       */
+      bool preallocate(uint64_t const& nBytes);
+
+      /** compress the output from now on, what is in the buffer is written out uncompressed first
+       * @param level zlib compression level, 1 (fastest) to 9, 0 to stop compressing
+       * @param nThreads number of compression threads
+       * @param chunkSize number of bytes of events compressed in one frame
+       */
+      void setCompression(int const& level, unsigned const& nThreads, size_t const& chunkSize=DEFAULT_CHUNK_SIZE);
+
+      bool isOpen() const { return fd_ >= 0; };
+
+      std::string const& getFileName()  const { return fileName_;     };
+      uint64_t getBytesWritten()        const { return bytesWritten_.load(); };
+      uint64_t getEventsWritten()       const { return eventsWritten_; };
+      uint32_t getWriteErrors()         const { return writeErrors_.load();  };
+      /** bytes of events handed to the compression, getBytesWritten() counts the bytes on disk */
+      uint64_t getBytesCompressed()     const { return bytesCompressed_; };
+      /** number of times commitEvent() had to wait for the compression threads */
+      uint32_t getCompressionStalls()   const { return compressionStalls_; };
+
+    private:
+      /** write the first nBytes of the buffer and move the remainder to the front
+       * @param nBytes number of bytes to write
+       */
+      void writeOut(size_t const& nBytes);
+
+      /** write bytes to the file, retrying on EINTR
+       * @retval returns the number of bytes written
+       */
+      size_t writeBytes(char const* data, size_t const& nBytes);
+
+      /** free the preallocated blocks past the end of the file */
+      void releasePreallocation();
+
+      /** events between two calls of cutChunk() */
+      struct Chunk {
+        uint64_t seq;
+        uint64_t firstEvent;
+        uint32_t nEvents;
+        size_t size;
+        std::vector<char> data;
+        std::vector<char> frame;
+      };
+
+      /** hand the buffer to the compression threads and start a new one */
+      void cutChunk();
+
+      /** wait until every chunk cut so far is on disk */
+      void drainChunks();
+
+      void compressLoop();
+      void stopCompression();
+
+      log4cplus::Logger gemLogger_;
+
+      std::string fileName_;
+      int fd_;
+      bool created_; // the file was opened (and truncated) once already
+
+      std::vector<char> buffer_;
+      size_t bufferSize_;
+      size_t used_;
+
+      // also updated by the compression threads, read by the monitoring while they run
+      std::atomic<uint64_t> bytesWritten_;
+      uint64_t eventsWritten_;
+      std::atomic<uint32_t> writeErrors_;
+      uint64_t preallocated_;
+
+      int compressionLevel_;
+      size_t chunkSize_;
+      uint64_t chunkFirstEvent_;
+      uint64_t bytesCompressed_;
+      uint32_t compressionStalls_;
+
+      std::vector<std::thread> workers_;
+      std::mutex chunkMutex_;
+      std::condition_variable chunkReady_;
+      std::condition_variable chunkDone_;
+      std::deque<std::shared_ptr<Chunk> > queue_;         // cut, waiting for a worker
+      std::map<uint64_t, std::shared_ptr<Chunk> > done_;  // compressed, waiting for the ones before
+      std::vector<std::shared_ptr<Chunk> > spare_;        // written, buffers kept for reuse
+      size_t inFlight_;
+      uint64_t nextSeq_;
+      uint64_t nextWrite_;
+      bool writing_;
+      bool stopWorkers_;
+
+      // Prevent copying.
+      RawEventWriter(RawEventWriter const&);
+      RawEventWriter& operator=(RawEventWriter const&);
+    };
+  }
+}
+#endif
@@ -0,0 +1,80 @@
+#ifndef gem_readout_RunFileWriter_h
+#define gem_readout_RunFileWriter_h
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+#include "gem/readout/GEMRunFile.h"
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace readout {
+
+    class RawEventWriter;
+
+    /** Writer of the "Bin" run files described in GEMRunFile.h
+     * Frames the events handed to it in length prefixed records with periodic sync records,
+     * on top of a RawEventWriter, and keeps the offset of every event for the index written
+     * at close(). The file header is written with the first event, so the run information
+     * can be set up to then.
+     * Offsets count from the file header, which must be the first thing in the file.
+     */
+    class RunFileWriter
+    {
+    public:
+      /** RunFileWriter constructor
+       * @param writer output file, empty
+       */
+      RunFileWriter(std::shared_ptr<gem::readout::RawEventWriter> writer);
+      ~RunFileWriter();
+
+      /** run number for the file header, ignored once the first event is written */
+      void setRunNumber(uint32_t const& runNumber);
+
+      /** place the file in a run written in segments, ignored once the first event is written
+       * @param segment number of the segment, from 0
+       * @param firstEvent number of events of the run in the segments before this one
+       */
+      void setSegment(uint16_t const& segment, uint64_t const& firstEvent);
+
+      /** add a board to the file header, ignored once the first event is written */
+      void addBoard(uint16_t const& boardID);
+
+      /** write one event
+       * @param payload the chambers of the event, in the format described in GEMRunFile.h
+       * @param nBytes size of the payload
+       */
+      void writeEvent(char const* payload, size_t const& nBytes);
+
+      /** write the index and the trailer, nothing can be written afterwards
+       * they reach the disk with the next RawEventWriter::flush() or close()
+       */
+      void close();
+
+      bool isHeaderWritten()     const { return headerWritten_; };
+      uint64_t getEventsWritten() const { return nEvents_; };
+
+    private:
+      void writeHeader();
+      void append(void const* data, size_t const& nBytes);
+
+      log4cplus::Logger gemLogger_;
+
+      std::shared_ptr<gem::readout::RawEventWriter> writer_;
+
+      RunFile::FileHeader header_;
+      bool headerWritten_;
+      bool closed_;
+
+      uint64_t offset_;
+      uint64_t nEvents_;
+      std::vector<uint64_t> offsets_;
+
+      // Prevent copying.
+      RunFileWriter(RunFileWriter const&);
+      RunFileWriter& operator=(RunFileWriter const&);
+    };
+  }
+}
+#endif
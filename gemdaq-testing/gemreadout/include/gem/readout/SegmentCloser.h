@@ -0,0 +1,72 @@
+#ifndef gem_readout_SegmentCloser_h
+#define gem_readout_SegmentCloser_h
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <stdint.h>
+
+#include "gem/utils/GEMLogging.h"
+
+namespace gem {
+  namespace readout {
+
+    class RawEventWriter;
+
+    /** Closes the completed segments of a run in the background
+     * The readout hands a segment over as soon as its last event is appended and goes on filling
+     * the next one. The closer thread flushes what is still buffered, gives back the unused
+     * preallocation and renames the file into the closed directory, where the DQM picks it up:
+     * a file in there is complete and is not written to any more.
+     */
+    class SegmentCloser
+    {
+    public:
+      /** SegmentCloser constructor
+       * @param closedDir directory the closed segments are moved to, created if it does not exist
+       */
+      SegmentCloser(std::string const& closedDir);
+
+      /** closes every segment handed over so far */
+      ~SegmentCloser();
+
+      /** close a segment and move it to the closed directory
+       * @param writer the segment, not to be used by the caller any more
+       */
+      void hand(std::shared_ptr<gem::readout::RawEventWriter> writer);
+
+      /** wait until every segment handed over so far is closed */
+      void drain();
+
+      std::string const& getClosedDir() const { return closedDir_; };
+      uint32_t getSegmentsClosed() const;
+
+    private:
+      void closeLoop();
+
+      /** close one segment and rename it into closedDir_ */
+      void closeSegment(gem::readout::RawEventWriter& writer);
+
+      log4cplus::Logger gemLogger_;
+
+      std::string closedDir_;
+
+      std::thread thread_;
+      mutable std::mutex mutex_;
+      std::condition_variable ready_;
+      std::condition_variable done_;
+      std::deque<std::shared_ptr<gem::readout::RawEventWriter> > queue_;
+      bool closing_;
+      bool stop_;
+      uint32_t segmentsClosed_;
+
+      // Prevent copying.
+      SegmentCloser(SegmentCloser const&);
+      SegmentCloser& operator=(SegmentCloser const&);
+    };
+  }
+}
+#endif
@@ -1,24 +1,81 @@
 #include "gem/datachecker/GEMDataChecker.h"
-//#include "gem/readout/GEMDataAMCformat.h"
 
-#include <boost/utility/binary.hpp>
-#include <bitset>
+#include <cstring>
+#include <iomanip>
 
-#include <sstream>
-#include <vector>
+// Main constructor
+gem::datachecker::GEMDataChecker::GEMDataChecker() :
+  checkCRC_(true)
+{
+  std::memset(slot_, NO_SLOT, sizeof(slot_));
+  std::memset(hasMap_, 0, sizeof(hasMap_));
+  reset();
+}
 
-int counter_vfats_ = 0;
-int event_counter_ = 0;
+void gem::datachecker::GEMDataChecker::setChipSlot(uint8_t const& link, uint8_t const& slot, uint16_t const& chipID)
+{
+  if (link >= MAX_LINKS || slot >= MAX_CHIPS)
+    return;
+  slot_[link][gem::readout::VFAT::ChipID::get(chipID)] = slot;
+  hasMap_[link] = true;
+}
 
-// Main constructor
-gem::datachecker::GEMDataChecker::GEMDataChecker(gem::readout::GEMData& gem, gem::readout::GEBData& geb, 
-                                                 gem::readout::VFATData& vfat)
+void gem::datachecker::GEMDataChecker::reset()
 {
-  event_counter_ = 0;
+  std::memset(lastEC_,    0, sizeof(lastEC_));
+  std::memset(seen_,      0, sizeof(seen_));
+  std::memset(eventEC_,   0, sizeof(eventEC_));
+  std::memset(eventBC_,   0, sizeof(eventBC_));
+  std::memset(eventSeen_, 0, sizeof(eventSeen_));
+  std::memset(blocks_,    0, sizeof(blocks_));
+  std::memset(errors_,    0, sizeof(errors_));
+  nBlocks_    = 0;
+  nBadBlocks_ = 0;
+}
+
+uint64_t gem::datachecker::GEMDataChecker::getErrors(Check const& check) const
+{
+  uint64_t total = 0;
+  for (unsigned link = 0; link < MAX_LINKS; ++link)
+    for (unsigned slot = 0; slot <= MAX_CHIPS; ++slot)
+      total += errors_[link][slot][check];
+  return total;
+}
+
+void gem::datachecker::GEMDataChecker::report(std::ostream& out) const
+{
+  out << nBadBlocks_ << " of " << nBlocks_ << " VFAT blocks failed a check" << std::endl;
+  for (unsigned link = 0; link < MAX_LINKS; ++link)
+    for (unsigned slot = 0; slot <= MAX_CHIPS; ++slot) {
+      bool bad = false;
+      for (unsigned check = 0; check < N_CHECKS; ++check)
+        bad |= (errors_[link][slot][check] != 0);
+      if (!bad)
+        continue;
+
+      out << "  link " << link << " ";
+      if (slot == MAX_CHIPS)
+        out << "unknown chips";
+      else
+        out << "slot " << std::setw(2) << slot;
+      out << " blocks " << blocks_[link][slot];
+      for (unsigned check = 0; check < N_CHECKS; ++check)
+        if (errors_[link][slot][check])
+          out << " " << checkName(static_cast<Check>(check)) << " " << errors_[link][slot][check];
+      out << std::endl;
+    }
 }
 
-int gem::datachecker::GEMDataChecker::counterGEMdata(gem::readout::GEMData& gem, gem::readout::GEBData& geb, 
-                                                     gem::readout::VFATData& vfat)
+char const* gem::datachecker::GEMDataChecker::checkName(Check const& check)
 {
-  return event_counter_;
+  switch (check) {
+  case CONTROL_1010: return "1010";
+  case CONTROL_1100: return "1100";
+  case CONTROL_1110: return "1110";
+  case CRC:          return "CRC";
+  case EC_JUMP:      return "EC";
+  case BC_MISMATCH:  return "BC";
+  case UNKNOWN_CHIP: return "ChipID";
+  default:           return "?";
+  }
 }
@@ -1,5 +1,10 @@
 #include "gem/readout/GEMDataParker.h"
 #include "gem/readout/GEMDataAMCformat.h"
+#include "gem/datachecker/GEMDataChecker.h"
+#include "gem/readout/RawEventWriter.h"
+#include "gem/readout/RunFileWriter.h"
+#include "gem/readout/SegmentCloser.h"
+#include "gem/readout/GEMEventBuilder.h"
 #include "gem/hw/glib/HwGLIB.h"
 
 #include <boost/utility/binary.hpp>
@@ -16,62 +21,217 @@
 
 #include "gem/utils/GEMLogging.h"
 
-int counterVFATs_ = 0;
-uint64_t ZSFlag = 0;
-bool dumpGEMevent_ = false;
+// passed by reference to drainTrackingFIFO, so it needs a definition
+const uint32_t gem::readout::GEMDataParker::MAX_BLOCKS_PER_DRAIN;
 
 // Main constructor
 gem::readout::GEMDataParker::GEMDataParker(gem::hw::glib::HwGLIB& glibDevice,
                                            std::string const& outFileName,
-                                           std::string const& outputType) :
-  gemLogger_(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:GEMDataParker")))
+                                           std::string const& outputType,
+                                           uint8_t const& readoutMask,
+                                           uint32_t const& eventTimeout) :
+  gemLogger_(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:GEMDataParker"))),
+  compressionLevel_(0),
+  compressionThreads_(0),
+  runNumber_(0),
+  segmentMaxBytes_(0),
+  segmentMaxEvents_(0),
+  segmentMaxSeconds_(0),
+  segment_(0),
+  segmentBytes_(0),
+  segmentEvents_(0),
+  segmentStart_(0),
+  runEvents_(0)
 {
   //gemLogger_   = log4cplus::Logger::getInstance("gem:readout:GEMDataParker");
   glibDevice_  = &glibDevice;
   outFileName_ = outFileName;
   outputType_  = outputType;
+  readoutMask_ = readoutMask;
   counter_ = {0,0,0};
   vfat_ = 0;
   event_ = 0;
   sumVFAT_ = 0;
+  zeroSuppression_ = false;
+
+  builder_.reset(new gem::readout::GEMEventBuilder(readoutMask_, eventTimeout));
+  checker_.reset(new gem::datachecker::GEMDataChecker());
+  builtEvent_.reset(new gem::readout::GEMData());
+
+  // the output file is opened with the first event, once the settings are known
 }
 
-int *gem::readout::GEMDataParker::dumpDataToDisk(uint8_t const& link)
+gem::readout::GEMDataParker::~GEMDataParker()
 {
-  // Book GEM Data format
-  gem::readout::GEMData  gem;
-  gem::readout::GEBData  geb;
-  gem::readout::VFATData vfat;
-  
-  // get GLIB data from one VFAT chip, as it's (update that part for MP7 when it'll be)
-  dumpGEMevent_ = false;
-  vfat_ = gem::readout::GEMDataParker::getGLIBData(link, gem, geb, vfat);
-  
-  // Write GEM Data to Disk, when GEM event is off
-  if ( dumpGEMevent_ ) {
-    event_++;
-    gem::readout::GEMDataParker::writeGEMevent(gem, geb, vfat);
+  // a run without events still leaves its single file behind, segments are only made for events
+  if (!writer_ && !closer_)
+    openOutput();
+  closeOutput();
+  // waits for the last segments to be closed
+  closer_.reset();
+}
+
+void gem::readout::GEMDataParker::flush()
+{
+  // whatever is still pending will not be completed any more
+  builder_->flush();
+  writeBuiltEvents();
+  if (builder_->getIncompleteEvents())
+    WARN("flush:: " << builder_->getIncompleteEvents() << " of " << builder_->getBuiltEvents()
+         << " events were written without data from every link");
+  if (checker_->getBadBlocks()) {
+    std::stringstream report;
+    checker_->report(report);
+    WARN("flush:: " << report.str());
+  }
+
+  if (closer_) {
+    // the segment is complete as far as this run is concerned, the next event starts a new one
+    closeOutput();
+    closer_->drain();
+  } else if (writer_) {
+    writer_->flush();
+  }
+}
+
+size_t gem::readout::GEMDataParker::getPendingEvents() const
+{
+  return builder_->getPendingEvents();
+}
+
+void gem::readout::GEMDataParker::setCompression(int const& level, unsigned const& nThreads)
+{
+  compressionLevel_   = level;
+  compressionThreads_ = nThreads;
+  if (writer_)
+    writer_->setCompression(level, nThreads);
+}
+
+void gem::readout::GEMDataParker::setChipSlot(uint8_t const& link, uint8_t const& slot, uint16_t const& chipID)
+{
+  checker_->setChipSlot(link, slot, chipID);
+}
+
+void gem::readout::GEMDataParker::setRunNumber(uint32_t const& runNumber)
+{
+  runNumber_ = runNumber;
+  if (runFile_)
+    runFile_->setRunNumber(runNumber);
+}
+
+void gem::readout::GEMDataParker::setSegmentation(uint64_t const& maxBytes, uint64_t const& maxEvents,
+                                                  uint32_t const& maxSeconds, std::string const& closedDir)
+{
+  if (writer_) {
+    WARN("setSegmentation:: " << writer_->getFileName() << " is already being written, ignored");
+    return;
   }
+  segmentMaxBytes_   = maxBytes;
+  segmentMaxEvents_  = maxEvents;
+  segmentMaxSeconds_ = maxSeconds;
+  if (!maxBytes && !maxEvents && !maxSeconds) {
+    closer_.reset();
+    return;
+  }
+  closer_.reset(new gem::readout::SegmentCloser(closedDir));
+  INFO("setSegmentation:: new segment of " << outFileName_ << " every " << maxBytes << " bytes, "
+       << maxEvents << " events or " << maxSeconds << " s, closed segments go to " << closer_->getClosedDir());
+}
+
+void gem::readout::GEMDataParker::openOutput()
+{
+  std::string fileName = outFileName_;
+  if (closer_) {
+    // <name>_NNNN.dat, the segment number goes before the extension
+    std::string::size_type dot   = outFileName_.rfind('.');
+    std::string::size_type slash = outFileName_.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+      dot = outFileName_.size();
+    std::stringstream segmentName;
+    segmentName << outFileName_.substr(0, dot) << "_" << std::setfill('0') << std::setw(4) << segment_
+                << outFileName_.substr(dot);
+    fileName = segmentName.str();
+  }
+
+  writer_.reset(new gem::readout::RawEventWriter(fileName));
+  if (segmentMaxBytes_)
+    writer_->preallocate(segmentMaxBytes_);
+  if (compressionLevel_)
+    writer_->setCompression(compressionLevel_, compressionThreads_);
+  if (outputType_ != "Hex") {
+    runFile_.reset(new gem::readout::RunFileWriter(writer_));
+    runFile_->setRunNumber(runNumber_);
+    if (closer_)
+      runFile_->setSegment(segment_, runEvents_);
+  }
+
+  segmentBytes_  = 0;
+  segmentEvents_ = 0;
+  segmentStart_  = time(0);
+}
+
+void gem::readout::GEMDataParker::closeOutput()
+{
+  if (!writer_)
+    return;
+
+  // closing the run file writes its index, closing the writer flushes whatever is still buffered
+  runFile_.reset();
+  if (closer_) {
+    closer_->hand(writer_);
+    runEvents_ += segmentEvents_;
+    ++segment_;
+  }
+  writer_.reset();
+}
+
+bool gem::readout::GEMDataParker::segmentComplete() const
+{
+  return (segmentMaxBytes_   && segmentBytes_  >= segmentMaxBytes_) ||
+         (segmentMaxEvents_  && segmentEvents_ >= segmentMaxEvents_) ||
+         (segmentMaxSeconds_ && time(0) - segmentStart_ >= static_cast<time_t>(segmentMaxSeconds_));
+}
+
+uint64_t gem::readout::GEMDataParker::getCRCErrors() const
+{
+  return checker_->getErrors(gem::datachecker::GEMDataChecker::CRC);
+}
+
+int *gem::readout::GEMDataParker::dumpDataToDisk()
+{
+  gem::readout::VFATData vfat;
+
+  // get GLIB data from all the links, the event builder merges them by BX/EC
+  for (uint8_t link = 0; link < gem::readout::GEMEventBuilder::MAX_LINKS; ++link)
+    if ((readoutMask_ >> link) & 0x1)
+      vfat_ = gem::readout::GEMDataParker::getGLIBData(link, vfat);
+
+  // Write GEM Data to Disk, for every complete GEM event
+  writeBuiltEvents();
 
   counter_[0] = vfat_;
   counter_[1] = event_;
-  counter_[2] = (0x000000000fffffff & geb.header);
+  counter_[2] = sumVFAT_;
 
   int *point = &counter_[0]; 
 
   return point;
 }
 
-int gem::readout::GEMDataParker::getGLIBData(uint8_t const& link, 
-                                             gem::readout::GEMData& gem, gem::readout::GEBData& geb, gem::readout::VFATData& vfat)
+int gem::readout::GEMDataParker::writeBuiltEvents()
 {
-  // Book VFAT variables
-  bool     isFirst = true;
-  uint8_t  SBit, flags;
-  uint16_t bcn, evn, chipid, crc;
-  uint32_t BXfrOH, BXOHexp, TrigReg, BXOHTrig;
-  uint64_t msData, lsData;
+  int nEvents = 0;
+  while (builder_->popEvent(*builtEvent_)) {
+    event_++;
+    nEvents++;
+    gem::readout::GEMDataParker::fillGEMevent(*builtEvent_);
+    gem::readout::GEMDataParker::writeGEMevent(*builtEvent_);
+  }
+  return nEvents;
+}
 
+int gem::readout::GEMDataParker::getGLIBData(uint8_t const& link, gem::readout::VFATData& vfat)
+{
   // GLIB data buffer validation
   /*
     boost::format linkForm("LINK%d");
@@ -91,282 +251,250 @@ int gem::readout::GEMDataParker::getGLIBData(uint8_t const& link,
     "bufferDepth[2] = " << std::hex << fifoDepth[2] << std::dec);
   */
 
-  /** the FIFO depth is not reliable */
-  int bufferDepth = 0;
+  /** the FIFO depth is not reliable, drainTrackingFIFO only returns the blocks flagged with DATA_RDY */
+  uint32_t nBlocks = glibDevice_->drainTrackingFIFO(link, MAX_BLOCKS_PER_DRAIN, blocks_);
+  DEBUG(" blocks read = " << nBlocks);
+
+  // For each batch of VFAT blocks drained from the GLIB data buffer
+  while (nBlocks) {
+    gem::readout::GEMDataParker::decodeBlocks(link, &blocks_[0], nBlocks, vfat);
+    nBlocks = glibDevice_->drainTrackingFIFO(link, MAX_BLOCKS_PER_DRAIN, blocks_);
+  }//closes while loop
+  
+  return vfat_;
+}
 
-  bufferDepth = glibDevice_->getFIFOOccupancy(link);
-  INFO(" bufferDepth = " << std::hex << bufferDepth << std::dec);
+int *gem::readout::GEMDataParker::processBlocks(uint8_t const& link, uint32_t const* blocks, uint32_t const& nBlocks)
+{
+  gem::readout::VFATData vfat;
+  if (nBlocks)
+    gem::readout::GEMDataParker::decodeBlocks(link, blocks, nBlocks, vfat);
 
-  // For each event in GLIB data buffer
-  // should probably switch this while with the next if, to ensure that there is actually a value in the vector
-  while (bufferDepth) {
-    std::vector<uint32_t> data;
+  // also releases the events which timed out
+  writeBuiltEvents();
 
-    if (glibDevice_->hasTrackingData(link)) {
+  counter_[0] = vfat_;
+  counter_[1] = event_;
+  counter_[2] = sumVFAT_;
+  return &counter_[0];
+}
 
-      data = glibDevice_->getTrackingData(link);
-      //for (int word = 0; word < 7; ++word) {
-      //	std::stringstream ss9;
-      //	ss9 << "DATA." << word;
-      //	data.push_back(glibDevice_->readReg(glibDevice_->getDeviceBaseNode(),ss9.str()));
-      //}
-    }
+void gem::readout::GEMDataParker::decodeBlocks(uint8_t const& link, uint32_t const* blocks, uint32_t const& nBlocks,
+                                               gem::readout::VFATData& vfat)
+{
+  for (uint32_t iBlock = 0; iBlock < nBlocks; ++iBlock) {
+    // data[0-6] are the tracking data words, data[7] the trigger data word
+    uint32_t const* data = blocks + iBlock*gem::hw::glib::HwGLIB::TRACKING_BLOCK_WORDS;
 
     // read trigger data
-    TrigReg = glibDevice_->readTriggerFIFO(link);
-    BXOHTrig = TrigReg >> 6;
-    SBit = TrigReg & 0x0000003F;
-
-    uint16_t b1010, b1100, b1110;
-    b1010 = ((data.at(5) & 0xF0000000)>>28);
-    b1100 = ((data.at(5) & 0x0000F000)>>12);
-    b1110 = ((data.at(4) & 0xF0000000)>>28);
-	
-    if (!(((b1010 == 0xa) && (b1100==0xc) && (b1110==0xe)))) {
+    uint32_t BXOHTrig = gem::readout::TRK::TrigBX::get(data[7]);
+    uint8_t  SBit     = gem::readout::TRK::SBit::get(data[7]);
+    DEBUG(" BXOHTrig " << BXOHTrig << " SBit " << (int)SBit);
+
+    gem::readout::decodeTrackingBlock(data, vfat);
+
+    // validate every block, bad blocks are counted and kept
+    uint32_t errors = checker_->checkBlock(link, vfat);
+    if (errors & gem::datachecker::GEMDataChecker::CONTROL_BITS_ERRORS) {
       WARN("VFAT headers do not match expectation");
       /* do not ignore incorrect data
-         bufferDepth = glibDevice_->getFIFOOccupancy(link);
          continue;
       */
     }
-
-    BXfrOH = data.at(6);
-
-    if (isFirst) {
-      BXOHexp = BXfrOH;
-      if (counterVFATs_ != 0) {
-        dumpGEMevent_ = true;
-        DEBUG(" getGLIBData:: End Event: vfat_ " << vfat_ << " counterVFATs " << counterVFATs_);
-        ZSFlag = 0;
-      }
-      counterVFATs_ = 0;
-    }
-
-    if (BXfrOH == BXOHexp) {
-      isFirst = false;
-    } else { 
-      isFirst = true;
-    }
-
-    // BXOHexp:28
-    // BXfrOH  = (BXfrOH << 8 ) | (SBit); // BXfrOH:8  | SBit:8
-
-    bcn    = (0x0fff0000 & data.at(5)) >> 16;
-    evn    = (0x00000ff0 & data.at(5)) >> 4;
-    chipid = (0x0fff0000 & data.at(4)) >> 16;
-    flags  = (0x0000000f & data.at(5));
-    crc    = (0x0000ffff & data.at(0));
-
-    uint64_t data1  = ((0x0000ffff & data.at(4)) << 16) | ((0xffff0000 & data.at(3)) >> 16);
-    uint64_t data2  = ((0x0000ffff & data.at(3)) << 16) | ((0xffff0000 & data.at(2)) >> 16);
-    uint64_t data3  = ((0x0000ffff & data.at(2)) << 16) | ((0xffff0000 & data.at(1)) >> 16);
-    uint64_t data4  = ((0x0000ffff & data.at(1)) << 16) | ((0xffff0000 & data.at(0)) >> 16);
-
-    lsData = (data3 << 32) | (data4);
-    msData = (data1 << 32) | (data2);
+    if (errors)
+      DEBUG("VFAT block " << vfat_ << " link " << (int)link << " ChipID 0x" << std::hex
+            << VFAT::ChipID::get(vfat.ChipID) << " failed checks 0x" << errors << std::dec);
 
     vfat_++;
-    counterVFATs_++;
-
-    vfat.BC     = ( b1010 << 12 ) | (bcn);                // 1010     | bcn:12
-    vfat.EC     = ( b1100 << 12 ) | (evn << 4) | (flags); // 1100     | EC:8      | Flag:4
-    vfat.ChipID = ( b1110 << 12 ) | (chipid);             // 1110     | ChipID:12
-    vfat.lsData = lsData;                                 // lsData:64
-    vfat.msData = msData;                                 // msData:64
-    vfat.BXfrOH = BXfrOH;                                 // BXfrOH:16
-    vfat.crc    = crc;                                    // crc:16
-
-    bufferDepth = glibDevice_->getFIFOOccupancy(link);
 
     /*
      * dump VFAT data
      gem::readout::printVFATdataBits(vfat_, vfat);
     */
-    
-    // GEM data filling
-    gem::readout::GEMDataParker::fillGEMevent(gem, geb, vfat);
-
-  }//closes check on DATA_RDY
-  //}//closes while loop
   
-  return vfat_;
+    // event building
+    builder_->addBlock(link, vfat);
+
+  }//closes loop on blocks
 }
 
-void gem::readout::GEMDataParker::fillGEMevent(gem::readout::GEMData& gem, gem::readout::GEBData& geb, gem::readout::VFATData& vfat)
+void gem::readout::GEMDataParker::fillGEMevent(gem::readout::GEMData& gem)
 {
   /*
    *  GEM, All Chamber Data
    */
 
-  // GEM Event Headers [1]
-  uint64_t AmcNo       = BOOST_BINARY( 1 );    // :4 
-  uint64_t ZeroFlag    = BOOST_BINARY( 0000 ); // :4
-  uint64_t LV1ID       = BOOST_BINARY( 1 );    // :24
-  uint64_t BXID        = BOOST_BINARY( 1 );    // :12
-  uint64_t DataLgth    = BOOST_BINARY( 1 );    // :20
-
-  gem.header1 = (AmcNo <<60)|(ZeroFlag << 56)|(LV1ID <<32)|(BXID << 20)|(DataLgth);
+  // DAV list and count: one bit per chamber with data in the event
+  uint64_t DAVList = 0;
+  for (std::vector<GEBData>::const_iterator iGEB=gem.gebs.begin(); iGEB != gem.gebs.end(); ++iGEB)
+    DAVList |= (static_cast<uint64_t>(1) << GEB::ChamID::get(iGEB->header));
 
-  AmcNo    =  (0xf000000000000000 & gem.header1) >> 60;
-  ZeroFlag =  (0x0f00000000000000 & gem.header1) >> 56; 
-  LV1ID    =  (0x00ffffff00000000 & gem.header1) >> 32; 
-  BXID     =  (0x00000000fff00000 & gem.header1) >> 20;
-  DataLgth =  (0x00000000000fffff & gem.header1);
+  // GEM Event Headers [1]
+  gem.header1 =
+    AMC::AmcNo::pack(BOOST_BINARY( 1 ))|
+    AMC::ZeroFlag::pack(BOOST_BINARY( 0000 ))|
+    AMC::LV1ID::pack(BOOST_BINARY( 1 ))|
+    AMC::BXID::pack(BOOST_BINARY( 1 ))|
+    AMC::DataLgth::pack(BOOST_BINARY( 1 ));
 
   // GEM Event Headers [2]
-  uint64_t User        = BOOST_BINARY( 1 );    // :32
-  uint64_t OrN         = BOOST_BINARY( 1 );    // :16
-  uint64_t BoardID     = BOOST_BINARY( 1 );    // :16
-
-  gem.header2 = (User << 32)|(OrN << 16)|(BoardID);
-
-  User     =  (0xffffffff00000000 & gem.header2) >> 32; 
-  OrN      =  (0x00000000ffff0000 & gem.header2) >> 16;
-  BoardID  =  (0x000000000000ffff & gem.header2);
+  gem.header2 =
+    AMC::User::pack(BOOST_BINARY( 1 ))|
+    AMC::OrN::pack(BOOST_BINARY( 1 ))|
+    AMC::BoardID::pack(BOOST_BINARY( 1 ));
 
   // GEM Event Headers [3]
-  uint64_t DAVList     = BOOST_BINARY( 1 );    // :24
-  uint64_t BufStat     = BOOST_BINARY( 1 );    // :24
-  uint64_t DAVCount    = BOOST_BINARY( 1 );    // :5
-  uint64_t FormatVer   = BOOST_BINARY( 1 );    // :3
-  uint64_t MP7BordStat = BOOST_BINARY( 1 );    // :8
-
-  gem.header3 = (BufStat << 40)|(DAVCount << 16)|(DAVCount << 11)|(FormatVer << 8)|(MP7BordStat);
-
-  DAVList     = (0xffffff0000000000 & gem.header3) >> 40; 
-  BufStat     = (0x000000ffffff0000 & gem.header3) >> 16;
-  DAVCount    = (0x000000000000ff00 & gem.header3) >> 11;
-  FormatVer   = (0x0000000000000f00 & gem.header3) >> 8;
-  MP7BordStat = (0x00000000000000ff & gem.header3);
+  gem.header3 =
+    AMC::DAVList::pack(DAVList)|
+    AMC::BufStat::pack(BOOST_BINARY( 1 ))|
+    AMC::DAVCount::pack(gem.gebs.size())|
+    AMC::FormatVer::pack(BOOST_BINARY( 1 ))|
+    AMC::MP7BordStat::pack(BOOST_BINARY( 1 ));
 
   // GEM Event Treailer [2]
-  uint64_t EventStat  = BOOST_BINARY( 1 );    // :32
-  uint64_t GEBerrFlag = BOOST_BINARY( 1 );    // :24
-
-  gem.trailer2 = ( EventStat << 40)|(GEBerrFlag);
-
-  FormatVer   = (0xffffffffff000000 & gem.trailer2) >> 40;
-  MP7BordStat = (0x0000000000ffffff & gem.trailer2);
+  gem.trailer2 =
+    AMC::EventStat::pack(BOOST_BINARY( 1 ))|
+    AMC::GEBerrFlag::pack(BOOST_BINARY( 1 ));
 
   // GEM Event Treailer [1]
-  uint64_t crc      = BOOST_BINARY( 1 );    // :32
-  uint64_t LV1IDT   = BOOST_BINARY( 1 );    // :8
-  ZeroFlag = BOOST_BINARY( 0000 ); // :4
-  DataLgth = BOOST_BINARY( 1 );    // :20
-
-  gem.trailer1 = (crc<<32)|(LV1IDT << 24)|(ZeroFlag <<20)|(DataLgth);
-
-  crc      = (0xffffffff00000000 & gem.trailer1) >> 32;
-  LV1IDT   = (0x00000000ff000000 & gem.trailer1) >> 24;
-  ZeroFlag = (0x0000000000f00000 & gem.trailer1) >> 20;
-  DataLgth = (0x00000000000fffff & gem.trailer1);
+  gem.trailer1 =
+    AMC::CRC::pack(BOOST_BINARY( 1 ))|
+    AMC::LV1IDT::pack(BOOST_BINARY( 1 ))|
+    AMC::TrailerZeroFlag::pack(BOOST_BINARY( 0000 ))|
+    AMC::TrailerDataLgth::pack(BOOST_BINARY( 1 ));
 
   /*
-    int nGEBs = 1;
-    for (int nume = 0; nume < nGEBs; nume++) {
-    gem.gebs.push_back(geb);
-    }
-    DEBUG(" gem.gebs.size " << int(gem.gebs.size())); */
-
-  /*
-   * One GEM bord loop, 24 VFAT chips maximum
-   */
-
-  /*
-   * GEB, One Chamber Data
+   * GEB, One Chamber Data, one per link filled by the event builder
    */
-  int IndexVFATChipOnGEB = -99;
-  // VFAT position definition on the board, very temporary
-  if ((0x0fff & vfat.ChipID)        == 0x838 ) {
-    IndexVFATChipOnGEB = 0;
-  } else if ((0x0fff & vfat.ChipID) == 0xe7b ) { 
-    IndexVFATChipOnGEB = 4;
-  } else if ((0x0fff & vfat.ChipID) == 0xe21 ) { 
-    IndexVFATChipOnGEB = 8;
-  } else if ((0x0fff & vfat.ChipID) == 0xe74 ) { 
-    IndexVFATChipOnGEB = 12;
-  } else if ((0x0fff & vfat.ChipID) == 0x840 ) { 
-    IndexVFATChipOnGEB = 16;
-  } else if ((0x0fff & vfat.ChipID) == 0xa64 ) { 
-    IndexVFATChipOnGEB = 20;
-  } else { 
-  };
-
-  geb.vfats.push_back(vfat);
-  DEBUG(" geb.vfats.size " << int(geb.vfats.size()));
-    
-  // Chamber Header, Zero Suppression flags, Chamber ID
-  ZSFlag           = (ZSFlag | (1 << (23-IndexVFATChipOnGEB))); // :24
-  uint64_t ChamID  = 0xdea;                                     // :12
-  uint64_t sumVFAT = int(geb.vfats.size());                     // :28, geb.vfats.size was placed a very temporary here!!!
-
-  geb.header  = (ZSFlag << 40)|(ChamID << 28)|(sumVFAT);
-
-  //show24bits(ZSFlag); 
-  DEBUG(" ChipID 0x" << std::hex << (0x0fff & vfat.ChipID) << std::dec << " IndexVFATChipOnGEB " << IndexVFATChipOnGEB);
+  sumVFAT_ = 0;
+  for (std::vector<GEBData>::iterator iGEB=gem.gebs.begin(); iGEB != gem.gebs.end(); ++iGEB) {
+    /*
+     * One GEM bord loop, 24 VFAT chips maximum
+     */
+    uint64_t ZSFlag = 0;
+    for (GEBData::VFATs::iterator iVFAT=iGEB->vfats.begin(); iVFAT != iGEB->vfats.end(); ++iVFAT) {
+      ZSFlag |= slotFlag(iGEB->header, *iVFAT); // :24
+      DEBUG(" ChipID 0x" << std::hex << VFAT::ChipID::get(iVFAT->ChipID) << " slot flag " << slotFlag(iGEB->header, *iVFAT) << std::dec);
+    }
 
-  ZSFlag =  (0xffffff0000000000 & geb.header) >> 40; 
-  ChamID =  (0x000000fff0000000 & geb.header) >> 28; 
+    // Chamber Header, Zero Suppression flags, Chamber ID
+    uint64_t ChamID  = GEB::ChamID::get(iGEB->header); // :12, the link number
+    uint64_t sumVFAT = iGEB->vfats.size();              // :27
 
-  DEBUG(" ZSFlag " << std::hex << ZSFlag << " ChamID " << ChamID << std::dec << " sumVFAT " << sumVFAT);
+    iGEB->header = GEB::ZSFlag::pack(ZSFlag)|GEB::ChamID::pack(ChamID)|GEB::SumVFAT::pack(sumVFAT);
+    sumVFAT_ += sumVFAT;
 
-  // Chamber Trailer, OptoHybrid: crc, wordcount, Chamber status
-  uint64_t OHcrc       = BOOST_BINARY( 1 ); // :16
-  uint64_t OHwCount    = BOOST_BINARY( 1 ); // :16
-  uint64_t ChamStatus  = BOOST_BINARY( 1 ); // :16
-  geb.trailer = ((OHcrc << 48)|(OHwCount << 32 )|(ChamStatus << 16));
+    DEBUG(" ZSFlag " << std::hex << ZSFlag << " ChamID " << ChamID << std::dec << " sumVFAT " << sumVFAT);
 
-  OHcrc      = (0xffff000000000000 & geb.trailer) >> 48; 
-  OHwCount   = (0x0000ffff00000000 & geb.trailer) >> 32; 
-  ChamStatus = (0x00000000ffff0000 & geb.trailer) >> 16;
+    // Chamber Trailer, OptoHybrid: crc, wordcount, Chamber status
+    uint64_t OHcrc       = BOOST_BINARY( 1 ); // :16
+    uint64_t OHwCount    = BOOST_BINARY( 1 ); // :16
+    uint64_t ChamStatus  = BOOST_BINARY( 1 ); // :16
+    iGEB->trailer = GEB::OHcrc::pack(OHcrc)|GEB::OHwCount::pack(OHwCount)|GEB::ChamStatus::pack(ChamStatus);
 
-  DEBUG(" OHcrc " << std::hex << OHcrc << " OHwCount " << OHwCount << " ChamStatus " << ChamStatus << std::dec);
+    DEBUG(" OHcrc " << std::hex << OHcrc << " OHwCount " << OHwCount << " ChamStatus " << ChamStatus << std::dec);
+  } // end of GEB
 
 }
 
-void gem::readout::GEMDataParker::writeGEMevent(gem::readout::GEMData& gem, gem::readout::GEBData& geb, gem::readout::VFATData& vfat)
+uint64_t gem::readout::GEMDataParker::slotFlag(uint64_t const& gebHeader, gem::readout::VFATData const& vfat) const
 {
-  INFO("\nwriteGEMevent:: counter " << vfat_ << " event " << event_ << " sumVFAT " << (0x000000000fffffff & geb.header));
+  uint8_t slot = checker_->getChipSlot(GEB::ChamID::get(gebHeader), VFAT::ChipID::get(vfat.ChipID));
+  if (slot == gem::datachecker::GEMDataChecker::NO_SLOT || slot >= GEB::ZSFlag::size())
+    return 0;
+  return static_cast<uint64_t>(1) << (23-slot);
+}
 
-  // GEM Chamber's data level
-  /*
-    int nGEB=0;
-    for (vector<GEBData>::iterator iGEB=gem.gebs.begin(); iGEB != gem.gebs.end(); ++iGEB) {
-    nGEB++;
-    uint64_t ZSFlag =  (0xffffff0000000000 & geb.header) >> 40; show24bits(ZSFlag);
-  */
+void gem::readout::GEMDataParker::writeGEMevent(gem::readout::GEMData& gem)
+{
+  DEBUG("writeGEMevent:: counter " << vfat_ << " event " << event_ << " nGEB " << gem.gebs.size() << " sumVFAT " << sumVFAT_);
+
+  bool hexOutput = (outputType_ == "Hex");
+
+  // longest possible event: in hex, header and trailer, and per block BC, EC, ChipID, the hit
+  // count, the channel list and BXfrOH, crc, one line each (and one spare, the buffer is never
+  // empty), in binary the GEB words and the longest VFAT record
+  size_t maxSize = gem::readout::HEX::MAX_LINE;
+  for (std::vector<GEBData>::const_iterator iGEB=gem.gebs.begin(); iGEB != gem.gebs.end(); ++iGEB)
+    maxSize += hexOutput ?
+      (2 + iGEB->vfats.size()*(6 + gem::readout::ZS_MAX_SPARSE_HITS))*gem::readout::HEX::MAX_LINE :
+      2*sizeof(uint64_t) + iGEB->vfats.size()*gem::readout::RunFile::MAX_VFAT_RECORD;
+  if (eventBuffer_.size() < maxSize)
+    eventBuffer_.resize(maxSize);
+  char* out = &eventBuffer_[0];
+
+  if (!writer_)
+    openOutput();
+  if (runFile_ && !runFile_->isHeaderWritten())
+    runFile_->addBoard(AMC::BoardID::get(gem.header2));
+
+  // GEM Chamber's data level, all chambers of the event are written consecutively
+  for (std::vector<GEBData>::iterator iGEB=gem.gebs.begin(); iGEB != gem.gebs.end(); ++iGEB) {
+    // zero suppression: count the hits of each block, ZSFlag marks the slots of the suppressed ones
+    if (zeroSuppression_) {
+      uint64_t ZSFlag = 0;
+      zsHits_.resize(iGEB->vfats.size());
+      for (size_t iVFAT = 0; iVFAT < iGEB->vfats.size(); ++iVFAT) {
+        zsHits_[iVFAT] = gem::readout::zsChannelCount(iGEB->vfats[iVFAT]);
+        if (zsHits_[iVFAT] != gem::readout::ZS_FULL_PAYLOAD)
+          ZSFlag |= slotFlag(iGEB->header, iGEB->vfats[iVFAT]);
+      }
+      iGEB->header = GEB::ZSMode::set(GEB::ZSFlag::set(iGEB->header, ZSFlag), 1);
+    }
 
-  // GEB data level
-  if (outputType_ == "Hex") {
-    writeGEBheader (outFileName_, event_, geb);
-  } else {
-    writeGEBheaderBinary (outFileName_, event_, geb);
-  } 
-  // printGEBheader (event_, geb);
+    // GEB data level
+    if (hexOutput)
+      out = gem::readout::HEX::putLine(out, iGEB->header);
+    else
+      out = gem::readout::RunFile::put(out, iGEB->header);
+    // printGEBheader (event_, *iGEB);
     
-  int nChip=0;
-  for (std::vector<VFATData>::iterator iVFAT=geb.vfats.begin(); iVFAT != geb.vfats.end(); ++iVFAT) {
-    nChip++;
-    vfat.BC     = (*iVFAT).BC;
-    vfat.EC     = (*iVFAT).EC;
-    vfat.ChipID = (*iVFAT).ChipID;
-    vfat.lsData = (*iVFAT).lsData;
-    vfat.msData = (*iVFAT).msData;
-    vfat.crc    = (*iVFAT).crc;
-      
-    if (outputType_ == "Hex") {
-      gem::readout::writeVFATdata (outFileName_, nChip, vfat); 
-    } else {
-      gem::readout::writeVFATdataBinary (outFileName_, nChip, vfat);
-    } 
-    gem::readout::printVFATdataBits(nChip, vfat);
-  } //end of VFAT
-
-  if (outputType_ == "Hex") {
-    writeGEBtrailer (outFileName_, event_, geb);
+    int nChip=0;
+    for (GEBData::VFATs::iterator iVFAT=iGEB->vfats.begin(); iVFAT != iGEB->vfats.end(); ++iVFAT) {
+      uint8_t nHits = zeroSuppression_ ? zsHits_[nChip] : gem::readout::ZS_FULL_PAYLOAD;
+      uint8_t channels[gem::readout::ZS_MAX_SPARSE_HITS];
+      if (nHits != gem::readout::ZS_FULL_PAYLOAD)
+        gem::readout::zsEncodeChannels(*iVFAT, channels);
+      nChip++;
+      if (hexOutput) {
+        out = gem::readout::HEX::putLine(out, iVFAT->BC);
+        out = gem::readout::HEX::putLine(out, iVFAT->EC);
+        out = gem::readout::HEX::putLine(out, iVFAT->ChipID);
+        if (zeroSuppression_)
+          out = gem::readout::HEX::putLine(out, nHits);
+        if (nHits == gem::readout::ZS_FULL_PAYLOAD) {
+          out = gem::readout::HEX::putLine(out, iVFAT->lsData);
+          out = gem::readout::HEX::putLine(out, iVFAT->msData);
+        } else {
+          for (uint8_t hit = 0; hit < nHits; ++hit)
+            out = gem::readout::HEX::putLine(out, channels[hit]);
+        }
+        out = gem::readout::HEX::putLine(out, iVFAT->BXfrOH);
+        out = gem::readout::HEX::putLine(out, iVFAT->crc);
+      } else {
+        out = gem::readout::RunFile::putVFAT(out, *iVFAT, zeroSuppression_, nHits, channels);
+      } 
+      /*
+       * dump VFAT data
+       gem::readout::printVFATdataBits(nChip, *iVFAT);
+      */
+    } //end of VFAT
+
+    if (hexOutput)
+      out = gem::readout::HEX::putLine(out, iGEB->trailer);
+    else
+      out = gem::readout::RunFile::put(out, iGEB->trailer);
+  } // end of GEB
+
+  if (hexOutput) {
+    writer_->append(&eventBuffer_[0], out - &eventBuffer_[0]);
+    writer_->commitEvent();
   } else {
-    writeGEBtrailerBinary (outFileName_, event_, geb);
-  } 
+    runFile_->writeEvent(&eventBuffer_[0], out - &eventBuffer_[0]);
+  }
 
-  /* } // end of GEB */
+  segmentBytes_ += out - &eventBuffer_[0];
+  ++segmentEvents_;
+  if (closer_ && segmentComplete())
+    closeOutput();
 }
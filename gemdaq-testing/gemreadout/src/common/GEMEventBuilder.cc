@@ -0,0 +1,172 @@
+#include "gem/readout/GEMEventBuilder.h"
+
+#include <time.h>
+
+const uint8_t  gem::readout::GEMEventBuilder::MAX_LINKS;
+const uint32_t gem::readout::GEMEventBuilder::DEFAULT_TIMEOUT_MS;
+
+gem::readout::GEMEventBuilder::GEMEventBuilder(uint8_t const& readoutMask, uint32_t const& timeoutMs) :
+  gemLogger_(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:GEMEventBuilder"))),
+  readoutMask_(readoutMask & ((1 << MAX_LINKS) - 1)),
+  timeoutMs_(timeoutMs),
+  pending_(16, static_cast<PendingEvent*>(0)),
+  firstPending_(0),
+  nPending_(0),
+  builtEvents_(0),
+  incompleteEvents_(0),
+  droppedBlocks_(0)
+{
+  for (uint8_t link = 0; link < MAX_LINKS; ++link) {
+    linkOpen_[link] = false;
+    linkBX_[link]   = 0;
+    linkEC_[link]   = 0;
+    linkSeq_[link]  = 0;
+  }
+}
+
+void gem::readout::GEMEventBuilder::addBlock(uint8_t const& link, gem::readout::VFATData const& vfat)
+{
+  if (link >= MAX_LINKS) {
+    ERROR("addBlock:: invalid link " << (int)link << ", dropping block");
+    return;
+  }
+
+  uint16_t bx = vfat.BXfrOH;
+  uint8_t  ec = gem::readout::VFAT::EC::get(vfat.EC);
+
+  // a new BX/EC on a link ends that link's part of the previous event
+  if (linkOpen_[link] && (bx != linkBX_[link] || ec != linkEC_[link]))
+    closeLink(link, linkBX_[link], linkEC_[link]);
+
+  linkOpen_[link] = true;
+  linkBX_[link]   = bx;
+  linkEC_[link]   = ec;
+
+  PendingEvent& event = findEvent(link, bx, ec);
+  event.seenMask |= (1 << link);
+  if (!event.chambers[link].vfats.push_back(vfat)) {
+    ++droppedBlocks_;
+    WARN("addBlock:: more than " << GEB_MAX_VFATS << " blocks on link " << (int)link << " for BX 0x"
+         << std::hex << bx << " EC 0x" << (int)ec << std::dec << ", dropping block");
+  }
+}
+
+bool gem::readout::GEMEventBuilder::popEvent(gem::readout::GEMData& gem)
+{
+  if (!nPending_)
+    return false;
+
+  PendingEvent& event = *pending(0);
+  bool complete = ((event.doneMask & readoutMask_) == readoutMask_);
+  if (!complete && !event.closed && (nowMs() - event.firstSeen) < timeoutMs_)
+    return false;
+
+  if (!complete) {
+    ++incompleteEvents_;
+    WARN("popEvent:: releasing incomplete event BX 0x" << std::hex << event.bx << " EC 0x" << (int)event.ec
+         << " links seen 0x" << (int)event.seenMask << " finished 0x" << (int)event.doneMask
+         << " expected 0x" << (int)readoutMask_ << std::dec);
+  }
+
+  // the vector keeps its capacity, a reused GEMData is filled without allocating
+  gem.gebs.clear();
+  for (uint8_t link = 0; link < MAX_LINKS; ++link) {
+    if (!((event.seenMask >> link) & 0x1))
+      continue;
+    // the chamber is identified by the link it is read out from
+    event.chambers[link].header  = (static_cast<uint64_t>(link) << 28);
+    event.chambers[link].trailer = 0;
+    gem.gebs.push_back(event.chambers[link]);
+  }
+
+  ++builtEvents_;
+  pool_.release(&event);
+  firstPending_ = (firstPending_ + 1) % pending_.size();
+  --nPending_;
+  return true;
+}
+
+void gem::readout::GEMEventBuilder::flush()
+{
+  for (uint8_t link = 0; link < MAX_LINKS; ++link) {
+    if (linkOpen_[link])
+      closeLink(link, linkBX_[link], linkEC_[link]);
+    linkOpen_[link] = false;
+  }
+
+  for (size_t i = 0; i < nPending_; ++i)
+    pending(i)->closed = true;
+}
+
+gem::readout::GEMEventBuilder::PendingEvent& gem::readout::GEMEventBuilder::findEvent(uint8_t const& link, uint16_t const& bx, uint8_t const& ec)
+{
+  // a link adds to the event it added to last or to the one after it, whichever link leads
+  for (uint64_t seq = linkSeq_[link]; seq <= linkSeq_[link] + 1; ++seq) {
+    PendingEvent* event = pendingSeq(seq);
+    if (event && event->bx == bx && event->ec == ec) {
+      linkSeq_[link] = seq;
+      return *event;
+    }
+  }
+
+  // a link leading the others starts a new event, no older one can match
+  PendingEvent* last = pendingSeq(linkSeq_[link]);
+  bool leading = (last && ((last->seenMask >> link) & 0x1) && linkSeq_[link] + 1 == builtEvents_ + nPending_);
+
+  // otherwise the event is most likely one of the latest ones
+  for (size_t i = leading ? 0 : nPending_; i-- > 0; ) {
+    PendingEvent* event = pending(i);
+    if (event->bx == bx && event->ec == ec) {
+      linkSeq_[link] = builtEvents_ + i;
+      return *event;
+    }
+  }
+
+  // the ring is only grown when more events are pending than ever before
+  if (nPending_ == pending_.size()) {
+    std::vector<PendingEvent*> ring(2*pending_.size(), static_cast<PendingEvent*>(0));
+    for (size_t i = 0; i < nPending_; ++i)
+      ring[i] = pending(i);
+    pending_.swap(ring);
+    firstPending_ = 0;
+  }
+
+  PendingEvent* event = pool_.acquire();
+  event->bx        = bx;
+  event->ec        = ec;
+  event->seenMask  = 0;
+  event->doneMask  = 0;
+  event->closed    = false;
+  event->firstSeen = nowMs();
+  for (uint8_t chamber = 0; chamber < MAX_LINKS; ++chamber)
+    event->chambers[chamber].vfats.clear();
+  linkSeq_[link] = builtEvents_ + nPending_;
+  pending(nPending_++) = event;
+  DEBUG("findEvent:: new event BX 0x" << std::hex << bx << " EC 0x" << (int)ec << std::dec
+        << ", " << nPending_ << " events pending");
+  return *event;
+}
+
+void gem::readout::GEMEventBuilder::closeLink(uint8_t const& link, uint16_t const& bx, uint8_t const& ec)
+{
+  PendingEvent* last = pendingSeq(linkSeq_[link]);
+  if (last && last->bx == bx && last->ec == ec) {
+    last->doneMask |= (1 << link);
+    return;
+  }
+
+  for (size_t i = nPending_; i-- > 0; ) {
+    PendingEvent* event = pending(i);
+    if (event->bx == bx && event->ec == ec) {
+      event->doneMask |= (1 << link);
+      return;
+    }
+  }
+}
+
+uint64_t gem::readout::GEMEventBuilder::nowMs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec)*1000 + now.tv_nsec/1000000;
+}
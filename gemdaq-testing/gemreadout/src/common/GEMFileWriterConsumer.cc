@@ -0,0 +1,24 @@
+#include "gem/readout/GEMFileWriterConsumer.h"
+#include "gem/readout/GEMReadoutFrame.h"
+#include "gem/readout/GEMDataParker.h"
+
+gem::readout::GEMFileWriterConsumer::GEMFileWriterConsumer(std::shared_ptr<gem::readout::GEMDataParker> const& parker) :
+  parker_(parker)
+{
+}
+
+void gem::readout::GEMFileWriterConsumer::consume(toolbox::mem::Reference* frame)
+{
+  gem::readout::GEMReadoutFrame* data = gem::readout::GEMReadoutFrame::get(frame);
+  parker_->processBlocks(data->link, data->blocks(), data->nBlocks);
+}
+
+void gem::readout::GEMFileWriterConsumer::idle()
+{
+  parker_->processBlocks(0x0, 0, 0);
+}
+
+void gem::readout::GEMFileWriterConsumer::flush()
+{
+  parker_->flush();
+}
@@ -0,0 +1,185 @@
+/**
+ * class: GEMGLIBReadoutApplication
+ * description: Reads the tracking data of a GLIB into memory pool frames and passes
+ *              them to the file writer and the monitoring sample
+ * author:
+ * date:
+ */
+
+#include "gem/readout/GEMGLIBReadoutApplication.h"
+#include "gem/readout/GEMReadoutFrame.h"
+#include "gem/readout/GEMFileWriterConsumer.h"
+#include "gem/readout/GEMSamplingConsumer.h"
+#include "gem/readout/GEMDataParker.h"
+#include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMEventBuilder.h"
+#include "gem/hw/glib/HwGLIB.h"
+
+#include "toolbox/mem/Reference.h"
+#include "toolbox/fsm/exception/Exception.h"
+
+#include "gem/utils/GEMLogging.h"
+
+#include <algorithm>
+#include <ctime>
+
+XDAQ_INSTANTIATOR_IMPL(gem::readout::GEMGLIBReadoutApplication)
+
+void gem::readout::GEMGLIBReadoutApplication::ConfigParams::registerFields(xdata::Bag<ConfigParams> *bag)
+{
+  deviceIP     = "";
+  readoutMask  = 0x7;
+  for (int i = 0; i < 24; ++i)
+    chipIDs.push_back(0U);
+  outFileName  = "";
+  outputType   = "Hex";
+
+  eventTimeout       = 100U;
+  zeroSuppression    = false;
+  compressionLevel   = 0U;
+  compressionThreads = 2U;
+  runNumber          = 0U;
+  segmentSize        = 0U;
+  segmentEvents      = 0U;
+  segmentSeconds     = 0U;
+  closedDir          = "closed";
+
+  sampleFrames       = 64U;
+  samplePrescale     = 100U;
+
+  bag->addField("deviceIP",      &deviceIP    );
+  bag->addField("readoutMask",   &readoutMask );
+  bag->addField("chipIDs",       &chipIDs     );
+  bag->addField("outFileName",   &outFileName );
+  bag->addField("outputType",    &outputType  );
+
+  bag->addField("eventTimeout",       &eventTimeout );
+  bag->addField("zeroSuppression",    &zeroSuppression );
+  bag->addField("compressionLevel",   &compressionLevel );
+  bag->addField("compressionThreads", &compressionThreads );
+  bag->addField("runNumber",          &runNumber );
+  bag->addField("segmentSize",        &segmentSize );
+  bag->addField("segmentEvents",      &segmentEvents );
+  bag->addField("segmentSeconds",     &segmentSeconds );
+  bag->addField("closedDir",          &closedDir );
+
+  bag->addField("sampleFrames",       &sampleFrames );
+  bag->addField("samplePrescale",     &samplePrescale );
+}
+
+gem::readout::GEMGLIBReadoutApplication::GEMGLIBReadoutApplication(xdaq::ApplicationStub *stub)
+  throw (xdaq::exception::Exception) :
+  gem::base::GEMReadoutApplication(stub),
+  readoutMask_(0x0),
+  maxBlocks_(0)
+{
+  // by default a frame holds one drain of the size the supervisor reads
+  frameSize_ = gem::readout::GEMReadoutFrame::size(gem::readout::GEMDataParker::MAX_BLOCKS_PER_DRAIN,
+                                                   gem::hw::glib::HwGLIB::TRACKING_BLOCK_WORDS);
+
+  getApplicationInfoSpace()->fireItemAvailable("confParams", &confParams_);
+  getApplicationInfoSpace()->fireItemValueRetrieve("confParams", &confParams_);
+}
+
+gem::readout::GEMGLIBReadoutApplication::~GEMGLIBReadoutApplication()
+{
+  // readout() must not be called once this part of the object is gone
+  stopReadout();
+  clearConsumers();
+}
+
+int gem::readout::GEMGLIBReadoutApplication::readout(unsigned int expected, unsigned int* eventNumbers,
+                                                     std::vector< ::toolbox::mem::Reference* >& data)
+{
+  unsigned int nFrames = 0;
+  for (uint8_t link = 0; link < gem::readout::GEMEventBuilder::MAX_LINKS && nFrames < expected; ++link) {
+    if (!((readoutMask_ >> link) & 0x1))
+      continue;
+
+    uint32_t nBlocks = maxBlocks_;
+    while (nBlocks == maxBlocks_ && nFrames < expected) {
+      ::toolbox::mem::Reference* ref = getFrame();
+      if (!ref)
+        // the data waits in the GLIB until the consumers give frames back
+        return nFrames;
+
+      gem::readout::GEMReadoutFrame* frame = gem::readout::GEMReadoutFrame::get(ref);
+      nBlocks = glibDevice_->drainTrackingFIFO(link, maxBlocks_, frame->blocks());
+      if (!nBlocks) {
+        ref->release();
+        break;
+      }
+
+      frame->link    = link;
+      frame->nBlocks = nBlocks;
+      ref->setDataSize(gem::readout::GEMReadoutFrame::size(nBlocks, gem::hw::glib::HwGLIB::TRACKING_BLOCK_WORDS));
+      eventNumbers[nFrames++] = gem::readout::VFAT::EC::get(gem::readout::TRK::ECword::get(frame->blocks()[5]));
+      data.push_back(ref);
+    }
+  }
+  return nFrames;
+}
+
+void gem::readout::GEMGLIBReadoutApplication::configureAction(toolbox::Event::Reference e)
+{
+  // stops a previous run and drops its consumers, which closes its output file
+  gem::base::GEMReadoutApplication::configureAction(e);
+
+  maxBlocks_ = gem::readout::GEMReadoutFrame::maxBlocks(frameSize_, gem::hw::glib::HwGLIB::TRACKING_BLOCK_WORDS);
+  if (!maxBlocks_)
+    XCEPT_RAISE(toolbox::fsm::exception::Exception,
+                "frameSize " + frameSize_.toString() + " is too small for a VFAT block");
+
+  sampler_.reset();
+  glibDevice_ = std::shared_ptr<gem::hw::glib::HwGLIB>(new gem::hw::glib::HwGLIB());
+  glibDevice_->setDeviceIPAddress(confParams_.bag.deviceIP);
+  glibDevice_->connectDevice();
+  if (!glibDevice_->isHwConnected())
+    XCEPT_RAISE(toolbox::fsm::exception::Exception,
+                "no connection to the GLIB at " + confParams_.bag.deviceIP.toString());
+
+  readoutMask_ = confParams_.bag.readoutMask;
+
+  std::string fileName = confParams_.bag.outFileName.toString();
+  if (fileName.empty()) {
+    time_t now  = time(0);
+    tm    *gmtm = gmtime(&now);
+    fileName = "GEM_DAQ_";
+    fileName.append(asctime(gmtm));
+    fileName.erase(std::remove(fileName.begin(), fileName.end(), '\n'), fileName.end());
+    fileName.append(".dat");
+    std::replace(fileName.begin(), fileName.end(), ' ', '_' );
+    std::replace(fileName.begin(), fileName.end(), ':', '-');
+  }
+
+  uint64_t segmentBytes = static_cast<uint64_t>(confParams_.bag.segmentSize)*1024*1024;
+  std::shared_ptr<gem::readout::GEMDataParker> parker(
+    new gem::readout::GEMDataParker(*glibDevice_, fileName, confParams_.bag.outputType.toString(),
+                                    readoutMask_, confParams_.bag.eventTimeout));
+  // without chip IDs the blocks are not checked against a chip map, and ZSFlag stays empty
+  for (size_t slot = 0; slot < confParams_.bag.chipIDs.size(); ++slot)
+    if (confParams_.bag.chipIDs[slot])
+      parker->setChipSlot(slot/8, slot, confParams_.bag.chipIDs[slot]);
+  parker->setZeroSuppression(confParams_.bag.zeroSuppression);
+  parker->setCompression(confParams_.bag.compressionLevel, confParams_.bag.compressionThreads);
+  parker->setRunNumber(confParams_.bag.runNumber);
+  parker->setSegmentation(segmentBytes, confParams_.bag.segmentEvents,
+                          confParams_.bag.segmentSeconds, confParams_.bag.closedDir.toString());
+  addConsumer(std::shared_ptr<gem::base::GEMReadoutConsumer>(new gem::readout::GEMFileWriterConsumer(parker)));
+
+  if (confParams_.bag.sampleFrames) {
+    sampler_ = std::shared_ptr<gem::readout::GEMSamplingConsumer>(
+      new gem::readout::GEMSamplingConsumer(confParams_.bag.sampleFrames, confParams_.bag.samplePrescale));
+    addConsumer(sampler_);
+  }
+
+  INFO("configureAction:: GLIB " << confParams_.bag.deviceIP.toString() << " readout mask 0x"
+       << std::hex << readoutMask_ << std::dec << ", " << maxBlocks_ << " blocks per frame, writing " << fileName);
+}
+
+void gem::readout::GEMGLIBReadoutApplication::haltAction(toolbox::Event::Reference e)
+{
+  gem::base::GEMReadoutApplication::haltAction(e);
+  sampler_.reset();
+  glibDevice_.reset();
+}
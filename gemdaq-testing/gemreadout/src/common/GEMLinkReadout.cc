@@ -0,0 +1,133 @@
+#include "gem/readout/GEMLinkReadout.h"
+#include "gem/readout/GEMDataParker.h"
+
+#include "toolbox/task/WorkLoopFactory.h"
+
+#include "gem/utils/LockGuard.h"
+
+#include <unistd.h>
+
+gem::readout::GEMLinkReadout::GEMLinkReadout(gem::hw::glib::HwGLIB& glibDevice, uint8_t const& link,
+                                             std::string const& loopName,
+                                             std::string const& outFileName, std::string const& outputType,
+                                             uint32_t const& eventTimeout) :
+  gemLogger_(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:GEMLinkReadout"))),
+  link_(link),
+  loopName_(loopName),
+  outFileName_(outFileName),
+  wl_(0),
+  readSig_(0),
+  lock_(toolbox::BSem::FULL, true),
+  running_(false)
+{
+  counters_[0] = 0;
+  counters_[1] = 0;
+  counters_[2] = 0;
+
+  // the parker only sees its own link
+  parker_.reset(new gem::readout::GEMDataParker(glibDevice, outFileName_, outputType, (1 << link_), eventTimeout));
+
+  readSig_ = toolbox::task::bind(this, &gem::readout::GEMLinkReadout::readAction, "readAction");
+  wl_      = toolbox::task::getWorkLoopFactory()->getWorkLoop(loopName_, "waiting");
+}
+
+gem::readout::GEMLinkReadout::~GEMLinkReadout()
+{
+  stop();
+  delete readSig_;
+  readSig_ = 0;
+}
+
+void gem::readout::GEMLinkReadout::start()
+{
+  {
+    gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+    if (running_)
+      return;
+    running_ = true;
+  }
+
+  if (!wl_->isActive())
+    wl_->activate();
+  wl_->submit(readSig_);
+  INFO("start:: reading out link " << (int)link_ << " on " << loopName_ << " into " << outFileName_);
+}
+
+void gem::readout::GEMLinkReadout::stop()
+{
+  {
+    // waits for a read out in progress to finish, the action then removes itself from the workloop
+    gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+    if (!running_)
+      return;
+    running_ = false;
+  }
+
+  if (wl_->isActive())
+    wl_->cancel();
+
+  parker_->flush();
+  INFO("stop:: link " << (int)link_ << " stopped after " << counters_[1] << " events, "
+       << parker_->getCRCErrors() << " VFAT blocks with a bad CRC");
+}
+
+bool gem::readout::GEMLinkReadout::readAction(toolbox::task::WorkLoop* wl)
+{
+  bool idle;
+  {
+    gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+    if (!running_)
+      return false;
+
+    int* counter = parker_->dumpDataToDisk();
+    idle = (counter[0] == counters_[0]);
+    counters_[0] = counter[0];
+    counters_[1] = counter[1];
+    counters_[2] = counter[2];
+  }
+
+  // nothing in the FIFO, do not hammer the GLIB
+  if (idle)
+    usleep(IDLE_SLEEP_US);
+
+  return true;
+}
+
+void gem::readout::GEMLinkReadout::setZeroSuppression(bool const& zeroSuppression)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+  parker_->setZeroSuppression(zeroSuppression);
+}
+
+void gem::readout::GEMLinkReadout::setChipSlot(uint8_t const& slot, uint16_t const& chipID)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+  parker_->setChipSlot(link_, slot, chipID);
+}
+
+void gem::readout::GEMLinkReadout::setCompression(int const& level, unsigned const& nThreads)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+  parker_->setCompression(level, nThreads);
+}
+
+void gem::readout::GEMLinkReadout::setRunNumber(uint32_t const& runNumber)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+  parker_->setRunNumber(runNumber);
+}
+
+void gem::readout::GEMLinkReadout::setSegmentation(uint64_t const& maxBytes, uint64_t const& maxEvents,
+                                                   uint32_t const& maxSeconds, std::string const& closedDir)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+  parker_->setSegmentation(maxBytes, maxEvents, maxSeconds, closedDir);
+}
+
+void gem::readout::GEMLinkReadout::getCounters(int* counters)
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+  counters[0] = counters_[0];
+  counters[1] = counters_[1];
+  counters[2] = counters_[2];
+}
@@ -0,0 +1,57 @@
+#include "gem/readout/GEMSamplingConsumer.h"
+
+#include "toolbox/mem/Reference.h"
+
+#include "gem/utils/LockGuard.h"
+
+gem::readout::GEMSamplingConsumer::GEMSamplingConsumer(size_t const& maxSamples, uint32_t const& prescale) :
+  prescale_(prescale ? prescale : 1),
+  seen_(0),
+  sampled_(0),
+  lock_(toolbox::BSem::FULL, true),
+  samples_(maxSamples ? maxSamples : 1, static_cast<toolbox::mem::Reference*>(0)),
+  firstSample_(0),
+  nSamples_(0)
+{
+}
+
+gem::readout::GEMSamplingConsumer::~GEMSamplingConsumer()
+{
+  // the pool gets its frames back
+  for (toolbox::mem::Reference* sample = takeSample(); sample; sample = takeSample())
+    sample->release();
+}
+
+void gem::readout::GEMSamplingConsumer::consume(toolbox::mem::Reference* frame)
+{
+  if (seen_++ % prescale_)
+    return;
+
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+  if (nSamples_ == samples_.size()) {
+    samples_[firstSample_]->release();
+    firstSample_ = (firstSample_ + 1) % samples_.size();
+    --nSamples_;
+  }
+  samples_[(firstSample_ + nSamples_) % samples_.size()] = frame->duplicate();
+  ++nSamples_;
+  ++sampled_;
+}
+
+toolbox::mem::Reference* gem::readout::GEMSamplingConsumer::takeSample()
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+  if (!nSamples_)
+    return 0;
+  toolbox::mem::Reference* sample = samples_[firstSample_];
+  samples_[firstSample_] = 0;
+  firstSample_ = (firstSample_ + 1) % samples_.size();
+  --nSamples_;
+  return sample;
+}
+
+size_t gem::readout::GEMSamplingConsumer::getSamples()
+{
+  gem::utils::LockGuard<gem::utils::Lock> guardedLock(lock_);
+  return nSamples_;
+}
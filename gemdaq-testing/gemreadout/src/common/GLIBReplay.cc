@@ -0,0 +1,319 @@
+#include "gem/readout/GLIBReplay.h"
+#include "gem/readout/GEMDataAMCformat.h"
+#include "gem/readout/GEMDataGenerator.h"
+#include "gem/readout/GEMRawFileMap.h"
+
+#include <algorithm>
+#include <limits>
+#include <time.h>
+
+const uint8_t gem::readout::GLIBReplay::MAX_LINKS;
+
+namespace {
+  double nowNs()
+  {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec*1e9 + now.tv_nsec;
+  }
+}
+
+gem::readout::GLIBReplay::GLIBReplay(std::string const& fileName) :
+  gem::hw::glib::HwGLIB(),
+  fileName_(fileName),
+  nEvents_(0),
+  rate_(0),
+  burst_(1),
+  fifoDepth_(0),
+  loops_(1),
+  startNs_(0)
+{
+  gemLogger_ = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:GLIBReplay"));
+  setDeviceID("GLIBReplay");
+  load(fileName_);
+  start();
+}
+
+gem::readout::GLIBReplay::GLIBReplay(gem::readout::GEMDataGenerator& generator, uint64_t const& nEvents) :
+  gem::hw::glib::HwGLIB(),
+  fileName_("generator"),
+  nEvents_(0),
+  rate_(0),
+  burst_(1),
+  fifoDepth_(0),
+  loops_(1),
+  startNs_(0)
+{
+  gemLogger_ = log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:GLIBReplay"));
+  setDeviceID("GLIBReplay");
+  load(generator, nEvents);
+  start();
+}
+
+gem::readout::GLIBReplay::~GLIBReplay()
+{
+}
+
+void gem::readout::GLIBReplay::load(std::string const& fileName)
+{
+  gem::readout::RawFileMap file(fileName);
+  if (!file.isOpen()) {
+    ERROR("Unable to open the replay file " << fileName);
+    return;
+  }
+
+  // a chamber goes to the link it was read out from, the events of the file are numbered in order
+  uint64_t event = 0;
+  bool first = true;
+  for (gem::readout::RawFileMap::iterator geb = file.begin(); geb != file.end(); ++geb) {
+    if (first || geb->event() != event) {
+      if (!first)
+        endEvent();
+      event = geb->event();
+      first = false;
+    }
+    uint8_t link = GEB::ChamID::get(geb->header());
+    if (link >= MAX_LINKS) {
+      WARN("Chamber " << (int)link << " of event " << event << " is not on a GLIB link, skipped");
+      continue;
+    }
+    gem::readout::VFATData vfat;
+    for (gem::readout::GEBView::const_iterator block = geb->begin(); block != geb->end(); ++block) {
+      block->get(vfat);
+      addBlock(link, vfat);
+    }
+  }
+  if (!first)
+    endEvent();
+  nEvents_ = links_[0].eventEnd.size();
+  loaded(fileName);
+}
+
+void gem::readout::GLIBReplay::load(gem::readout::GEMDataGenerator& generator, uint64_t const& nEvents)
+{
+  gem::readout::GEMData gem;
+  for (uint64_t event = 0; event < nEvents; ++event) {
+    generator.next(gem);
+    for (std::vector<GEBData>::const_iterator geb = gem.gebs.begin(); geb != gem.gebs.end(); ++geb) {
+      uint8_t link = GEB::ChamID::get(geb->header);
+      for (GEBData::VFATs::const_iterator vfat = geb->vfats.begin(); vfat != geb->vfats.end(); ++vfat)
+        addBlock(link, *vfat);
+    }
+    endEvent();
+  }
+  nEvents_ = nEvents;
+  loaded(fileName_);
+}
+
+void gem::readout::GLIBReplay::addBlock(uint8_t const& link, gem::readout::VFATData const& vfat)
+{
+  std::vector<uint32_t>& words = links_[link].words;
+  size_t at = words.size();
+  words.resize(at + TRACKING_BLOCK_WORDS);
+  gem::readout::encodeTrackingBlock(vfat, &words[at]);
+  // the trigger data is not recorded, the BX of the OptoHybrid stands in for it, without S-bits
+  words[at + TRACKING_BLOCK_WORDS - 1] = TRK::TrigBX::pack(vfat.BXfrOH);
+}
+
+void gem::readout::GLIBReplay::endEvent()
+{
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    links_[link].eventEnd.push_back(links_[link].words.size()/TRACKING_BLOCK_WORDS);
+}
+
+void gem::readout::GLIBReplay::loaded(std::string const& source)
+{
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    if (!links_[link].words.empty())
+      INFO("Replaying " << links_[link].words.size()/TRACKING_BLOCK_WORDS << " VFAT blocks on link "
+           << (int)link << " from " << source);
+  INFO("Replaying " << nEvents_ << " events from " << source);
+}
+
+void gem::readout::GLIBReplay::start()
+{
+  for (uint8_t link = 0; link < MAX_LINKS; ++link) {
+    links_[link].fifo.clear();
+    links_[link].emitted     = 0;
+    links_[link].read        = 0;
+    links_[link].lost        = 0;
+    links_[link].triggerWord = 0;
+  }
+  startNs_ = nowNs();
+}
+
+bool gem::readout::GLIBReplay::isDone()
+{
+  if (!loops_ || eventsDue() < nEvents_*loops_)
+    return false;
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    if (links_[link].read + links_[link].lost < linkBlocks(links_[link], nEvents_*loops_))
+      return false;
+  return true;
+}
+
+uint8_t gem::readout::GLIBReplay::getLinkMask() const
+{
+  uint8_t mask = 0;
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    if (!links_[link].words.empty())
+      mask |= (1 << link);
+  return mask;
+}
+
+uint64_t gem::readout::GLIBReplay::getEventsEmitted()
+{
+  return eventsDue();
+}
+
+uint64_t gem::readout::GLIBReplay::getBlocksRead(uint8_t const& link) const
+{
+  return (link < MAX_LINKS) ? links_[link].read.load() : 0;
+}
+
+uint64_t gem::readout::GLIBReplay::getBlocksLost(uint8_t const& link) const
+{
+  return (link < MAX_LINKS) ? links_[link].lost.load() : 0;
+}
+
+uint64_t gem::readout::GLIBReplay::getBlocksRead() const
+{
+  uint64_t blocks = 0;
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    blocks += links_[link].read;
+  return blocks;
+}
+
+uint64_t gem::readout::GLIBReplay::getBlocksLost() const
+{
+  uint64_t blocks = 0;
+  for (uint8_t link = 0; link < MAX_LINKS; ++link)
+    blocks += links_[link].lost;
+  return blocks;
+}
+
+uint64_t gem::readout::GLIBReplay::eventsDue()
+{
+  uint64_t total = loops_ ? nEvents_*loops_ : std::numeric_limits<uint64_t>::max();
+  if (!nEvents_ || rate_ <= 0)
+    return nEvents_ ? total : 0;
+
+  // bursts of burst_ events every burst_/rate_ seconds, the first one at start()
+  double bursts = (nowNs() - startNs_)*1e-9*rate_/burst_;
+  double due    = (static_cast<uint64_t>(bursts) + 1.)*burst_;
+  return (due >= static_cast<double>(total)) ? total : static_cast<uint64_t>(due);
+}
+
+uint64_t gem::readout::GLIBReplay::linkBlocks(Link const& link, uint64_t const& nEvents) const
+{
+  if (!nEvents)
+    return 0;
+  uint64_t passes = (nEvents - 1)/nEvents_;
+  uint64_t blocksPerPass = link.words.size()/TRACKING_BLOCK_WORDS;
+  if (passes > std::numeric_limits<uint64_t>::max()/(blocksPerPass + 1))
+    return std::numeric_limits<uint64_t>::max();
+  return passes*blocksPerPass + link.eventEnd[(nEvents - 1) % nEvents_];
+}
+
+uint64_t gem::readout::GLIBReplay::update(uint8_t const& link)
+{
+  Link& l = links_[link];
+  uint64_t occupancy = 0;
+  for (std::deque<BlockRange>::const_iterator range = l.fifo.begin(); range != l.fifo.end(); ++range)
+    occupancy += range->second - range->first;
+  if (l.words.empty())
+    return occupancy;
+
+  uint64_t emitted = linkBlocks(l, eventsDue());
+  if (emitted <= l.emitted)
+    return occupancy;
+
+  // what does not fit in the FIFO is lost, the blocks after it go in again once there is room
+  uint64_t accepted = emitted - l.emitted;
+  if (fifoDepth_) {
+    uint64_t room = (occupancy < fifoDepth_) ? fifoDepth_ - occupancy : 0;
+    if (accepted > room) {
+      l.lost  += accepted - room;
+      accepted = room;
+    }
+  }
+  if (accepted) {
+    if (!l.fifo.empty() && l.fifo.back().second == l.emitted)
+      l.fifo.back().second += accepted;
+    else
+      l.fifo.push_back(BlockRange(l.emitted, l.emitted + accepted));
+    occupancy += accepted;
+  }
+  l.emitted = emitted;
+  return occupancy;
+}
+
+uint32_t gem::readout::GLIBReplay::readTriggerFIFO(uint8_t const& link)
+{
+  return (link < MAX_LINKS) ? links_[link].triggerWord : 0;
+}
+
+void gem::readout::GLIBReplay::flushTriggerFIFO(uint8_t const& link)
+{
+}
+
+uint32_t gem::readout::GLIBReplay::getFIFOOccupancy(uint8_t const& link)
+{
+  if (link >= MAX_LINKS)
+    return 0;
+  uint64_t occupancy = update(link);
+  return (occupancy > std::numeric_limits<uint32_t>::max()) ? std::numeric_limits<uint32_t>::max() : occupancy;
+}
+
+bool gem::readout::GLIBReplay::hasTrackingData(uint8_t const& link)
+{
+  return getFIFOOccupancy(link) != 0;
+}
+
+void gem::readout::GLIBReplay::getTrackingData(uint8_t const& link, std::vector<uint32_t>& data)
+{
+  if (drainTrackingFIFO(link, 1, data))
+    data.resize(TRACKING_BLOCK_WORDS - 1);
+  else
+    data.assign(TRACKING_BLOCK_WORDS - 1, 0x0);
+}
+
+uint32_t gem::readout::GLIBReplay::drainTrackingFIFO(uint8_t const& link, uint32_t const& maxBlocks,
+                                                     uint32_t* data)
+{
+  if (link >= MAX_LINKS || !update(link))
+    return 0;
+
+  Link& l = links_[link];
+  uint64_t blocksPerPass = l.words.size()/TRACKING_BLOCK_WORDS;
+  uint32_t nBlocks = 0;
+  while (nBlocks < maxBlocks && !l.fifo.empty()) {
+    BlockRange& range = l.fifo.front();
+    // copy up to the end of the range, the end of the request or the end of the pass
+    uint64_t position = range.first % blocksPerPass;
+    uint64_t n = range.second - range.first;
+    if (n > maxBlocks - nBlocks)
+      n = maxBlocks - nBlocks;
+    if (n > blocksPerPass - position)
+      n = blocksPerPass - position;
+    std::vector<uint32_t>::const_iterator first = l.words.begin() + position*TRACKING_BLOCK_WORDS;
+    std::copy(first, first + n*TRACKING_BLOCK_WORDS, data + nBlocks*TRACKING_BLOCK_WORDS);
+    nBlocks     += n;
+    range.first += n;
+    if (range.first == range.second)
+      l.fifo.pop_front();
+  }
+  l.read += nBlocks;
+  if (nBlocks)
+    l.triggerWord = data[nBlocks*TRACKING_BLOCK_WORDS - 1];
+  return nBlocks;
+}
+
+void gem::readout::GLIBReplay::flushFIFO(uint8_t const& link)
+{
+  if (link >= MAX_LINKS)
+    return;
+  uint64_t occupancy = update(link);
+  links_[link].fifo.clear();
+  links_[link].lost += occupancy;
+}
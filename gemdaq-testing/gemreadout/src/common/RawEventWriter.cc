@@ -0,0 +1,309 @@
+#include "gem/readout/RawEventWriter.h"
+#include "gem/readout/GEMDataCompression.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+const size_t gem::readout::RawEventWriter::WRITE_ALIGNMENT;
+const size_t gem::readout::RawEventWriter::DEFAULT_BUFFER_SIZE;
+const size_t gem::readout::RawEventWriter::DEFAULT_CHUNK_SIZE;
+
+gem::readout::RawEventWriter::RawEventWriter(std::string const& fileName, size_t const& bufferSize) :
+  gemLogger_(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:RawEventWriter"))),
+  fileName_(fileName),
+  fd_(-1),
+  created_(false),
+  bufferSize_(bufferSize < WRITE_ALIGNMENT ? WRITE_ALIGNMENT : bufferSize),
+  used_(0),
+  bytesWritten_(0),
+  eventsWritten_(0),
+  writeErrors_(0),
+  preallocated_(0),
+  compressionLevel_(0),
+  chunkSize_(DEFAULT_CHUNK_SIZE),
+  chunkFirstEvent_(0),
+  bytesCompressed_(0),
+  compressionStalls_(0),
+  inFlight_(0),
+  nextSeq_(0),
+  nextWrite_(0),
+  writing_(false),
+  stopWorkers_(false)
+{
+  // leave room for one more event above the nominal size so that a flush is rarely followed by a resize
+  buffer_.resize(2*bufferSize_);
+  open();
+}
+
+gem::readout::RawEventWriter::~RawEventWriter()
+{
+  close();
+}
+
+bool gem::readout::RawEventWriter::open()
+{
+  if (fd_ >= 0)
+    return true;
+
+  // the run file framing assumes the file starts empty, an older file of the same name is
+  // replaced; reopening after close() continues the file written so far
+  int flags = O_WRONLY | O_CREAT | O_APPEND | (created_ ? 0 : O_TRUNC);
+  fd_ = ::open(fileName_.c_str(), flags, 0644);
+  if (fd_ < 0) {
+    ERROR("Unable to open output file " << fileName_ << ": " << strerror(errno));
+    return false;
+  }
+  created_ = true;
+  INFO("Opened output file " << fileName_);
+  return true;
+}
+
+void gem::readout::RawEventWriter::append(void const* data, size_t const& nBytes)
+{
+  if (used_ + nBytes > buffer_.size())
+    buffer_.resize(2*(used_ + nBytes));
+  std::memcpy(&buffer_[used_], data, nBytes);
+  used_ += nBytes;
+}
+
+void gem::readout::RawEventWriter::commitEvent()
+{
+  ++eventsWritten_;
+  if (compressionLevel_) {
+    if (used_ >= chunkSize_)
+      cutChunk();
+    return;
+  }
+  if (used_ < bufferSize_)
+    return;
+
+  // only full aligned blocks go out here, the tail stays for the next event
+  size_t aligned = used_ - (used_ % WRITE_ALIGNMENT);
+  writeOut(aligned);
+}
+
+void gem::readout::RawEventWriter::flush()
+{
+  if (compressionLevel_) {
+    if (used_)
+      cutChunk();
+    drainChunks();
+    return;
+  }
+  if (used_)
+    writeOut(used_);
+}
+
+void gem::readout::RawEventWriter::close()
+{
+  if (fd_ < 0)
+    return;
+
+  flush();
+  stopCompression();
+  releasePreallocation();
+  if (::close(fd_) != 0)
+    ERROR("Error closing output file " << fileName_ << ": " << strerror(errno));
+  INFO("Closed output file " << fileName_ << ", " << eventsWritten_ << " events, "
+       << bytesWritten_ << " bytes written");
+  if (bytesCompressed_)
+    INFO(bytesCompressed_ << " bytes of events compressed to " << bytesWritten_ << " bytes, "
+         << compressionStalls_ << " stalls waiting for the compression");
+  fd_ = -1;
+}
+
+bool gem::readout::RawEventWriter::preallocate(uint64_t const& nBytes)
+{
+  if (fd_ < 0 && !open())
+    return false;
+
+  // FALLOC_FL_KEEP_SIZE leaves the end of the file where it is, O_APPEND writes go on from there
+  if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, nBytes) != 0) {
+    WARN("Unable to preallocate " << nBytes << " bytes for " << fileName_ << ": " << strerror(errno));
+    return false;
+  }
+  if (nBytes > preallocated_)
+    preallocated_ = nBytes;
+  return true;
+}
+
+void gem::readout::RawEventWriter::releasePreallocation()
+{
+  uint64_t preallocated = preallocated_;
+  preallocated_ = 0;
+
+  struct stat st;
+  if (!preallocated || ::fstat(fd_, &st) != 0 || static_cast<uint64_t>(st.st_size) >= preallocated)
+    return;
+  // blocks allocated past the end of the file stay with it until it is truncated
+  if (::ftruncate(fd_, st.st_size) != 0)
+    WARN("Unable to release the space preallocated for " << fileName_ << ": " << strerror(errno));
+}
+
+void gem::readout::RawEventWriter::writeOut(size_t const& nBytes)
+{
+  bytesWritten_ += writeBytes(&buffer_[0], nBytes);
+
+  if (nBytes < used_)
+    std::memmove(&buffer_[0], &buffer_[nBytes], used_ - nBytes);
+  used_ -= nBytes;
+}
+
+size_t gem::readout::RawEventWriter::writeBytes(char const* data, size_t const& nBytes)
+{
+  if (fd_ < 0 && !open()) {
+    ++writeErrors_;
+    ERROR("Dropping " << nBytes << " bytes, output file " << fileName_ << " is not open");
+    return 0;
+  }
+
+  size_t done = 0;
+  while (done < nBytes) {
+    ssize_t res = ::write(fd_, data + done, nBytes - done);
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      ++writeErrors_;
+      ERROR("Error writing to output file " << fileName_ << ": " << strerror(errno)
+            << ", dropping " << (nBytes - done) << " bytes");
+      break;
+    }
+    done += res;
+  }
+  return done;
+}
+
+void gem::readout::RawEventWriter::setCompression(int const& level, unsigned const& nThreads, size_t const& chunkSize)
+{
+  // whatever was buffered so far goes out in the old format
+  flush();
+  stopCompression();
+
+  compressionLevel_ = (level < 0) ? 0 : ((level > 9) ? 9 : level);
+  if (!compressionLevel_) {
+    INFO("Writing " << fileName_ << " uncompressed");
+    return;
+  }
+
+  // a chunk of whole events may reach twice the chunk size, the readers reject larger frames
+  chunkSize_       = chunkSize ? std::min<size_t>(chunkSize, gem::readout::ZFrame::MAX_FRAME_SIZE/2) : DEFAULT_CHUNK_SIZE;
+  chunkFirstEvent_ = eventsWritten_;
+  if (buffer_.size() < 2*chunkSize_)
+    buffer_.resize(2*chunkSize_);
+
+  unsigned nWorkers = nThreads ? nThreads : 1;
+  for (unsigned i = 0; i < nWorkers; ++i)
+    workers_.push_back(std::thread(&gem::readout::RawEventWriter::compressLoop, this));
+  INFO("Compressing " << fileName_ << " with zlib level " << compressionLevel_ << ", "
+       << nWorkers << " threads, " << chunkSize_ << " byte chunks");
+}
+
+void gem::readout::RawEventWriter::cutChunk()
+{
+  std::shared_ptr<Chunk> chunk;
+  {
+    std::unique_lock<std::mutex> lock(chunkMutex_);
+    if (inFlight_ >= MAX_CHUNKS_PER_THREAD*workers_.size()) {
+      ++compressionStalls_;
+      while (inFlight_ >= MAX_CHUNKS_PER_THREAD*workers_.size())
+        chunkDone_.wait(lock);
+    }
+    if (spare_.empty()) {
+      chunk = std::shared_ptr<Chunk>(new Chunk());
+    } else {
+      chunk = spare_.back();
+      spare_.pop_back();
+    }
+  }
+
+  // the chunk takes the buffer, events go on in the buffer of a chunk already written
+  chunk->data.swap(buffer_);
+  if (buffer_.size() < 2*chunkSize_)
+    buffer_.resize(2*chunkSize_);
+  chunk->size       = used_;
+  chunk->firstEvent = chunkFirstEvent_;
+  chunk->nEvents    = eventsWritten_ - chunkFirstEvent_;
+  bytesCompressed_ += used_;
+  chunkFirstEvent_  = eventsWritten_;
+  used_ = 0;
+
+  std::lock_guard<std::mutex> lock(chunkMutex_);
+  chunk->seq = nextSeq_++;
+  ++inFlight_;
+  queue_.push_back(chunk);
+  chunkReady_.notify_one();
+}
+
+void gem::readout::RawEventWriter::drainChunks()
+{
+  std::unique_lock<std::mutex> lock(chunkMutex_);
+  while (inFlight_)
+    chunkDone_.wait(lock);
+}
+
+void gem::readout::RawEventWriter::compressLoop()
+{
+  std::unique_lock<std::mutex> lock(chunkMutex_);
+  for (;;) {
+    while (queue_.empty() && !stopWorkers_)
+      chunkReady_.wait(lock);
+    if (queue_.empty())
+      return;
+
+    std::shared_ptr<Chunk> chunk = queue_.front();
+    queue_.pop_front();
+
+    lock.unlock();
+    if (!gem::readout::ZFrame::compress(&chunk->data[0], chunk->size, chunk->firstEvent, chunk->nEvents,
+                                        compressionLevel_, chunk->frame))
+      WARN("Unable to compress events " << chunk->firstEvent << " to "
+           << (chunk->firstEvent + chunk->nEvents) << ", stored uncompressed");
+    lock.lock();
+
+    // frames go to disk in the order the chunks were cut, the worker that completes
+    // the sequence writes out everything that is ready
+    done_[chunk->seq] = chunk;
+    if (writing_)
+      continue;
+    writing_ = true;
+    std::map<uint64_t, std::shared_ptr<Chunk> >::iterator next;
+    while ((next = done_.find(nextWrite_)) != done_.end()) {
+      std::shared_ptr<Chunk> ready = next->second;
+      done_.erase(next);
+      lock.unlock();
+      size_t written = writeBytes(&ready->frame[0], ready->frame.size());
+      lock.lock();
+      bytesWritten_ += written;
+      ++nextWrite_;
+      --inFlight_;
+      spare_.push_back(ready);
+      chunkDone_.notify_all();
+    }
+    writing_ = false;
+  }
+}
+
+void gem::readout::RawEventWriter::stopCompression()
+{
+  if (workers_.empty())
+    return;
+
+  drainChunks();
+  {
+    std::lock_guard<std::mutex> lock(chunkMutex_);
+    stopWorkers_ = true;
+    chunkReady_.notify_all();
+  }
+  for (std::vector<std::thread>::iterator worker = workers_.begin(); worker != workers_.end(); ++worker)
+    worker->join();
+  workers_.clear();
+  spare_.clear();
+  stopWorkers_      = false;
+  compressionLevel_ = 0;
+}
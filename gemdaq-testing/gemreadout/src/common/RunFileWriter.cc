@@ -0,0 +1,120 @@
+#include "gem/readout/RunFileWriter.h"
+#include "gem/readout/RawEventWriter.h"
+
+#include <cstring>
+#include <time.h>
+
+gem::readout::RunFileWriter::RunFileWriter(std::shared_ptr<gem::readout::RawEventWriter> writer) :
+  gemLogger_(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:RunFileWriter"))),
+  writer_(writer),
+  headerWritten_(false),
+  closed_(false),
+  offset_(0),
+  nEvents_(0)
+{
+  std::memset(&header_, 0, sizeof(header_));
+  header_.magic      = RunFile::MAGIC;
+  header_.version    = RunFile::VERSION;
+  header_.headerSize = sizeof(header_);
+}
+
+gem::readout::RunFileWriter::~RunFileWriter()
+{
+  close();
+}
+
+void gem::readout::RunFileWriter::setRunNumber(uint32_t const& runNumber)
+{
+  if (headerWritten_) {
+    WARN("Run number " << runNumber << " set after the file header of " << writer_->getFileName()
+         << " was written, ignored");
+    return;
+  }
+  header_.runNumber = runNumber;
+}
+
+void gem::readout::RunFileWriter::setSegment(uint16_t const& segment, uint64_t const& firstEvent)
+{
+  if (headerWritten_) {
+    WARN("Segment " << segment << " set after the file header of " << writer_->getFileName()
+         << " was written, ignored");
+    return;
+  }
+  header_.segment    = segment;
+  header_.firstEvent = firstEvent;
+}
+
+void gem::readout::RunFileWriter::addBoard(uint16_t const& boardID)
+{
+  if (headerWritten_)
+    return;
+  for (uint16_t board = 0; board < header_.nBoards; ++board)
+    if (header_.boardIDs[board] == boardID)
+      return;
+  if (header_.nBoards >= RunFile::MAX_BOARDS) {
+    WARN("No room for board " << boardID << " in the file header, already " << header_.nBoards << " boards");
+    return;
+  }
+  header_.boardIDs[header_.nBoards++] = boardID;
+}
+
+void gem::readout::RunFileWriter::writeEvent(char const* payload, size_t const& nBytes)
+{
+  if (closed_) {
+    ERROR("Event " << nEvents_ << " written after " << writer_->getFileName() << " was closed, dropped");
+    return;
+  }
+  if (nBytes > RunFile::MAX_EVENT_SIZE) {
+    ERROR("Event " << nEvents_ << " of " << nBytes << " bytes is larger than the run file limit of "
+          << RunFile::MAX_EVENT_SIZE << ", dropped");
+    return;
+  }
+  if (!headerWritten_)
+    writeHeader();
+
+  // the reader resumes at a sync record after a corrupted record
+  if (nEvents_ % RunFile::SYNC_INTERVAL == 0) {
+    RunFile::SyncRecord sync = {RunFile::SYNC_MAGIC, nEvents_};
+    append(&sync, sizeof(sync));
+  }
+
+  RunFile::EventHeader header = {RunFile::EVENT_MARKER, static_cast<uint32_t>(nBytes), nEvents_};
+  offsets_.push_back(offset_);
+  append(&header, sizeof(header));
+  append(payload, nBytes);
+  ++nEvents_;
+  writer_->commitEvent();
+}
+
+void gem::readout::RunFileWriter::close()
+{
+  if (closed_)
+    return;
+  if (!headerWritten_)
+    writeHeader();
+
+  RunFile::IndexHeader index = {RunFile::INDEX_MAGIC, 0, nEvents_};
+  RunFile::FileTrailer trailer = {offset_, nEvents_, RunFile::TRAILER_MAGIC};
+  append(&index, sizeof(index));
+  if (!offsets_.empty())
+    append(&offsets_[0], offsets_.size()*sizeof(uint64_t));
+  append(&trailer, sizeof(trailer));
+  closed_ = true;
+
+  INFO("Closed run " << header_.runNumber << " file " << writer_->getFileName() << ", "
+       << nEvents_ << " events indexed");
+  std::vector<uint64_t>().swap(offsets_);
+}
+
+void gem::readout::RunFileWriter::writeHeader()
+{
+  header_.startTime = time(0);
+  append(&header_, sizeof(header_));
+  headerWritten_ = true;
+}
+
+void gem::readout::RunFileWriter::append(void const* data, size_t const& nBytes)
+{
+  writer_->append(data, nBytes);
+  offset_ += nBytes;
+}
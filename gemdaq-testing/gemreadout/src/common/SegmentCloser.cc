@@ -0,0 +1,93 @@
+#include "gem/readout/SegmentCloser.h"
+#include "gem/readout/RawEventWriter.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+gem::readout::SegmentCloser::SegmentCloser(std::string const& closedDir) :
+  gemLogger_(log4cplus::Logger::getInstance(LOG4CPLUS_TEXT("gem:readout:SegmentCloser"))),
+  closedDir_(closedDir.empty() ? std::string(".") : closedDir),
+  closing_(false),
+  stop_(false),
+  segmentsClosed_(0)
+{
+  if (::mkdir(closedDir_.c_str(), 0755) != 0 && errno != EEXIST)
+    ERROR("Unable to create the directory " << closedDir_ << " for the closed segments: " << strerror(errno));
+  thread_ = std::thread(&gem::readout::SegmentCloser::closeLoop, this);
+}
+
+gem::readout::SegmentCloser::~SegmentCloser()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+    ready_.notify_all();
+  }
+  thread_.join();
+}
+
+void gem::readout::SegmentCloser::hand(std::shared_ptr<gem::readout::RawEventWriter> writer)
+{
+  if (!writer)
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.push_back(writer);
+  ready_.notify_one();
+}
+
+void gem::readout::SegmentCloser::drain()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!queue_.empty() || closing_)
+    done_.wait(lock);
+}
+
+uint32_t gem::readout::SegmentCloser::getSegmentsClosed() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return segmentsClosed_;
+}
+
+void gem::readout::SegmentCloser::closeLoop()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    while (queue_.empty() && !stop_)
+      ready_.wait(lock);
+    // the segments still queued when stopping are closed all the same
+    if (queue_.empty())
+      return;
+
+    std::shared_ptr<gem::readout::RawEventWriter> writer = queue_.front();
+    queue_.pop_front();
+    closing_ = true;
+
+    lock.unlock();
+    closeSegment(*writer);
+    writer.reset();
+    lock.lock();
+
+    closing_ = false;
+    ++segmentsClosed_;
+    done_.notify_all();
+  }
+}
+
+void gem::readout::SegmentCloser::closeSegment(gem::readout::RawEventWriter& writer)
+{
+  writer.close();
+
+  std::string const& fileName = writer.getFileName();
+  std::string::size_type slash = fileName.rfind('/');
+  std::string closedName = closedDir_ + "/" + ((slash == std::string::npos) ? fileName : fileName.substr(slash + 1));
+  if (std::rename(fileName.c_str(), closedName.c_str()) != 0) {
+    ERROR("Unable to move the closed segment " << fileName << " to " << closedName << ": " << strerror(errno));
+    return;
+  }
+  INFO("Segment " << closedName << " closed, " << writer.getEventsWritten() << " events, "
+       << writer.getBytesWritten() << " bytes");
+}
@@ -4,6 +4,7 @@
 #include "xdaq/Application.h"
 #include "xdaq/WebApplication.h"
 
+#include "xdata/Boolean.h"
 #include "xdata/Float.h"
 #include "xdata/String.h"
 #include "xdata/Vector.h"
@@ -38,6 +39,9 @@
 #include "cgicc/HTMLClasses.h"
 
 #include <string>
+#include <vector>
+
+#include "gem/utils/SPSCRing.h"
 
 namespace gem {
   namespace hw {
@@ -54,6 +58,7 @@ namespace gem {
   }
   namespace readout {
     class GEMDataParker;
+    class GEMLinkReadout;
   }
 
   typedef std::shared_ptr<hw::vfat::HwVFAT2 > vfat_shared_ptr;
@@ -145,9 +150,13 @@ namespace gem {
          */
         bool runAction(toolbox::task::WorkLoop *wl);
         /**
-         *    Dump to disk all data available in GLIB data buffer
+         *    Readout thread: drain the GLIB data buffers into the readout ring
          */
         bool readAction(toolbox::task::WorkLoop *wl);
+        /**
+         *    Processing thread: decode the blocks in the readout ring and dump the events to disk
+         */
+        bool processAction(toolbox::task::WorkLoop *wl);
 
         // State transitions
         /**
@@ -172,6 +181,10 @@ namespace gem {
          *    Empty action for forbidden state transitions in FSM
          */
         void noAction(toolbox::Event::Reference e);
+        /**
+         *    Stop the readout and processing threads, processing the blocks left in the readout ring
+         */
+        void stopReadoutPipeline();
 
 	
         /**
@@ -195,16 +208,44 @@ namespace gem {
           xdata::UnsignedShort deviceChipID;
           xdata::UnsignedShort deviceVT1;
           xdata::UnsignedShort deviceVT2;
+
+          xdata::UnsignedInteger32 eventTimeout; // ms before an incomplete event is written
+          xdata::Boolean parallelReadout;        // one parser thread and output file per link
+          xdata::Boolean zeroSuppression;        // write the VFAT payloads zero suppressed
+          xdata::UnsignedInteger32 compressionLevel;   // zlib level of the output file, 0 for none
+          xdata::UnsignedInteger32 compressionThreads; // compression threads per output file
+          xdata::UnsignedInteger32 runNumber;          // written in the header of "Bin" run files
+          xdata::UnsignedInteger32 segmentSize;        // MB of events per output file segment, 0 for no limit
+          xdata::UnsignedInteger32 segmentEvents;      // events per segment, 0 for no limit
+          xdata::UnsignedInteger32 segmentSeconds;     // seconds per segment, 0 for no limit
+          xdata::String            closedDir;          // directory the complete segments are moved to
         };
 
       private:
+        /**
+         *    One drain of the tracking data FIFO of a link, passed from the readout to the processing thread
+         */
+        struct ReadoutSlot {
+          uint8_t  link;
+          uint32_t nBlocks;
+          std::vector<uint32_t> words;
+        };
+        static const size_t READOUT_RING_SLOTS = 1024;
 
         log4cplus::Logger gemLogger_;
 	
         toolbox::task::WorkLoop *wl_;
+        toolbox::task::WorkLoop *readout_wl_;
+        toolbox::task::WorkLoop *process_wl_;
 
         toolbox::BSem wl_semaphore_;
         toolbox::BSem hw_semaphore_;
+        // held by the readout and processing threads for one iteration, used to stop them
+        toolbox::BSem readout_semaphore_;
+        toolbox::BSem process_semaphore_;
+
+        gem::utils::SPSCRing<ReadoutSlot> readoutRing_;
+        bool is_reading_, is_processing_;
 
         toolbox::task::ActionSignature *configure_signature_;
         toolbox::task::ActionSignature *stop_signature_;
@@ -212,6 +253,7 @@ namespace gem {
         toolbox::task::ActionSignature *start_signature_;
         toolbox::task::ActionSignature *run_signature_;
         toolbox::task::ActionSignature *read_signature_;
+        toolbox::task::ActionSignature *process_signature_;
 
         toolbox::fsm::FiniteStateMachine fsm_;
 
@@ -230,6 +272,8 @@ namespace gem {
         std::vector<vfat_shared_ptr> vfatDevice_;
         //readout application should be running elsewhere, not tied to supervisor
         gem::readout::GEMDataParker* gemDataParker;
+        //one parser per link on its own workloop, used instead of gemDataParker in parallel readout mode
+        std::vector<std::shared_ptr<gem::readout::GEMLinkReadout> > linkReadout_;
 
         // Counter
         int counter_[3];
@@ -255,6 +299,11 @@ namespace gem {
         // BC0 counting
         uint32_t BC0Count_;
 
+        /**
+         *    Read all the T1 counters of the OptoHybrid in a single transaction, hw_semaphore_ held
+         */
+        void readT1Counters();
+
         void fireEvent(std::string name);
         void stateChanged(toolbox::fsm::FiniteStateMachine &fsm);
         void transitionFailed(toolbox::Event::Reference event);
@@ -1,16 +1,20 @@
 #include "gem/supervisor/GEMGLIBSupervisorWeb.h"
 #include "gem/readout/GEMDataParker.h"
+#include "gem/readout/GEMLinkReadout.h"
 #include "gem/hw/vfat/HwVFAT2.h"
+#include "gem/hw/vfat/VFAT2ChamberConfigurator.h"
 #include "gem/hw/glib/HwGLIB.h"
 #include "gem/hw/optohybrid/HwOptoHybrid.h"
 
 #include "gem/utils/GEMLogging.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <ctime>
 #include <sstream>
 #include <cstdlib>
+#include <unistd.h>
 #include <boost/lexical_cast.hpp>
 #include <boost/format.hpp>
 
@@ -33,6 +37,17 @@ void gem::supervisor::GEMGLIBSupervisorWeb::ConfigParams::registerFields(xdata::
   deviceVT1     = 0x0; 
   deviceVT2     = 0x0; 
 
+  eventTimeout  = 100U;
+  parallelReadout = false;
+  zeroSuppression = false;
+  compressionLevel   = 0U;
+  compressionThreads = 2U;
+  runNumber          = 0U;
+  segmentSize        = 0U;
+  segmentEvents      = 0U;
+  segmentSeconds     = 0U;
+  closedDir          = "closed";
+
   bag->addField("latency",       &latency );
   bag->addField("outputType",    &outputType  );
   bag->addField("outFileName",   &outFileName );
@@ -46,6 +61,17 @@ void gem::supervisor::GEMGLIBSupervisorWeb::ConfigParams::registerFields(xdata::
   bag->addField("deviceVT1",     &deviceVT1   );
   bag->addField("deviceVT2",     &deviceVT2   );
 
+  bag->addField("eventTimeout",  &eventTimeout );
+  bag->addField("parallelReadout", &parallelReadout );
+  bag->addField("zeroSuppression", &zeroSuppression );
+  bag->addField("compressionLevel",   &compressionLevel );
+  bag->addField("compressionThreads", &compressionThreads );
+  bag->addField("runNumber",          &runNumber );
+  bag->addField("segmentSize",        &segmentSize );
+  bag->addField("segmentEvents",      &segmentEvents );
+  bag->addField("segmentSeconds",     &segmentSeconds );
+  bag->addField("closedDir",          &closedDir );
+
 }
 
 // Main constructor
@@ -54,6 +80,11 @@ gem::supervisor::GEMGLIBSupervisorWeb::GEMGLIBSupervisorWeb(xdaq::ApplicationStu
   gemLogger_(this->getApplicationLogger()),
   wl_semaphore_(toolbox::BSem::FULL),
   hw_semaphore_(toolbox::BSem::FULL),
+  readout_semaphore_(toolbox::BSem::FULL),
+  process_semaphore_(toolbox::BSem::FULL),
+  readoutRing_(READOUT_RING_SLOTS),
+  is_reading_(false),
+  is_processing_(false),
   readout_mask(0x0),
   is_working_ (false),
   is_initialized_ (false),
@@ -89,6 +120,17 @@ gem::supervisor::GEMGLIBSupervisorWeb::GEMGLIBSupervisorWeb(xdaq::ApplicationStu
   wl_ = toolbox::task::getWorkLoopFactory()->getWorkLoop("GEMGLIBSupervisorWebWorkLoop", "waiting");
   wl_->activate();
 
+  // Readout and processing workloops, decoupled by the readout ring
+  readout_wl_ = toolbox::task::getWorkLoopFactory()->getWorkLoop("GEMGLIBSupervisorWebReadoutLoop", "waiting");
+  process_wl_ = toolbox::task::getWorkLoopFactory()->getWorkLoop("GEMGLIBSupervisorWebProcessLoop", "waiting");
+  readout_wl_->activate();
+  process_wl_->activate();
+
+  // preallocate the ring slots for the largest possible drain
+  for (size_t slot = 0; slot < readoutRing_.capacity(); ++slot)
+    readoutRing_.slot(slot).words.reserve(gem::readout::GEMDataParker::MAX_BLOCKS_PER_DRAIN*
+                                          gem::hw::glib::HwGLIB::TRACKING_BLOCK_WORDS);
+
   // Workloop bindings
   configure_signature_ = toolbox::task::bind(this, &gem::supervisor::GEMGLIBSupervisorWeb::configureAction, "configureAction");
   start_signature_     = toolbox::task::bind(this, &gem::supervisor::GEMGLIBSupervisorWeb::startAction,     "startAction"    );
@@ -96,6 +138,7 @@ gem::supervisor::GEMGLIBSupervisorWeb::GEMGLIBSupervisorWeb(xdaq::ApplicationStu
   halt_signature_      = toolbox::task::bind(this, &gem::supervisor::GEMGLIBSupervisorWeb::haltAction,      "haltAction"     );
   run_signature_       = toolbox::task::bind(this, &gem::supervisor::GEMGLIBSupervisorWeb::runAction,       "runAction"      );
   read_signature_      = toolbox::task::bind(this, &gem::supervisor::GEMGLIBSupervisorWeb::readAction,      "readAction"     );
+  process_signature_   = toolbox::task::bind(this, &gem::supervisor::GEMGLIBSupervisorWeb::processAction,   "processAction"  );
 
   // Define FSM states
   fsm_.addState('I', "Initial",    this, &gem::supervisor::GEMGLIBSupervisorWeb::stateChanged);
@@ -133,6 +176,7 @@ gem::supervisor::GEMGLIBSupervisorWeb::GEMGLIBSupervisorWeb(xdaq::ApplicationStu
   sumVFAT_ = 0;
   counter_ = {0,0,0};
 
+  gemDataParker = NULL;
 }
 
 void gem::supervisor::GEMGLIBSupervisorWeb::actionPerformed(xdata::Event& event)
@@ -241,6 +285,9 @@ void gem::supervisor::GEMGLIBSupervisorWeb::webDefault(xgi::Input * in, xgi::Out
   *out << "BC0 counter: "         << BC0Count_       << cgicc::br();
   *out << "VFAT blocks counter: " << (counter_[0]-1) << " dumped to disk"          << cgicc::br();
   *out << "VFATs counter: "       << counter_[2]     << " VFATs chips, last event" << cgicc::br();
+  *out << "Readout ring: "        << readoutRing_.occupancy() << "/" << readoutRing_.capacity() << " slots used, "
+       << readoutRing_.maxOccupancy() << " max, "
+       << readoutRing_.getFullCount() << " times full"                                 << cgicc::br();
   *out << "Output filename: "     << confParams_.bag.outFileName.toString()        << cgicc::br();
   *out << "Output type: "         << confParams_.bag.outputType.toString()         << cgicc::br();
 
@@ -408,10 +455,7 @@ void gem::supervisor::GEMGLIBSupervisorWeb::webTrigger(xgi::Input * in, xgi::Out
   optohybridDevice_->SendL1A(1);
 
   //counting "1" Internal triggers, one link enough 
-  L1ACount_[0] = optohybridDevice_->GetL1ACount(0); //external
-  L1ACount_[1] = optohybridDevice_->GetL1ACount(1); //internal
-  L1ACount_[2] = optohybridDevice_->GetL1ACount(2); //delayed
-  L1ACount_[3] = optohybridDevice_->GetL1ACount(3); //total
+  readT1Counters();
 
   hw_semaphore_.give();
 
@@ -425,9 +469,7 @@ void gem::supervisor::GEMGLIBSupervisorWeb::webL1ACalPulse(xgi::Input * in, xgi:
 
   INFO("webCalPulse: sending 1 CalPulse with 25 clock delayed L1A");
   optohybridDevice_->SendL1ACal(1, 25);
-  CalPulseCount_[0] = optohybridDevice_->GetCalPulseCount(0); //internal
-  CalPulseCount_[1] = optohybridDevice_->GetCalPulseCount(1); //delayed
-  CalPulseCount_[2] = optohybridDevice_->GetCalPulseCount(2); //total
+  readT1Counters();
   
   hw_semaphore_.give();
 
@@ -441,7 +483,7 @@ void gem::supervisor::GEMGLIBSupervisorWeb::webResync(xgi::Input * in, xgi::Outp
 
   INFO("webResync: sending Resync");
   optohybridDevice_->SendResync();
-  ResyncCount_ = optohybridDevice_->GetResyncCount();
+  readT1Counters();
 
   hw_semaphore_.give();
 
@@ -455,7 +497,7 @@ void gem::supervisor::GEMGLIBSupervisorWeb::webBC0(xgi::Input * in, xgi::Output
 
   INFO("webBC0: sending BC0");
   optohybridDevice_->SendBC0();
-  BC0Count_ = optohybridDevice_->GetBC0Count();
+  readT1Counters();
 
   hw_semaphore_.give();
 
@@ -507,6 +549,19 @@ bool gem::supervisor::GEMGLIBSupervisorWeb::haltAction(toolbox::task::WorkLoop *
 
 bool gem::supervisor::GEMGLIBSupervisorWeb::runAction(toolbox::task::WorkLoop *wl)
 {
+  // in parallel readout mode the links are read out by their own workloops, only collect the counters
+  if (!linkReadout_.empty()) {
+    int linkCounter[3];
+    counter_ = {0,0,0};
+    for (auto link = linkReadout_.begin(); link != linkReadout_.end(); ++link) {
+      (*link)->getCounters(linkCounter);
+      counter_[0] += linkCounter[0];
+      counter_[1] += linkCounter[1];
+      counter_[2] += linkCounter[2];
+    }
+    return false;
+  }
+
   wl_semaphore_.take();
   hw_semaphore_.take();
 
@@ -542,74 +597,82 @@ bool gem::supervisor::GEMGLIBSupervisorWeb::runAction(toolbox::task::WorkLoop *w
 
   INFO("Combined bufferDepth = " << std::hex << bufferDepth << std::dec);
 
-  // If GLIB data buffer has non-zero size, initiate read workloop
-  if (bufferDepth) {
-    wl_->submit(read_signature_);
-  }
+  // the readout and processing workloops run on their own, only report how far behind the processing is
+  INFO("Readout ring occupancy = " << readoutRing_.occupancy() << "/" << readoutRing_.capacity()
+       << ", max " << readoutRing_.maxOccupancy() << ", drains published " << readoutRing_.getPublished()
+       << ", claims with the ring full " << readoutRing_.getFullCount());
 
   return false;
 }
 
 bool gem::supervisor::GEMGLIBSupervisorWeb::readAction(toolbox::task::WorkLoop *wl)
 {
-  wl_semaphore_.take();
-  hw_semaphore_.take();
+  readout_semaphore_.take();
+  if (!is_reading_) {
+    readout_semaphore_.give();
+    return false;
+  }
 
-  //set up a counter for each column/link?
-  // should the counter increment each time read action is executed?
-  //also, only read out links for VFATs in the configuration
-  //if 0-7 in deviceNum
-  if (readout_mask&0x1) {
-    DEBUG("reading out link 0");
-    //std::shared_ptr<int> pLk0(gemDataParker->dumpDataToDisk(0x0));
-    int* pLk0 = gemDataParker->dumpDataToDisk(0x0);
-    if (pLk0) {
-      vfat_    = *pLk0;
-      event_   = *(pLk0+1);
-      sumVFAT_ = *(pLk0+2);
-      counter_[0] = vfat_;
-      counter_[1] = event_;
-      counter_[2] = sumVFAT_;
-      //delete pLk0;
+  // only drain the FIFOs here, decoding and writing is done by processAction
+  bool idle = true;
+  for (uint8_t link = 0; link < 3; ++link) {
+    if (!((readout_mask >> link) & 0x1))
+      continue;
+
+    ReadoutSlot* slot = readoutRing_.claim();
+    if (!slot) {
+      // processing is behind, leave the data in the GLIB FIFO until a slot is free
+      DEBUG("readAction:: readout ring full, " << readoutRing_.getFullCount() << " times so far");
+      break;
     }
-    //pLk0 = 0;
-  }
-  //if 8-15 in deviceNum
-  if (readout_mask&0x2) {
-    DEBUG("reading out link 1");
-    //std::shared_ptr<int> pLk1(gemDataParker->dumpDataToDisk(0x1));
-    int* pLk1 = gemDataParker->dumpDataToDisk(0x1);
-    if (pLk1) {
-      vfat_    = *pLk1;
-      event_   = *(pLk1+1);
-      sumVFAT_ = *(pLk1+2);
-      counter_[0] += vfat_;
-      counter_[1] += event_;
-      counter_[2] += sumVFAT_;
-      //delete pLk1;
+
+    hw_semaphore_.take();
+    slot->nBlocks = glibDevice_->drainTrackingFIFO(link, gem::readout::GEMDataParker::MAX_BLOCKS_PER_DRAIN, slot->words);
+    hw_semaphore_.give();
+
+    if (slot->nBlocks) {
+      slot->link = link;
+      readoutRing_.publish();
+      idle = false;
     }
-    //pLk1 = 0;
   }
-  //if 16-23 in deviceNum
-  if (readout_mask&0x4) {
-    DEBUG("reading out link 2");
-    //std::shared_ptr<int> pLk2(gemDataParker->dumpDataToDisk(0x2));
-    int* pLk2 = gemDataParker->dumpDataToDisk(0x2);
-    if (pLk2) {
-      vfat_    = *pLk2;
-      event_   = *(pLk2+1);
-      sumVFAT_ = *(pLk2+2);
-      counter_[0] += vfat_;
-      counter_[1] += event_;
-      counter_[2] += sumVFAT_;
-      //delete pLk2;
-    }
-    //pLk2 = 0;
+  readout_semaphore_.give();
+
+  // FIFOs empty (or ring full), do not hammer the GLIB
+  if (idle)
+    usleep(gem::readout::GEMLinkReadout::IDLE_SLEEP_US);
+
+  return true;
+}
+
+bool gem::supervisor::GEMGLIBSupervisorWeb::processAction(toolbox::task::WorkLoop *wl)
+{
+  process_semaphore_.take();
+  if (!is_processing_) {
+    process_semaphore_.give();
+    return false;
   }
-  hw_semaphore_.give();
-  wl_semaphore_.give();
 
-  return false;
+  // with no data, still let the parker write the events which timed out
+  ReadoutSlot* slot = readoutRing_.front();
+  int* pLk = slot ?
+    gemDataParker->processBlocks(slot->link, &slot->words[0], slot->nBlocks) :
+    gemDataParker->processBlocks(0x0, NULL, 0);
+  if (slot)
+    readoutRing_.release();
+
+  vfat_    = *pLk;
+  event_   = *(pLk+1);
+  sumVFAT_ = *(pLk+2);
+  counter_[0] = vfat_;
+  counter_[1] = event_;
+  counter_[2] = sumVFAT_;
+  process_semaphore_.give();
+
+  if (!slot)
+    usleep(gem::readout::GEMLinkReadout::IDLE_SLEEP_US);
+
+  return true;
 }
 
 // State transitions
@@ -633,6 +696,8 @@ void gem::supervisor::GEMGLIBSupervisorWeb::configureAction(toolbox::Event::Refe
 
   /**Definitely need to rework this J.S July 16*/
   //change to vector loop J.S. July 16
+  // position on the GEB of each chip used, VFATn is slot n, read out by link n/8
+  std::vector<uint8_t> vfatSlot;
   for (int i = 0; i < 24; ++i) {
     std::string VfatName = confParams_.bag.deviceName[i].toString();
     //for (auto chip = confParams_.bag.deviceName.begin(); chip != confParams_.bag.deviceName.end(); ++chip) {
@@ -643,34 +708,44 @@ void gem::supervisor::GEMGLIBSupervisorWeb::configureAction(toolbox::Event::Refe
     vfat_shared_ptr tmpVFATDevice(new gem::hw::vfat::HwVFAT2(tmpChipName.str()));
     tmpVFATDevice->setDeviceIPAddress(confParams_.bag.deviceIP);
     tmpVFATDevice->connectDevice();
-    tmpVFATDevice->setRunMode(0);
-    // need to put all chips in sleep mode to start off
-    if (VfatName != "")
+    // the chips are only configured through these objects, the setters need no read back
+    tmpVFATDevice->setShadowEnabled(true);
+    // need to put all chips in sleep mode to start off, the configuration of the used ones does it
+    if (VfatName != "") {
       // Define device
       vfatDevice_.push_back(tmpVFATDevice);
+      vfatSlot.push_back(i);
+    } else
+      tmpVFATDevice->setRunMode(0);
   }
   
-  for (auto chip = vfatDevice_.begin(); chip != vfatDevice_.end(); ++chip) {
-    (*chip)->setDeviceIPAddress(confParams_.bag.deviceIP);
-    
-    (*chip)->connectDevice();
-    (*chip)->readVFAT2Counters();
-    (*chip)->setRunMode(0);
-    confParams_.bag.deviceChipID = (*chip)->getChipID();
-    
-    latency_   = confParams_.bag.latency;
-    
-    // Set VFAT2 registers
-    (*chip)->loadDefaults();
-    (*chip)->setLatency(latency_);
-    
-    (*chip)->setVThreshold1(50);
-    confParams_.bag.deviceVT1 = (*chip)->getVThreshold1();
-
-    (*chip)->setVThreshold2(0);
-    confParams_.bag.deviceVT2 = (*chip)->getVThreshold2();
-    confParams_.bag.latency = (*chip)->getLatency();
-    
+  latency_   = confParams_.bag.latency;
+
+  std::vector<std::pair<uint8_t, uint16_t> > chipSlots;
+
+  // Set VFAT2 registers of all the chips together, the defaults with the run settings
+  if (!vfatDevice_.empty()) {
+    gem::hw::vfat::VFAT2ChamberConfigurator chamber(vfatDevice_);
+    chamber.setCommonSettings(vfatDevice_.front()->getDefaultSettings());
+
+    vfat_reg_pair_list runSettings;
+    runSettings.push_back(std::make_pair("Latency",     static_cast<uint8_t>(latency_)));
+    runSettings.push_back(std::make_pair("VThreshold1", 50));
+    runSettings.push_back(std::make_pair("VThreshold2",  0));
+    for (size_t chip = 0; chip < vfatDevice_.size(); ++chip)
+      chamber.setChipSettings(chip, runSettings);
+    chamber.configure();
+
+    // the chip map of the readout, from the chip IDs read while configuring
+    for (size_t chip = 0; chip < vfatDevice_.size(); ++chip)
+      if (chamber.isConnected(chip))
+        chipSlots.push_back(std::make_pair(vfatSlot[chip], vfatDevice_[chip]->getVFAT2Params().chipID));
+
+    vfat_shared_ptr chip = vfatDevice_.back();
+    confParams_.bag.deviceChipID = chip->getVFAT2Params().chipID;
+    confParams_.bag.deviceVT1    = chip->getVThreshold1();
+    confParams_.bag.deviceVT2    = chip->getVThreshold2();
+    confParams_.bag.latency      = chip->getLatency();
   }
 
   // Create a new output file
@@ -685,12 +760,51 @@ void gem::supervisor::GEMGLIBSupervisorWeb::configureAction(toolbox::Event::Refe
   std::replace(tmpFileName.begin(), tmpFileName.end(), ':', '-');
 
   confParams_.bag.outFileName = tmpFileName;
-  std::ofstream outf(tmpFileName.c_str(), std::ios_base::app | std::ios::binary );
+
+  // a run written in segments goes to <name>_NNNN.dat files instead, created as the events come
+  uint64_t segmentBytes = static_cast<uint64_t>(confParams_.bag.segmentSize)*1024*1024;
+  bool segmented = segmentBytes || confParams_.bag.segmentEvents || confParams_.bag.segmentSeconds;
+  std::ofstream outf;
+  if (!segmented)
+    outf.open(tmpFileName.c_str(), std::ios_base::app | std::ios::binary );
 
   tmpType = confParams_.bag.outputType.toString();
 
-  // Book GEM Data Parker
-  gemDataParker = new gem::readout::GEMDataParker(*glibDevice_, tmpFileName, tmpType);
+  // Book GEM Data Parker, or one per link each writing its own file
+  delete gemDataParker;
+  gemDataParker = NULL;
+  linkReadout_.clear();
+  if (confParams_.bag.parallelReadout) {
+    linkReadout_.clear();
+    for (uint8_t link = 0; link < 3; ++link) {
+      if (!((readout_mask >> link) & 0x1))
+        continue;
+      std::stringstream linkFileName, loopName;
+      linkFileName << tmpFileName.substr(0, tmpFileName.rfind(".dat")) << "_link" << (int)link << ".dat";
+      loopName << "GEMGLIBSupervisorWebReadoutLink" << (int)link;
+      linkReadout_.push_back(std::shared_ptr<gem::readout::GEMLinkReadout>(
+        new gem::readout::GEMLinkReadout(*glibDevice_, link, loopName.str(), linkFileName.str(),
+                                         tmpType, confParams_.bag.eventTimeout)));
+      for (auto chip = chipSlots.begin(); chip != chipSlots.end(); ++chip)
+        if (chip->first/8 == link)
+          linkReadout_.back()->setChipSlot(chip->first, chip->second);
+      linkReadout_.back()->setZeroSuppression(confParams_.bag.zeroSuppression);
+      linkReadout_.back()->setCompression(confParams_.bag.compressionLevel, confParams_.bag.compressionThreads);
+      linkReadout_.back()->setRunNumber(confParams_.bag.runNumber);
+      linkReadout_.back()->setSegmentation(segmentBytes, confParams_.bag.segmentEvents,
+                                           confParams_.bag.segmentSeconds, confParams_.bag.closedDir.toString());
+    }
+  } else {
+    gemDataParker = new gem::readout::GEMDataParker(*glibDevice_, tmpFileName, tmpType,
+                                                    readout_mask, confParams_.bag.eventTimeout);
+    for (auto chip = chipSlots.begin(); chip != chipSlots.end(); ++chip)
+      gemDataParker->setChipSlot(chip->first/8, chip->first, chip->second);
+    gemDataParker->setZeroSuppression(confParams_.bag.zeroSuppression);
+    gemDataParker->setCompression(confParams_.bag.compressionLevel, confParams_.bag.compressionThreads);
+    gemDataParker->setRunNumber(confParams_.bag.runNumber);
+    gemDataParker->setSegmentation(segmentBytes, confParams_.bag.segmentEvents,
+                                   confParams_.bag.segmentSeconds, confParams_.bag.closedDir.toString());
+  }
 
   // scanStream.close();
   outf.close();
@@ -754,11 +868,12 @@ void gem::supervisor::GEMGLIBSupervisorWeb::startAction(toolbox::Event::Referenc
   for (auto chip = vfatDevice_.begin(); chip != vfatDevice_.end(); ++chip) (*chip)->setRunMode(1);
 
   //flush FIFO
+  std::vector<uint32_t> dumping;
   for (int i = 0; i < 2; ++i)
     if (readout_mask >> i) {
       glibDevice_->flushFIFO(i);
       while (glibDevice_->hasTrackingData(i))
-        std::vector<uint32_t> dumping = glibDevice_->getTrackingData(i);
+        glibDevice_->getTrackingData(i, dumping);
       glibDevice_->flushFIFO(i);
     }
 
@@ -766,33 +881,39 @@ void gem::supervisor::GEMGLIBSupervisorWeb::startAction(toolbox::Event::Referenc
   optohybridDevice_->SendResync();
 
   //reset counters
-  optohybridDevice_->ResetL1ACount(0x4);
-  L1ACount_[0] = optohybridDevice_->GetL1ACount(0); //external
-  L1ACount_[1] = optohybridDevice_->GetL1ACount(1); //internal
-  L1ACount_[2] = optohybridDevice_->GetL1ACount(2); //delayed
-  L1ACount_[3] = optohybridDevice_->GetL1ACount(3); //total
+  optohybridDevice_->ResetT1Counters();
+  readT1Counters();
 
-  optohybridDevice_->ResetResyncCount();
-  ResyncCount_ = optohybridDevice_->GetResyncCount();
+  hw_semaphore_.give();
 
-  optohybridDevice_->ResetBC0Count();
-  BC0Count_ = optohybridDevice_->GetBC0Count();
+  for (auto link = linkReadout_.begin(); link != linkReadout_.end(); ++link)
+    (*link)->start();
 
-  optohybridDevice_->ResetCalPulseCount(0x3);
-  CalPulseCount_[0] = optohybridDevice_->GetCalPulseCount(0); //internal
-  CalPulseCount_[1] = optohybridDevice_->GetCalPulseCount(1); //delayed
-  CalPulseCount_[2] = optohybridDevice_->GetCalPulseCount(2); //total
+  // start the readout pipeline
+  if (gemDataParker) {
+    is_processing_ = true;
+    is_reading_    = true;
+    process_wl_->submit(process_signature_);
+    readout_wl_->submit(read_signature_);
+  }
 
-  hw_semaphore_.give();
   is_working_ = false;
 }
 
 void gem::supervisor::GEMGLIBSupervisorWeb::stopAction(toolbox::Event::Reference evt) {
   is_running_ = false;
+
+  // make sure everything read out so far is on disk
+  stopReadoutPipeline();
+  if (gemDataParker)
+    gemDataParker->flush();
+  for (auto link = linkReadout_.begin(); link != linkReadout_.end(); ++link)
+    (*link)->stop();
 }
 
 void gem::supervisor::GEMGLIBSupervisorWeb::haltAction(toolbox::Event::Reference evt) {
   is_running_ = false;
+  stopReadoutPipeline();
 
   vfat_ = 0;
   event_ = 0;
@@ -813,11 +934,39 @@ void gem::supervisor::GEMGLIBSupervisorWeb::haltAction(toolbox::Event::Reference
 
   delete gemDataParker;
   gemDataParker = NULL;
+
+  // stops the link workloops and closes their files
+  linkReadout_.clear();
 }
 
 void gem::supervisor::GEMGLIBSupervisorWeb::noAction(toolbox::Event::Reference evt) {
 }
 
+void gem::supervisor::GEMGLIBSupervisorWeb::stopReadoutPipeline() {
+  // stop the readout thread first, then let the processing thread finish what is in the ring
+  readout_semaphore_.take();
+  is_reading_ = false;
+  readout_semaphore_.give();
+
+  process_semaphore_.take();
+  is_processing_ = false;
+  if (gemDataParker) {
+    for (ReadoutSlot* slot = readoutRing_.front(); slot; slot = readoutRing_.front()) {
+      gemDataParker->processBlocks(slot->link, &slot->words[0], slot->nBlocks);
+      readoutRing_.release();
+    }
+  }
+  process_semaphore_.give();
+}
+
+void gem::supervisor::GEMGLIBSupervisorWeb::readT1Counters() {
+  gem::hw::optohybrid::HwOptoHybrid::T1Counters counters = optohybridDevice_->GetT1Counters();
+  std::copy(counters.L1A,      counters.L1A+4,      L1ACount_);
+  std::copy(counters.CalPulse, counters.CalPulse+3, CalPulseCount_);
+  ResyncCount_ = counters.Resync;
+  BC0Count_    = counters.BC0;
+}
+
 void gem::supervisor::GEMGLIBSupervisorWeb::fireEvent(std::string name) {
   toolbox::Event::Reference event(new toolbox::Event(name, this));
   fsm_.fireEvent(event);
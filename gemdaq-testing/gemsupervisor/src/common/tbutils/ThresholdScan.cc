@@ -390,22 +390,15 @@ bool gem::supervisor::tbutils::ThresholdScan::readFIFO(toolbox::task::WorkLoop*
     // read trigger data
     vfatDevice_->setDeviceBaseNode("GLIB");
     TrigReg = vfatDevice_->readReg(vfatDevice_->getDeviceBaseNode(),"TRG_DATA.DATA");
-    bxNumTr = TrigReg >> 6;
-    sBit = TrigReg & 0x0000003F;
+    bxNumTr = gem::readout::TRK::TrigBX::get(TrigReg);
+    sBit    = gem::readout::TRK::SBit::get(TrigReg);
 
     //make sure we are aligned
 
     //if (!checkHeaders(data)) 
-    uint16_t b1010, b1100, b1110;
-    b1010 = ((data.at(5) & 0xF0000000)>>28);
-    b1100 = ((data.at(5) & 0x0000F000)>>12);
-    b1110 = ((data.at(4) & 0xF0000000)>>28);
-
     bxNum = data.at(6);
     
-    uint16_t bcn, evn, crc, chipid;
     uint64_t msData, lsData;
-    uint8_t  flags;
     double   delVT;
 
     if (isFirst)
@@ -414,37 +407,20 @@ bool gem::supervisor::tbutils::ThresholdScan::readFIFO(toolbox::task::WorkLoop*
     if (bxNum == bxExp)
       isFirst = false;
     
-    bxNum  = data.at(6);
-    bcn    = (0x0fff0000 & data.at(5)) >> 16;
-    evn    = (0x00000ff0 & data.at(5)) >> 4;
-    chipid = (0x0fff0000 & data.at(4)) >> 16;
-    flags  = (0x0000000f & data.at(5));
-    crc    = (0x0000ffff & data.at(0));
-
-    uint64_t data1  = ((0x0000ffff & data.at(4)) << 16) | ((0xffff0000 & data.at(3)) >> 16);
-    uint64_t data2  = ((0x0000ffff & data.at(3)) << 16) | ((0xffff0000 & data.at(2)) >> 16);
-    uint64_t data3  = ((0x0000ffff & data.at(2)) << 16) | ((0xffff0000 & data.at(1)) >> 16);
-    uint64_t data4  = ((0x0000ffff & data.at(1)) << 16) | ((0xffff0000 & data.at(0)) >> 16);
-
-    lsData = (data3 << 32) | (data4);
-    msData = (data1 << 32) | (data2);
+    // 1010 | bcn:12, 1100 | EC:8 | Flag:4 (zero?), 1110 | ChipID:12, lsData:64, msData:64, crc:16
+    gem::readout::decodeTrackingBlock(&data.at(0), vfat);
+    lsData = vfat.lsData;
+    msData = vfat.msData;
 
     delVT = (scanParams_.bag.deviceVT2-scanParams_.bag.deviceVT1);
 
-    vfat.BC     = ( b1010 << 12 ) | (bcn);                // 1010     | bcn:12
-    vfat.EC     = ( b1100 << 12 ) | (evn << 4) | (flags); // 1100     | EC:8      | Flag:4 (zero?)
-    vfat.ChipID = ( b1110 << 12 ) | (chipid);             // 1110     | ChipID:12
-    vfat.lsData = lsData;                                 // lsData:64
-    vfat.msData = msData;                                 // msData:64
-    vfat.crc    = crc;                                    // crc:16
-
     /*
       vfat.delVT = delVT;
       vfat.bxNum = (bxNum << 6) | sBit);
     */
     // keepEvent(tmpFileName, ievent, ev, ch);
 
-    if (!(((b1010 == 0xa) && (b1100==0xc) && (b1110==0xe)))){
+    if (!gem::readout::VFAT::controlBitsOK(vfat.BC, vfat.EC, vfat.ChipID)){
       // dump VFAT data
       gem::readout::printVFATdataBits(ievent, vfat);
       LOG4CPLUS_INFO(getApplicationLogger(),"VFAT headers do not match expectation");
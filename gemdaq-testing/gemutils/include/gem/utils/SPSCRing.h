@@ -0,0 +1,148 @@
+#ifndef gem_utils_SPSCRing_h
+#define gem_utils_SPSCRing_h
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace gem {
+  namespace utils {
+
+    /** Lock-free ring of preallocated slots between one producer and one consumer thread
+     * The producer claims the next free slot, fills it in place and publishes it, the consumer
+     * takes the oldest published slot and releases it when done, so no data is copied and nothing
+     * is allocated once the slots are set up.
+     * Only the producer may call claim()/publish() and only the consumer front()/release().
+     */
+    template <class T>
+      class SPSCRing
+      {
+      public:
+        /** SPSCRing constructor
+         * @param capacity number of slots, rounded up to a power of two
+         */
+        explicit SPSCRing(size_t const& capacity);
+
+        /** producer: get the next free slot
+         * @retval returns NULL if the ring is full, counted by getFullCount(); the caller keeps
+         * its data and may claim again later
+         */
+        T* claim();
+
+        /** producer: make the slot returned by claim() visible to the consumer
+         */
+        void publish();
+
+        /** consumer: get the oldest published slot
+         * @retval returns NULL if the ring is empty
+         */
+        T* front();
+
+        /** consumer: hand the slot returned by front() back to the producer
+         */
+        void release();
+
+        /** direct access to a slot, only to set up the slots before the threads are started
+         */
+        T& slot(size_t const& index) { return slots_[index & mask_]; };
+
+        size_t   capacity()     const { return slots_.size(); };
+        size_t   occupancy()    const;
+        size_t   maxOccupancy() const { return maxOccupancy_.load(std::memory_order_relaxed); };
+        uint64_t getPublished() const { return published_.load(std::memory_order_relaxed);    };
+        uint64_t getFullCount() const { return fullCount_.load(std::memory_order_relaxed);    };
+
+      private:
+        static size_t roundUp(size_t const& capacity);
+
+        std::vector<T> slots_;
+        size_t mask_;
+
+        // head_ is only written by the producer and tail_ by the consumer,
+        // keep them on separate cache lines
+        std::atomic<size_t> head_;
+        char pad0_[64 - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> tail_;
+        char pad1_[64 - sizeof(std::atomic<size_t>)];
+
+        std::atomic<size_t>   maxOccupancy_;
+        std::atomic<uint64_t> published_;
+        std::atomic<uint64_t> fullCount_; // claims that found the ring full
+
+        // Prevent copying.
+        SPSCRing(SPSCRing const&);
+        SPSCRing& operator=(SPSCRing const&);
+      };
+
+  } // namespace utils
+} // namespace gem
+
+template <class T>
+gem::utils::SPSCRing<T>::SPSCRing(size_t const& capacity) :
+  slots_(roundUp(capacity)),
+  mask_(slots_.size() - 1),
+  head_(0),
+  tail_(0),
+  maxOccupancy_(0),
+  published_(0),
+  fullCount_(0)
+{
+}
+
+template <class T>
+T* gem::utils::SPSCRing<T>::claim()
+{
+  size_t head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) >= slots_.size()) {
+    fullCount_.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+  }
+  return &slots_[head & mask_];
+}
+
+template <class T>
+void gem::utils::SPSCRing<T>::publish()
+{
+  size_t head = head_.load(std::memory_order_relaxed) + 1;
+  head_.store(head, std::memory_order_release);
+  published_.fetch_add(1, std::memory_order_relaxed);
+
+  size_t used = head - tail_.load(std::memory_order_relaxed);
+  if (used > maxOccupancy_.load(std::memory_order_relaxed))
+    maxOccupancy_.store(used, std::memory_order_relaxed);
+}
+
+template <class T>
+T* gem::utils::SPSCRing<T>::front()
+{
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  if (tail == head_.load(std::memory_order_acquire))
+    return NULL;
+  return &slots_[tail & mask_];
+}
+
+template <class T>
+void gem::utils::SPSCRing<T>::release()
+{
+  tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <class T>
+size_t gem::utils::SPSCRing<T>::occupancy() const
+{
+  // tail first, it can only move up to the head
+  size_t tail = tail_.load(std::memory_order_acquire);
+  return head_.load(std::memory_order_acquire) - tail;
+}
+
+template <class T>
+size_t gem::utils::SPSCRing<T>::roundUp(size_t const& capacity)
+{
+  size_t size = 1;
+  while (size < capacity)
+    size <<= 1;
+  return size;
+}
+
+#endif // gem_utils_SPSCRing_h